@@ -2,23 +2,38 @@
 """
 TCP full-duplex threaded streamer for FPGA
 - Send 320x180 BGR24 frames
-- Receive 1280x720 ABGR32 frames
-- Save first N frames as HEX (AABBGGRR per pixel)
-- Save all frames to binary (.bin)
+- Receive 1280x720 frames as BGR24: the board strips the IP's constant
+  alpha byte before TX (OUT_FMT), 25% less on the link
+- Save all frames to an indexed .vfc container (frame_file.py); the input
+  may be a .vfc too, geometry then comes from its header
+- After the run, write the first N frames as HEX (AABBGGRR per pixel, alpha
+  00 added back), converted from the container in parallel instead of
+  inside the RX loop
+- WIRE_FRAMED: per-frame header (seq, geometry, format, length, CRC32),
+  checked on receive for misframing, seq gaps and latency
+- Geometry and scale are sent to the board at connect (MSG_CONFIG)
 """
 
 import os
 import sys
 import socket
 import threading
+import time
 from pathlib import Path
-import numpy as np
+
+import frame_proto as fp
+import frame_file as ff
 
 # ---- Protocol ----
-IN_W, IN_H, IN_BPP = 320, 180, 3
+# Defaults; main() may replace them from the geometry prompt (set_geometry)
+DEFAULT_IN_W, DEFAULT_IN_H, DEFAULT_SCALE = 320, 180, 4
+
+IN_W, IN_H, IN_BPP = DEFAULT_IN_W, DEFAULT_IN_H, 3
 IN_FRAME_BYTES = IN_W * IN_H * IN_BPP
 
-OUT_W, OUT_H, OUT_BPP = 1280, 720, 4
+# PIXFMT_BGR24: asked of the board at connect; PIXFMT_ABGR32 for the IP's raw output
+OUT_FMT = fp.PIXFMT_BGR24
+OUT_W, OUT_H, OUT_BPP = IN_W * DEFAULT_SCALE, IN_H * DEFAULT_SCALE, 3
 OUT_FRAME_BYTES = OUT_W * OUT_H * OUT_BPP
 
 DEFAULT_CHUNK = 1460
@@ -28,6 +43,12 @@ DEFAULT_IP = "192.168.1.20"
 SAVE_HEX_N = 10
 SOCK_TIMEOUT_S = 15
 
+WIRE_FRAMED = True      # must match the firmware WIRE_FRAMED build option
+TX_CRC = True           # ask the firmware to verify each input frame
+
+# seq -> send time, filled by the sender, consumed by the receiver
+send_times = {}
+
 def human(n: int) -> str:
     units = ["B", "KB", "MB", "GB", "TB"]
     i, f = 0, float(n)
@@ -36,30 +57,43 @@ def human(n: int) -> str:
         i += 1
     return f"{f:.1f}{units[i]}"
 
-def save_txt_frame_hex_abgr(frame_bytes: bytes, frame_idx: int, save_dir: Path) -> Path:
-    abgr = np.frombuffer(frame_bytes, dtype=np.uint8).reshape((OUT_H, OUT_W, OUT_BPP))
-    out_path = save_dir / f"frame_{frame_idx:06d}.txt"
-    with open(out_path, "w") as f:
-        for y in range(OUT_H):
-            line = " ".join(
-                f"{abgr[y, x, 0]:02X}{abgr[y, x, 1]:02X}{abgr[y, x, 2]:02X}{abgr[y, x, 3]:02X}"
-                for x in range(OUT_W)
-            )
-            f.write(line + "\n")
-    return out_path
-
-def sender_thread(sock: socket.socket, f, num_frames: int, stop_event: threading.Event):
+def set_geometry(in_w: int, in_h: int, scale: int):
+    global IN_W, IN_H, IN_FRAME_BYTES, OUT_W, OUT_H, OUT_FMT, OUT_BPP, OUT_FRAME_BYTES
+    IN_W, IN_H = in_w, in_h
+    IN_FRAME_BYTES = IN_W * IN_H * IN_BPP
+    OUT_W, OUT_H = in_w * scale, in_h * scale
+    if not WIRE_FRAMED:
+        OUT_FMT = fp.PIXFMT_ABGR32      # boot default, no MSG_CONFIG to ask with
+    OUT_BPP = 3 if OUT_FMT == fp.PIXFMT_BGR24 else 4
+    OUT_FRAME_BYTES = OUT_W * OUT_H * OUT_BPP
+
+def parse_geometry(text: str):
+    """'WxH' or 'WxHxS' -> (w, h, scale); empty selects the defaults."""
+    if not text:
+        return DEFAULT_IN_W, DEFAULT_IN_H, DEFAULT_SCALE
+    parts = [int(v) for v in text.lower().split("x")]
+    if len(parts) == 2:
+        parts.append(DEFAULT_SCALE)
+    w, h, scale = parts
+    return w, h, scale
+
+def sender_thread(sock: socket.socket, read_frame, num_frames: int, stop_event: threading.Event):
     try:
         total_sent = 0
         for i in range(num_frames):
             if stop_event.is_set():
                 break
-            frame = f.read(IN_FRAME_BYTES)
+            frame = read_frame(i)
             if not frame or len(frame) < IN_FRAME_BYTES:
                 print(f"[TX] EOF or short read at frame {i}")
                 stop_event.set()
                 break
 
+            if WIRE_FRAMED:
+                hdr = fp.make_header(i, IN_W, IN_H, fp.PIXFMT_BGR24, IN_BPP, frame, TX_CRC)
+                send_times[i] = time.perf_counter()
+                sock.sendall(hdr)
+
             view = memoryview(frame)
             off = 0
             while off < IN_FRAME_BYTES:
@@ -83,42 +117,85 @@ def sender_thread(sock: socket.socket, f, num_frames: int, stop_event: threading
         print(f"[ERROR][TX] {e}")
         stop_event.set()
 
+def recv_exact(sock: socket.socket, n: int, stop_event: threading.Event):
+    buf = bytearray(n)
+    view = memoryview(buf)
+    got = 0
+    while got < n:
+        if stop_event.is_set():
+            return None
+        chunk = sock.recv(n - got)
+        if not chunk:
+            print(f"[ERROR][RX] Socket closed early: got {got} < {n}")
+            stop_event.set()
+            return None
+        view[got:got+len(chunk)] = chunk
+        got += len(chunk)
+    return buf
+
+def recv_frame_header(sock: socket.socket, stop_event: threading.Event):
+    raw = recv_exact(sock, fp.HDR_BYTES, stop_event)
+    if raw is None:
+        return None
+    hdr = fp.FrameHeader.unpack(bytes(raw))
+    if hdr.msg_type != fp.MSG_FRAME or hdr.length != OUT_FRAME_BYTES or \
+       (hdr.width, hdr.height, hdr.bpp) != (OUT_W, OUT_H, OUT_BPP):
+        raise fp.MisframedError(
+            f"unexpected header seq={hdr.seq} {hdr.width}x{hdr.height} "
+            f"bpp={hdr.bpp} len={hdr.length}")
+    return hdr
+
 def receiver_thread(sock: socket.socket, num_frames: int, out_dir: Path, stop_event: threading.Event):
     try:
         total_recv = 0
-        bin_path = out_dir / "output_frames.bin"
+        next_seq = 0
+        lat_ms = []
+        vfc_path = out_dir / "output_frames.vfc"
 
-        with open(bin_path, "wb") as fout:
+        with ff.VfcWriter(vfc_path, OUT_W, OUT_H, OUT_FMT, OUT_BPP, num_frames) as fout:
             for i in range(num_frames):
                 if stop_event.is_set():
                     break
 
-                buf = bytearray(OUT_FRAME_BYTES)
-                view = memoryview(buf)
-                got = 0
-                while got < OUT_FRAME_BYTES:
-                    if stop_event.is_set():
-                        break
-                    chunk = sock.recv(OUT_FRAME_BYTES - got)
-                    if not chunk:
-                        print(f"[ERROR][RX] Socket closed early: got {got} < {OUT_FRAME_BYTES}")
-                        stop_event.set()
+                hdr = None
+                if WIRE_FRAMED:
+                    hdr = recv_frame_header(sock, stop_event)
+                    if hdr is None:
                         return
-                    view[got:got+len(chunk)] = chunk
-                    got += len(chunk)
+
+                buf = recv_exact(sock, OUT_FRAME_BYTES, stop_event)
+                if buf is None:
+                    return
 
                 frame_out = bytes(buf)
-                total_recv += got
+                total_recv += OUT_FRAME_BYTES
                 fout.write(frame_out)
 
-                if i < SAVE_HEX_N:
-                    save_txt_frame_hex_abgr(frame_out, i, out_dir)
+                tag = ""
+                if hdr is not None:
+                    if hdr.seq != next_seq:
+                        print(f"[WARN][RX] seq gap: expected {next_seq}, got {hdr.seq}")
+                    next_seq = hdr.seq + 1
+                    if not fp.check_payload(hdr, frame_out):
+                        print(f"[ERROR][RX] CRC mismatch on seq {hdr.seq}")
+                    t0 = send_times.pop(hdr.seq, None)
+                    if t0 is not None:
+                        lat_ms.append((time.perf_counter() - t0) * 1000.0)
+                        tag = f" seq={hdr.seq} latency={lat_ms[-1]:.1f}ms"
 
-                print(f"[RX] frame {i+1}/{num_frames} total={human(total_recv)}")
+                print(f"[RX] frame {i+1}/{num_frames} total={human(total_recv)}{tag}")
+
+            if lat_ms:
+                lat_ms.sort()
+                print(f"[RX] latency ms: min={lat_ms[0]:.1f} "
+                      f"p50={lat_ms[len(lat_ms)//2]:.1f} max={lat_ms[-1]:.1f}")
 
     except socket.timeout:
         print("[ERROR][RX] recv timeout")
         stop_event.set()
+    except fp.MisframedError as e:
+        print(f"[ERROR][RX] Misframed stream: {e}")
+        stop_event.set()
     except Exception as e:
         print(f"[ERROR][RX] {e}")
         stop_event.set()
@@ -131,17 +208,35 @@ def main():
             print(f"[ERROR] File not found: {src}")
             return
 
+        reader = ff.VfcReader(src) if ff.is_vfc(src) else None
+        if reader is not None:
+            if (reader.hdr.pixfmt, reader.hdr.bpp) != (fp.PIXFMT_BGR24, IN_BPP):
+                print("[ERROR] Input frames must be BGR24.")
+                return
+            scale = input(f"Scale [{DEFAULT_SCALE}]: ").strip()
+            set_geometry(reader.hdr.width, reader.hdr.height, int(scale or DEFAULT_SCALE))
+        else:
+            geom = input(f"Input geometry WxH[xScale] [{DEFAULT_IN_W}x{DEFAULT_IN_H}x{DEFAULT_SCALE}]: ").strip()
+            set_geometry(*parse_geometry(geom))
+        if not WIRE_FRAMED and (IN_W, IN_H) != (DEFAULT_IN_W, DEFAULT_IN_H):
+            print("[ERROR] Geometry can only be changed on the framed protocol.")
+            return
+
         file_size = src.stat().st_size
-        if file_size == 0 or file_size % IN_FRAME_BYTES != 0:
+        if reader is not None:
+            num_frames = len(reader)
+        elif file_size == 0 or file_size % IN_FRAME_BYTES != 0:
             print("[ERROR] Invalid file size.")
             return
-
-        num_frames = file_size // IN_FRAME_BYTES
+        else:
+            num_frames = file_size // IN_FRAME_BYTES
         total_out = num_frames * OUT_FRAME_BYTES
         out_dir = src.parent / "recv_out"
         out_dir.mkdir(parents=True, exist_ok=True)
 
         print(f"[INFO] Input: {src} ({human(file_size)})")
+        out_name = "BGR24" if OUT_FMT == fp.PIXFMT_BGR24 else "ABGR32"
+        print(f"[INFO] Geometry: {IN_W}x{IN_H} BGR24 -> {OUT_W}x{OUT_H} {out_name}")
         print(f"[INFO] Frames: {num_frames}")
         print(f"[INFO] Expect RX: {human(total_out)}")
 
@@ -162,10 +257,18 @@ def main():
             sock.connect((DEFAULT_IP, DEFAULT_PORT))
             print("[INFO] Connected.")
 
+            if WIRE_FRAMED:
+                ack = fp.configure(sock, fp.FrameConfig.upscale(IN_W, IN_H, OUT_W // IN_W, OUT_FMT))
+                print(f"[INFO] Board config: {ack.in_w}x{ack.in_h} -> {ack.out_w}x{ack.out_h}")
+
             stop_event = threading.Event()
             try:
                 with open(src, "rb") as f:
-                    tx_thread = threading.Thread(target=sender_thread, args=(sock, f, num_frames, stop_event), daemon=True)
+                    if reader is not None:
+                        read_frame = lambda i: bytes(reader.frame(i))
+                    else:
+                        read_frame = lambda i: f.read(IN_FRAME_BYTES)
+                    tx_thread = threading.Thread(target=sender_thread, args=(sock, read_frame, num_frames, stop_event), daemon=True)
                     rx_thread = threading.Thread(target=receiver_thread, args=(sock, num_frames, out_dir, stop_event), daemon=True)
 
                     tx_thread.start()
@@ -176,8 +279,12 @@ def main():
             finally:
                 pass
 
+        out_path = out_dir / "output_frames.vfc"
         print("[SUCCESS] Stream finished.")
-        print(f"[INFO] Output binary: {out_dir / 'output_frames.bin'}")
+        print(f"[INFO] Output: {out_path}")
+        if SAVE_HEX_N:
+            n = ff.convert(out_path, "hex", out_dir, SAVE_HEX_N, abgr=True)
+            print(f"[INFO] Hex dumps: {n} frames in {out_dir}")
 
     except KeyboardInterrupt:
         print("\n[INFO] Interrupted.")
@@ -0,0 +1,317 @@
+#!/usr/bin/env python3
+"""
+.vfc indexed frame container (tools/frame_file.hpp)
+
+Header page (geometry, pixel format, frame count), then an index of
+(offset, length, crc32) per frame, then the frames, each starting on a
+4 KB boundary. Replaces the headerless .bin streams; keep HDR_FMT in sync
+with vfc_hdr_t.
+
+Conversions run here (or in tools/frame_convert) after a run instead of in
+the receive loop:
+  python frame_file.py hex   FILE.vfc OUTDIR [--first N] [-j N] [--abgr]
+  python frame_file.py bmp   FILE.vfc OUTDIR [--first N] [-j N]
+  python frame_file.py png   FILE.vfc OUTDIR [--first N] [-j N]
+  python frame_file.py check FILE.vfc
+  python frame_file.py pack  IN.bin WxHxBPP OUT.vfc
+"""
+
+import argparse
+import mmap
+import os
+import struct
+import sys
+import zlib
+from concurrent.futures import ProcessPoolExecutor
+from dataclasses import dataclass
+from pathlib import Path
+import numpy as np
+
+import frame_proto as fp
+
+VFC_MAGIC = 0x31434656          # "VFC1"
+VFC_VERSION = 1
+VFC_ALIGN = 4096
+VFC_FLAG_CRC = 0x0001
+
+HDR_FMT = "<IHHHHBBHIIIIQQQ"
+HDR_BYTES = struct.calcsize(HDR_FMT)
+assert HDR_BYTES == 56
+INDEX_FMT = "<QII"
+INDEX_BYTES = struct.calcsize(INDEX_FMT)
+assert INDEX_BYTES == 16
+
+HEX_FIRST_N = 10
+
+
+def align(n: int) -> int:
+    return (n + VFC_ALIGN - 1) & ~(VFC_ALIGN - 1)
+
+
+@dataclass
+class VfcHeader:
+    width: int
+    height: int
+    pixfmt: int
+    bpp: int
+    capacity: int
+    frames: int = 0
+    flags: int = VFC_FLAG_CRC
+
+    @property
+    def frame_bytes(self) -> int:
+        return self.width * self.height * self.bpp
+
+    @property
+    def frame_stride(self) -> int:
+        return align(self.frame_bytes)
+
+    @property
+    def index_off(self) -> int:
+        return VFC_ALIGN
+
+    @property
+    def data_off(self) -> int:
+        return self.index_off + align(self.capacity * INDEX_BYTES)
+
+    def pack(self) -> bytes:
+        return struct.pack(HDR_FMT, VFC_MAGIC, VFC_VERSION, HDR_BYTES,
+                           self.width, self.height, self.pixfmt, self.bpp,
+                           self.flags, self.frame_bytes, self.capacity,
+                           self.frames, 0, self.frame_stride,
+                           self.index_off, self.data_off)
+
+    @classmethod
+    def unpack(cls, raw) -> "VfcHeader":
+        (magic, version, _, width, height, pixfmt, bpp, flags, frame_bytes,
+         capacity, frames, _, stride, index_off, data_off) = struct.unpack_from(HDR_FMT, raw)
+        if magic != VFC_MAGIC or version != VFC_VERSION:
+            raise ValueError("not a .vfc file (or unsupported version)")
+        hdr = cls(width, height, pixfmt, bpp, capacity, frames, flags)
+        if (frame_bytes, stride, index_off, data_off) != \
+           (hdr.frame_bytes, hdr.frame_stride, hdr.index_off, hdr.data_off):
+            raise ValueError("corrupt .vfc header")
+        return hdr
+
+
+class VfcWriter:
+    """Appends frames; the header and index are final only after close()."""
+
+    def __init__(self, path, width: int, height: int, pixfmt: int, bpp: int, capacity: int):
+        self.path = Path(path)
+        self.hdr = VfcHeader(width, height, pixfmt, bpp, capacity)
+        self.index = []
+        self.f = open(self.path, "wb")
+        self._write_meta()
+        self.f.seek(self.hdr.data_off)
+
+    def _write_meta(self):
+        self.hdr.frames = len(self.index)
+        meta = bytearray(self.hdr.data_off)
+        meta[:HDR_BYTES] = self.hdr.pack()
+        for i, e in enumerate(self.index):
+            struct.pack_into(INDEX_FMT, meta, self.hdr.index_off + i * INDEX_BYTES, *e)
+        self.f.seek(0)
+        self.f.write(meta)
+
+    def write(self, frame):
+        if len(frame) != self.hdr.frame_bytes:
+            raise ValueError(f"frame is {len(frame)} bytes, expected {self.hdr.frame_bytes}")
+        if len(self.index) >= self.hdr.capacity:
+            raise ValueError(f"container full ({self.hdr.capacity} frames)")
+        off = self.hdr.data_off + len(self.index) * self.hdr.frame_stride
+        self.f.seek(off)
+        self.f.write(frame)
+        self.index.append((off, len(frame), fp.crc32(frame)))
+
+    def close(self):
+        if self.f.closed:
+            return
+        self.f.truncate(self.hdr.data_off + len(self.index) * self.hdr.frame_stride)
+        self._write_meta()
+        self.f.close()
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, *exc):
+        self.close()
+
+
+class VfcReader:
+    """Memory-mapped; frame(i) is a zero-copy view."""
+
+    def __init__(self, path):
+        self.path = Path(path)
+        with open(self.path, "rb") as f:
+            self.map = mmap.mmap(f.fileno(), 0, access=mmap.ACCESS_READ)
+        self.hdr = VfcHeader.unpack(self.map)
+        self.index = [struct.unpack_from(INDEX_FMT, self.map, self.hdr.index_off + i * INDEX_BYTES)
+                      for i in range(self.hdr.frames)]
+        for i, (off, length, _) in enumerate(self.index):
+            if length != self.hdr.frame_bytes or off + length > len(self.map):
+                raise ValueError(f"frame {i} lies outside the file")
+
+    def __len__(self) -> int:
+        return self.hdr.frames
+
+    def frame(self, i: int) -> memoryview:
+        off, length, _ = self.index[i]
+        return memoryview(self.map)[off:off + length]
+
+    def array(self, i: int) -> np.ndarray:
+        """(height, width, bpp) uint8 view of frame i."""
+        return np.frombuffer(self.frame(i), dtype=np.uint8).reshape(
+            (self.hdr.height, self.hdr.width, self.hdr.bpp))
+
+    def check(self, i: int) -> bool:
+        return fp.crc32(self.frame(i)) == self.index[i][2]
+
+    def close(self):
+        try:
+            self.map.close()
+        except BufferError:
+            pass                # views still alive; unmapped with the last one
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, *exc):
+        self.close()
+
+
+def is_vfc(path) -> bool:
+    with open(path, "rb") as f:
+        raw = f.read(4)
+    return len(raw) == 4 and struct.unpack("<I", raw)[0] == VFC_MAGIC
+
+
+# ---- Converters ----
+_HEX = np.frombuffer(b"".join(f"{v:02X}".encode() for v in range(256)), dtype=np.uint8).reshape(256, 2)
+
+
+def hex_text(arr: np.ndarray, abgr: bool = False) -> bytes:
+    """Every pixel's bytes in memory order (AABBGGRR for ABGR32), space
+    separated, one line per row - what save_txt_frame_hex_abgr() wrote.
+    abgr widens BGR24 frames to AABBGGRR with alpha 00."""
+    if abgr and arr.shape[2] == 3:
+        arr = np.concatenate([np.zeros(arr.shape[:2] + (1,), np.uint8), arr], axis=2)
+    h, w, bpp = arr.shape
+    out = np.empty((h, w, bpp * 2 + 1), dtype=np.uint8)
+    out[:, :, :-1] = _HEX[arr].reshape(h, w, bpp * 2)
+    out[:, :, -1] = ord(" ")
+    out[:, -1, -1] = ord("\n")
+    return out.tobytes()
+
+
+def _bgr(arr: np.ndarray, pixfmt: int) -> np.ndarray:
+    if pixfmt == fp.PIXFMT_ABGR32:
+        return arr[:, :, 1:4]
+    if pixfmt == fp.PIXFMT_BGR24:
+        return arr
+    raise ValueError("BMP/PNG need BGR24 or ABGR32 frames")
+
+
+def bmp_bytes(bgr: np.ndarray) -> bytes:
+    h, w, _ = bgr.shape
+    stride = (w * 3 + 3) & ~3
+    rows = np.zeros((h, stride), dtype=np.uint8)
+    rows[:, :w * 3] = bgr[::-1].reshape(h, w * 3)     # bottom-up
+    img = rows.tobytes()
+    hdr = struct.pack("<2sIHHIIiiHHIIiiII", b"BM", 54 + len(img), 0, 0, 54,
+                      40, w, h, 1, 24, 0, len(img), 0, 0, 0, 0)
+    return hdr + img
+
+
+def png_bytes(bgr: np.ndarray) -> bytes:
+    h, w, _ = bgr.shape
+    rows = np.zeros((h, 1 + w * 3), dtype=np.uint8)  # filter type 0
+    rows[:, 1:] = bgr[:, :, ::-1].reshape(h, w * 3)
+
+    def chunk(kind: bytes, data: bytes) -> bytes:
+        return struct.pack(">I", len(data)) + kind + data + \
+            struct.pack(">I", zlib.crc32(kind + data) & 0xFFFFFFFF)
+
+    return (b"\x89PNG\r\n\x1a\n" +
+            chunk(b"IHDR", struct.pack(">IIBBBBB", w, h, 8, 2, 0, 0, 0)) +
+            chunk(b"IDAT", zlib.compress(rows.tobytes(), 1)) +
+            chunk(b"IEND", b""))
+
+
+def _convert_range(path: str, kind: str, out_dir: str, frames, abgr: bool):
+    with VfcReader(path) as r:
+        for i in frames:
+            arr = r.array(i)
+            if kind == "hex":
+                data, ext = hex_text(arr, abgr), "txt"
+            elif kind == "bmp":
+                data, ext = bmp_bytes(_bgr(arr, r.hdr.pixfmt)), "bmp"
+            else:
+                data, ext = png_bytes(_bgr(arr, r.hdr.pixfmt)), "png"
+            (Path(out_dir) / f"frame_{i:06d}.{ext}").write_bytes(data)
+    return len(frames)
+
+
+def convert(path, kind: str, out_dir, first: int = 0, jobs: int = 0,
+            abgr: bool = False) -> int:
+    """Write frames 0..first-1 (all if 0) of a .vfc as hex/bmp/png files,
+    split over `jobs` processes. Returns the number of frames written.
+    abgr: hex of BGR24 frames as AABBGGRR, as before the board packed."""
+    with VfcReader(path) as r:
+        n = len(r) if first <= 0 else min(first, len(r))
+    Path(out_dir).mkdir(parents=True, exist_ok=True)
+    jobs = max(1, min(jobs or os.cpu_count() or 1, n))
+    parts = [list(range(k, n, jobs)) for k in range(jobs)]
+    if jobs == 1:
+        return _convert_range(str(path), kind, str(out_dir), parts[0], abgr)
+    with ProcessPoolExecutor(jobs) as ex:
+        return sum(ex.map(_convert_range, [str(path)] * jobs, [kind] * jobs,
+                          [str(out_dir)] * jobs, parts, [abgr] * jobs))
+
+
+def pack(raw_path, width: int, height: int, bpp: int, out_path) -> int:
+    """Wrap a headerless .bin (bpp 3 = BGR24, 4 = ABGR32) in a .vfc."""
+    frame_bytes = width * height * bpp
+    size = Path(raw_path).stat().st_size
+    if size == 0 or size % frame_bytes:
+        raise ValueError(f"{raw_path}: size is not a multiple of {frame_bytes}")
+    pixfmt = {3: fp.PIXFMT_BGR24, 4: fp.PIXFMT_ABGR32}.get(bpp, fp.PIXFMT_RAW)
+    n = size // frame_bytes
+    with open(raw_path, "rb") as f, VfcWriter(out_path, width, height, pixfmt, bpp, n) as w:
+        for _ in range(n):
+            w.write(f.read(frame_bytes))
+    return n
+
+
+def main():
+    ap = argparse.ArgumentParser(description=".vfc frame container tools")
+    ap.add_argument("cmd", choices=["hex", "bmp", "png", "check", "pack", "info"])
+    ap.add_argument("args", nargs="+")
+    ap.add_argument("--first", type=int, default=0)
+    ap.add_argument("-j", "--jobs", type=int, default=0)
+    ap.add_argument("--abgr", action="store_true", help="hex: BGR24 as AABBGGRR")
+    a = ap.parse_args()
+
+    if a.cmd == "pack":
+        raw, geom, out = a.args
+        w, h, bpp = [int(v) for v in geom.lower().split("x")]
+        print(f"[VFC] {pack(raw, w, h, bpp, out)} frames -> {out}")
+    elif a.cmd in ("check", "info"):
+        with VfcReader(a.args[0]) as r:
+            h = r.hdr
+            print(f"[VFC] {len(r)}/{h.capacity} frames {h.width}x{h.height} "
+                  f"fmt={h.pixfmt} bpp={h.bpp} stride={h.frame_stride}")
+            if a.cmd == "check":
+                bad = [i for i in range(len(r)) if not r.check(i)]
+                for i in bad[:10]:
+                    print(f"[ERROR] frame {i}: CRC mismatch")
+                print(f"[VFC] {len(r) - len(bad)}/{len(r)} frames ok")
+                sys.exit(1 if bad else 0)
+    else:
+        src, out = a.args
+        first = a.first or (HEX_FIRST_N if a.cmd == "hex" else 0)
+        print(f"[VFC] {convert(src, a.cmd, out, first, a.jobs, a.abgr)} frames -> {out}")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,195 @@
+"""
+Wire framing shared with the firmware (src/frame_proto.h)
+
+Every frame on the TCP stream is a 24-byte little-endian header followed by
+`length` payload bytes. Keep HDR_FMT in sync with frame_hdr_t.
+"""
+
+import struct
+import zlib
+from dataclasses import dataclass
+
+FRAME_MAGIC = 0x314D5246        # "FRM1"
+HDR_FMT = "<IBBBBIHHII"
+HDR_BYTES = struct.calcsize(HDR_FMT)
+assert HDR_BYTES == 24
+
+MSG_FRAME = 0x01
+MSG_CONFIG = 0x02
+MSG_CONFIG_ACK = 0x03
+MSG_LOG_REQ = 0x04
+MSG_LOG_DUMP = 0x05
+MSG_STATS_REQ = 0x06
+MSG_STATS = 0x07
+MSG_UDP_OPEN = 0x08             # this client stays on TCP (tools/stream_client --udp)
+MSG_UDP_ACK = 0x09
+
+PIXFMT_BGR24 = 0x01            # as out_fmt: the IP's ABGR32, alpha stripped by the board
+PIXFMT_ABGR32 = 0x02
+PIXFMT_RAW = 0x03
+
+CFG_FMT = "<HHHHBBBBBBH"
+CFG_BYTES = struct.calcsize(CFG_FMT)
+assert CFG_BYTES == 16
+
+CFG_STATUS = {0: "ok", 1: "busy", 2: "invalid", 3: "no memory"}
+
+FLAG_CRC = 0x01
+FLAG_CODED = 0x02              # payload is a src/vcodec.h stream
+
+# FrameConfig.codec; this client leaves it 0 (tools/stream_client --codec)
+CFG_CODEC_IN = 0x01
+CFG_CODEC_OUT = 0x02
+CFG_CODEC_OUT_SKIP = 0x04
+
+
+class MisframedError(Exception):
+    pass
+
+
+@dataclass
+class FrameHeader:
+    seq: int
+    width: int
+    height: int
+    fmt: int
+    bpp: int
+    length: int
+    flags: int = 0
+    crc32: int = 0
+    msg_type: int = MSG_FRAME
+
+    def pack(self) -> bytes:
+        return struct.pack(HDR_FMT, FRAME_MAGIC, self.msg_type, self.flags,
+                           self.fmt, self.bpp, self.seq, self.width,
+                           self.height, self.length, self.crc32)
+
+    @classmethod
+    def unpack(cls, raw: bytes) -> "FrameHeader":
+        (magic, msg_type, flags, fmt, bpp, seq,
+         width, height, length, crc) = struct.unpack(HDR_FMT, raw)
+        if magic != FRAME_MAGIC:
+            raise MisframedError(f"bad magic 0x{magic:08X}")
+        return cls(seq, width, height, fmt, bpp, length, flags, crc, msg_type)
+
+
+def crc32(payload) -> int:
+    return zlib.crc32(payload) & 0xFFFFFFFF
+
+
+def make_header(seq: int, width: int, height: int, fmt: int, bpp: int,
+                payload, with_crc: bool = False) -> bytes:
+    hdr = FrameHeader(seq, width, height, fmt, bpp, len(payload))
+    if with_crc:
+        hdr.flags |= FLAG_CRC
+        hdr.crc32 = crc32(payload)
+    return hdr.pack()
+
+
+def check_payload(hdr: FrameHeader, payload) -> bool:
+    """True if the payload matches the header CRC (or the header has none)."""
+    if not (hdr.flags & FLAG_CRC):
+        return True
+    return crc32(payload) == hdr.crc32
+
+
+@dataclass
+class FrameConfig:
+    in_w: int
+    in_h: int
+    out_w: int
+    out_h: int
+    in_fmt: int = PIXFMT_BGR24
+    in_bpp: int = 3
+    out_fmt: int = PIXFMT_ABGR32
+    out_bpp: int = 4
+    scale: int = 0
+    status: int = 0
+    codec: int = 0
+
+    @classmethod
+    def upscale(cls, in_w: int, in_h: int, scale: int,
+                out_fmt: int = PIXFMT_ABGR32) -> "FrameConfig":
+        out_bpp = 3 if out_fmt == PIXFMT_BGR24 else 4
+        return cls(in_w, in_h, in_w * scale, in_h * scale,
+                   out_fmt=out_fmt, out_bpp=out_bpp, scale=scale)
+
+    @property
+    def in_bytes(self) -> int:
+        return self.in_w * self.in_h * self.in_bpp
+
+    @property
+    def out_bytes(self) -> int:
+        return self.out_w * self.out_h * self.out_bpp
+
+    def pack(self) -> bytes:
+        body = struct.pack(CFG_FMT, self.in_w, self.in_h, self.out_w, self.out_h,
+                           self.in_fmt, self.in_bpp, self.out_fmt, self.out_bpp,
+                           self.scale, self.status, self.codec)
+        hdr = FrameHeader(0, 0, 0, 0, 0, len(body), msg_type=MSG_CONFIG)
+        return hdr.pack() + body
+
+    @classmethod
+    def unpack(cls, body: bytes) -> "FrameConfig":
+        (in_w, in_h, out_w, out_h, in_fmt, in_bpp, out_fmt, out_bpp,
+         scale, status, codec) = struct.unpack(CFG_FMT, body)
+        return cls(in_w, in_h, out_w, out_h, in_fmt, in_bpp, out_fmt, out_bpp,
+                   scale, status, codec)
+
+
+def configure(sock, cfg: FrameConfig) -> FrameConfig:
+    """Send MSG_CONFIG and block for the ACK; raises if the board refuses."""
+    sock.sendall(cfg.pack())
+    raw = _recv_exact(sock, HDR_BYTES)
+    hdr = FrameHeader.unpack(raw)
+    if hdr.msg_type != MSG_CONFIG_ACK or hdr.length != CFG_BYTES:
+        raise MisframedError(f"expected CONFIG_ACK, got type {hdr.msg_type}")
+    ack = FrameConfig.unpack(_recv_exact(sock, CFG_BYTES))
+    if ack.status != 0:
+        raise RuntimeError(f"board refused config: {CFG_STATUS.get(ack.status, ack.status)}")
+    return ack
+
+
+def request_log(sock) -> bytes:
+    """Send MSG_LOG_REQ and return the MSG_LOG_DUMP payload (tlog.h layout)."""
+    sock.sendall(FrameHeader(0, 0, 0, 0, 0, 0, msg_type=MSG_LOG_REQ).pack())
+    hdr = FrameHeader.unpack(_recv_exact(sock, HDR_BYTES))
+    if hdr.msg_type != MSG_LOG_DUMP:
+        raise MisframedError(f"expected LOG_DUMP, got type {hdr.msg_type}")
+    return _recv_exact(sock, hdr.length)
+
+
+# frame_trace.h: stage order of the MSG_STATS payload
+STAGE_NAMES = ["rx assemble", "rx flush", "sched wait", "dma queue", "mm2s",
+               "ip + s2mm", "invalidate", "tx queue", "tx", "total"]
+STATS_RESET = 0x01
+STATS_HDR_FMT = "<IIHH"         # frame_trace_hdr_t
+STATS_STAGE_FMT = "<IIII"       # frame_trace_stage_t
+
+
+def request_stats(sock, reset: bool = False):
+    """Send MSG_STATS_REQ; returns (frames, [(name, count, p50_ns, p99_ns, max_ns)])."""
+    flags = STATS_RESET if reset else 0
+    sock.sendall(FrameHeader(0, 0, 0, 0, 0, 0, flags, msg_type=MSG_STATS_REQ).pack())
+    hdr = FrameHeader.unpack(_recv_exact(sock, HDR_BYTES))
+    if hdr.msg_type != MSG_STATS:
+        raise MisframedError(f"expected STATS, got type {hdr.msg_type}")
+    body = _recv_exact(sock, hdr.length)
+    frames, _, nstages, stage_bytes = struct.unpack_from(STATS_HDR_FMT, body)
+    off = struct.calcsize(STATS_HDR_FMT)
+    stages = []
+    for i in range(nstages):
+        vals = struct.unpack_from(STATS_STAGE_FMT, body, off + i * stage_bytes)
+        name = STAGE_NAMES[i] if i < len(STAGE_NAMES) else f"stage {i}"
+        stages.append((name, *vals))
+    return frames, stages
+
+
+def _recv_exact(sock, n: int) -> bytes:
+    buf = bytearray()
+    while len(buf) < n:
+        chunk = sock.recv(n - len(buf))
+        if not chunk:
+            raise ConnectionError("socket closed")
+        buf += chunk
+    return bytes(buf)
@@ -0,0 +1,42 @@
+#!/usr/bin/env python3
+"""
+Print the firmware's per-stage frame latencies (src/frame_trace.h)
+
+- Sends MSG_STATS_REQ on a fresh connection; the histograms cover every
+  session since boot or the last --reset
+- p50/p99 are histogram bucket bounds (within 25%), max is exact
+
+usage: frame_stats.py [ip [port]] [--reset]
+"""
+
+import socket
+import sys
+
+import frame_proto as fp
+
+DEFAULT_PORT = 6001
+DEFAULT_IP = "192.168.1.20"
+
+
+def main():
+    argv = sys.argv[1:]
+    reset = "--reset" in argv
+    if reset:
+        argv.remove("--reset")
+    ip = argv[0] if argv else DEFAULT_IP
+    port = int(argv[1]) if len(argv) > 1 else DEFAULT_PORT
+
+    with socket.create_connection((ip, port), timeout=5) as sock:
+        frames, stages = fp.request_stats(sock, reset)
+
+    print(f"{frames} frames")
+    if not stages:
+        print("no histograms (firmware built with FRAME_TRACE=0)")
+        return
+    print(f"{'stage':<14}{'count':>8}{'p50 us':>12}{'p99 us':>12}{'max us':>12}")
+    for name, count, p50, p99, mx in stages:
+        print(f"{name:<14}{count:>8}{p50 / 1000:>12.1f}{p99 / 1000:>12.1f}{mx / 1000:>12.1f}")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,253 @@
+#!/usr/bin/env python3
+"""
+Build-and-run checks on the host simulator (sim/)
+
+- overlap: one stream through an OUT_SLOTS=1 build (DMA and TX of a
+  session take turns) and an OUT_SLOTS=2 build (frame n+1 in the DMA while
+  frame n goes out), both at the same fixed SIM_DMA_LATENCY_US. Prints the
+  client's fps for each and fails unless the overlapped build is at least
+  --min-gain times faster
+- rxfill: one stream through the default build with the DMA slowed to
+  --latency (default 20000 us, slower than the link delivers input), the
+  client comparing every returned frame with the reference model
+  (--verify). Passes if the simulator's [PIPE] RX ring lines show the ring
+  full at least once and no refused pbuf (recv_callback's ERR_MEM), and
+  the client reports every frame bit-exact
+- zerocopy: one stream through a DMA_USE_SG=1 RX_ZERO_COPY=1 build, where
+  the DMA model has the SG engine and each pbuf of a frame is one MM2S BD
+  with TLAST on the last one only, under --verify. Passes if the client
+  reports every frame bit-exact and the simulator logged no [ERROR]
+- sgrecover: one stream through a DMA_USE_SG=1 OUT_SLOTS=4 build behind a
+  slow DMA (default 20000 us), with SIM_DMA_FAIL_FRAMES failing S2MM
+  completions 40, 41 (the first retry) and 100. Passes if the DMA queue
+  held several frames, the firmware caught every injected error, and the
+  client still reports every frame bit-exact
+- Each build goes to sim/build/check-<name>/, with the simulator's output
+  in sim.log there; the client is tools/stream_client on a generated
+  320x180 BGR24 input
+- Needs an lwIP tree (sim/Makefile LWIP=) and the TAP device of the README
+  (Host Simulator); the simulator itself needs no root
+
+usage: sim_check.py overlap|rxfill|zerocopy|sgrecover [--lwip DIR]
+                    [--latency US] [--frames N] [--min-gain X] [--tap IF] [--ip A]
+"""
+
+import argparse
+import os
+import random
+import re
+import subprocess
+import sys
+import tempfile
+import threading
+import time
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+SIM_DIR = os.path.join(HERE, "..", "sim")
+TOOLS_DIR = os.path.join(HERE, "..", "tools")
+CLIENT = os.path.join(TOOLS_DIR, "stream_client")
+
+IN_W, IN_H = 320, 180
+READY = "Waiting for client connection"
+RX_RE = re.compile(r"\[RX\] (\d+) frames in ([\d.]+) s: ([\d.]+) fps")
+RING_RE = re.compile(r"\[PIPE\] RX ring: full (\d+) times, peak (\d+) of (\d+) frames, (\d+) refused")
+GOLDEN_PASS = "[GOLDEN] PASS"
+DMA_RE = re.compile(r"\[PIPE\] DMA queue depth (\d+), max (\d+) of (\d+), errors (\d+)")
+LATENCY = {"overlap": 4000, "rxfill": 20000, "zerocopy": 2000, "sgrecover": 20000}
+SG_FAILS = [40, 41, 100]
+
+
+class CheckError(Exception):
+    pass
+
+
+def build_sim(name, fw_opts, lwip):
+    """make a simulator variant; returns its binary"""
+    build = os.path.join("build", "check-" + name)
+    cmd = ["make", "-C", SIM_DIR, "BUILD=" + build, "SIM=" + os.path.join(build, "ethernet_sim"),
+           "FW_OPTS=" + fw_opts]
+    if lwip:
+        cmd.append("LWIP=" + os.path.abspath(lwip))
+    print(f"[BUILD] {name}: {fw_opts or 'default options'}")
+    if subprocess.run(cmd, stdout=subprocess.DEVNULL).returncode != 0:
+        raise CheckError(f"simulator build '{name}' failed (is LWIP= an lwIP 2.1 tree?)")
+    return os.path.join(SIM_DIR, build, "ethernet_sim")
+
+
+def build_client():
+    if subprocess.run(["make", "-C", TOOLS_DIR, "stream_client"], stdout=subprocess.DEVNULL).returncode != 0:
+        raise CheckError("tools/stream_client build failed")
+
+
+def make_input(path, frames):
+    """frames of 320x180 BGR24: smooth gradients plus noise, like camera input"""
+    rnd = random.Random(1)
+    with open(path, "wb") as f:
+        for n in range(frames):
+            row = bytes((x + n * 3) & 0xFF for x in range(IN_W * 3))
+            frame = bytearray(row * IN_H)
+            frame[::7] = rnd.randbytes(len(range(0, len(frame), 7)))
+            f.write(frame)
+
+
+class Sim:
+    """One simulator process; its output is kept for the checks"""
+
+    def __init__(self, binary, tap, latency_us, log_path, extra_env=None):
+        env = dict(os.environ, SIM_TAP=tap, SIM_DMA_LATENCY_US=str(latency_us), **(extra_env or {}))
+        self.lines = []
+        self.ready = threading.Event()
+        self.log = open(log_path, "w")
+        self.proc = subprocess.Popen([binary], env=env, stdout=subprocess.PIPE,
+                                     stderr=subprocess.STDOUT, text=True)
+        self.reader = threading.Thread(target=self._read, daemon=True)
+        self.reader.start()
+        if not self.ready.wait(10):
+            self.stop()
+            raise CheckError(f"simulator not ready after 10 s, see {log_path}")
+
+    def _read(self):
+        for line in self.proc.stdout:
+            line = line.rstrip("\r\n")
+            self.lines.append(line)
+            self.log.write(line + "\n")
+            if READY in line:
+                self.ready.set()
+
+    def stop(self):
+        self.proc.terminate()
+        try:
+            self.proc.wait(5)
+        except subprocess.TimeoutExpired:
+            self.proc.kill()
+            self.proc.wait()
+        self.reader.join(2)
+        self.log.close()
+
+
+def run_client(input_path, ip, extra):
+    """stream input_path once; returns (fps, output)"""
+    cmd = [CLIENT, input_path, f"{IN_W}x{IN_H}", "--ip", ip, "--no-save"] + extra
+    r = subprocess.run(cmd, stdout=subprocess.PIPE, stderr=subprocess.STDOUT, text=True, timeout=600)
+    m = RX_RE.search(r.stdout)
+    if r.returncode != 0 or not m:
+        sys.stdout.write(r.stdout)
+        raise CheckError("stream_client failed")
+    return float(m.group(3)), r.stdout
+
+
+def stream_on(name, fw_opts, args, input_path, client_args=(), sim_env=None):
+    """build, start, stream, stop; returns (fps, client output, sim lines)"""
+    binary = build_sim(name, fw_opts, args.lwip)
+    sim = Sim(binary, args.tap, args.latency, os.path.join(os.path.dirname(binary), "sim.log"), sim_env)
+    try:
+        time.sleep(0.5)     # ARP for 192.168.1.20 settles
+        fps, out = run_client(input_path, args.ip, list(client_args))
+    finally:
+        sim.stop()
+    return fps, out, sim.lines
+
+
+def stream_verified(name, fw_opts, args, input_path, sim_env=None):
+    """stream_on() with --verify; fails unless every frame came back bit-exact"""
+    fps, out, lines = stream_on(name, fw_opts, args, input_path, ["--verify"], sim_env)
+    if GOLDEN_PASS not in out:
+        sys.stdout.write(out)
+        raise CheckError("output not bit-exact")
+    return fps, lines
+
+
+def check_overlap(args, input_path):
+    serial, _, _ = stream_on("slots1", "-DOUT_SLOTS=1", args, input_path)
+    print(f"[RESULT] OUT_SLOTS=1 (serial):     {serial:.1f} fps")
+    overlap, _, _ = stream_on("slots2", "-DOUT_SLOTS=2", args, input_path)
+    print(f"[RESULT] OUT_SLOTS=2 (overlapped): {overlap:.1f} fps")
+
+    gain = overlap / serial if serial > 0 else 0.0
+    print(f"[RESULT] gain {gain:.2f}x at {args.latency} us DMA latency, {args.frames} frames")
+    if gain < args.min_gain:
+        raise CheckError(f"overlapped build not faster: {gain:.2f}x < {args.min_gain:.2f}x")
+
+
+def check_rxfill(args, input_path):
+    fps, lines = stream_verified("rxfill", "", args, input_path)
+    reports = [tuple(map(int, m.groups())) for m in map(RING_RE.search, lines) if m]
+    if not reports:
+        raise CheckError("no [PIPE] RX ring report (fewer than 60 frames?)")
+    full = sum(r[0] for r in reports)
+    peak = max(r[1] for r in reports)
+    refused = sum(r[3] for r in reports)
+    print(f"[RESULT] {fps:.1f} fps at {args.latency} us DMA latency: ring full {full} times, "
+          f"peak {peak} of {reports[0][2]} frames, {refused} refused pbufs")
+    if full == 0:
+        raise CheckError("RX ring never filled: raise --latency")
+    if refused:
+        raise CheckError(f"recv_callback refused {refused} pbufs (ERR_MEM)")
+
+
+def check_zerocopy(args, input_path):
+    fps, lines = stream_verified("zerocopy", "-DDMA_USE_SG=1 -DRX_ZERO_COPY=1", args, input_path)
+    if not any("DMA SG mode" in l for l in lines):
+        raise CheckError("simulator did not come up in DMA SG mode")
+    errors = [l for l in lines if "[ERROR]" in l]
+    print(f"[RESULT] {fps:.1f} fps, every frame bit-exact, {len(errors)} errors logged")
+    if errors:
+        raise CheckError(f"simulator logged: {errors[0]}")
+
+
+def check_sgrecover(args, input_path):
+    fails = [n for n in SG_FAILS if n <= args.frames]
+    env = {"SIM_DMA_FAIL_FRAMES": ",".join(map(str, fails))}
+    fps, lines = stream_verified("sgrecover", "-DDMA_USE_SG=1 -DOUT_SLOTS=4", args, input_path, env)
+    reports = [tuple(map(int, m.groups())) for m in map(DMA_RE.search, lines) if m]
+    if not reports:
+        raise CheckError("no [PIPE] DMA queue report (fewer than 60 frames?)")
+    depth_max = max(r[1] for r in reports)
+    injected = sum("injected S2MM error" in l for l in lines)
+    caught = sum("S2MM BD error" in l for l in lines)
+    print(f"[RESULT] {fps:.1f} fps at {args.latency} us DMA latency: queue max {depth_max} of "
+          f"{reports[0][2]}, {injected} errors injected, {caught} caught, every frame bit-exact")
+    if depth_max < 2:
+        raise CheckError("DMA queue never held more than one frame: raise --latency")
+    if injected != len(fails) or caught != injected:
+        raise CheckError(f"expected {len(fails)} injected and caught errors")
+
+
+CHECKS = {"overlap": check_overlap, "rxfill": check_rxfill, "zerocopy": check_zerocopy,
+          "sgrecover": check_sgrecover}
+
+
+def main():
+    ap = argparse.ArgumentParser(description="host simulator checks")
+    ap.add_argument("check", choices=sorted(CHECKS))
+    ap.add_argument("--lwip", help="lwIP 2.1 tree (default: sim/Makefile's ../../lwip)")
+    ap.add_argument("--latency", type=int,
+                    help="SIM_DMA_LATENCY_US (default 4000 overlap, 20000 rxfill and "
+                         "sgrecover, 2000 zerocopy)")
+    ap.add_argument("--frames", type=int, default=200, help="frames to stream (default 200)")
+    ap.add_argument("--min-gain", type=float, default=1.1,
+                    help="overlap: required OUT_SLOTS=2 / OUT_SLOTS=1 fps (default 1.1)")
+    ap.add_argument("--tap", default="tap0", help="TAP device (default tap0)")
+    ap.add_argument("--ip", default="192.168.1.20", help="simulated board (default 192.168.1.20)")
+    args = ap.parse_args()
+    if args.latency is None:
+        args.latency = LATENCY[args.check]
+
+    if not os.path.exists(os.path.join("/sys/class/net", args.tap)):
+        print(f"[FAIL] no {args.tap}: set it up as in the README (Host Simulator)")
+        return 1
+    try:
+        build_client()
+        with tempfile.TemporaryDirectory(prefix="sim_check_") as workdir:
+            input_path = os.path.join(workdir, "input.bin")
+            make_input(input_path, args.frames)
+            CHECKS[args.check](args, input_path)
+    except CheckError as e:
+        print(f"[FAIL] {e}")
+        return 1
+    print(f"[PASS] {args.check}")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
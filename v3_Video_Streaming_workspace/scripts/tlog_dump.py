@@ -0,0 +1,122 @@
+#!/usr/bin/env python3
+"""
+Fetch and decode the firmware's binary log ring (src/tlog.h)
+
+- Sends MSG_LOG_REQ until the board has no records left
+- Ids and format strings are read from src/tlog_ids.h, so the decoder
+  always matches the firmware source next to it
+- Raw payloads can be saved (--save) and decoded later offline (--file)
+
+usage: tlog_dump.py [ip [port]] [--save FILE] | --file FILE
+"""
+
+import re
+import socket
+import struct
+import sys
+from pathlib import Path
+
+import frame_proto as fp
+
+DEFAULT_PORT = 6001
+DEFAULT_IP = "192.168.1.20"
+
+IDS_H = Path(__file__).resolve().parent.parent / "src" / "tlog_ids.h"
+
+DUMP_HDR_FMT = "<IIHH"          # tlog_dump_hdr_t
+DUMP_HDR_BYTES = struct.calcsize(DUMP_HDR_FMT)
+REC_FMT = "<QHBB5I"             # tlog_rec_t
+REC_BYTES = struct.calcsize(REC_FMT)
+assert DUMP_HDR_BYTES == 12 and REC_BYTES == 32
+
+LEVELS = {1: "ERR", 2: "WRN", 3: "INF", 4: "DBG"}
+CONV_RE = re.compile(r"%[-0-9]*([dxXu])")
+
+
+def load_ids(path=IDS_H):
+    """[(name, format)] in id order, from the TLOG_ID lines."""
+    ids = []
+    for line in path.read_text().splitlines():
+        m = re.match(r'\s*TLOG_ID\(\s*(\w+)\s*,\s*\w+\s*,\s*"(.*)"\s*\)', line)
+        if m:
+            ids.append((m.group(1), m.group(2)))
+    return ids
+
+
+def format_record(fmt, args):
+    """Apply a C format: %d args are signed 32-bit, %x/%u unsigned."""
+    vals = []
+    for conv, a in zip(CONV_RE.findall(fmt), args):
+        vals.append(a - (1 << 32) if conv == "d" and a & 0x80000000 else a)
+    return CONV_RE.sub(lambda m: "%" + m.group(0)[1:].replace("u", "d"), fmt) % tuple(vals)
+
+
+def decode_payload(payload, ids):
+    """Yield (seconds, level, text) per record; prints a note on lost records."""
+    tps, lost, nrec, rec_bytes = struct.unpack_from(DUMP_HDR_FMT, payload)
+    if lost:
+        print(f"... {lost} records overwritten before they were read")
+    for i in range(nrec):
+        ts, rid, level, nargs, *args = struct.unpack_from(
+            REC_FMT, payload, DUMP_HDR_BYTES + i * rec_bytes)
+        if rid < len(ids):
+            text = format_record(ids[rid][1], args[:nargs])
+        else:
+            text = f"<id {rid}> " + " ".join(str(a) for a in args[:nargs])
+        yield ts / tps, LEVELS.get(level, "?"), text
+
+
+def fetch(ip, port):
+    """Yield MSG_LOG_DUMP payloads until the ring is empty."""
+    with socket.create_connection((ip, port), timeout=5) as sock:
+        while True:
+            payload = fp.request_log(sock)
+            yield payload
+            if struct.unpack_from(DUMP_HDR_FMT, payload)[2] == 0:
+                return
+
+
+def read_saved(path):
+    """Payloads saved by --save: u32 length prefix each."""
+    data = Path(path).read_bytes()
+    off = 0
+    while off + 4 <= len(data):
+        (n,) = struct.unpack_from("<I", data, off)
+        yield data[off + 4:off + 4 + n]
+        off += 4 + n
+
+
+def main():
+    argv = sys.argv[1:]
+    save = load = None
+    if "--save" in argv:
+        i = argv.index("--save")
+        save = argv[i + 1]
+        del argv[i:i + 2]
+    if "--file" in argv:
+        i = argv.index("--file")
+        load = argv[i + 1]
+        del argv[i:i + 2]
+
+    ids = load_ids()
+    if load:
+        payloads = read_saved(load)
+    else:
+        ip = argv[0] if argv else DEFAULT_IP
+        port = int(argv[1]) if len(argv) > 1 else DEFAULT_PORT
+        payloads = fetch(ip, port)
+
+    out = open(save, "wb") if save else None
+    try:
+        for payload in payloads:
+            if out:
+                out.write(struct.pack("<I", len(payload)) + payload)
+            for t, level, text in decode_payload(payload, ids):
+                print(f"[{t:12.6f}] {level} {text}")
+    finally:
+        if out:
+            out.close()
+
+
+if __name__ == "__main__":
+    main()
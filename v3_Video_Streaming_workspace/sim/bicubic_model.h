@@ -0,0 +1,111 @@
+/*
+ * bicubic_model.h - software model of the x4 Bicubic AXIS IP
+ *
+ * BGR24 (w x h) in, ABGR32 (4w x 4h) out, byte order A,B,G,R per pixel with
+ * A = 0x00, matching what the clients receive from the board.
+ *
+ * Keys kernel (a = -0.5) with half-pixel centres. At x4 the source phase of
+ * output column 4k+j is one of {0.625, 0.875, 0.125, 0.375}, so the weights
+ * are exact in Q10. Horizontal pass keeps the Q10 sum, vertical pass brings
+ * it to Q20 and rounds once; borders replicate the edge pixel.
+ */
+
+#ifndef BICUBIC_MODEL_H
+#define BICUBIC_MODEL_H
+
+#include <stdint.h>
+
+#define BICUBIC_SCALE   4
+#define BICUBIC_QBITS   10
+
+/* Per output phase j: taps relative to the base source index */
+static const int32_t bicubic_w[BICUBIC_SCALE][4] = {
+    { -45, 399, 745, -75 },     // t = 0.625
+    {  -7,  93, 987, -49 },     // t = 0.875
+    { -49, 987,  93,  -7 },     // t = 0.125
+    { -75, 745, 399, -45 },     // t = 0.375
+};
+
+/* First tap of output index o: phases 0,1 sit left of source k = o/4 */
+static inline int bicubic_tap0(int o)
+{
+    int k = o / BICUBIC_SCALE;
+    return ((o % BICUBIC_SCALE) < 2) ? k - 2 : k - 1;
+}
+
+static inline int bicubic_clampi(int v, int lo, int hi)
+{
+    return (v < lo) ? lo : (v > hi) ? hi : v;
+}
+
+static inline uint8_t bicubic_round_q20(int32_t v)
+{
+    if (v <= 0) return 0;
+    v = (v + (1 << (2 * BICUBIC_QBITS - 1))) >> (2 * BICUBIC_QBITS);
+    return (v > 255) ? 255 : (uint8_t)v;
+}
+
+/*
+ * Horizontal pass of one source row: tmp gets 4w x 3 Q10 samples (B,G,R).
+ */
+static inline void bicubic_row_h(const uint8_t *src_row, int w, int32_t *tmp)
+{
+    for (int ox = 0; ox < w * BICUBIC_SCALE; ox++) {
+        const int32_t *wt = bicubic_w[ox % BICUBIC_SCALE];
+        int x0 = bicubic_tap0(ox);
+        for (int c = 0; c < 3; c++) {
+            int32_t acc = 0;
+            for (int t = 0; t < 4; t++) {
+                int sx = bicubic_clampi(x0 + t, 0, w - 1);
+                acc += wt[t] * src_row[sx * 3 + c];
+            }
+            tmp[ox * 3 + c] = acc;
+        }
+    }
+}
+
+/*
+ * Vertical pass for output row oy from the four horizontally filtered rows.
+ */
+static inline void bicubic_row_v(const int32_t *const rows[4], int oy, int out_w,
+                                 uint8_t *dst_row)
+{
+    const int32_t *wt = bicubic_w[oy % BICUBIC_SCALE];
+    for (int ox = 0; ox < out_w; ox++) {
+        uint8_t bgr[3];
+        for (int c = 0; c < 3; c++) {
+            int32_t acc = 0;
+            for (int t = 0; t < 4; t++)
+                acc += wt[t] * rows[t][ox * 3 + c];
+            bgr[c] = bicubic_round_q20(acc);
+        }
+        dst_row[ox * 4 + 0] = 0x00;     // A
+        dst_row[ox * 4 + 1] = bgr[0];   // B
+        dst_row[ox * 4 + 2] = bgr[1];   // G
+        dst_row[ox * 4 + 3] = bgr[2];   // R
+    }
+}
+
+/*
+ * Whole frame. tmp must hold h * (4w * 3) int32 (every filtered source row).
+ */
+static inline void bicubic_x4_bgr24_to_abgr32(const uint8_t *in, int w, int h,
+                                              uint8_t *out, int32_t *tmp)
+{
+    int out_w = w * BICUBIC_SCALE;
+    int out_h = h * BICUBIC_SCALE;
+    int row_n = out_w * 3;
+
+    for (int y = 0; y < h; y++)
+        bicubic_row_h(in + (size_t)y * w * 3, w, tmp + (size_t)y * row_n);
+
+    for (int oy = 0; oy < out_h; oy++) {
+        const int32_t *rows[4];
+        int y0 = bicubic_tap0(oy);
+        for (int t = 0; t < 4; t++)
+            rows[t] = tmp + (size_t)bicubic_clampi(y0 + t, 0, h - 1) * row_n;
+        bicubic_row_v(rows, oy, out_w, out + (size_t)oy * out_w * 4);
+    }
+}
+
+#endif /* BICUBIC_MODEL_H */
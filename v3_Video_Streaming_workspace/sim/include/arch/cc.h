@@ -0,0 +1,16 @@
+/*
+ * arch/cc.h - lwIP port definitions for the host simulator
+ */
+
+#ifndef ARCH_CC_H
+#define ARCH_CC_H
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define LWIP_PLATFORM_DIAG(x)   do { printf x; } while (0)
+#define LWIP_PLATFORM_ASSERT(x) do { printf("lwIP assert: %s (%s:%d)\n", \
+                                        x, __FILE__, __LINE__); abort(); } while (0)
+#define LWIP_RAND()             ((u32_t)rand())
+
+#endif /* ARCH_CC_H */
@@ -0,0 +1,46 @@
+/*
+ * lwipopts.h - lwIP configuration for the host simulator
+ *
+ * Mirrors the BSP settings the board build relies on (RAW API, NO_SYS,
+ * IPv4 TCP). PBUF_POOL_SIZE covers a full RX_ZERO_COPY ring (NUM_BUFFERS
+ * frames of ~120 pbufs at 320x180 BGR24) plus the TCP window; that build is
+ * FW_OPTS="-DDMA_USE_SG=1 -DRX_ZERO_COPY=1" (make check-zerocopy).
+ */
+
+#ifndef LWIPOPTS_H
+#define LWIPOPTS_H
+
+#define NO_SYS                      1
+#define LWIP_SOCKET                 0
+#define LWIP_NETCONN                0
+#define SYS_LIGHTWEIGHT_PROT        0
+
+#define LWIP_IPV4                   1
+#define LWIP_IPV6                   0
+#define LWIP_ARP                    1
+#define LWIP_ETHERNET               1
+#define LWIP_ICMP                   1
+#define LWIP_TCP                    1
+#define LWIP_UDP                    1
+#define LWIP_DHCP                   0
+
+#define MEM_ALIGNMENT               8
+#define MEM_SIZE                    (4 * 1024 * 1024)
+#define MEMP_NUM_PBUF               1024
+#define MEMP_NUM_TCP_PCB            8
+#define MEMP_NUM_TCP_SEG            1024
+#define PBUF_POOL_SIZE              2048
+#define PBUF_POOL_BUFSIZE           1700
+
+#define TCP_MSS                     1460
+#define TCP_WND                     (44 * TCP_MSS)
+#define TCP_SND_BUF                 65535
+#define TCP_SND_QUEUELEN            (4 * TCP_SND_BUF / TCP_MSS)
+#define TCP_QUEUE_OOSEQ             1
+
+#define LWIP_STATS                  0
+#define LWIP_NETIF_LOOPBACK         0
+#define CHECKSUM_CHECK_IP           1
+#define CHECKSUM_CHECK_TCP          1
+
+#endif /* LWIPOPTS_H */
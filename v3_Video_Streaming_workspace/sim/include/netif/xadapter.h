@@ -0,0 +1,17 @@
+/*
+ * xadapter.h - host stand-in: xemac_add() brings up a Linux TAP device and
+ * xemacif_input() pumps it, the lwIP timers and the simulated DMA
+ */
+
+#ifndef XADAPTER_H
+#define XADAPTER_H
+
+#include "lwip/netif.h"
+#include "xil_types.h"
+
+struct netif *xemac_add(struct netif *netif, ip_addr_t *ipaddr, ip_addr_t *netmask,
+                        ip_addr_t *gw, unsigned char *mac_ethernet_address,
+                        UINTPTR mac_baseaddr);
+int xemacif_input(struct netif *netif);
+
+#endif /* XADAPTER_H */
@@ -0,0 +1,12 @@
+/*
+ * platform.h - host stand-in
+ */
+
+#ifndef PLATFORM_H
+#define PLATFORM_H
+
+void init_platform(void);
+void cleanup_platform(void);
+void platform_enable_interrupts(void);
+
+#endif /* PLATFORM_H */
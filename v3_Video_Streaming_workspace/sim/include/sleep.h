@@ -0,0 +1,10 @@
+/*
+ * sleep.h - host stand-in
+ */
+
+#ifndef SLEEP_H
+#define SLEEP_H
+
+#include <unistd.h>
+
+#endif /* SLEEP_H */
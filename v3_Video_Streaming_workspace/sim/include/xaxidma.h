@@ -0,0 +1,120 @@
+/*
+ * xaxidma.h - host stand-in for the AXI DMA driver
+ *
+ * Simple mode, and the BD ring calls dma.c uses in SG mode. The model has
+ * the SG engine when the firmware is built with DMA_USE_SG, and then
+ * refuses simple transfers like the driver does.
+ */
+
+#ifndef XAXIDMA_H
+#define XAXIDMA_H
+
+#include "xil_types.h"
+
+#define XAXIDMA_DMA_TO_DEVICE   0x00
+#define XAXIDMA_DEVICE_TO_DMA   0x01
+
+#define XAXIDMA_HALTED_MASK     0x00000001
+#define XAXIDMA_IRQ_IOC_MASK    0x00001000
+#define XAXIDMA_IRQ_DELAY_MASK  0x00002000
+#define XAXIDMA_IRQ_ERROR_MASK  0x00004000
+#define XAXIDMA_IRQ_ALL_MASK    0x00007000
+
+/* Buffer descriptors */
+#define XAXIDMA_BD_MINIMUM_ALIGNMENT    0x40
+#define XAXIDMA_ALL_BDS                 0x0FFFFFFF
+
+#define XAXIDMA_BD_CTRL_TXSOF_MASK      0x08000000
+#define XAXIDMA_BD_CTRL_TXEOF_MASK      0x04000000
+#define XAXIDMA_BD_CTRL_ALL_MASK        0x0C000000
+
+#define XAXIDMA_BD_STS_COMPLETE_MASK    0x80000000
+#define XAXIDMA_BD_STS_DEC_ERR_MASK     0x40000000
+#define XAXIDMA_BD_STS_SLV_ERR_MASK     0x20000000
+#define XAXIDMA_BD_STS_INT_ERR_MASK     0x10000000
+#define XAXIDMA_BD_STS_ALL_ERR_MASK     0x70000000
+#define XAXIDMA_BD_STS_RXSOF_MASK       0x08000000
+#define XAXIDMA_BD_STS_RXEOF_MASK       0x04000000
+#define XAXIDMA_BD_STS_ACTUAL_LEN_MASK  0x03FFFFFF
+
+#define XAXIDMA_MAX_TRANSFER_LEN        0x03FFFFFF
+
+/* One descriptor; the driver's is 16 words, this one keeps the same size */
+typedef struct {
+    UINTPTR BufAddr;
+    u32     Length;
+    u32     Ctrl;
+    u32     Sts;
+    UINTPTR Id;
+} __attribute__((aligned(XAXIDMA_BD_MINIMUM_ALIGNMENT))) XAxiDma_Bd;
+
+/*
+ * BDs move Free -> (Alloc) Pre -> (ToHw) Hw -> (FromHw) Post -> (Free) Free
+ * around the ring; each group is contiguous and starts at its head.
+ */
+typedef struct {
+    XAxiDma_Bd *FirstBdAddr;
+    int         AllCnt;
+    int         FreeCnt, PreCnt, HwCnt, PostCnt;
+    int         FreeHead, PreHead, HwHead, PostHead;
+    int         RunState;
+    u32         MaxTransferLen;
+} XAxiDma_BdRing;
+
+typedef struct {
+    UINTPTR BaseAddr;
+    int     HasSg;
+} XAxiDma_Config;
+
+typedef struct {
+    UINTPTR        RegBase;
+    int            Initialized;
+    int            HasSg;
+    XAxiDma_BdRing TxBdRing;
+    XAxiDma_BdRing RxBdRing;
+} XAxiDma;
+
+#define XAxiDma_GetTxRing(InstancePtr)  (&((InstancePtr)->TxBdRing))
+#define XAxiDma_GetRxRing(InstancePtr)  (&((InstancePtr)->RxBdRing))
+
+#define XAxiDma_BdRingMemCalc(Alignment, NumBd) \
+    ((u32)(((sizeof(XAxiDma_Bd) + ((Alignment) - 1)) & ~((Alignment) - 1)) * (NumBd)))
+
+XAxiDma_Config *XAxiDma_LookupConfigBaseAddr(UINTPTR Baseaddr);
+int  XAxiDma_CfgInitialize(XAxiDma *InstancePtr, XAxiDma_Config *Config);
+u32  XAxiDma_SimpleTransfer(XAxiDma *InstancePtr, UINTPTR BuffAddr, u32 Length,
+                            int Direction);
+int  XAxiDma_Busy(XAxiDma *InstancePtr, int Direction);
+u32  XAxiDma_ReadReg(UINTPTR BaseAddr, u32 Offset);
+void XAxiDma_Reset(XAxiDma *InstancePtr);
+int  XAxiDma_ResetIsDone(XAxiDma *InstancePtr);
+int  XAxiDma_HasSg(XAxiDma *InstancePtr);
+void XAxiDma_IntrEnable(XAxiDma *InstancePtr, u32 Mask, int Direction);
+void XAxiDma_IntrDisable(XAxiDma *InstancePtr, u32 Mask, int Direction);
+u32  XAxiDma_IntrGetIrq(XAxiDma *InstancePtr, int Direction);
+void XAxiDma_IntrAckIrq(XAxiDma *InstancePtr, u32 Mask, int Direction);
+
+/* BD rings (SG mode) */
+int  XAxiDma_BdRingCreate(XAxiDma_BdRing *RingPtr, UINTPTR PhysAddr, UINTPTR VirtAddr,
+                          u32 Alignment, int BdCount);
+int  XAxiDma_BdRingClone(XAxiDma_BdRing *RingPtr, XAxiDma_Bd *SrcBdPtr);
+int  XAxiDma_BdRingStart(XAxiDma_BdRing *RingPtr);
+void XAxiDma_BdRingIntEnable(XAxiDma_BdRing *RingPtr, u32 Mask);
+void XAxiDma_BdRingIntDisable(XAxiDma_BdRing *RingPtr, u32 Mask);
+int  XAxiDma_BdRingGetFreeCnt(XAxiDma_BdRing *RingPtr);
+int  XAxiDma_BdRingAlloc(XAxiDma_BdRing *RingPtr, int NumBd, XAxiDma_Bd **BdSetPtr);
+int  XAxiDma_BdRingUnAlloc(XAxiDma_BdRing *RingPtr, int NumBd, XAxiDma_Bd *BdSetPtr);
+int  XAxiDma_BdRingToHw(XAxiDma_BdRing *RingPtr, int NumBd, XAxiDma_Bd *BdSetPtr);
+int  XAxiDma_BdRingFromHw(XAxiDma_BdRing *RingPtr, int BdLimit, XAxiDma_Bd **BdSetPtr);
+int  XAxiDma_BdRingFree(XAxiDma_BdRing *RingPtr, int NumBd, XAxiDma_Bd *BdSetPtr);
+XAxiDma_Bd *XAxiDma_BdRingNext(XAxiDma_BdRing *RingPtr, XAxiDma_Bd *BdPtr);
+
+void XAxiDma_BdClear(XAxiDma_Bd *BdPtr);
+int  XAxiDma_BdSetBufAddr(XAxiDma_Bd *BdPtr, UINTPTR Addr);
+int  XAxiDma_BdSetLength(XAxiDma_Bd *BdPtr, u32 LenBytes, u32 LengthMask);
+void XAxiDma_BdSetCtrl(XAxiDma_Bd *BdPtr, u32 Data);
+void XAxiDma_BdSetId(XAxiDma_Bd *BdPtr, UINTPTR Id);
+u32  XAxiDma_BdGetSts(XAxiDma_Bd *BdPtr);
+UINTPTR XAxiDma_BdGetId(XAxiDma_Bd *BdPtr);
+
+#endif /* XAXIDMA_H */
@@ -0,0 +1,14 @@
+/*
+ * xil_cache.h - host stand-in; the simulated DMA shares the CPU's view of
+ * memory, so maintenance only counts bytes
+ */
+
+#ifndef XIL_CACHE_H
+#define XIL_CACHE_H
+
+#include "xil_types.h"
+
+void Xil_DCacheFlushRange(INTPTR adr, INTPTR len);
+void Xil_DCacheInvalidateRange(INTPTR adr, INTPTR len);
+
+#endif /* XIL_CACHE_H */
@@ -0,0 +1,17 @@
+/*
+ * xil_mmu.h - host stand-in; memory attributes cannot be changed on the host
+ */
+
+#ifndef XIL_MMU_H
+#define XIL_MMU_H
+
+#include "xil_types.h"
+
+#define NORM_NONCACHE       0x401UL
+#define NORM_WB_CACHE       0x705UL
+#define INNER_SHAREABLE     (0x3 << 8)
+#define OUTER_SHAREABLE     (0x2 << 8)
+
+void Xil_SetTlbAttributes(UINTPTR Addr, u64 attrib);
+
+#endif /* XIL_MMU_H */
@@ -0,0 +1,10 @@
+/*
+ * xil_printf.h - host stand-in, prints to stdout
+ */
+
+#ifndef XIL_PRINTF_H
+#define XIL_PRINTF_H
+
+void xil_printf(const char *fmt, ...) __attribute__((format(printf, 1, 2)));
+
+#endif /* XIL_PRINTF_H */
@@ -0,0 +1,16 @@
+/*
+ * xparameters.h - host stand-in with the addresses main.c/dma.c refer to
+ */
+
+#ifndef XPARAMETERS_H
+#define XPARAMETERS_H
+
+#define XPAR_PSU_ETHERNET_3_BASEADDR                0xFF0E0000U
+#define XPAR_AXI_DMA_0_BASEADDR                     0xA0000000U
+#define XPAR_SCUGIC_SINGLE_DEVICE_ID                0U
+#define XPAR_SCUGIC_0_CPU_BASEADDR                  0xF9020000U
+#define XPAR_SCUGIC_0_DIST_BASEADDR                 0xF9010000U
+#define XPAR_FABRIC_AXI_DMA_0_MM2S_INTROUT_INTR     121U
+#define XPAR_FABRIC_AXI_DMA_0_S2MM_INTROUT_INTR     122U
+
+#endif /* XPARAMETERS_H */
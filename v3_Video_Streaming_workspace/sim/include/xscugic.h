@@ -0,0 +1,40 @@
+/*
+ * xscugic.h - host stand-in; handlers are called from the simulated
+ * xemacif_input() pump when the DMA model raises an interrupt
+ */
+
+#ifndef XSCUGIC_H
+#define XSCUGIC_H
+
+#include "xil_types.h"
+
+typedef void (*Xil_InterruptHandler)(void *data);
+
+typedef struct {
+    u16 DeviceId;
+    u32 CpuBaseAddress;
+    u32 DistBaseAddress;
+} XScuGic_Config;
+
+typedef struct {
+    XScuGic_Config *Config;
+    u32 IsReady;
+} XScuGic;
+
+XScuGic_Config *XScuGic_LookupConfig(u16 DeviceId);
+s32  XScuGic_CfgInitialize(XScuGic *InstancePtr, XScuGic_Config *ConfigPtr,
+                           u32 EffectiveAddr);
+s32  XScuGic_Connect(XScuGic *InstancePtr, u32 Int_Id,
+                     Xil_InterruptHandler Handler, void *CallBackRef);
+void XScuGic_Enable(XScuGic *InstancePtr, u32 Int_Id);
+void XScuGic_SetPriorityTriggerType(XScuGic *InstancePtr, u32 Int_Id,
+                                    u8 Priority, u8 Trigger);
+
+void XScuGic_RegisterHandler(u32 BaseAddress, int InterruptID,
+                             Xil_InterruptHandler IntrHandler, void *CallBackRef);
+void XScuGic_EnableIntr(u32 DistBaseAddress, u32 Int_Id);
+void XScuGic_DisableIntr(u32 DistBaseAddress, u32 Int_Id);
+void XScuGic_SetPriTrigTypeByDistAddr(u32 DistBaseAddress, u32 Int_Id,
+                                      u8 Priority, u8 Trigger);
+
+#endif /* XSCUGIC_H */
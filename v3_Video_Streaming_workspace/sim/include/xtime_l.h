@@ -0,0 +1,16 @@
+/*
+ * xtime_l.h - host stand-in, XTime counts CLOCK_MONOTONIC nanoseconds
+ */
+
+#ifndef XTIME_L_H
+#define XTIME_L_H
+
+#include "xil_types.h"
+
+typedef u64 XTime;
+
+#define COUNTS_PER_SECOND   1000000000ULL
+
+void XTime_GetTime(XTime *t);
+
+#endif /* XTIME_L_H */
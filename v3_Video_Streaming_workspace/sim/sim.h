@@ -0,0 +1,15 @@
+/*
+ * sim.h - glue between the simulated BSP pieces
+ */
+
+#ifndef SIM_H
+#define SIM_H
+
+#include "xil_types.h"
+
+void sim_dma_configure(void);
+void sim_dma_tick(void);
+void sim_raise_irq(u32 id);
+int  sim_idle(u32 max_us);
+
+#endif /* SIM_H */
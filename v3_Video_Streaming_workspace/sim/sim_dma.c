@@ -0,0 +1,504 @@
+/*
+ * sim_dma.c - AXI DMA + Bicubic IP model for the host simulator
+ *
+ * MM2S transfers are gathered into the IP's input frame; once a full input
+ * frame and an armed S2MM buffer are present the x4 bicubic model runs and
+ * S2MM completes SIM_DMA_LATENCY_US later (env, default 2000 us), which
+ * stands in for the PL processing time. Geometry follows the firmware's
+ * frame_cfg; shapes the bicubic model does not cover get a nearest-neighbour
+ * resample so transport benchmarks still see correctly sized output.
+ *
+ * Built with DMA_USE_SG the model has the SG engine instead: MM2S walks the
+ * TX BD ring and the IP frames its input on TLAST (TXEOF), so a frame must
+ * be exactly one input frame long with TXEOF on its last BD only; anything
+ * else completes the output BD with an error. The output goes to the next
+ * RX BD. SIM_DMA_FAIL_FRAMES (env, e.g. "40,41") fails those S2MM
+ * completions, counted from 1, with an internal error; the engine then
+ * halts until XAxiDma_Reset(), as the hardware does. Freed BDs are
+ * poisoned with error status.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "xparameters.h"
+#include "xaxidma.h"
+#include "xtime_l.h"
+#include "sim.h"
+#include "frame_cfg.h"
+#include "pix_pack.h"
+#include "bicubic_model.h"
+
+#if defined(DMA_USE_SG) && DMA_USE_SG
+#define SIM_HAS_SG      1
+#else
+#define SIM_HAS_SG      0
+#endif
+
+#define SIM_MAX_FAILS   16
+
+typedef struct {
+    int     busy;
+    u8     *buf;
+    u32     len;
+    u32     irq_mask;   // enabled interrupts
+    u32     irq_sts;    // pending interrupts
+} sim_chan_t;
+
+static XAxiDma_Config sim_cfg = { XPAR_AXI_DMA_0_BASEADDR, SIM_HAS_SG };
+static XAxiDma *sim_inst;
+static sim_chan_t mm2s, s2mm;
+
+static u8      *ip_in;
+static u32     ip_in_cap = 0;
+static u32     ip_in_fill = 0;
+static int32_t *ip_tmp;
+static u32     ip_tmp_cap = 0;
+static XTime   s2mm_due = 0;
+static XTime   latency_ticks;
+
+/* SG engine */
+static XAxiDma_Bd *sg_out_bd;       // RX BD the IP is writing, done at s2mm_due
+static int     sg_halted = 0;       // error seen, until XAxiDma_Reset()
+static u32     sg_frames = 0;       // S2MM completions
+static u32     fail_at[SIM_MAX_FAILS];
+static int     fail_cnt = 0;
+
+void sim_dma_configure(void)
+{
+    const char *lat = getenv("SIM_DMA_LATENCY_US");
+    u32 us = lat ? (u32)strtoul(lat, NULL, 0) : 2000;
+
+    latency_ticks = (XTime)us * (COUNTS_PER_SECOND / 1000000);
+    printf("[SIM] DMA model: bicubic x4 (nearest otherwise), latency %u us%s\n", us,
+           SIM_HAS_SG ? ", SG engine" : "");
+
+    const char *fail = getenv("SIM_DMA_FAIL_FRAMES");
+    for (char *p = (char *)fail; p && *p && fail_cnt < SIM_MAX_FAILS; ) {
+        u32 n = (u32)strtoul(p, &p, 0);
+        if (n) fail_at[fail_cnt++] = n;
+        if (*p) p++;
+    }
+    if (fail_cnt) printf("[SIM] DMA model: %d S2MM completions will fail (%s)\n", fail_cnt, fail);
+}
+
+/* Grow the model buffers to the geometry in effect */
+static int ip_reserve(const frame_cfg_t *c)
+{
+    u32 in_bytes = frame_cfg_in_bytes();
+    u32 tmp_n    = (u32)c->in_h * c->in_w * BICUBIC_SCALE * 3;
+
+    if (in_bytes > ip_in_cap) {
+        free(ip_in);
+        ip_in = malloc(in_bytes);
+        ip_in_cap = ip_in ? in_bytes : 0;
+    }
+    if (tmp_n > ip_tmp_cap) {
+        free(ip_tmp);
+        ip_tmp = malloc(sizeof(int32_t) * tmp_n);
+        ip_tmp_cap = ip_tmp ? tmp_n : 0;
+    }
+    return (ip_in && ip_tmp) ? 0 : -1;
+}
+
+/* Any other shape: nearest-neighbour, bytes copied per pixel, rest zeroed */
+static void nearest_model(const frame_cfg_t *c, const u8 *in, u8 *out)
+{
+    u32 out_bpp = frame_cfg_out_packed() ? IP_OUT_BPP : c->out_bpp;
+    u32 n = (c->in_bpp < out_bpp) ? c->in_bpp : out_bpp;
+
+    for (u32 oy = 0; oy < c->out_h; oy++) {
+        const u8 *row = in + (size_t)(oy * c->in_h / c->out_h) * c->in_w * c->in_bpp;
+        for (u32 ox = 0; ox < c->out_w; ox++) {
+            const u8 *sp = row + (size_t)(ox * c->in_w / c->out_w) * c->in_bpp;
+            u8 *dp = out + ((size_t)oy * c->out_w + ox) * out_bpp;
+            memset(dp, 0, out_bpp);
+            memcpy(dp + out_bpp - n, sp, n);
+        }
+    }
+}
+
+static void chan_irq(sim_chan_t *ch, u32 irq_id)
+{
+    ch->irq_sts |= XAXIDMA_IRQ_IOC_MASK;
+    if (ch->irq_mask & XAXIDMA_IRQ_IOC_MASK) sim_raise_irq(irq_id);
+}
+
+static void sg_tick(void);
+
+/* Called from the xemacif_input() pump */
+void sim_dma_tick(void)
+{
+    if (sim_inst && sim_inst->HasSg) {
+        sg_tick();
+        return;
+    }
+    if (!s2mm.busy || s2mm_due == 0) return;
+
+    XTime now;
+    XTime_GetTime(&now);
+    if (now < s2mm_due) return;
+
+    s2mm_due  = 0;
+    s2mm.busy = 0;
+    chan_irq(&s2mm, XPAR_FABRIC_AXI_DMA_0_S2MM_INTROUT_INTR);
+}
+
+/* IP consumed a full input frame: produce the output, schedule S2MM */
+static int run_ip(void)
+{
+    XTime now;
+    const frame_cfg_t *c = frame_cfg_get();
+
+    /* The IP writes ABGR32 even when the session gets BGR24 (pix_pack.c) */
+    if (s2mm.len < frame_cfg_ip_out_bytes()) {
+        fprintf(stderr, "[SIM] S2MM buffer too small (%u)\n", s2mm.len);
+        return -1;
+    }
+    if (c->scale == BICUBIC_SCALE && c->in_fmt == PIXFMT_BGR24 &&
+        (c->out_fmt == PIXFMT_ABGR32 || c->out_fmt == PIXFMT_BGR24))
+        bicubic_x4_bgr24_to_abgr32(ip_in, c->in_w, c->in_h, s2mm.buf, ip_tmp);
+    else
+        nearest_model(c, ip_in, s2mm.buf);
+    ip_in_fill = 0;
+
+    XTime_GetTime(&now);
+    s2mm_due = now + latency_ticks;
+    return 0;
+}
+
+/* -------------------------------------------------------------------------- */
+/* SG engine                                                                  */
+/* -------------------------------------------------------------------------- */
+static XAxiDma_Bd *ring_bd(XAxiDma_BdRing *r, int i)
+{
+    return &r->FirstBdAddr[i % r->AllCnt];
+}
+
+static sim_chan_t *ring_chan(XAxiDma_BdRing *r)
+{
+    return (r == &sim_inst->RxBdRing) ? &s2mm : &mm2s;
+}
+
+/* First BD handed to the hardware that it has not completed yet */
+static XAxiDma_Bd *hw_next(XAxiDma_BdRing *r)
+{
+    for (int i = 0; i < r->HwCnt; i++) {
+        XAxiDma_Bd *bd = ring_bd(r, r->HwHead + i);
+        if (!(bd->Sts & XAXIDMA_BD_STS_COMPLETE_MASK)) return bd;
+    }
+    return NULL;
+}
+
+static int fail_due(u32 frame)
+{
+    for (int i = 0; i < fail_cnt; i++)
+        if (fail_at[i] == frame) return 1;
+    return 0;
+}
+
+/* Complete bd with an error and halt the engine */
+static void sg_error(sim_chan_t *ch, u32 irq_id, XAxiDma_Bd *bd, const char *why)
+{
+    printf("[SIM] DMA error: %s, engine halted\n", why);
+    bd->Sts = XAXIDMA_BD_STS_COMPLETE_MASK | XAXIDMA_BD_STS_INT_ERR_MASK;
+    sg_halted = 1;
+    ch->irq_sts |= XAXIDMA_IRQ_ERROR_MASK;
+    if (ch->irq_mask & XAXIDMA_IRQ_ERROR_MASK) sim_raise_irq(irq_id);
+}
+
+/* Finish the output in flight, then feed the IP one frame of TX BDs */
+static void sg_tick(void)
+{
+    XAxiDma_BdRing *tx = &sim_inst->TxBdRing;
+    XAxiDma_BdRing *rx = &sim_inst->RxBdRing;
+    XAxiDma_Bd *bd, *out;
+    XTime now;
+    int fed = 0;
+
+    if (sg_halted || !tx->RunState || !rx->RunState) return;
+
+    if (sg_out_bd) {
+        XTime_GetTime(&now);
+        if (now < s2mm_due) return;
+        out = sg_out_bd;
+        sg_out_bd = NULL;
+        s2mm_due  = 0;
+        if (fail_due(++sg_frames)) {
+            sg_error(&s2mm, XPAR_FABRIC_AXI_DMA_0_S2MM_INTROUT_INTR, out, "injected S2MM error");
+            return;
+        }
+        out->Sts = XAXIDMA_BD_STS_COMPLETE_MASK | XAXIDMA_BD_STS_RXSOF_MASK |
+                   XAXIDMA_BD_STS_RXEOF_MASK | frame_cfg_ip_out_bytes();
+        chan_irq(&s2mm, XPAR_FABRIC_AXI_DMA_0_S2MM_INTROUT_INTR);
+    }
+
+    /* The IP holds its input stream until there is somewhere to write */
+    out = hw_next(rx);
+    if (!out || ip_reserve(frame_cfg_get()) != 0) return;
+
+    while ((bd = hw_next(tx)) != NULL) {
+        if (ip_in_fill + bd->Length > frame_cfg_in_bytes()) {
+            sg_error(&s2mm, XPAR_FABRIC_AXI_DMA_0_S2MM_INTROUT_INTR, out,
+                     "input runs past the frame (TXEOF missing)");
+            return;
+        }
+        memcpy(ip_in + ip_in_fill, (const void *)bd->BufAddr, bd->Length);
+        ip_in_fill += bd->Length;
+        bd->Sts = XAXIDMA_BD_STS_COMPLETE_MASK | bd->Length;
+        fed = 1;
+
+        if (bd->Ctrl & XAXIDMA_BD_CTRL_TXEOF_MASK) {
+            if (ip_in_fill != frame_cfg_in_bytes()) {
+                printf("[SIM] TLAST after %u of %u input bytes\n", ip_in_fill, frame_cfg_in_bytes());
+                sg_error(&s2mm, XPAR_FABRIC_AXI_DMA_0_S2MM_INTROUT_INTR, out, "short input frame");
+                return;
+            }
+            s2mm.buf = (u8 *)out->BufAddr;
+            s2mm.len = out->Length;
+            if (run_ip() != 0) {
+                sg_error(&s2mm, XPAR_FABRIC_AXI_DMA_0_S2MM_INTROUT_INTR, out, "S2MM buffer too small");
+                return;
+            }
+            sg_out_bd = out;
+            break;
+        }
+    }
+    if (fed) chan_irq(&mm2s, XPAR_FABRIC_AXI_DMA_0_MM2S_INTROUT_INTR);
+}
+
+/* -------------------------------------------------------------------------- */
+/* Driver API                                                                 */
+/* -------------------------------------------------------------------------- */
+XAxiDma_Config *XAxiDma_LookupConfigBaseAddr(UINTPTR Baseaddr)
+{
+    return (Baseaddr == sim_cfg.BaseAddr) ? &sim_cfg : NULL;
+}
+
+int XAxiDma_CfgInitialize(XAxiDma *InstancePtr, XAxiDma_Config *Config)
+{
+    if (!Config) return XST_FAILURE;
+    memset(InstancePtr, 0, sizeof(*InstancePtr));
+    InstancePtr->RegBase     = Config->BaseAddr;
+    InstancePtr->HasSg       = Config->HasSg;
+    InstancePtr->Initialized = 1;
+    sim_inst = InstancePtr;
+    return XST_SUCCESS;
+}
+
+u32 XAxiDma_SimpleTransfer(XAxiDma *InstancePtr, UINTPTR BuffAddr, u32 Length,
+                           int Direction)
+{
+    if (InstancePtr->HasSg) return XST_FAILURE;
+
+    if (Direction == XAXIDMA_DEVICE_TO_DMA) {
+        if (s2mm.busy) return XST_FAILURE;
+        s2mm.busy = 1;
+        s2mm.buf  = (u8 *)BuffAddr;
+        s2mm.len  = Length;
+        return XST_SUCCESS;
+    }
+
+    if (mm2s.busy || ip_reserve(frame_cfg_get()) != 0 ||
+        ip_in_fill + Length > frame_cfg_in_bytes()) return XST_FAILURE;
+
+    /* The stream is consumed as fast as it is fed; MM2S completes at once */
+    memcpy(ip_in + ip_in_fill, (const void *)BuffAddr, Length);
+    ip_in_fill += Length;
+    chan_irq(&mm2s, XPAR_FABRIC_AXI_DMA_0_MM2S_INTROUT_INTR);
+
+    if (ip_in_fill == frame_cfg_in_bytes() && s2mm.busy) run_ip();
+    return XST_SUCCESS;
+}
+
+int XAxiDma_Busy(XAxiDma *InstancePtr, int Direction)
+{
+    (void)InstancePtr;
+    if (Direction == XAXIDMA_DEVICE_TO_DMA) {
+        sim_dma_tick();
+        return s2mm.busy;
+    }
+    return mm2s.busy;
+}
+
+u32 XAxiDma_ReadReg(UINTPTR BaseAddr, u32 Offset)
+{
+    (void)BaseAddr; (void)Offset;
+    return XAXIDMA_HALTED_MASK;
+}
+
+void XAxiDma_Reset(XAxiDma *InstancePtr)
+{
+    memset(&mm2s, 0, sizeof(mm2s));
+    memset(&s2mm, 0, sizeof(s2mm));
+    ip_in_fill = 0;
+    s2mm_due   = 0;
+    sg_out_bd  = NULL;
+    sg_halted  = 0;
+    InstancePtr->TxBdRing.RunState = 0;
+    InstancePtr->RxBdRing.RunState = 0;
+}
+
+int XAxiDma_ResetIsDone(XAxiDma *InstancePtr) { (void)InstancePtr; return 1; }
+int XAxiDma_HasSg(XAxiDma *InstancePtr)       { return InstancePtr->HasSg; }
+
+void XAxiDma_IntrEnable(XAxiDma *InstancePtr, u32 Mask, int Direction)
+{
+    (void)InstancePtr;
+    (Direction == XAXIDMA_DEVICE_TO_DMA ? &s2mm : &mm2s)->irq_mask |= Mask;
+}
+
+void XAxiDma_IntrDisable(XAxiDma *InstancePtr, u32 Mask, int Direction)
+{
+    (void)InstancePtr;
+    (Direction == XAXIDMA_DEVICE_TO_DMA ? &s2mm : &mm2s)->irq_mask &= ~Mask;
+}
+
+u32 XAxiDma_IntrGetIrq(XAxiDma *InstancePtr, int Direction)
+{
+    (void)InstancePtr;
+    return (Direction == XAXIDMA_DEVICE_TO_DMA ? &s2mm : &mm2s)->irq_sts;
+}
+
+void XAxiDma_IntrAckIrq(XAxiDma *InstancePtr, u32 Mask, int Direction)
+{
+    (void)InstancePtr;
+    (Direction == XAXIDMA_DEVICE_TO_DMA ? &s2mm : &mm2s)->irq_sts &= ~Mask;
+}
+
+/* -------------------------------------------------------------------------- */
+/* BD rings                                                                   */
+/* -------------------------------------------------------------------------- */
+int XAxiDma_BdRingCreate(XAxiDma_BdRing *RingPtr, UINTPTR PhysAddr, UINTPTR VirtAddr,
+                         u32 Alignment, int BdCount)
+{
+    (void)PhysAddr;
+    if (BdCount <= 0 || Alignment < XAXIDMA_BD_MINIMUM_ALIGNMENT ||
+        (VirtAddr & (XAXIDMA_BD_MINIMUM_ALIGNMENT - 1))) return XST_FAILURE;
+
+    memset(RingPtr, 0, sizeof(*RingPtr));
+    RingPtr->FirstBdAddr    = (XAxiDma_Bd *)VirtAddr;
+    RingPtr->AllCnt         = BdCount;
+    RingPtr->FreeCnt        = BdCount;
+    RingPtr->MaxTransferLen = XAXIDMA_MAX_TRANSFER_LEN;
+    memset(RingPtr->FirstBdAddr, 0, sizeof(XAxiDma_Bd) * BdCount);
+    return XST_SUCCESS;
+}
+
+int XAxiDma_BdRingClone(XAxiDma_BdRing *RingPtr, XAxiDma_Bd *SrcBdPtr)
+{
+    if (RingPtr->FreeCnt != RingPtr->AllCnt || RingPtr->RunState) return XST_FAILURE;
+    for (int i = 0; i < RingPtr->AllCnt; i++) {
+        RingPtr->FirstBdAddr[i]     = *SrcBdPtr;
+        RingPtr->FirstBdAddr[i].Sts = 0;
+    }
+    return XST_SUCCESS;
+}
+
+int XAxiDma_BdRingStart(XAxiDma_BdRing *RingPtr)
+{
+    RingPtr->RunState = 1;
+    sg_tick();
+    return XST_SUCCESS;
+}
+
+void XAxiDma_BdRingIntEnable(XAxiDma_BdRing *RingPtr, u32 Mask)  { ring_chan(RingPtr)->irq_mask |= Mask; }
+void XAxiDma_BdRingIntDisable(XAxiDma_BdRing *RingPtr, u32 Mask) { ring_chan(RingPtr)->irq_mask &= ~Mask; }
+int  XAxiDma_BdRingGetFreeCnt(XAxiDma_BdRing *RingPtr)           { return RingPtr->FreeCnt; }
+
+int XAxiDma_BdRingAlloc(XAxiDma_BdRing *RingPtr, int NumBd, XAxiDma_Bd **BdSetPtr)
+{
+    if (NumBd <= 0 || NumBd > RingPtr->FreeCnt) return XST_FAILURE;
+    *BdSetPtr = ring_bd(RingPtr, RingPtr->FreeHead);
+    RingPtr->FreeHead = (RingPtr->FreeHead + NumBd) % RingPtr->AllCnt;
+    RingPtr->FreeCnt -= NumBd;
+    RingPtr->PreCnt  += NumBd;
+    return XST_SUCCESS;
+}
+
+/* Only the BDs allocated last can go back */
+int XAxiDma_BdRingUnAlloc(XAxiDma_BdRing *RingPtr, int NumBd, XAxiDma_Bd *BdSetPtr)
+{
+    int head = (RingPtr->FreeHead + RingPtr->AllCnt - NumBd) % RingPtr->AllCnt;
+
+    if (NumBd <= 0 || NumBd > RingPtr->PreCnt || BdSetPtr != ring_bd(RingPtr, head))
+        return XST_FAILURE;
+    RingPtr->FreeHead = head;
+    RingPtr->FreeCnt += NumBd;
+    RingPtr->PreCnt  -= NumBd;
+    return XST_SUCCESS;
+}
+
+int XAxiDma_BdRingToHw(XAxiDma_BdRing *RingPtr, int NumBd, XAxiDma_Bd *BdSetPtr)
+{
+    if (NumBd <= 0 || NumBd > RingPtr->PreCnt || BdSetPtr != ring_bd(RingPtr, RingPtr->PreHead))
+        return XST_FAILURE;
+    for (int i = 0; i < NumBd; i++) ring_bd(RingPtr, RingPtr->PreHead + i)->Sts = 0;
+    RingPtr->PreHead = (RingPtr->PreHead + NumBd) % RingPtr->AllCnt;
+    RingPtr->PreCnt -= NumBd;
+    RingPtr->HwCnt  += NumBd;
+    sg_tick();
+    return XST_SUCCESS;
+}
+
+/* Completed BDs, oldest first, up to BdLimit; stops at the first busy one */
+int XAxiDma_BdRingFromHw(XAxiDma_BdRing *RingPtr, int BdLimit, XAxiDma_Bd **BdSetPtr)
+{
+    int n = 0;
+
+    sg_tick();
+    while (n < RingPtr->HwCnt && n < BdLimit &&
+           (ring_bd(RingPtr, RingPtr->HwHead + n)->Sts & XAXIDMA_BD_STS_COMPLETE_MASK))
+        n++;
+    if (n == 0) {
+        *BdSetPtr = NULL;
+        return 0;
+    }
+    *BdSetPtr = ring_bd(RingPtr, RingPtr->HwHead);
+    RingPtr->HwHead = (RingPtr->HwHead + n) % RingPtr->AllCnt;
+    RingPtr->HwCnt  -= n;
+    RingPtr->PostCnt += n;
+    return n;
+}
+
+/* Freed BDs are poisoned, so reading one after XAxiDma_BdRingFree() shows up as an error */
+int XAxiDma_BdRingFree(XAxiDma_BdRing *RingPtr, int NumBd, XAxiDma_Bd *BdSetPtr)
+{
+    if (NumBd <= 0 || NumBd > RingPtr->PostCnt || BdSetPtr != ring_bd(RingPtr, RingPtr->PostHead))
+        return XST_FAILURE;
+    for (int i = 0; i < NumBd; i++) {
+        XAxiDma_Bd *bd = ring_bd(RingPtr, RingPtr->PostHead + i);
+        bd->Sts = XAXIDMA_BD_STS_COMPLETE_MASK | XAXIDMA_BD_STS_ALL_ERR_MASK;
+        bd->Id  = 0;
+    }
+    RingPtr->PostHead = (RingPtr->PostHead + NumBd) % RingPtr->AllCnt;
+    RingPtr->PostCnt -= NumBd;
+    RingPtr->FreeCnt += NumBd;
+    return XST_SUCCESS;
+}
+
+XAxiDma_Bd *XAxiDma_BdRingNext(XAxiDma_BdRing *RingPtr, XAxiDma_Bd *BdPtr)
+{
+    return ring_bd(RingPtr, (int)(BdPtr - RingPtr->FirstBdAddr) + 1);
+}
+
+void XAxiDma_BdClear(XAxiDma_Bd *BdPtr) { memset(BdPtr, 0, sizeof(*BdPtr)); }
+
+int XAxiDma_BdSetBufAddr(XAxiDma_Bd *BdPtr, UINTPTR Addr)
+{
+    BdPtr->BufAddr = Addr;
+    return XST_SUCCESS;
+}
+
+int XAxiDma_BdSetLength(XAxiDma_Bd *BdPtr, u32 LenBytes, u32 LengthMask)
+{
+    if (LenBytes == 0 || LenBytes > LengthMask) return XST_FAILURE;
+    BdPtr->Length = LenBytes;
+    return XST_SUCCESS;
+}
+
+void XAxiDma_BdSetCtrl(XAxiDma_Bd *BdPtr, u32 Data)        { BdPtr->Ctrl = Data & XAXIDMA_BD_CTRL_ALL_MASK; }
+void XAxiDma_BdSetId(XAxiDma_Bd *BdPtr, UINTPTR Id)        { BdPtr->Id = Id; }
+u32  XAxiDma_BdGetSts(XAxiDma_Bd *BdPtr)                   { return BdPtr->Sts; }
+UINTPTR XAxiDma_BdGetId(XAxiDma_Bd *BdPtr)                 { return BdPtr->Id; }
@@ -0,0 +1,277 @@
+/*
+ * sim_platform.c - host stand-ins for the standalone BSP and xemacpsif
+ *
+ * xemac_add() attaches lwIP to a Linux TAP device (SIM_TAP, default tap0)
+ * and xemacif_input() is the pump the firmware already calls in its loop:
+ * it drains the TAP, runs the lwIP timers and advances the DMA model.
+ * With PIPELINE_DUAL_CORE the DMA service runs in a second thread standing
+ * in for core 1, and only that thread advances the DMA model.
+ */
+
+#include <stdio.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <net/if.h>
+#include <linux/if_tun.h>
+
+#include "lwip/init.h"
+#include "lwip/netif.h"
+#include "lwip/etharp.h"
+#include "lwip/timeouts.h"
+#include "netif/ethernet.h"
+
+#include "xil_printf.h"
+#include "xil_cache.h"
+#include "xil_mmu.h"
+#include "xtime_l.h"
+#include "xscugic.h"
+#include "platform.h"
+#include "netif/xadapter.h"
+#include "pipe_ipc.h"
+#include "sim.h"
+
+#define SIM_MAX_FRAME   1600
+#define SIM_MAX_IRQ     256
+
+static int tap_fd = -1;
+
+/* Cache maintenance counters, reported at exit (bumped from both "cores") */
+static u64 flushed_bytes = 0;
+static u64 invalidated_bytes = 0;
+
+/* Registered "GIC" handlers */
+static Xil_InterruptHandler irq_handler[SIM_MAX_IRQ];
+static void *irq_ref[SIM_MAX_IRQ];
+static u8 irq_enabled[SIM_MAX_IRQ];
+
+/* -------------------------------------------------------------------------- */
+/* BSP                                                                        */
+/* -------------------------------------------------------------------------- */
+void xil_printf(const char *fmt, ...)
+{
+    va_list ap;
+    va_start(ap, fmt);
+    vprintf(fmt, ap);
+    va_end(ap);
+}
+
+void Xil_DCacheFlushRange(INTPTR adr, INTPTR len)
+{
+    (void)adr;
+    __atomic_fetch_add(&flushed_bytes, len, __ATOMIC_RELAXED);
+}
+
+void Xil_DCacheInvalidateRange(INTPTR adr, INTPTR len)
+{
+    (void)adr;
+    __atomic_fetch_add(&invalidated_bytes, len, __ATOMIC_RELAXED);
+}
+void Xil_SetTlbAttributes(UINTPTR adr, u64 attrib)      { (void)adr; (void)attrib; }
+
+void XTime_GetTime(XTime *t)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    *t = (XTime)ts.tv_sec * 1000000000ULL + (XTime)ts.tv_nsec;
+}
+
+u32_t sys_now(void)
+{
+    XTime t;
+    XTime_GetTime(&t);
+    return (u32_t)(t / 1000000ULL);
+}
+
+static void report_at_exit(void)
+{
+    printf("[SIM] cache flush %llu bytes, invalidate %llu bytes\n",
+           (unsigned long long)flushed_bytes, (unsigned long long)invalidated_bytes);
+}
+
+#if PIPELINE_DUAL_CORE
+static void *sim_core1(void *arg)
+{
+    (void)arg;
+    pipe_dma_main();
+    return NULL;
+}
+#endif
+
+void init_platform(void)
+{
+    setvbuf(stdout, NULL, _IOLBF, 0);
+    sim_dma_configure();
+    atexit(report_at_exit);
+#if PIPELINE_DUAL_CORE
+    pthread_t t;
+    if (pthread_create(&t, NULL, sim_core1, NULL) != 0) {
+        perror("[SIM] core 1 thread");
+        exit(1);
+    }
+#endif
+}
+
+void cleanup_platform(void) { }
+void platform_enable_interrupts(void) { }
+
+/* -------------------------------------------------------------------------- */
+/* GIC                                                                        */
+/* -------------------------------------------------------------------------- */
+void XScuGic_RegisterHandler(u32 BaseAddress, int InterruptID,
+                             Xil_InterruptHandler IntrHandler, void *CallBackRef)
+{
+    (void)BaseAddress;
+    if (InterruptID < 0 || InterruptID >= SIM_MAX_IRQ) return;
+    irq_handler[InterruptID] = IntrHandler;
+    irq_ref[InterruptID]     = CallBackRef;
+}
+
+void XScuGic_EnableIntr(u32 DistBaseAddress, u32 Int_Id)
+{
+    (void)DistBaseAddress;
+    if (Int_Id < SIM_MAX_IRQ) irq_enabled[Int_Id] = 1;
+}
+
+void XScuGic_DisableIntr(u32 DistBaseAddress, u32 Int_Id)
+{
+    (void)DistBaseAddress;
+    if (Int_Id < SIM_MAX_IRQ) irq_enabled[Int_Id] = 0;
+}
+
+void XScuGic_SetPriTrigTypeByDistAddr(u32 DistBaseAddress, u32 Int_Id,
+                                      u8 Priority, u8 Trigger)
+{
+    (void)DistBaseAddress; (void)Int_Id; (void)Priority; (void)Trigger;
+}
+
+static XScuGic_Config gic_cfg = { XPAR_SCUGIC_SINGLE_DEVICE_ID,
+                                   XPAR_SCUGIC_0_CPU_BASEADDR, XPAR_SCUGIC_0_DIST_BASEADDR };
+
+XScuGic_Config *XScuGic_LookupConfig(u16 DeviceId)
+{
+    return DeviceId == gic_cfg.DeviceId ? &gic_cfg : NULL;
+}
+
+s32 XScuGic_CfgInitialize(XScuGic *InstancePtr, XScuGic_Config *ConfigPtr, u32 EffectiveAddr)
+{
+    (void)EffectiveAddr;
+    InstancePtr->Config  = ConfigPtr;
+    InstancePtr->IsReady = XIL_COMPONENT_IS_READY;
+    return XST_SUCCESS;
+}
+
+s32 XScuGic_Connect(XScuGic *InstancePtr, u32 Int_Id,
+                    Xil_InterruptHandler Handler, void *CallBackRef)
+{
+    if (Int_Id >= SIM_MAX_IRQ) return XST_FAILURE;
+    XScuGic_RegisterHandler(InstancePtr->Config->CpuBaseAddress, (int)Int_Id, Handler, CallBackRef);
+    return XST_SUCCESS;
+}
+
+void XScuGic_Enable(XScuGic *InstancePtr, u32 Int_Id)
+{
+    XScuGic_EnableIntr(InstancePtr->Config->DistBaseAddress, Int_Id);
+}
+
+void XScuGic_SetPriorityTriggerType(XScuGic *InstancePtr, u32 Int_Id, u8 Priority, u8 Trigger)
+{
+    (void)InstancePtr; (void)Int_Id; (void)Priority; (void)Trigger;
+}
+
+/* Deliver an interrupt synchronously, as if it fired between two polls */
+void sim_raise_irq(u32 id)
+{
+    if (id < SIM_MAX_IRQ && irq_enabled[id] && irq_handler[id])
+        irq_handler[id](irq_ref[id]);
+}
+
+/* -------------------------------------------------------------------------- */
+/* TAP netif                                                                  */
+/* -------------------------------------------------------------------------- */
+static err_t tap_linkoutput(struct netif *netif, struct pbuf *p)
+{
+    u8 frame[SIM_MAX_FRAME];
+    (void)netif;
+
+    if (p->tot_len > sizeof(frame)) return ERR_BUF;
+    pbuf_copy_partial(p, frame, p->tot_len, 0);
+    if (write(tap_fd, frame, p->tot_len) != p->tot_len) return ERR_IF;
+    return ERR_OK;
+}
+
+static err_t tap_netif_init(struct netif *netif)
+{
+    netif->name[0]    = 't';
+    netif->name[1]    = 'p';
+    netif->output     = etharp_output;
+    netif->linkoutput = tap_linkoutput;
+    netif->mtu        = 1500;
+    netif->hwaddr_len = 6;
+    netif->flags      = NETIF_FLAG_BROADCAST | NETIF_FLAG_ETHARP |
+                        NETIF_FLAG_ETHERNET | NETIF_FLAG_LINK_UP;
+    return ERR_OK;
+}
+
+struct netif *xemac_add(struct netif *netif, ip_addr_t *ipaddr, ip_addr_t *netmask,
+                        ip_addr_t *gw, unsigned char *mac_ethernet_address,
+                        UINTPTR mac_baseaddr)
+{
+    const char *name = getenv("SIM_TAP");
+    struct ifreq ifr;
+    (void)mac_baseaddr;
+
+    tap_fd = open("/dev/net/tun", O_RDWR | O_NONBLOCK);
+    if (tap_fd < 0) {
+        perror("[SIM] open /dev/net/tun");
+        return NULL;
+    }
+    memset(&ifr, 0, sizeof(ifr));
+    ifr.ifr_flags = IFF_TAP | IFF_NO_PI;
+    strncpy(ifr.ifr_name, name ? name : "tap0", IFNAMSIZ - 1);
+    if (ioctl(tap_fd, TUNSETIFF, &ifr) < 0) {
+        perror("[SIM] TUNSETIFF");
+        close(tap_fd);
+        return NULL;
+    }
+
+    memcpy(netif->hwaddr, mac_ethernet_address, 6);
+    if (!netif_add(netif, ipaddr, netmask, gw, NULL, tap_netif_init, ethernet_input))
+        return NULL;
+
+    printf("[SIM] attached to %s\n", ifr.ifr_name);
+    return netif;
+}
+
+/* evq idle: block until the TAP has a frame or max_us passes */
+int sim_idle(u32 max_us)
+{
+    struct pollfd pfd = { .fd = tap_fd, .events = POLLIN };
+    return poll(&pfd, 1, (int)((max_us + 999) / 1000)) > 0;
+}
+
+int xemacif_input(struct netif *netif)
+{
+    u8 frame[SIM_MAX_FRAME];
+    int n, frames = 0;
+
+    while ((n = read(tap_fd, frame, sizeof(frame))) > 0) {
+        struct pbuf *p = pbuf_alloc(PBUF_RAW, (u16_t)n, PBUF_POOL);
+        if (!p) break;
+        pbuf_take(p, frame, (u16_t)n);
+        if (netif->input(p, netif) != ERR_OK) pbuf_free(p);
+        frames++;
+    }
+
+    sys_check_timeouts();
+#if !PIPELINE_DUAL_CORE
+    sim_dma_tick();
+#endif
+    return frames;
+}
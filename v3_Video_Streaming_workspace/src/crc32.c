@@ -0,0 +1,54 @@
+/*
+ * crc32.c - CRC-32 for frame payloads
+ *
+ * Uses the ARMv8 CRC32 instructions when the compiler targets them (A53 has
+ * the extension; add -march=armv8-a+crc), otherwise a 1 KB table.
+ */
+
+#include "crc32.h"
+
+#if defined(__ARM_FEATURE_CRC32)
+#include <arm_acle.h>
+
+u32 crc32_update(u32 crc, const u8 *buf, u32 len)
+{
+    crc = ~crc;
+    while (len && ((UINTPTR)buf & 7)) {
+        crc = __crc32b(crc, *buf++);
+        len--;
+    }
+    while (len >= 8) {
+        crc = __crc32d(crc, *(const u64 *)buf);
+        buf += 8;
+        len -= 8;
+    }
+    while (len--) crc = __crc32b(crc, *buf++);
+    return ~crc;
+}
+
+#else
+
+static u32 crc_table[256];
+static int crc_table_ready = 0;
+
+static void crc32_init_table(void)
+{
+    for (u32 i = 0; i < 256; i++) {
+        u32 c = i;
+        for (int k = 0; k < 8; k++)
+            c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+        crc_table[i] = c;
+    }
+    crc_table_ready = 1;
+}
+
+u32 crc32_update(u32 crc, const u8 *buf, u32 len)
+{
+    if (!crc_table_ready) crc32_init_table();
+
+    crc = ~crc;
+    while (len--) crc = crc_table[(crc ^ *buf++) & 0xFF] ^ (crc >> 8);
+    return ~crc;
+}
+
+#endif
@@ -0,0 +1,13 @@
+/*
+ * crc32.h - CRC-32 (IEEE 802.3, reflected 0xEDB88320), zlib compatible
+ */
+
+#ifndef CRC32_H
+#define CRC32_H
+
+#include "xil_types.h"
+
+/* Start with crc = 0; feed chunks in order */
+u32 crc32_update(u32 crc, const u8 *buf, u32 len);
+
+#endif /* CRC32_H */
@@ -0,0 +1,481 @@
+/*
+ * dma.c - AXI DMA backend, non-blocking
+ *
+ * Simple mode: a job is submitted S2MM first, then MM2S one segment at a
+ * time; dma_poll() advances it without blocking so the caller keeps pumping
+ * lwIP while the IP is working. With DMA_USE_INTERRUPTS the MM2S/S2MM IOC
+ * interrupts post completions and dma_poll() never touches the status
+ * registers.
+ *
+ * SG mode (DMA_USE_SG): each job is one S2MM BD plus one MM2S BD per input
+ * segment (SOF on the first, EOF on the last), and up to DMA_SG_DEPTH jobs
+ * sit in the BD rings at once. Jobs complete in submission order.
+ */
+
+#include "xparameters.h"
+#include "xil_printf.h"
+#include "xaxidma.h"
+#include "xtime_l.h"
+#include "dma.h"
+#include "frame_cache.h"
+#include "evq.h"
+#if DMA_USE_INTERRUPTS
+#include "xscugic.h"
+#endif
+
+#define DMA_TIMEOUT_TICKS   ((XTime)DMA_TIMEOUT_US * (COUNTS_PER_SECOND / 1000000))
+
+/* DMA and DMA configuration */
+XAxiDma myDma;
+XAxiDma_Config *myDmaConfig;
+
+static dma_job_t *cur_job = NULL;
+static dma_stats_t dma_stats;
+static int dma_dead = 0;            // recovery failed: every poll is DMA_ERROR
+
+#if DMA_USE_SG
+#define SG_TX_BDS   (DMA_SG_DEPTH * DMA_MAX_SEGS)
+#define SG_RX_BDS   (DMA_SG_DEPTH)
+
+/* BD rings */
+static u8 sg_tx_bd_space[XAxiDma_BdRingMemCalc(XAXIDMA_BD_MINIMUM_ALIGNMENT, SG_TX_BDS)]
+    __attribute__((aligned(XAXIDMA_BD_MINIMUM_ALIGNMENT)));
+static u8 sg_rx_bd_space[XAxiDma_BdRingMemCalc(XAXIDMA_BD_MINIMUM_ALIGNMENT, SG_RX_BDS)]
+    __attribute__((aligned(XAXIDMA_BD_MINIMUM_ALIGNMENT)));
+
+/* Queued jobs, oldest first */
+static dma_job_t *sg_jobs[DMA_SG_DEPTH];
+static int sg_head = 0;
+static int sg_cnt  = 0;
+#endif
+
+#if DMA_USE_INTERRUPTS
+/* Completion counters: bumped by the ISRs, compared in dma_poll() */
+static volatile u32 mm2s_irq_cnt = 0;
+static volatile u32 s2mm_irq_cnt = 0;
+static volatile u32 dma_irq_err  = 0;
+static u32 mm2s_seen = 0;
+static u32 s2mm_seen = 0;
+#endif
+
+/* DMA checkHalted function declare */
+u32 checkHalted(u32 baseAddress, u32 offset) {
+    return (XAxiDma_ReadReg(baseAddress, offset)) & XAXIDMA_HALTED_MASK;
+}
+
+#if DMA_USE_INTERRUPTS
+/* -------------------------------------------------------------------------- */
+/* Interrupts                                                                 */
+/* -------------------------------------------------------------------------- */
+static void dma_mm2s_isr(void *ref)
+{
+    XAxiDma *dma = (XAxiDma *)ref;
+    u32 irq = XAxiDma_IntrGetIrq(dma, XAXIDMA_DMA_TO_DEVICE);
+    XAxiDma_IntrAckIrq(dma, irq, XAXIDMA_DMA_TO_DEVICE);
+
+    if (irq & XAXIDMA_IRQ_ERROR_MASK) dma_irq_err = 1;
+    if (irq & XAXIDMA_IRQ_IOC_MASK)   mm2s_irq_cnt++;
+    evq_post(EV_DMA);
+}
+
+static void dma_s2mm_isr(void *ref)
+{
+    XAxiDma *dma = (XAxiDma *)ref;
+    u32 irq = XAxiDma_IntrGetIrq(dma, XAXIDMA_DEVICE_TO_DMA);
+    XAxiDma_IntrAckIrq(dma, irq, XAXIDMA_DEVICE_TO_DMA);
+
+    if (irq & XAXIDMA_IRQ_ERROR_MASK) dma_irq_err = 1;
+    if (irq & XAXIDMA_IRQ_IOC_MASK)   s2mm_irq_cnt++;
+    evq_post(EV_DMA);
+}
+
+/* The GIC itself is brought up by init_platform() for the lwIP timer */
+static int dma_setup_interrupts(void)
+{
+    XScuGic *gic = evq_gic();
+
+    if (!gic ||
+        XScuGic_Connect(gic, DMA_MM2S_IRQ_ID, dma_mm2s_isr, &myDma) != XST_SUCCESS ||
+        XScuGic_Connect(gic, DMA_S2MM_IRQ_ID, dma_s2mm_isr, &myDma) != XST_SUCCESS) {
+        xil_printf("[ERROR] DMA interrupt connect failed\r\n");
+        return -1;
+    }
+
+    /* Rising edge, priority below the EMAC */
+    XScuGic_SetPriorityTriggerType(gic, DMA_MM2S_IRQ_ID, 0xA0, 0x3);
+    XScuGic_SetPriorityTriggerType(gic, DMA_S2MM_IRQ_ID, 0xA0, 0x3);
+
+    XAxiDma_IntrEnable(&myDma, XAXIDMA_IRQ_IOC_MASK | XAXIDMA_IRQ_ERROR_MASK,
+                       XAXIDMA_DMA_TO_DEVICE);
+    XAxiDma_IntrEnable(&myDma, XAXIDMA_IRQ_IOC_MASK | XAXIDMA_IRQ_ERROR_MASK,
+                       XAXIDMA_DEVICE_TO_DMA);
+
+    XScuGic_Enable(gic, DMA_MM2S_IRQ_ID);
+    XScuGic_Enable(gic, DMA_S2MM_IRQ_ID);
+    return 0;
+}
+#endif
+
+#if DMA_USE_SG
+/* -------------------------------------------------------------------------- */
+/* SG: build and start both BD rings                                          */
+/* -------------------------------------------------------------------------- */
+static int sg_setup_ring(XAxiDma_BdRing *ring, u8 *space, int nbds)
+{
+    XAxiDma_Bd tmpl;
+
+    XAxiDma_BdRingIntDisable(ring, XAXIDMA_IRQ_ALL_MASK);
+    if (XAxiDma_BdRingCreate(ring, (UINTPTR)space, (UINTPTR)space,
+                             XAXIDMA_BD_MINIMUM_ALIGNMENT, nbds) != XST_SUCCESS)
+        return -1;
+
+    XAxiDma_BdClear(&tmpl);
+    if (XAxiDma_BdRingClone(ring, &tmpl) != XST_SUCCESS) return -1;
+#if DMA_USE_INTERRUPTS
+    XAxiDma_BdRingIntEnable(ring, XAXIDMA_IRQ_IOC_MASK | XAXIDMA_IRQ_ERROR_MASK);
+#endif
+    if (XAxiDma_BdRingStart(ring) != XST_SUCCESS) return -1;
+    return 0;
+}
+
+static int sg_setup(void)
+{
+    if (!XAxiDma_HasSg(&myDma)) {
+        xil_printf("[ERROR] DMA_USE_SG set but axi_dma_0 has no SG engine\r\n");
+        return -1;
+    }
+    if (sg_setup_ring(XAxiDma_GetTxRing(&myDma), sg_tx_bd_space, SG_TX_BDS) != 0 ||
+        sg_setup_ring(XAxiDma_GetRxRing(&myDma), sg_rx_bd_space, SG_RX_BDS) != 0) {
+        xil_printf("[ERROR] DMA BD ring setup failed\r\n");
+        return -1;
+    }
+    sg_head = sg_cnt = 0;
+    return 0;
+}
+#endif
+
+/*
+ * Abort a stuck job: reset both channels so the next submit starts clean.
+ * If the reset does not finish or the rings cannot be rebuilt the DMA is
+ * left dead: no more submits, and every dma_poll() returns DMA_ERROR.
+ */
+static void dma_recover(void)
+{
+    XTime t0, now;
+
+    dma_stats.errors++;
+    cur_job = NULL;
+    dma_stats.depth = 0;
+    XAxiDma_Reset(&myDma);
+    XTime_GetTime(&t0);
+    while (!XAxiDma_ResetIsDone(&myDma)) {
+        XTime_GetTime(&now);
+        if (now - t0 > DMA_TIMEOUT_TICKS) {
+            xil_printf("[ERROR] DMA reset timeout, DMA stopped\n\r");
+            dma_dead = 1;
+            return;
+        }
+    }
+#if DMA_USE_SG
+    if (sg_setup() != 0) {
+        xil_printf("[ERROR] DMA recovery failed, DMA stopped\n\r");
+        dma_dead = 1;
+        return;
+    }
+#endif
+#if DMA_USE_INTERRUPTS
+    XAxiDma_IntrEnable(&myDma, XAXIDMA_IRQ_IOC_MASK | XAXIDMA_IRQ_ERROR_MASK,
+                       XAXIDMA_DMA_TO_DEVICE);
+    XAxiDma_IntrEnable(&myDma, XAXIDMA_IRQ_IOC_MASK | XAXIDMA_IRQ_ERROR_MASK,
+                       XAXIDMA_DEVICE_TO_DMA);
+    mm2s_seen   = mm2s_irq_cnt;
+    s2mm_seen   = s2mm_irq_cnt;
+    dma_irq_err = 0;
+#endif
+}
+
+int dma_init(void)
+{
+    u32 status;
+
+    myDmaConfig = XAxiDma_LookupConfigBaseAddr(XPAR_AXI_DMA_0_BASEADDR);
+	status = XAxiDma_CfgInitialize(&myDma, myDmaConfig);
+	if (status != XST_SUCCESS) {
+		xil_printf("DMA initialization failed\r\n");
+		return -1;
+	}
+	xil_printf("DMA initialization success..\r\n");
+	status = checkHalted(XPAR_AXI_DMA_0_BASEADDR, 0x4);
+	xil_printf("Status before data transfer: %0x\r\n", status);
+
+#if DMA_USE_SG
+    if (sg_setup() != 0) return -1;
+    dma_stats.ring_size = DMA_SG_DEPTH;
+    xil_printf("DMA SG mode, %d frames deep (%d MM2S BDs)\r\n", DMA_SG_DEPTH, SG_TX_BDS);
+#else
+    dma_stats.ring_size = 1;
+#endif
+
+#if DMA_USE_INTERRUPTS
+    if (dma_setup_interrupts() != 0) return -1;
+    xil_printf("DMA IOC interrupts enabled (mm2s=%d, s2mm=%d)\r\n",
+               DMA_MM2S_IRQ_ID, DMA_S2MM_IRQ_ID);
+#else
+    XAxiDma_IntrDisable(&myDma, XAXIDMA_IRQ_ALL_MASK, XAXIDMA_DMA_TO_DEVICE);
+    XAxiDma_IntrDisable(&myDma, XAXIDMA_IRQ_ALL_MASK, XAXIDMA_DEVICE_TO_DMA);
+#endif
+    return 0;
+}
+
+#if DMA_USE_SG
+int dma_can_submit(void) { return !dma_dead && sg_cnt < DMA_SG_DEPTH; }
+#else
+int dma_can_submit(void) { return !dma_dead && cur_job == NULL; }
+#endif
+
+static void stats_push(void)
+{
+    if (++dma_stats.depth > dma_stats.depth_max) dma_stats.depth_max = dma_stats.depth;
+}
+
+void dma_get_stats(dma_stats_t *st) { *st = dma_stats; }
+void dma_stats_reset(void) { dma_stats.depth_max = dma_stats.depth; }
+
+#if DMA_USE_SG
+/* -------------------------------------------------------------------------- */
+/* SG mode                                                                    */
+/* -------------------------------------------------------------------------- */
+/* Queue one job: S2MM BD first, then the MM2S chain */
+int dma_submit(dma_job_t *job)
+{
+    XAxiDma_BdRing *tx = XAxiDma_GetTxRing(&myDma);
+    XAxiDma_BdRing *rx = XAxiDma_GetRxRing(&myDma);
+    XAxiDma_Bd *rx_bd, *tx_bd, *bd;
+
+    if (dma_dead || sg_cnt == DMA_SG_DEPTH) return -1;
+    if (XAxiDma_BdRingGetFreeCnt(tx) < job->nsegs) return -1;
+
+    /* Input was written back by the RX ring when the frame completed */
+
+    if (XAxiDma_BdRingAlloc(rx, 1, &rx_bd) != XST_SUCCESS) return -1;
+    XAxiDma_BdSetBufAddr(rx_bd, (UINTPTR)job->out);
+    XAxiDma_BdSetLength(rx_bd, job->out_len, rx->MaxTransferLen);
+    XAxiDma_BdSetCtrl(rx_bd, 0);
+    XAxiDma_BdSetId(rx_bd, (UINTPTR)job);
+
+    if (XAxiDma_BdRingAlloc(tx, job->nsegs, &tx_bd) != XST_SUCCESS) {
+        XAxiDma_BdRingUnAlloc(rx, 1, rx_bd);
+        return -1;
+    }
+    bd = tx_bd;
+    for (int i = 0; i < job->nsegs; i++) {
+        u32 ctrl = 0;
+        if (i == 0)              ctrl |= XAXIDMA_BD_CTRL_TXSOF_MASK;
+        if (i == job->nsegs - 1) ctrl |= XAXIDMA_BD_CTRL_TXEOF_MASK;
+        XAxiDma_BdSetBufAddr(bd, (UINTPTR)job->segs[i].ptr);
+        XAxiDma_BdSetLength(bd, job->segs[i].len, tx->MaxTransferLen);
+        XAxiDma_BdSetCtrl(bd, ctrl);
+        XAxiDma_BdSetId(bd, (UINTPTR)job);
+        bd = (XAxiDma_Bd *)XAxiDma_BdRingNext(tx, bd);
+    }
+
+    if (XAxiDma_BdRingToHw(rx, 1, rx_bd) != XST_SUCCESS ||
+        XAxiDma_BdRingToHw(tx, job->nsegs, tx_bd) != XST_SUCCESS) {
+        xil_printf("[ERROR] DMA BD submission failed\n\r");
+        dma_recover();
+        return -1;
+    }
+
+    job->seg_next  = job->nsegs;
+    job->mm2s_done = 0;
+    if (sg_cnt == 0) {
+        XTime_GetTime(&job->t_stage);
+        job->t_start = job->t_stage;
+    }
+    sg_jobs[(sg_head + sg_cnt) % DMA_SG_DEPTH] = job;
+    sg_cnt++;
+    stats_push();
+    return 0;
+}
+
+/* Reap finished BDs; one S2MM BD completing retires the oldest job */
+int dma_poll(dma_job_t **done)
+{
+    XAxiDma_BdRing *tx = XAxiDma_GetTxRing(&myDma);
+    XAxiDma_BdRing *rx = XAxiDma_GetRxRing(&myDma);
+    XAxiDma_Bd *bd;
+    int n;
+
+    if (dma_dead) return DMA_ERROR;
+    if (sg_cnt == 0) return DMA_IDLE;
+    dma_job_t *job = sg_jobs[sg_head];
+
+#if DMA_USE_INTERRUPTS
+    if (dma_irq_err) {
+        xil_printf("[ERROR] DMA error interrupt\n\r");
+        dma_recover();
+        return DMA_ERROR;
+    }
+#endif
+
+    /* Return finished MM2S BDs to the free pool */
+    n = XAxiDma_BdRingFromHw(tx, XAXIDMA_ALL_BDS, &bd);
+    if (n > 0) XAxiDma_BdRingFree(tx, n, bd);
+
+    if (XAxiDma_BdRingFromHw(rx, 1, &bd) == 0) {
+        XTime now;
+        XTime_GetTime(&now);
+        if (now - job->t_stage > DMA_TIMEOUT_TICKS) {
+            xil_printf("[ERROR] SG frame timeout!\n\r");
+            dma_recover();
+            return DMA_ERROR;
+        }
+        return DMA_BUSY;
+    }
+
+    /* Read the BD before it goes back to the free pool */
+    u32 sts = XAxiDma_BdGetSts(bd);
+    dma_job_t *id = (dma_job_t *)XAxiDma_BdGetId(bd);
+    XAxiDma_BdRingFree(rx, 1, bd);
+    if ((sts & XAXIDMA_BD_STS_ALL_ERR_MASK) || id != job) {
+        xil_printf("[ERROR] S2MM BD error (sts=0x%08x)\n\r", sts);
+        dma_recover();
+        return DMA_ERROR;
+    }
+
+    XTime_GetTime(&job->t_s2mm);
+    job->t_mm2s = job->t_s2mm;
+    frame_buf_invalidate(job->out, job->out_len);
+
+    job->mm2s_done = 1;
+    sg_head = (sg_head + 1) % DMA_SG_DEPTH;
+    sg_cnt--;
+    dma_stats.depth--;
+    if (sg_cnt > 0) {
+        XTime_GetTime(&sg_jobs[sg_head]->t_stage);
+        sg_jobs[sg_head]->t_start = sg_jobs[sg_head]->t_stage;
+    }
+
+    *done = job;
+    return DMA_DONE;
+}
+
+#else
+/* MM2S channel ready for the next segment */
+static int mm2s_idle(void)
+{
+#if DMA_USE_INTERRUPTS
+    if (mm2s_seen == mm2s_irq_cnt) return 0;
+    mm2s_seen++;
+    return 1;
+#else
+    return !XAxiDma_Busy(&myDma, XAXIDMA_DMA_TO_DEVICE);
+#endif
+}
+
+/* S2MM has written the whole output frame */
+static int s2mm_idle(void)
+{
+#if DMA_USE_INTERRUPTS
+    if (s2mm_seen == s2mm_irq_cnt) return 0;
+    s2mm_seen++;
+    return 1;
+#else
+    return !XAxiDma_Busy(&myDma, XAXIDMA_DEVICE_TO_DMA);
+#endif
+}
+
+static int submit_next_seg(dma_job_t *job)
+{
+    const rx_seg_t *seg = &job->segs[job->seg_next];
+    u32 mm2s = XAxiDma_SimpleTransfer(&myDma,
+                    (UINTPTR)seg->ptr, seg->len, XAXIDMA_DMA_TO_DEVICE);
+    if (mm2s != XST_SUCCESS) {
+    	xil_printf("[ERROR] DMA transfer submission failed (mm2s=%d, seg=%d)\n\r",
+				   mm2s, job->seg_next);
+    	return -1;
+    }
+    job->seg_next++;
+    XTime_GetTime(&job->t_stage);
+    return 0;
+}
+
+/* Start one job; returns 0 if the DMA accepted it */
+int dma_submit(dma_job_t *job)
+{
+    if (dma_dead || cur_job) return -1;
+
+    /* Input was written back by the RX ring when the frame completed */
+
+    /* Kick DMA: S2MM first, then MM2S */
+    u32 s2mm = XAxiDma_SimpleTransfer(&myDma,
+                    (UINTPTR)job->out, job->out_len, XAXIDMA_DEVICE_TO_DMA);
+    if (s2mm != XST_SUCCESS) {
+    	xil_printf("[ERROR] DMA transfer submission failed (s2mm=%d)\n\r", s2mm);
+    	return -1;
+    }
+
+    job->seg_next  = 0;
+    job->mm2s_done = 0;
+    if (submit_next_seg(job) != 0) {
+        dma_recover();
+        return -1;
+    }
+    job->t_start = job->t_stage;
+    cur_job = job;
+    stats_push();
+    return 0;
+}
+
+/*
+ * Advance the current job. Simple mode only sees copy-mode frames (dma.h
+ * refuses RX_ZERO_COPY without SG), so a job is one MM2S transfer.
+ */
+int dma_poll(dma_job_t **done)
+{
+    dma_job_t *job = cur_job;
+    if (dma_dead) return DMA_ERROR;
+    if (!job) return DMA_IDLE;
+
+#if DMA_USE_INTERRUPTS
+    if (dma_irq_err) {
+        xil_printf("[ERROR] DMA error interrupt\n\r");
+        dma_recover();
+        return DMA_ERROR;
+    }
+#endif
+
+    XTime now;
+    XTime_GetTime(&now);
+    if (now - job->t_stage > DMA_TIMEOUT_TICKS) {
+        xil_printf("[ERROR] %s timeout!\n\r", job->mm2s_done ? "S2MM" : "MM2S");
+        dma_recover();
+        return DMA_ERROR;
+    }
+
+    if (!job->mm2s_done) {
+        if (!mm2s_idle()) return DMA_BUSY;
+
+        if (job->seg_next < job->nsegs) {
+            if (submit_next_seg(job) != 0) {
+                dma_recover();
+                return DMA_ERROR;
+            }
+            return DMA_BUSY;
+        }
+        job->mm2s_done = 1;
+        job->t_stage   = now;   // S2MM drains after the last input byte
+        job->t_mm2s    = now;
+    }
+
+    if (!s2mm_idle()) return DMA_BUSY;
+
+    XTime_GetTime(&job->t_s2mm);
+    frame_buf_invalidate(job->out, job->out_len);
+
+    cur_job = NULL;
+    dma_stats.depth--;
+    *done = job;
+    return DMA_DONE;
+}
+#endif /* DMA_USE_SG */
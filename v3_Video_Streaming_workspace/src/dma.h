@@ -0,0 +1,107 @@
+/*
+ * dma.h - AXI DMA (MM2S -> AXIS IP -> S2MM) frame jobs
+ */
+
+#ifndef DMA_H
+#define DMA_H
+
+#include "xparameters.h"
+#include "xil_types.h"
+#include "xtime_l.h"
+#include "echo.h"
+
+/*
+ * DMA_USE_INTERRUPTS
+ *   0 : dma_poll() reads XAxiDma_Busy on both channels
+ *   1 : MM2S/S2MM IOC interrupts post completions; dma_poll() only checks
+ *       the counters the ISRs bump, so the lwIP pump never stalls on the DMA
+ */
+#ifndef DMA_USE_INTERRUPTS
+#define DMA_USE_INTERRUPTS  0
+#endif
+
+/*
+ * DMA_USE_SG
+ *   0 : XAxiDma_SimpleTransfer, one frame in the PL at a time
+ *   1 : scatter-gather BD rings on both channels; up to DMA_SG_DEPTH ready
+ *       frames (and their output slots) are queued so the AXIS IP streams
+ *       back-to-back with no software gap. Needs the AXI DMA built with
+ *       "Enable Scatter Gather Engine". The pipeline can only queue as many
+ *       frames as it has free output slots, so raise OUT_SLOTS with it.
+ */
+#ifndef DMA_USE_SG
+#define DMA_USE_SG          0
+#endif
+
+#ifndef DMA_SG_DEPTH
+#define DMA_SG_DEPTH        4
+#endif
+
+/*
+ * A zero-copy frame is one MM2S descriptor per pbuf payload. Simple mode
+ * would raise TLAST after each of them and the IP would frame on it.
+ */
+#if RX_ZERO_COPY && !DMA_USE_SG
+#error "zero-copy RX needs DMA_USE_SG"
+#endif
+
+#if RX_ZERO_COPY
+#define DMA_MAX_SEGS        RX_ZC_MAX_SEGS
+#else
+#define DMA_MAX_SEGS        1
+#endif
+
+/* Fabric interrupt lines of axi_dma_0 (names follow the exported XSA) */
+#ifndef DMA_MM2S_IRQ_ID
+#define DMA_MM2S_IRQ_ID     XPAR_FABRIC_AXI_DMA_0_MM2S_INTROUT_INTR
+#endif
+#ifndef DMA_S2MM_IRQ_ID
+#define DMA_S2MM_IRQ_ID     XPAR_FABRIC_AXI_DMA_0_S2MM_INTROUT_INTR
+#endif
+
+/* dma_poll() results */
+#define DMA_IDLE    0
+#define DMA_BUSY    1
+#define DMA_DONE    2
+#define DMA_ERROR   -1
+
+#define DMA_TIMEOUT_US      1000000     // max time per MM2S segment / S2MM drain
+
+/*
+ * One frame through the PL: input scatter list in, one output buffer out.
+ * The input must already be written back (the RX ring does it on frame
+ * completion); the output is invalidated here before DMA_DONE.
+ */
+typedef struct {
+    const rx_seg_t *segs;
+    int             nsegs;
+    u8             *out;
+    u32             out_len;
+    int             tag;        // owner's slot index
+
+    /* backend progress */
+    int             seg_next;   // next MM2S segment to submit
+    int             mm2s_done;
+    XTime           t_stage;    // start of the current wait, for timeouts
+
+    /* stage stamps for frame_trace.h; SG mode cannot see MM2S per job */
+    XTime           t_start;    // DMA began on this job
+    XTime           t_mm2s;     // last input byte read
+    XTime           t_s2mm;     // output written
+} dma_job_t;
+
+typedef struct {
+    u32 depth;          // jobs queued in the DMA right now
+    u32 depth_max;      // high-water mark since the last dma_stats_reset()
+    u32 ring_size;      // jobs the backend can queue (1 in simple mode)
+    u32 errors;
+} dma_stats_t;
+
+int  dma_init(void);
+int  dma_can_submit(void);
+int  dma_submit(dma_job_t *job);
+int  dma_poll(dma_job_t **done);
+void dma_get_stats(dma_stats_t *st);
+void dma_stats_reset(void);
+
+#endif /* DMA_H */
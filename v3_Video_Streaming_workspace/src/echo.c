@@ -1,14 +1,32 @@
 /*
  * echo.c - TCP RX ring buffer + backpressure (lwIP RAW API)
+ *
+ * Up to MAX_SESSIONS clients are served at once. Every connection owns a
+ * tcp_session_t: its own RX ring slice, frame parser, TX state and (in
+ * pipeline.c) output slots. The shared DMA/IP is scheduled by the pipeline.
+ * With WIRE_UDP a session's frames may travel as datagrams instead, and
+ * with WIRE_L2 those datagrams as raw Ethernet frames; the ring and the TX
+ * API stay the same for the pipeline.
  */
 
 #include <stdio.h>
 #include <string.h>
 #include "lwip/err.h"
 #include "lwip/tcp.h"
+#include "lwip/priv/tcp_priv.h"   // struct tcp_seg (unsent queue)
+#include "lwip/udp.h"
+#include "netif/ethernet.h"
 #include "netif/xadapter.h"
+#include "echo.h"
+#include "frame_proto.h"
+#include "frame_cfg.h"
+#include "frame_cache.h"
+#include "crc32.h"
+#include "vcodec.h"
+#include "tlog.h"
+#include "frame_trace.h"
 
-#if defined (__arm__) || defined (__aarch64__)
+#if defined (__arm__) || defined (__aarch64__) || defined (SIM_HOST)
 #include "xil_printf.h"
 #include "sleep.h"
 #endif
@@ -18,236 +36,1478 @@
 /* Config                                                                     */
 /* -------------------------------------------------------------------------- */
 #define TCP_PORT        6001
-#define IN_IMG_W        320
-#define IN_IMG_H        180
-#define IN_BPP          3
-#define IN_FRAME_BYTES  (IN_IMG_W * IN_IMG_H * IN_BPP)
-#define NUM_BUFFERS     10
-#define TCP_TX_CHUNK    1460    // safe MSS chunk
+
+/*
+ * TX_BURST_SEGS: MSS-sized segments per tcp_write(). A burst fills the
+ * available tcp_sndbuf in writes of this size, flagged TCP_WRITE_FLAG_MORE
+ * except the last one of a frame, and ends with a single tcp_output().
+ * The MSS follows the netif MTU, so a jumbo-enabled EMAC with a larger
+ * TCP_MSS in the lwIP BSP settings gets jumbo segments unchanged.
+ */
+#ifndef TX_BURST_SEGS
+#define TX_BURST_SEGS   16
+#endif
+
+#if TX_ZERO_COPY
+#define TCP_TX_WRITE_FLAGS  0
+#else
+#define TCP_TX_WRITE_FLAGS  TCP_WRITE_FLAG_COPY
+#endif
+
+/* FRAME_FLAG_CODED input: staged, then decoded into a copy-mode slot */
+#define RX_CODED        (WIRE_FRAMED && VCODEC && !RX_ZERO_COPY)
+
+#if WIRE_UDP && !WIRE_FRAMED
+#error "WIRE_UDP needs WIRE_FRAMED"
+#endif
+#if WIRE_L2 && !WIRE_UDP
+#error "WIRE_L2 needs WIRE_UDP"
+#endif
+#if WIRE_L2 && !LWIP_SUPPORT_CUSTOM_PBUF
+#error "WIRE_L2 needs LWIP_SUPPORT_CUSTOM_PBUF (IP_FRAG in the lwIP BSP settings)"
+#endif
+
+/* UDP_DIR_IN: fragments are copied straight into their ring slot */
+#define UDP_RX          (WIRE_UDP && !RX_ZERO_COPY)
+
+/* udpf_hdr_t.token: session id in the low bits, bumped per MSG_UDP_OPEN */
+#define UDP_TOKEN_SID   0xF
+typedef char udp_token_check[(MAX_SESSIONS <= UDP_TOKEN_SID + 1) ? 1 : -1];
+
+/* -------------------------------------------------------------------------- */
+/* Session state                                                              */
+/* -------------------------------------------------------------------------- */
+#if RX_ZERO_COPY
+/* Zero-copy slot: pbuf chains held by reference + payload scatter list */
+typedef struct {
+    rx_seg_t     segs[RX_ZC_MAX_SEGS];
+    struct pbuf *chains[RX_ZC_MAX_CHAINS];
+    u16          nsegs;
+    u16          nchains;
+} rx_zc_slot_t;
+#endif
+
+#if TX_ZERO_COPY
+/* Output buffers referenced by unacknowledged segments, oldest first */
+typedef struct {
+    const u8 *buf;
+    u32       unacked;
+} tx_inflight_t;
+#endif
+
+typedef struct {
+    struct tcp_pcb *pcb;
+    int             id;
+    int             state;                  // SESS_*
+
+    /* RX ring slice */
+#if RX_ZERO_COPY
+    rx_zc_slot_t    rx_zc[NUM_BUFFERS];
+#else
+    u8             *rx_buffers[NUM_BUFFERS];    // carved from the frame pool
+    rx_seg_t        rx_seg[NUM_BUFFERS];
+#endif
+    /* Core 0 only: the DMA core sees frames through pipe_ipc.h jobs */
+    u8              rx_ready[NUM_BUFFERS];
+    int             rx_wr_idx;
+    int             rx_rd_idx;
+    int             rx_count;
+    u32             rx_offset;
+    u32             rx_len;                 // payload bytes of the frame being assembled
+    u32             rx_owed;                // bytes received, window credit withheld
+    rx_frame_meta_t rx_meta[NUM_BUFFERS];
+    XTime           rx_t_first;             // first byte of the frame being assembled
+#if RX_CODED
+    /* FRAME_FLAG_CODED: payload lands here and is decoded into the slot */
+    u8             *rx_stage;
+    u8              rx_have_ref;            // previous slot holds the previous frame
+#endif
+
+#if WIRE_FRAMED
+    /* Header of the frame being assembled */
+    u8              rx_hdr[FRAME_HDR_BYTES];
+    u32             rx_hdr_fill;
+    u32             rx_crc;
+    /* MSG_CONFIG / MSG_UDP_OPEN payload being assembled */
+    u8              rx_ctl[FRAME_CFG_BYTES];
+    u8              rx_ctl_type;
+    u32             rx_ctl_need;
+    u32             rx_ctl_fill;
+#else
+    u32             rx_seq;                 // headerless stream: count frames instead
+#endif
+
+    /* TX async state */
+    u8             *tx_buf_ptr;
+    u32             tx_buf_len;
+    u32             tx_sent_len;
+    u8              tx_active;
+    u8              tx_hdr[FRAME_HDR_BYTES];
+    u32             tx_hdr_len;
+    u32             tx_hdr_sent;
+
+    /* Pending control reply, sent between frames */
+    u8              tx_ctl[FRAME_HDR_BYTES + TLOG_DUMP_BYTES];
+    u32             tx_ctl_len;
+
+#if TX_ZERO_COPY
+    tx_inflight_t   tx_inflight[TX_MAX_INFLIGHT];
+    int             tx_inflight_head;
+    int             tx_inflight_cnt;
+#endif
+
+#if WIRE_UDP
+    /* MSG_UDP_OPEN: frames of the granted directions go as datagrams */
+    u8              udp_dirs;               // UDP_DIR_*, 0 = all on TCP
+    u8              udp_gen;
+    u16             udp_token;
+    ip_addr_t       udp_ip;                 // the TCP peer
+    u16             udp_port;
+#if WIRE_L2
+    struct eth_addr udp_mac;                // UDP_DIR_L2: the client's NIC
+#endif
+    udpf_rx_t       udp_rx;
+    udpf_tx_t       udp_tx;
+    /* Output frame n in [n % UDPF_WINDOW] until the client acknowledges it */
+    frame_hdr_t     udp_tx_hdr[UDPF_WINDOW];
+    const u8       *udp_tx_buf[UDPF_WINDOW];
+    u32             udp_tx_len[UDPF_WINDOW];
+#if WIRE_L2
+    /* Payload pbufs of [w] the EMAC still holds; the slot is not reused until 0 */
+    u32             udp_l2_refs[UDPF_WINDOW];
+#endif
+#endif
+} tcp_session_t;
 
 /* -------------------------------------------------------------------------- */
 /* Globals                                                                    */
 /* -------------------------------------------------------------------------- */
 struct netif echo_netif;
-struct tcp_pcb *client_pcb = NULL;
 
-/* RX buffers */
-static u8 tcp_rx_buffers[NUM_BUFFERS][IN_FRAME_BYTES] __attribute__((aligned(64)));
-static volatile u8  tcp_rx_ready[NUM_BUFFERS] = {0};
-static volatile int tcp_rx_wr_idx = 0;
-static volatile int tcp_rx_rd_idx = 0;
-static volatile int tcp_rx_count  = 0;
-static u32 tcp_rx_offset = 0;
+/* tx_ctl is sized for the largest reply, rx_ctl for the largest request */
+typedef char tx_ctl_stats_check[(FT_STATS_BYTES <= TLOG_DUMP_BYTES) ? 1 : -1];
+typedef char rx_ctl_udp_check[(FRAME_UDP_BYTES <= FRAME_CFG_BYTES) ? 1 : -1];
+
+static tcp_session_t sessions[MAX_SESSIONS];
+static tcp_tx_stats_t tx_stats;
+static tcp_rx_flow_stats_t rx_flow_stats;
+static tcp_rx_codec_stats_t rx_codec_stats;
+static u32 tcp_rx_frame_bytes = 0;          // input frame size in effect
+#if WIRE_FRAMED
+static rx_config_handler_t tcp_rx_cfg_handler = NULL;
+#endif
+#if WIRE_UDP
+static struct udp_pcb *udp_srv = NULL;
+#endif
+#if WIRE_L2
+static netif_input_fn l2_next_input = NULL;     // ethernet_input, behind l2_input()
+
+/* A payload pbuf that points into an output buffer, counted in *refs while the EMAC has it */
+typedef struct {
+    struct pbuf_custom pc;
+    u32               *refs;        // NULL while free
+} l2_ref_t;
 
-/* TX async state */
-static u8 *tcp_tx_buf_ptr = NULL;
-static u32 tcp_tx_buf_len = 0;
-static u32 tcp_tx_sent_len = 0;
-static u8 tcp_tx_active = 0;
+static l2_ref_t l2_refs[L2_TX_REFS];
+static int      l2_ref_next = 0;
+#endif
 
 /* -------------------------------------------------------------------------- */
 /* Helpers                                                                    */
 /* -------------------------------------------------------------------------- */
-static inline int rx_full(void)  { return (tcp_rx_count == NUM_BUFFERS); }
-static inline int rx_empty(void) { return (tcp_rx_count == 0); }
+static inline int rx_full(tcp_session_t *s)  { return (s->rx_count == NUM_BUFFERS); }
+static inline int rx_empty(tcp_session_t *s) { return (s->rx_count == 0); }
+
+/* Bytes the ring can still take without overwriting unprocessed frames */
+static u32 rx_free_bytes(tcp_session_t *s)
+{
+    return (NUM_BUFFERS - s->rx_count) * tcp_rx_frame_bytes - s->rx_offset;
+}
+
+/*
+ * Window credit: received bytes are handed back to lwIP (tcp_recved) only
+ * while the ring still has room for the whole window lwIP would then
+ * advertise. The sender is throttled by the TCP window itself and
+ * recv_callback never has to refuse data; withheld credit is released as
+ * frames are popped.
+ */
+static void rx_credit(tcp_session_t *s)
+{
+    if (!s->pcb || s->rx_owed == 0) return;
+
+    u32 free = rx_free_bytes(s);
+    u32 wnd  = s->pcb->rcv_wnd;
+    if (free <= wnd) return;
+
+    u32 grant = free - wnd;
+    if (grant > s->rx_owed) grant = s->rx_owed;
+    s->rx_owed -= grant;
+    while (grant > 0) {
+        u16 n = (grant > 0xFFFF) ? 0xFFFF : (u16)grant;
+        tcp_recved(s->pcb, n);
+        grant -= n;
+    }
+}
+
+static inline int udp_in(tcp_session_t *s)
+{
+#if UDP_RX
+    return (s->udp_dirs & UDP_DIR_IN) != 0;
+#else
+    (void)s;
+    return 0;
+#endif
+}
+
+static inline int udp_out(tcp_session_t *s)
+{
+#if WIRE_UDP
+    return (s->udp_dirs & UDP_DIR_OUT) != 0;
+#else
+    (void)s;
+    return 0;
+#endif
+}
+
+/* Frames of a UDP session still half received or unacknowledged */
+static inline int udp_busy(tcp_session_t *s)
+{
+#if WIRE_UDP
+    return s->udp_dirs && (!udpf_tx_idle(&s->udp_tx) || udpf_rx_busy(&s->udp_rx));
+#else
+    (void)s;
+    return 0;
+#endif
+}
+
+static inline int rx_coded(tcp_session_t *s)
+{
+#if RX_CODED
+    return (s->rx_meta[s->rx_wr_idx].flags & FRAME_FLAG_CODED) != 0;
+#else
+    (void)s;
+    return 0;
+#endif
+}
+
+#if RX_CODED
+/*
+ * Decode the staged frame into its slot. The reference is the previous
+ * slot, which keeps the previous frame until the ring wraps round to it.
+ */
+static int rx_decode_frame(tcp_session_t *s)
+{
+    const frame_cfg_t *c = frame_cfg_get();
+    const rx_frame_meta_t *m = &s->rx_meta[s->rx_wr_idx];
+    int prev = (s->rx_wr_idx + NUM_BUFFERS - 1) % NUM_BUFFERS;
+    XTime t0, t1;
+
+    XTime_GetTime(&t0);
+    int r = vc_decode(s->rx_stage, s->rx_len, s->rx_buffers[s->rx_wr_idx],
+                      s->rx_have_ref ? s->rx_buffers[prev] : NULL, c->in_w, c->in_h, c->in_bpp);
+    XTime_GetTime(&t1);
+    if (r != 0) {
+        xil_printf("[TCP] s%d Undecodable frame seq=%d (%d bytes, %s)\n\r", s->id, m->seq,
+                   s->rx_len, vc_is_key(s->rx_stage, s->rx_len) ? "key" : "delta");
+        return -1;
+    }
+    rx_codec_stats.frames++;
+    rx_codec_stats.coded_bytes += s->rx_len;
+    rx_codec_stats.raw_bytes   += tcp_rx_frame_bytes;
+    rx_codec_stats.dec_ticks   += t1 - t0;
+    return 0;
+}
+#endif
+
+/* Mark the slot being assembled as ready and advance the write index */
+static int rx_commit_frame(tcp_session_t *s)
+{
+    rx_frame_meta_t *m = &s->rx_meta[s->rx_wr_idx];
+
+    m->t_first = s->rx_t_first;
+    XTime_GetTime(&m->t_done);
+#if RX_CODED
+    if (rx_coded(s) && rx_decode_frame(s) != 0) return -1;
+#endif
+    /* The only write-back before the DMA reads the frame (dma.c does none) */
+#if RX_ZERO_COPY
+#if !RX_FLUSH_PER_PBUF
+    rx_zc_slot_t *z = &s->rx_zc[s->rx_wr_idx];
+    for (int i = 0; i < z->nsegs; i++)
+        frame_buf_flush(z->segs[i].ptr, z->segs[i].len);
+#endif
+#else
+    /* A decoded frame was written after the last per-pbuf flush; UDP has none */
+    if (!RX_FLUSH_PER_PBUF || rx_coded(s) || udp_in(s))
+        frame_buf_flush(s->rx_buffers[s->rx_wr_idx], tcp_rx_frame_bytes);
+#endif
+#if WIRE_FRAMED
+    if ((m->flags & FRAME_FLAG_CRC) && s->rx_crc != m->crc32) {
+        m->crc_ok = 0;
+        TLOG(RX_CRC_BAD, s->id, m->seq, s->rx_crc, m->crc32);
+    }
+    s->rx_crc = 0;
+#else
+    const frame_cfg_t *c = frame_cfg_get();
+    m->seq    = s->rx_seq++;
+    m->width  = c->in_w;
+    m->height = c->in_h;
+    m->format = c->in_fmt;
+    m->bpp    = c->in_bpp;
+    m->flags  = 0;
+    m->crc_ok = 1;
+    m->length = tcp_rx_frame_bytes;
+#endif
+    XTime_GetTime(&m->t_commit);
+    s->rx_ready[s->rx_wr_idx] = 1;
+    s->rx_count++;
+    if ((u32)s->rx_count > rx_flow_stats.peak) rx_flow_stats.peak = s->rx_count;
+    if (rx_full(s)) rx_flow_stats.full++;
+    TLOG(RX_FRAME_READY, s->id, s->rx_wr_idx, s->rx_count);
+    s->rx_wr_idx = (s->rx_wr_idx + 1) % NUM_BUFFERS;
+    s->rx_offset = 0;
+#if RX_CODED
+    s->rx_have_ref = 1;
+#endif
+    return 0;
+}
+
+#if RX_ZERO_COPY
+/* Take one reference on chain p for this slot (once per slot) */
+static void rx_zc_hold(rx_zc_slot_t *z, struct pbuf *p)
+{
+    if (z->nchains > 0 && z->chains[z->nchains - 1] == p) return;
+    pbuf_ref(p);
+    z->chains[z->nchains++] = p;
+}
+
+/* Drop every pbuf reference held by a slot */
+static void rx_zc_release(rx_zc_slot_t *z)
+{
+    for (int i = 0; i < z->nchains; i++) {
+        pbuf_free(z->chains[i]);
+        z->chains[i] = NULL;
+    }
+    z->nchains = 0;
+    z->nsegs   = 0;
+}
+#endif
+
+/* Point every ring slice at the carved pool; only while all rings are empty */
+static void rx_carve(void)
+{
+#if !RX_ZERO_COPY
+    for (int sid = 0; sid < MAX_SESSIONS; sid++)
+        for (int i = 0; i < NUM_BUFFERS; i++)
+            sessions[sid].rx_buffers[i] = frame_cfg_rx_buf(sid, i);
+#endif
+#if RX_CODED
+    /* A new geometry or codec setting starts every reference chain over */
+    for (int sid = 0; sid < MAX_SESSIONS; sid++) {
+        sessions[sid].rx_stage    = frame_cfg_rx_stage(sid);
+        sessions[sid].rx_have_ref = 0;
+    }
+#endif
+    tcp_rx_frame_bytes = frame_cfg_in_bytes();
+    if ((u32)NUM_BUFFERS * tcp_rx_frame_bytes < TCP_WND)
+        xil_printf("[TCP] RX ring (%d bytes) is smaller than TCP_WND (%d), expect stalls\n\r",
+                   NUM_BUFFERS * tcp_rx_frame_bytes, TCP_WND);
+    for (int sid = 0; sid < MAX_SESSIONS; sid++)
+        rx_credit(&sessions[sid]);
+}
+
+void tcp_rx_set_config_handler(rx_config_handler_t fn)
+{
+#if WIRE_FRAMED
+    tcp_rx_cfg_handler = fn;
+#else
+    (void)fn;   // control messages need the framed stream
+#endif
+}
 
 /* -------------------------------------------------------------------------- */
 /* Public: peek/pop RX frame                                                  */
 /* -------------------------------------------------------------------------- */
-u8* tcp_rx_peek_frame(int *idx_out)
+u8* tcp_rx_peek_frame(int sid, int *idx_out)
+{
+#if RX_ZERO_COPY
+    (void)sid;
+    (void)idx_out;
+    return NULL;    // no contiguous copy exists, use tcp_rx_peek_frame_sg()
+#else
+    tcp_session_t *s = &sessions[sid];
+    if (rx_empty(s)) return NULL;
+    if (s->rx_ready[s->rx_rd_idx] == 0) return NULL;
+    if (idx_out) *idx_out = s->rx_rd_idx;
+    return s->rx_buffers[s->rx_rd_idx];
+#endif
+}
+
+/* Peek the next ready frame as a scatter list (one segment in copy mode) */
+int tcp_rx_peek_frame_sg(int sid, int *idx_out, const rx_seg_t **segs, int *nsegs)
 {
-    if (rx_empty()) return NULL;
-    if (tcp_rx_ready[tcp_rx_rd_idx] == 0) return NULL;
-    if (idx_out) *idx_out = tcp_rx_rd_idx;
-    return tcp_rx_buffers[tcp_rx_rd_idx];
+    return tcp_rx_peek_nth_sg(sid, 0, idx_out, segs, nsegs);
 }
 
-int tcp_rx_pop_frame(void)
+/* Peek the n-th ready frame after the read index (frames queued in the DMA) */
+int tcp_rx_peek_nth_sg(int sid, int n, int *idx_out, const rx_seg_t **segs, int *nsegs)
 {
-    if (rx_empty() || tcp_rx_ready[tcp_rx_rd_idx] == 0) return -1;
-    tcp_rx_ready[tcp_rx_rd_idx] = 0;
-    tcp_rx_rd_idx = (tcp_rx_rd_idx + 1) % NUM_BUFFERS;
-    tcp_rx_count--;
+    tcp_session_t *s = &sessions[sid];
+
+    if (n >= s->rx_count) return -1;
+    int idx = (s->rx_rd_idx + n) % NUM_BUFFERS;
+    if (s->rx_ready[idx] == 0) return -1;
+    if (idx_out) *idx_out = idx;
+#if RX_ZERO_COPY
+    *segs  = s->rx_zc[idx].segs;
+    *nsegs = s->rx_zc[idx].nsegs;
+#else
+    s->rx_seg[idx].ptr = s->rx_buffers[idx];
+    s->rx_seg[idx].len = tcp_rx_frame_bytes;
+    *segs  = &s->rx_seg[idx];
+    *nsegs = 1;
+#endif
+    return 0;
+}
+
+/* Release the oldest frame; in zero-copy mode call only after MM2S is done */
+int tcp_rx_pop_frame(int sid)
+{
+    tcp_session_t *s = &sessions[sid];
+
+    if (rx_empty(s) || s->rx_ready[s->rx_rd_idx] == 0) return -1;
+#if RX_ZERO_COPY
+    rx_zc_release(&s->rx_zc[s->rx_rd_idx]);
+#endif
+    s->rx_ready[s->rx_rd_idx] = 0;
+    s->rx_rd_idx = (s->rx_rd_idx + 1) % NUM_BUFFERS;
+    s->rx_count--;
+    rx_credit(s);   // a whole frame of room is back
+    return 0;
+}
+
+/* Frames queued, plus one if a frame is partly received */
+int tcp_rx_queued(int sid)
+{
+    tcp_session_t *s = &sessions[sid];
+    int partial = (s->rx_offset != 0);
+#if UDP_RX
+    if (udp_in(s)) partial = udpf_rx_busy(&s->udp_rx);
+#endif
+    return s->rx_count + partial;
+}
+
+/* Header fields of a ready slot (seq, geometry, CRC status) */
+const rx_frame_meta_t *tcp_rx_frame_meta(int sid, int idx)
+{
+    return &sessions[sid].rx_meta[idx];
+}
+
+void tcp_rx_get_flow_stats(tcp_rx_flow_stats_t *st) { *st = rx_flow_stats; }
+void tcp_rx_flow_stats_reset(void) { memset(&rx_flow_stats, 0, sizeof(rx_flow_stats)); }
+void tcp_rx_get_codec_stats(tcp_rx_codec_stats_t *st) { *st = rx_codec_stats; }
+void tcp_rx_codec_stats_reset(void) { memset(&rx_codec_stats, 0, sizeof(rx_codec_stats)); }
+
+#if TX_ZERO_COPY
+/* -------------------------------------------------------------------------- */
+/* TX zero-copy: track which buffers lwIP still references                    */
+/* -------------------------------------------------------------------------- */
+static int tx_inflight_push(tcp_session_t *s, const u8 *buf, u32 len)
+{
+    if (s->tx_inflight_cnt == TX_MAX_INFLIGHT) return -1;
+    int i = (s->tx_inflight_head + s->tx_inflight_cnt) % TX_MAX_INFLIGHT;
+    s->tx_inflight[i].buf     = buf;
+    s->tx_inflight[i].unacked = len;
+    s->tx_inflight_cnt++;
     return 0;
 }
+
+/* ACKs arrive in stream order: retire bytes from the oldest buffer first */
+static void tx_inflight_ack(tcp_session_t *s, u32 len)
+{
+    while (len > 0 && s->tx_inflight_cnt > 0) {
+        tx_inflight_t *e = &s->tx_inflight[s->tx_inflight_head];
+        u32 n = (len < e->unacked) ? len : e->unacked;
+        e->unacked -= n;
+        len -= n;
+        if (e->unacked == 0) {
+            e->buf = NULL;
+            s->tx_inflight_head = (s->tx_inflight_head + 1) % TX_MAX_INFLIGHT;
+            s->tx_inflight_cnt--;
+        }
+    }
+}
+
+/*
+ * A frame abandoned mid-send: lwIP only took its first written bytes, so
+ * the newest entry (the frame's) must not wait for ACKs of the rest.
+ */
+static void tx_inflight_trim(tcp_session_t *s, u32 written, u32 total)
+{
+    if (s->tx_inflight_cnt == 0) return;
+    int i = (s->tx_inflight_head + s->tx_inflight_cnt - 1) % TX_MAX_INFLIGHT;
+    tx_inflight_t *e = &s->tx_inflight[i];
+    u32 unsent = total - written;
+    e->unacked -= (unsent < e->unacked) ? unsent : e->unacked;
+    if (e->unacked == 0) {
+        e->buf = NULL;
+        s->tx_inflight_cnt--;
+    }
+}
+
+static void tx_inflight_reset(tcp_session_t *s)
+{
+    s->tx_inflight_head = 0;
+    s->tx_inflight_cnt  = 0;
+}
+#endif
+
+/* -------------------------------------------------------------------------- */
+/* TX: control replies                                                        */
+/* -------------------------------------------------------------------------- */
+#if WIRE_FRAMED
+/* Queue a reply; a newer one replaces a reply that has not gone out yet */
+static void tx_ctl_queue(tcp_session_t *s, u8 type, const void *payload, u32 len)
+{
+    frame_hdr_t h;
+
+    memset(&h, 0, sizeof(h));
+    h.magic  = FRAME_MAGIC;
+    h.type   = type;
+    h.length = len;
+    memcpy(s->tx_ctl, &h, FRAME_HDR_BYTES);
+    if (payload) memcpy(s->tx_ctl + FRAME_HDR_BYTES, payload, len);
+    s->tx_ctl_len = FRAME_HDR_BYTES + len;
+}
+#endif
+
+static err_t tx_ctl_flush(tcp_session_t *s, struct tcp_pcb *tpcb)
+{
+    if (tcp_sndbuf(tpcb) < s->tx_ctl_len) return ERR_MEM;
+#if TX_ZERO_COPY
+    if (s->tx_inflight_cnt == TX_MAX_INFLIGHT) return ERR_MEM;
+#endif
+    err_t e = tcp_write(tpcb, s->tx_ctl, s->tx_ctl_len, TCP_WRITE_FLAG_COPY);
+    if (e != ERR_OK) return e;
+#if TX_ZERO_COPY
+    tx_inflight_push(s, NULL, s->tx_ctl_len);  // keeps the ACK accounting aligned
+#endif
+    tcp_output(tpcb);
+    s->tx_ctl_len = 0;
+    return ERR_OK;
+}
+
 /* -------------------------------------------------------------------------- */
 /* TX: start async send */
 /* -------------------------------------------------------------------------- */
-err_t send_callback(void *arg, struct tcp_pcb *tpcb, u16_t len)
+/* Last segment on the unsent queue, NULL if it is empty */
+static struct tcp_seg *tcp_unsent_tail(struct tcp_pcb *tpcb)
 {
-    if (!tcp_tx_active) return ERR_OK;
+    struct tcp_seg *seg = tpcb->unsent;
+    while (seg && seg->next) seg = seg->next;
+    return seg;
+}
 
-    while (tcp_tx_sent_len < tcp_tx_buf_len) {
+/* Segments queued behind tail; bytes tcp_write() appended to tail itself add none */
+static u32 tcp_unsent_after(struct tcp_pcb *tpcb, struct tcp_seg *tail)
+{
+    u32 n = 0;
+    for (struct tcp_seg *seg = tail ? tail->next : tpcb->unsent; seg; seg = seg->next) n++;
+    return n;
+}
+
+static err_t send_callback(void *arg, struct tcp_pcb *tpcb, u16_t len)
+{
+    tcp_session_t *s = (tcp_session_t *)arg;
+
+    if (!s) return ERR_OK;
+#if TX_ZERO_COPY
+    tx_inflight_ack(s, len);
+#endif
+    if (!s->tx_active) {
+        // Control replies only go out between frames
+        if (s->tx_ctl_len) tx_ctl_flush(s, tpcb);  // retried on next ACK
+        return ERR_OK;
+    }
+
+    u32 mss = tcp_mss(tpcb);
+    u32 burst = mss * TX_BURST_SEGS;
+    u32 queued = 0;
+    struct tcp_seg *tail = tcp_unsent_tail(tpcb);   // this burst's segments go behind it
+    err_t e = ERR_OK;
+
+    if (burst > 0xFFFF) burst = 0xFFFF - 0xFFFF % mss;  // tcp_write takes a u16 length
+
+    // Frame header goes out first (always copied, it lives in tx_hdr)
+    while (s->tx_hdr_sent < s->tx_hdr_len) {
         u16_t sndbuf = tcp_sndbuf(tpcb);
-        if (sndbuf == 0) {
-            // No space, wait for next ACK
-            return ERR_OK;
-        }
+        if (sndbuf == 0) goto flush;
 
-        u32 remain = tcp_tx_buf_len - tcp_tx_sent_len;
-        u32 chunk  = (remain > TCP_TX_CHUNK) ? TCP_TX_CHUNK : remain;
+        u32 chunk = s->tx_hdr_len - s->tx_hdr_sent;
         if (chunk > sndbuf) chunk = sndbuf;
 
-        err_t e = tcp_write(tpcb,
-                            tcp_tx_buf_ptr + tcp_tx_sent_len,
-                            chunk,
-                            TCP_WRITE_FLAG_COPY);
-        if (e == ERR_OK) {
-            tcp_tx_sent_len += chunk;
-            tcp_output(tpcb);   // flush every chunk
-        } else if (e == ERR_MEM) {
-            // lwIP buffer full, retry on next tcp_sent()
-            return ERR_OK;
-        } else {
-            xil_printf("[TCP] tcp_write error: %d\n\r", e);
-            tcp_tx_active = 0;
-            return e;
+        e = tcp_write(tpcb, s->tx_hdr + s->tx_hdr_sent, chunk,
+                      TCP_WRITE_FLAG_COPY | TCP_WRITE_FLAG_MORE);
+        if (e == ERR_MEM) goto flush;
+        if (e != ERR_OK) goto fail;
+        s->tx_hdr_sent += chunk;
+        queued += chunk;
+    }
+
+    // Payload: whole MSS segments as far as sndbuf allows, one flush at the end
+    while (s->tx_sent_len < s->tx_buf_len) {
+        u32 remain = s->tx_buf_len - s->tx_sent_len;
+        u32 room   = tcp_sndbuf(tpcb);
+        u32 chunk  = burst;
+
+        if (chunk > remain) chunk = remain;
+        if (chunk > room) {
+            chunk = room - room % mss;  // no runt segments mid-frame
+            if (chunk == 0) break;      // wait for the next ACK
         }
+
+        u8 flags = TCP_TX_WRITE_FLAGS;
+        if (chunk < remain) flags |= TCP_WRITE_FLAG_MORE;
+        e = tcp_write(tpcb, s->tx_buf_ptr + s->tx_sent_len, chunk, flags);
+        if (e == ERR_MEM) break;        // segment queue full, retry on next tcp_sent()
+        if (e != ERR_OK) goto fail;
+
+        s->tx_sent_len += chunk;
+        queued += chunk;
+        tx_stats.writes++;
+    }
+
+flush:
+    if (queued) {
+        tx_stats.segs += tcp_unsent_after(tpcb, tail);
+        tcp_output(tpcb);
+        tx_stats.outputs++;
+        tx_stats.bytes += queued;
+        tx_stats.mss = mss;
     }
 
     // If we sent the whole frame, mark TX done
-    if (tcp_tx_sent_len >= tcp_tx_buf_len) {
-        xil_printf("[TCP] Frame sent (%d bytes)\n\r", tcp_tx_buf_len);
-        tcp_tx_active = 0;      // busy clear
+    if (s->tx_sent_len >= s->tx_buf_len) {
+        TLOG(TX_FRAME_SENT, s->id, s->tx_buf_len);
+        s->tx_active = 0;       // busy clear
+        tx_stats.frames++;
     }
 
     return ERR_OK;
+
+fail:
+    xil_printf("[TCP] s%d tcp_write error: %d\n\r", s->id, e);
+#if TX_ZERO_COPY
+    tx_inflight_trim(s, s->tx_hdr_sent + s->tx_sent_len, s->tx_hdr_len + s->tx_buf_len);
+#endif
+    s->tx_active = 0;
+    if (queued) tcp_output(tpcb);
+    return e;
 }
 
-int start_sending(const u8 *buf, u32 len)
+#if WIRE_UDP
+static int udp_tx_can_queue(tcp_session_t *s);
+static int udp_tx_frame(tcp_session_t *s, const frame_hdr_t *hdr, const u8 *buf, u32 len);
+#endif
+
+/* Async send of hdr (may be NULL for a headerless stream) + buf */
+int start_sending_frame(int sid, const frame_hdr_t *hdr, const u8 *buf, u32 len)
 {
-    if (!client_pcb || tcp_tx_active) return -1;
+    tcp_session_t *s = &sessions[sid];
+    u32 hdr_len = hdr ? FRAME_HDR_BYTES : 0;
+
+#if WIRE_UDP
+    if (s->pcb && udp_out(s)) return udp_tx_frame(s, hdr, buf, len);
+#endif
+    if (!s->pcb || s->tx_active) return -1;
+    if (s->tx_ctl_len && tx_ctl_flush(s, s->pcb) != ERR_OK) return -1;
+#if TX_ZERO_COPY
+    if (tx_inflight_push(s, buf, hdr_len + len) != 0) return -1;
+#endif
 
-    tcp_tx_buf_ptr   = (u8 *)buf;
-    tcp_tx_buf_len   = len;
-    tcp_tx_sent_len  = 0;
-    tcp_tx_active    = 1;
+    if (hdr) memcpy(s->tx_hdr, hdr, FRAME_HDR_BYTES);
+    s->tx_hdr_len   = hdr_len;
+    s->tx_hdr_sent  = 0;
+    s->tx_buf_ptr   = (u8 *)buf;
+    s->tx_buf_len   = len;
+    s->tx_sent_len  = 0;
+    s->tx_active    = 1;
 
     // Kick-off by trying the first chunk
-    return send_callback(NULL, client_pcb, 0);
+    return send_callback(s, s->pcb, 0);
+}
+
+int start_sending(int sid, const u8 *buf, u32 len)
+{
+    return start_sending_frame(sid, NULL, buf, len);
+}
+
+int tcp_tx_is_busy(int sid)
+{
+    tcp_session_t *s = &sessions[sid];
+#if WIRE_UDP
+    if (udp_out(s)) return !udp_tx_can_queue(s);
+#endif
+    return s->tx_active != 0;
 }
 
-int tcp_tx_is_busy(void) { return tcp_tx_active != 0; }
+void tcp_tx_get_stats(tcp_tx_stats_t *st) { *st = tx_stats; }
+void tcp_tx_stats_reset(void) { memset(&tx_stats, 0, sizeof(tx_stats)); }
+
+/* Nonzero while buf must not be overwritten (queued or, zero-copy, unACKed) */
+int tcp_tx_buf_in_flight(int sid, const u8 *buf)
+{
+    tcp_session_t *s = &sessions[sid];
+#if WIRE_L2
+    /* Also after a reset: the EMAC reads a held fragment whatever the session does */
+    for (int w = 0; w < UDPF_WINDOW; w++)
+        if (s->udp_tx_buf[w] == buf && __atomic_load_n(&s->udp_l2_refs[w], __ATOMIC_ACQUIRE))
+            return 1;
+#endif
+#if WIRE_UDP
+    if (udp_out(s)) {
+        /* Fragments are read out of buf until the client has the whole frame */
+        for (u32 n = s->udp_tx.acked; n != s->udp_tx.head; n++)
+            if (s->udp_tx_buf[n % UDPF_WINDOW] == buf) return 1;
+        return 0;
+    }
+#endif
+#if TX_ZERO_COPY
+    for (int n = 0; n < s->tx_inflight_cnt; n++) {
+        if (s->tx_inflight[(s->tx_inflight_head + n) % TX_MAX_INFLIGHT].buf == buf)
+            return 1;
+    }
+    return 0;
+#else
+    return s->tx_active && buf == s->tx_buf_ptr;
+#endif
+}
 
 /* -------------------------------------------------------------------------- */
-/* TX: send buffer to client                                                  */
+/* RX: frame header                                                           */
 /* -------------------------------------------------------------------------- */
-int transfer_data(u8 *buffer, int length) {
-    // Check if client is connected
-    if (client_pcb == NULL) {
-        xil_printf("No client connected. Skipping transfer.\n\r");
+#if WIRE_FRAMED
+/* Check a MSG_FRAME header against the config in effect and record it in m */
+static int rx_check_frame(tcp_session_t *s, const frame_hdr_t *hp, rx_frame_meta_t *m)
+{
+    const frame_hdr_t h = *hp;
+    const frame_cfg_t *c = frame_cfg_get();
+
+    /* Coded frames must be smaller than raw ones: the ring counts raw bytes */
+    int len_ok;
+#if RX_CODED
+    if (h.flags & FRAME_FLAG_CODED)
+        len_ok = s->rx_stage && h.length >= VC_HDR_BYTES && h.length < tcp_rx_frame_bytes;
+    else
+#endif
+        len_ok = !(h.flags & FRAME_FLAG_CODED) && h.length == tcp_rx_frame_bytes;
+    if (h.width != c->in_w || h.height != c->in_h || h.bpp != c->in_bpp ||
+        h.format != c->in_fmt || !len_ok) {
+        xil_printf("[TCP] s%d Unsupported frame seq=%d %dx%d bpp=%d len=%d flags=%x\n\r",
+                   s->id, h.seq, h.width, h.height, h.bpp, h.length, h.flags);
         return -1;
     }
 
-    err_t err;
-    int remaining = length;   // Use the given length instead of FRAME_BYTES
-    int offset = 0;
-    const int MAX_TCP_CHUNK = 1460;  // Maximum TCP payload size (close to MTU)
+    m->seq    = h.seq;
+    m->width  = h.width;
+    m->height = h.height;
+    m->format = h.format;
+    m->bpp    = h.bpp;
+    m->flags  = h.flags;
+    m->length = h.length;
+    m->crc32  = h.crc32;
+    m->crc_ok = 1;
+    return 0;
+}
+
+/* Validate the header just assembled and record it for slot wr_idx */
+static int rx_accept_header(tcp_session_t *s)
+{
+    frame_hdr_t h;
+
+    memcpy(&h, s->rx_hdr, sizeof(h));
+    if (h.magic == FRAME_MAGIC && h.type == MSG_LOG_REQ && h.length == 0) {
+        /* Records go straight into the reply buffer, the header after them */
+        u32 n = tlog_dump(s->tx_ctl + FRAME_HDR_BYTES, TLOG_DUMP_BYTES);
+        tx_ctl_queue(s, MSG_LOG_DUMP, NULL, n);
+        s->rx_hdr_fill = 0;
+        return 0;
+    }
+    if (h.magic == FRAME_MAGIC && h.type == MSG_STATS_REQ && h.length == 0) {
+        u32 n = frame_trace_query(s->tx_ctl + FRAME_HDR_BYTES, TLOG_DUMP_BYTES);
+        tx_ctl_queue(s, MSG_STATS, NULL, n);
+        if (h.flags & FT_STATS_RESET) frame_trace_reset();
+        s->rx_hdr_fill = 0;
+        return 0;
+    }
+    if (h.magic == FRAME_MAGIC && ((h.type == MSG_CONFIG && h.length == FRAME_CFG_BYTES) ||
+                                   (h.type == MSG_UDP_OPEN && h.length == FRAME_UDP_BYTES))) {
+        s->rx_ctl_type = h.type;
+        s->rx_ctl_need = h.length;
+        s->rx_ctl_fill = 0;
+        return 0;
+    }
+    if (h.magic != FRAME_MAGIC || h.type != MSG_FRAME || udp_in(s)) {
+        xil_printf("[TCP] s%d Misframed stream (magic=%08x type=%d)\n\r", s->id, h.magic, h.type);
+        return -1;
+    }
+    if (rx_check_frame(s, &h, &s->rx_meta[s->rx_wr_idx]) != 0) return -1;
+    s->rx_len = h.length;
+    return 0;
+}
+
+/*
+ * MSG_CONFIG: geometry is shared by every session, so it is only legal with
+ * nothing queued anywhere (the handler checks the other sessions). Always
+ * answered with an ACK.
+ */
+static void rx_handle_config(tcp_session_t *s)
+{
+    frame_cfg_t req, ack;
+    int st;
+
+    memcpy(&req, s->rx_ctl, sizeof(req));
+    if (!rx_empty(s) || s->rx_offset != 0)
+        st = CFG_ERR_BUSY;
+    else if (!tcp_rx_cfg_handler)
+        st = CFG_ERR_INVALID;
+    else
+        st = tcp_rx_cfg_handler(&req);
+
+    if (st == CFG_OK) rx_carve();
+    else xil_printf("[TCP] s%d CONFIG rejected (status %d)\n\r", s->id, st);
+
+    ack = *frame_cfg_get();
+    ack.status = (u8)st;
+    tx_ctl_queue(s, MSG_CONFIG_ACK, &ack, sizeof(ack));
+}
+
+#if WIRE_UDP
+static void udp_open(tcp_session_t *s, u8 dirs, const frame_udp_t *req);
+#endif
+
+/*
+ * MSG_UDP_OPEN: per session, only with nothing of it queued or in flight;
+ * the frames already on one transport must not be overtaken on the other.
+ * Always answered with an ACK on TCP.
+ */
+static void rx_handle_udp_open(tcp_session_t *s)
+{
+    frame_udp_t req, ack;
+    u8 offer = 0, via = 0;
+
+    memcpy(&req, s->rx_ctl, sizeof(req));
+    memset(&ack, 0, sizeof(ack));
+#if WIRE_UDP
+    if (udp_srv) offer = UDP_DIR_OUT | (UDP_RX ? UDP_DIR_IN : 0);
+#endif
+#if WIRE_L2
+    via = req.dirs & UDP_DIR_L2;
+#endif
+    if (!offer || (req.dirs && !via && req.port == 0))
+        ack.status = CFG_ERR_INVALID;
+    else if (!rx_empty(s) || s->rx_offset != 0 || s->tx_active || udp_busy(s))
+        ack.status = CFG_ERR_BUSY;
+    else
+        ack.status = CFG_OK;
+
+#if WIRE_UDP
+    if (ack.status == CFG_OK) {
+        u8 dirs = req.dirs & offer;
+        udp_open(s, dirs ? dirs | via : 0, &req);
+        ack.dirs       = s->udp_dirs;
+        ack.token      = s->udp_token;
+        ack.port       = UDP_PORT;
+        ack.frag_bytes = UDPF_FRAG_BYTES;
+        ack.window     = UDPF_WINDOW;
+        if (ack.dirs & UDP_DIR_L2) {
+            memcpy(ack.mac, echo_netif.hwaddr, sizeof(ack.mac));
+            xil_printf("[UDP] s%d dirs %x, client MAC %02x:%02x:%02x:%02x:%02x:%02x\n\r", s->id, ack.dirs,
+                       req.mac[0], req.mac[1], req.mac[2], req.mac[3], req.mac[4], req.mac[5]);
+        } else
+            xil_printf("[UDP] s%d dirs %x, client port %d\n\r", s->id, ack.dirs, req.port);
+    }
+#endif
+    if (ack.status != CFG_OK)
+        xil_printf("[UDP] s%d OPEN rejected (status %d)\n\r", s->id, ack.status);
+    tx_ctl_queue(s, MSG_UDP_ACK, &ack, sizeof(ack));
+}
+#endif
+
+/* Drop the frame being assembled (connection lost or misframed) */
+static void rx_reset_partial(tcp_session_t *s)
+{
+#if RX_ZERO_COPY
+    if (!rx_full(s)) rx_zc_release(&s->rx_zc[s->rx_wr_idx]);
+#endif
+#if WIRE_FRAMED
+    s->rx_hdr_fill = 0;
+    s->rx_crc = 0;
+    s->rx_ctl_need = 0;
+#endif
+    s->rx_offset = 0;
+}
 
+/* -------------------------------------------------------------------------- */
+/* RX: consume one pbuf payload into the ring                                 */
+/* -------------------------------------------------------------------------- */
+static int rx_consume(tcp_session_t *s, struct pbuf *chain, const u8 *src, u32 len)
+{
+    (void)chain;
 
-    while (remaining > 0) {
-        // Decide the size of current chunk
-        int chunk = (remaining > MAX_TCP_CHUNK) ? MAX_TCP_CHUNK : remaining;
+    while (len > 0) {
+#if WIRE_FRAMED
+        if (s->rx_hdr_fill < FRAME_HDR_BYTES) {
+            if (s->rx_hdr_fill == 0) XTime_GetTime(&s->rx_t_first);
+            u32 n = FRAME_HDR_BYTES - s->rx_hdr_fill;
+            if (n > len) n = len;
+            memcpy(&s->rx_hdr[s->rx_hdr_fill], src, n);
+            s->rx_hdr_fill += n;
+            src += n;
+            len -= n;
+            if (s->rx_hdr_fill == FRAME_HDR_BYTES && rx_accept_header(s) != 0)
+                return -1;
+            continue;
+        }
+        if (s->rx_ctl_need) {
+            u32 n = s->rx_ctl_need - s->rx_ctl_fill;
+            if (n > len) n = len;
+            memcpy(&s->rx_ctl[s->rx_ctl_fill], src, n);
+            s->rx_ctl_fill += n;
+            src += n;
+            len -= n;
+            if (s->rx_ctl_fill == s->rx_ctl_need) {
+                if (s->rx_ctl_type == MSG_UDP_OPEN) rx_handle_udp_open(s);
+                else rx_handle_config(s);
+                s->rx_ctl_need = 0;
+                s->rx_hdr_fill = 0;
+            }
+            continue;
+        }
+#endif
+        /* Only reachable when frames follow a CONFIG that shrank the ring */
+        if (rx_full(s)) {
+            xil_printf("[TCP] s%d Frame data sent before CONFIG_ACK\n\r", s->id);
+            return -1;
+        }
 
-        // Wait until TCP send buffer has enough space for the chunk
-        while (tcp_sndbuf(client_pcb) < chunk) {
-            xemacif_input(&echo_netif);  // Process incoming ACK packets
-            usleep(100);                 // Small delay to avoid busy-wait
+#if !WIRE_FRAMED
+        if (s->rx_offset == 0) {
+            XTime_GetTime(&s->rx_t_first);
+            s->rx_len = tcp_rx_frame_bytes;
         }
+#endif
+        u32 remain = s->rx_len - s->rx_offset;
+        u32 take   = (len < remain) ? len : remain;
+
+#if RX_ZERO_COPY
+        rx_zc_slot_t *z = &s->rx_zc[s->rx_wr_idx];
+        rx_zc_hold(z, chain);
+        z->segs[z->nsegs].ptr = src;
+        z->segs[z->nsegs].len = take;
+        z->nsegs++;
+#if RX_FLUSH_PER_PBUF
+        frame_buf_flush(src, take);
+#endif
+#else
+        u8 *dst = &s->rx_buffers[s->rx_wr_idx][s->rx_offset];
+#if RX_CODED
+        if (rx_coded(s)) dst = &s->rx_stage[s->rx_offset];
+#endif
+        memcpy(dst, src, take);
+#if RX_FLUSH_PER_PBUF
+        if (!rx_coded(s)) frame_buf_flush(dst, take);   // decoded frames: at commit
+#endif
+#endif
+#if WIRE_FRAMED
+        if (s->rx_meta[s->rx_wr_idx].flags & FRAME_FLAG_CRC)
+            s->rx_crc = crc32_update(s->rx_crc, src, take);
+#endif
+        s->rx_offset += take;
+        src += take;
+        len -= take;
 
-        // Write chunk into TCP send buffer
-        err = tcp_write(client_pcb, &buffer[offset], chunk, TCP_WRITE_FLAG_COPY);
-        if (err != ERR_OK) {
-            xil_printf("TCP write failed at offset %d: %d\n\r", offset, err);
-            return -2;
+        if (s->rx_offset == s->rx_len) {
+            if (rx_commit_frame(s) != 0) return -1;
+#if WIRE_FRAMED
+            s->rx_hdr_fill = 0;     // the next message starts
+#endif
         }
+    }
+    return 0;
+}
+
+#if WIRE_UDP
+/* -------------------------------------------------------------------------- */
+/* UDP transport (MSG_UDP_OPEN, udp_frag.h)                                   */
+/* -------------------------------------------------------------------------- */
+static u32 udp_now_us(void)
+{
+    XTime t;
+    XTime_GetTime(&t);
+    return (u32)(t / (COUNTS_PER_SECOND / 1000000));
+}
+
+static void udp_open(tcp_session_t *s, u8 dirs, const frame_udp_t *req)
+{
+    s->udp_gen++;
+    s->udp_token = (u16)(s->id | (s->udp_gen << 4));
+    ip_addr_copy(s->udp_ip, s->pcb->remote_ip);
+    s->udp_port  = req->port;
+#if WIRE_L2
+    memcpy(s->udp_mac.addr, req->mac, ETH_HWADDR_LEN);
+#endif
+    udpf_rx_init(&s->udp_rx);
+    udpf_tx_init(&s->udp_tx, UDPF_WINDOW);
+    s->udp_dirs  = dirs;
+}
+
+/* Back to TCP; unacknowledged output buffers are free again */
+static void udp_reset(tcp_session_t *s)
+{
+    s->udp_dirs = 0;
+}
+
+#if WIRE_L2
+/* The EMAC let go of a payload pbuf; may run in its TX-done interrupt */
+static void l2_ref_free(struct pbuf *p)
+{
+    l2_ref_t *r = (l2_ref_t *)p;
+
+    __atomic_fetch_sub(r->refs, 1, __ATOMIC_RELEASE);
+    __atomic_store_n(&r->refs, NULL, __ATOMIC_RELEASE);
+}
 
-        // Flush TCP send buffer immediately
-        err = tcp_output(client_pcb);
-        if (err != ERR_OK) {
-            xil_printf("TCP output failed: %d\n\r", err);
-            return -3;
+/* A payload pbuf over data, counted in *refs; they complete in order, so the next one is usually free */
+static struct pbuf *l2_ref_alloc(u32 *refs, const void *data, u32 len)
+{
+    for (int i = 0; i < L2_TX_REFS; i++) {
+        l2_ref_t *r = &l2_refs[(l2_ref_next + i) % L2_TX_REFS];
+        if (__atomic_load_n(&r->refs, __ATOMIC_ACQUIRE)) continue;
+
+        l2_ref_next = (l2_ref_next + i + 1) % L2_TX_REFS;
+        r->pc.custom_free_function = l2_ref_free;
+        struct pbuf *p = pbuf_alloced_custom(PBUF_RAW, (u16)len, PBUF_REF, &r->pc, (void *)data, (u16)len);
+        if (p) {
+            r->refs = refs;
+            __atomic_fetch_add(refs, 1, __ATOMIC_RELAXED);
         }
+        return p;
+    }
+    return NULL;
+}
+
+/*
+ * UDP_DIR_L2: one datagram as a raw Ethernet frame. The payload is chained
+ * by reference, so the EMAC descriptors point into the frame buffer; the
+ * adapter flushes it from the cache and holds the pbuf until the descriptor
+ * completes. Until then it counts against window slot w, which keeps the
+ * slot and its output buffer from being reused (tcp_tx_buf_in_flight()).
+ */
+static void l2_send_dgram(tcp_session_t *s, int w, const void *hdr, u32 hdr_len, const void *data,
+                          u32 len, err_t *e)
+{
+    struct pbuf *p = pbuf_alloc(PBUF_LINK, (u16)hdr_len, PBUF_RAM);
+    struct pbuf *d = NULL;
+
+    if (p && len) {
+        d = l2_ref_alloc(&s->udp_l2_refs[w], data, len);
+        if (d) pbuf_cat(p, d);
+    }
+    if (!p || (len && !d)) {
+        if (p) pbuf_free(p);
+        *e = ERR_MEM;
+        return;
+    }
+    memcpy(p->payload, hdr, hdr_len);
+    *e = ethernet_output(&echo_netif, p, (const struct eth_addr *)echo_netif.hwaddr, &s->udp_mac,
+                         L2_ETHERTYPE);
+    pbuf_free(p);
+}
+#endif
+
+/* data (len > 0) is part of output window slot w */
+static void udp_send_dgram(tcp_session_t *s, int w, const void *hdr, u32 hdr_len, const void *data,
+                           u32 len, err_t *e)
+{
+#if WIRE_L2
+    if (s->udp_dirs & UDP_DIR_L2) {
+        l2_send_dgram(s, w, hdr, hdr_len, data, len, e);
+        return;
+    }
+#endif
+    struct pbuf *p = pbuf_alloc(PBUF_TRANSPORT, (u16)(hdr_len + len), PBUF_RAM);
+
+    if (!p) {
+        *e = ERR_MEM;
+        return;
+    }
+    memcpy(p->payload, hdr, hdr_len);
+    if (len) memcpy((u8 *)p->payload + hdr_len, data, len);
+    *e = udp_sendto(udp_srv, p, &s->udp_ip, s->udp_port);
+    pbuf_free(p);
+}
+
+/*
+ * Put due fragments on the wire, at most UDP_TX_BURST per call. Payload is
+ * copied into the pbuf as TCP_WRITE_FLAG_COPY does; the frame's buffer stays
+ * reserved until the client acknowledges it anyway, for resends.
+ */
+static void udp_tx_pump(tcp_session_t *s, u32 now)
+{
+    udpf_tx_t *t = &s->udp_tx;
+
+    for (int i = 0; i < UDP_TX_BURST; i++) {
+        u32 frame;
+        u16 frag;
+        int kind = udpf_tx_next(t, now, &frame, &frag);
+        if (!kind) break;
 
-        // Update counters
-        offset += chunk;
-        remaining -= chunk;
+        int w = frame % UDPF_WINDOW;
+        u32 len = frag ? udpf_frag_len(s->udp_tx_len[w], frag) : FRAME_HDR_BYTES;
+        const u8 *src = frag ? s->udp_tx_buf[w] + udpf_frag_off(frag) : (const u8 *)&s->udp_tx_hdr[w];
+        udpf_hdr_t h;
+        err_t e;
+
+        udpf_make_hdr(&h, s->udp_token, frame, udpf_nfrags(s->udp_tx_len[w]), frag, len, kind == 2);
+        udp_send_dgram(s, w, &h, sizeof(h), src, len, &e);
+        if (e != ERR_OK) {
+            udpf_tx_resend(t, frame, frag, 1);  // out of pbufs or EMAC descriptors
+            break;
+        }
     }
+}
+
+/* Room in the window, and (L2) the EMAC is done with the slot the next frame takes */
+static int udp_tx_can_queue(tcp_session_t *s)
+{
+    if (!udpf_tx_can_queue(&s->udp_tx)) return 0;
+#if WIRE_L2
+    if (__atomic_load_n(&s->udp_l2_refs[s->udp_tx.head % UDPF_WINDOW], __ATOMIC_ACQUIRE)) return 0;
+#endif
+    return 1;
+}
+
+/* Queue an output frame; it goes out from udp_tx_pump() */
+static int udp_tx_frame(tcp_session_t *s, const frame_hdr_t *hdr, const u8 *buf, u32 len)
+{
+    if (!hdr || !udp_tx_can_queue(s)) return -1;
+
+    int w = udpf_tx_queue(&s->udp_tx, len) % UDPF_WINDOW;
+    s->udp_tx_hdr[w] = *hdr;
+    s->udp_tx_buf[w] = buf;
+    s->udp_tx_len[w] = len;
+    TLOG(TX_FRAME_SENT, s->id, len);
+    udp_tx_pump(s, udp_now_us());
+    return 0;
+}
 
-    xil_printf("[TCP] Frame sent (%d bytes)\n\r", length);
+#if UDP_RX
+/*
+ * Frames the ring can take: frame n lands in slot wr_idx + (n - next), so
+ * no further than the free slots. A config with CFG_CODEC_IN has one
+ * staging buffer per session, hence one frame at a time.
+ */
+static u32 udp_rx_limit(tcp_session_t *s)
+{
+    u32 room = NUM_BUFFERS - s->rx_count;
+
+    if (room > UDPF_WINDOW) room = UDPF_WINDOW;
+#if RX_CODED
+    if (s->rx_stage && room > 1) room = 1;
+#endif
+    return s->udp_rx.next + room;
+}
+
+/* Hand every complete frame to the ring, in order */
+static int udp_rx_commit(tcp_session_t *s)
+{
+    while (udpf_rx_ready(&s->udp_rx)) {
+        rx_frame_meta_t *m = &s->rx_meta[s->rx_wr_idx];
+        const u8 *buf = s->rx_buffers[s->rx_wr_idx];
+#if RX_CODED
+        if (rx_coded(s)) buf = s->rx_stage;
+#endif
+
+        s->rx_len     = m->length;
+        s->rx_t_first = m->t_first;
+        if (m->flags & FRAME_FLAG_CRC) s->rx_crc = crc32_update(0, buf, m->length);
+        udpf_rx_pop(&s->udp_rx);
+        if (rx_commit_frame(s) != 0) return -1;
+    }
     return 0;
 }
 
+/*
+ * DATA datagram. Fragment 0 is checked like a TCP header and fixes the
+ * frame's slot and length; later fragments are dropped until it is there
+ * (the NACK asks for them again), then copied to their offset.
+ */
+static int udp_rx_data(tcp_session_t *s, const udpf_hdr_t *h, struct pbuf *p)
+{
+    udpf_rx_t *r = &s->udp_rx;
+    u32 limit = udp_rx_limit(s);
+    u32 len = p->tot_len - UDPF_HDR_BYTES;
+    int idx = (s->rx_wr_idx + (h->frame - r->next)) % NUM_BUFFERS;
+    rx_frame_meta_t *m = &s->rx_meta[idx];
+
+    if (h->frame >= r->next && h->frame < limit && !udpf_rx_has(r, h->frame, h->frag)) {
+        if (h->frag == 0) {
+            frame_hdr_t fh;
+            if (len != FRAME_HDR_BYTES) return -1;
+            pbuf_copy_partial(p, &fh, sizeof(fh), UDPF_HDR_BYTES);
+            if (fh.magic != FRAME_MAGIC || fh.type != MSG_FRAME) {
+                xil_printf("[UDP] s%d Misframed datagram (magic=%08x type=%d)\n\r", s->id, fh.magic, fh.type);
+                return -1;
+            }
+            if (rx_check_frame(s, &fh, m) != 0) return -1;
+            if (h->nfrags != udpf_nfrags(fh.length)) return -1;
+            XTime_GetTime(&m->t_first);
+        }
+        else if (!udpf_rx_has(r, h->frame, 0)) {
+            udpf_rx_defer(r, h, limit);
+            return 0;
+        }
+        else if (h->nfrags != udpf_nfrags(m->length) || len != udpf_frag_len(m->length, h->frag)) {
+            r->st.dropped++;
+            return 0;
+        }
+    }
+    if (udpf_rx_accept(r, h, limit) != UDPF_NEW) return 0;
+
+    if (h->frag) {
+        u8 *dst = s->rx_buffers[idx];
+#if RX_CODED
+        if (m->flags & FRAME_FLAG_CODED) dst = s->rx_stage;
+#endif
+        pbuf_copy_partial(p, dst + udpf_frag_off(h->frag), (u16)len, UDPF_HDR_BYTES);
+    }
+    return udp_rx_commit(s);
+}
+#endif /* UDP_RX */
+
+/* The datagram's sender is the session's client, over the transport it opened */
+static int udp_from_client(tcp_session_t *s, const ip_addr_t *addr, u16 port, const struct eth_addr *mac)
+{
+#if WIRE_L2
+    if (s->udp_dirs & UDP_DIR_L2)
+        return mac && memcmp(mac->addr, s->udp_mac.addr, ETH_HWADDR_LEN) == 0;
+#endif
+    return !mac && port == s->udp_port && ip_addr_cmp(addr, &s->udp_ip);
+}
+
+/*
+ * A datagram from either transport, p starting at its udpf_hdr_t: from
+ * addr:port over UDP, or from mac in a raw Ethernet frame. Frees p.
+ */
+static void udp_dgram_input(struct pbuf *p, const ip_addr_t *addr, u16 port, const struct eth_addr *mac)
+{
+    udpf_hdr_t h;
+    u32 n;
+
+    if (pbuf_copy_partial(p, &h, sizeof(h), 0) != sizeof(h) || h.magic != UDPF_MAGIC ||
+        (n = udpf_dgram_len(&h, p->tot_len)) == 0) {
+        pbuf_free(p);
+        return;
+    }
+    /* Only the session's own client, and only while the session is alive */
+    tcp_session_t *s = &sessions[(h.token & UDP_TOKEN_SID) % MAX_SESSIONS];
+    if (!s->udp_dirs || h.token != s->udp_token || !udp_from_client(s, addr, port, mac) ||
+        (s->state != SESS_OPEN && s->state != SESS_CLOSING)) {
+        pbuf_free(p);
+        return;
+    }
+    if (n < p->tot_len) pbuf_realloc(p, (u16)n);   // Ethernet padding
+
+    if (h.type == UDPF_STATUS && udp_out(s)) {
+        u8 buf[UDPF_STATUS_MAX];
+        u32 slen = pbuf_copy_partial(p, buf, sizeof(buf), 0);
+        if (udpf_tx_status(&s->udp_tx, buf, slen, udp_now_us()) == 0)
+            udp_tx_pump(s, udp_now_us());   // resends and new credit
+    }
+#if UDP_RX
+    else if (h.type == UDPF_DATA && udp_in(s) && s->state == SESS_OPEN) {
+        if (udp_rx_data(s, &h, p) != 0) {
+            pbuf_free(p);
+            tcp_abort(s->pcb);      // err_callback marks the session dead
+            return;
+        }
+    }
+#endif
+    pbuf_free(p);
+}
+
+static void udp_recv_callback(void *arg, struct udp_pcb *pcb, struct pbuf *p,
+                              const ip_addr_t *addr, u16_t port)
+{
+    (void)arg;
+    (void)pcb;
+    udp_dgram_input(p, addr, port, NULL);
+}
+
+#if WIRE_L2
+/* netif->input in front of ethernet_input(): takes the L2_ETHERTYPE frames */
+static err_t l2_input(struct pbuf *p, struct netif *netif)
+{
+    const struct eth_hdr *eh = (const struct eth_hdr *)p->payload;
+
+    if (p->len < SIZEOF_ETH_HDR || eh->type != PP_HTONS(L2_ETHERTYPE))
+        return l2_next_input(p, netif);
+
+    struct eth_addr src = eh->src;
+    pbuf_remove_header(p, SIZEOF_ETH_HDR);
+    udp_dgram_input(p, NULL, 0, &src);
+    return ERR_OK;
+}
+#endif
+
+int udp_stream_poll(void)
+{
+    u32 now = udp_now_us();
+    int busy = 0;
+
+    for (int sid = 0; sid < MAX_SESSIONS; sid++) {
+        tcp_session_t *s = &sessions[sid];
+        if (!s->udp_dirs) continue;
+
+        if (udp_out(s)) {
+            /* A client that has hung up stops answering: drop what it never took */
+            if (s->state != SESS_OPEN && s->udp_tx.quiet >= UDP_GIVE_UP) {
+                xil_printf("[UDP] s%d client silent, dropping %d output frames\n\r",
+                           sid, s->udp_tx.head - s->udp_tx.acked);
+                udp_reset(s);
+                continue;
+            }
+            udp_tx_pump(s, now);
+            busy |= !udpf_tx_idle(&s->udp_tx);
+        }
+#if UDP_RX
+        /*
+         * ACKs, credit and NACKs. The credit moves as the pipeline pops
+         * frames, which is why this runs every turn; a lost credit update
+         * is repeated with the next STATUS.
+         */
+        if (udp_in(s) && s->state == SESS_OPEN) {
+            u8 buf[UDPF_STATUS_MAX];
+            u32 n;
+            err_t e;
+            while ((n = udpf_rx_status(&s->udp_rx, s->udp_token, udp_rx_limit(s), now, buf)) != 0) {
+                udp_send_dgram(s, 0, buf, n, NULL, 0, &e);
+                if (e != ERR_OK) break;
+            }
+            busy |= udpf_rx_busy(&s->udp_rx);
+        }
+#endif
+    }
+    return busy;
+}
+
+void udp_stream_get_stats(udpf_stats_t *rx, udpf_stats_t *tx)
+{
+    memset(rx, 0, sizeof(*rx));
+    memset(tx, 0, sizeof(*tx));
+    for (int sid = 0; sid < MAX_SESSIONS; sid++) {
+        const udpf_stats_t *a = &sessions[sid].udp_rx.st, *b = &sessions[sid].udp_tx.st;
+        rx->datagrams += a->datagrams; rx->retx += a->retx; rx->dups += a->dups;
+        rx->dropped += a->dropped; rx->nacks += a->nacks; rx->frames += a->frames;
+        tx->datagrams += b->datagrams; tx->retx += b->retx; tx->nacks += b->nacks;
+        tx->probes += b->probes; tx->frames += b->frames;
+    }
+}
+
+void udp_stream_stats_reset(void)
+{
+    for (int sid = 0; sid < MAX_SESSIONS; sid++) {
+        memset(&sessions[sid].udp_rx.st, 0, sizeof(udpf_stats_t));
+        memset(&sessions[sid].udp_tx.st, 0, sizeof(udpf_stats_t));
+    }
+}
+#else
+int  udp_stream_poll(void) { return 0; }
+void udp_stream_get_stats(udpf_stats_t *rx, udpf_stats_t *tx)
+{
+    memset(rx, 0, sizeof(*rx));
+    memset(tx, 0, sizeof(*tx));
+}
+void udp_stream_stats_reset(void) { }
+#endif /* WIRE_UDP */
+
+/* -------------------------------------------------------------------------- */
+/* Session teardown                                                           */
+/* -------------------------------------------------------------------------- */
+/* pcb is gone (aborted or reset): stop TX, let the pipeline drain the rest */
+static void session_lost(tcp_session_t *s)
+{
+    s->pcb = NULL;
+    s->state = SESS_DEAD;
+    s->tx_active = 0;
+    s->tx_ctl_len = 0;
+#if TX_ZERO_COPY
+    tx_inflight_reset(s);   // no more ACKs will arrive for this pcb
+#endif
+#if WIRE_UDP
+    udp_reset(s);
+#endif
+    rx_reset_partial(s);
+}
+
+static void err_callback(void *arg, err_t err)
+{
+    tcp_session_t *s = (tcp_session_t *)arg;
+
+    if (!s || s->state == SESS_FREE) return;
+    xil_printf("[TCP] s%d connection lost (err %d)\n\r", s->id, err);
+    session_lost(s);    // lwIP has already freed the pcb
+}
+
 /* -------------------------------------------------------------------------- */
 /* RX callback: copy into ring, apply backpressure                            */
 /* -------------------------------------------------------------------------- */
 static err_t recv_callback(void *arg, struct tcp_pcb *tpcb, struct pbuf *p, err_t err)
 {
+    tcp_session_t *s = (tcp_session_t *)arg;
+
 	if (!p) {
-	    xil_printf("[TCP] Client closed RX (FIN)\n\r");
-	    if (!tcp_tx_active) {
-	        tcp_close(tpcb);
-	        client_pcb = NULL;
-	    }
+	    // Finish the frames already received, pipeline closes once drained
+	    xil_printf("[TCP] s%d Client closed RX (FIN)\n\r", s->id);
+	    rx_reset_partial(s);
+	    s->state = SESS_CLOSING;
 	    return ERR_OK;
 	}
 
-    if (rx_full() && tcp_rx_offset == 0) return ERR_MEM; // stall
-
-    u32 copied = 0;
-    struct pbuf *q = p;
-    while (q) {
-        u8 *src = (u8 *)q->payload;
-        u16 len = q->len;
-        u32 remain = IN_FRAME_BYTES - tcp_rx_offset;
-
-        if (len <= remain) {
-            memcpy(&tcp_rx_buffers[tcp_rx_wr_idx][tcp_rx_offset], src, len);
-            tcp_rx_offset += len;
-            copied += len;
-            q = q->next;
-        } else {
-            if (remain > 0) {
-                memcpy(&tcp_rx_buffers[tcp_rx_wr_idx][tcp_rx_offset], src, remain);
-                tcp_rx_offset += remain;
-                copied += remain;
-                src += remain;
-                len -= remain;
-            }
-            if (tcp_rx_offset == IN_FRAME_BYTES) {
-                Xil_DCacheFlushRange((INTPTR)tcp_rx_buffers[tcp_rx_wr_idx], IN_FRAME_BYTES);
-                tcp_rx_ready[tcp_rx_wr_idx] = 1;
-                tcp_rx_count++;
-                xil_printf("[TCP] Frame ready buf[%d] count=%d\n\r", tcp_rx_wr_idx, tcp_rx_count);
-                tcp_rx_wr_idx = (tcp_rx_wr_idx + 1) % NUM_BUFFERS;
-                tcp_rx_offset = 0;
-            }
-            if (rx_full()) {
-                if (copied > 0) tcp_recved(tpcb, copied);
-                return ERR_MEM;
-            }
-            memcpy(&tcp_rx_buffers[tcp_rx_wr_idx][tcp_rx_offset], src, len);
-            tcp_rx_offset += len;
-            copied += len;
-            q = q->next;
-        }
-        if (tcp_rx_offset == IN_FRAME_BYTES) {
-            Xil_DCacheFlushRange((INTPTR)tcp_rx_buffers[tcp_rx_wr_idx], IN_FRAME_BYTES);
-            tcp_rx_ready[tcp_rx_wr_idx] = 1;
-            tcp_rx_count++;
-            xil_printf("[TCP] Frame ready buf[%d] count=%d\n\r", tcp_rx_wr_idx, tcp_rx_count);
-            tcp_rx_wr_idx = (tcp_rx_wr_idx + 1) % NUM_BUFFERS;
-            tcp_rx_offset = 0;
-            if (rx_full() && q) {
-                if (copied > 0) tcp_recved(tpcb, copied);
-                return ERR_MEM;
-            }
-        }
+    /*
+     * Window credit keeps this from happening; only a ring smaller than
+     * TCP_WND gets here. Take the whole chain or none of it, so a refusal
+     * never duplicates bytes.
+     */
+    if (rx_free_bytes(s) < p->tot_len) {
+        rx_flow_stats.refused++;
+        return ERR_MEM; // stall
     }
 
-    if (copied > 0) tcp_recved(tpcb, copied);
-    pbuf_free(p);
+#if RX_ZERO_COPY
+    if (s->rx_zc[s->rx_wr_idx].nsegs + pbuf_clen(p) + 1 > RX_ZC_MAX_SEGS ||
+        s->rx_zc[s->rx_wr_idx].nchains + 1 > RX_ZC_MAX_CHAINS) {
+        xil_printf("[TCP] s%d ZC slot %d out of segments, aborting\n\r", s->id, s->rx_wr_idx);
+        goto abort;
+    }
+#endif
+
+    for (struct pbuf *q = p; q; q = q->next) {
+        if (rx_consume(s, p, (const u8 *)q->payload, q->len) != 0) goto abort;
+    }
+
+    s->rx_owed += p->tot_len;
+    rx_credit(s);
+    if (s->rx_owed > rx_flow_stats.owed_max) rx_flow_stats.owed_max = s->rx_owed;
+    pbuf_free(p);   // zero-copy slots keep their own references
+    if (s->tx_ctl_len) send_callback(s, tpcb, 0);  // CONFIG_ACK
     return ERR_OK;
+
+abort:
+    pbuf_free(p);
+    tcp_abort(tpcb);    // err_callback marks the session dead
+    return ERR_ABRT;
 }
 
 /* -------------------------------------------------------------------------- */
@@ -255,18 +1515,82 @@ static err_t recv_callback(void *arg, struct tcp_pcb *tpcb, struct pbuf *p, err_
 /* -------------------------------------------------------------------------- */
 static err_t accept_callback(void *arg, struct tcp_pcb *newpcb, err_t err)
 {
-    xil_printf("[TCP] Client connected.\n\r");
-    client_pcb = newpcb;
+    tcp_session_t *s = NULL;
+
+    for (int i = 0; i < MAX_SESSIONS; i++) {
+        if (sessions[i].state == SESS_FREE) { s = &sessions[i]; break; }
+    }
+    if (!s) {
+        xil_printf("[TCP] All %d sessions busy, refusing client\n\r", MAX_SESSIONS);
+        tcp_abort(newpcb);
+        return ERR_ABRT;
+    }
+
+    xil_printf("[TCP] s%d Client connected.\n\r", s->id);
+    s->pcb   = newpcb;
+    s->state = SESS_OPEN;
+    s->rx_owed = 0;
+#if RX_CODED
+    s->rx_have_ref = 0;     // the ring restarts at slot 0
+#endif
+    tcp_arg(newpcb, s);
     tcp_recv(newpcb, recv_callback);
     tcp_sent(newpcb, send_callback);
+    tcp_err(newpcb, err_callback);
     return ERR_OK;
 }
 
+/* -------------------------------------------------------------------------- */
+/* Public: session table                                                      */
+/* -------------------------------------------------------------------------- */
+int tcp_session_state(int sid) { return sessions[sid].state; }
+
+int tcp_session_count(void)
+{
+    int n = 0;
+    for (int i = 0; i < MAX_SESSIONS; i++)
+        if (sessions[i].state != SESS_FREE) n++;
+    return n;
+}
+
+/* Called by the pipeline once a closing/dead session holds no frames */
+void tcp_session_release(int sid)
+{
+    tcp_session_t *s = &sessions[sid];
+
+    if (s->pcb) {
+        tcp_arg(s->pcb, NULL);
+        tcp_recv(s->pcb, NULL);
+        tcp_sent(s->pcb, NULL);
+        tcp_err(s->pcb, NULL);
+        if (tcp_close(s->pcb) != ERR_OK) tcp_abort(s->pcb);
+        s->pcb = NULL;
+    }
+    while (tcp_rx_pop_frame(sid) == 0) ;    // frames the client will never get
+    rx_reset_partial(s);
+    s->rx_wr_idx = s->rx_rd_idx = 0;
+    s->tx_active = 0;
+    s->tx_ctl_len = 0;
+#if TX_ZERO_COPY
+    tx_inflight_reset(s);
+#endif
+#if WIRE_UDP
+    udp_reset(s);
+#endif
+    s->state = SESS_FREE;
+    xil_printf("[TCP] s%d closed\n\r", sid);
+}
+
 /* -------------------------------------------------------------------------- */
 /* Start server                                                               */
 /* -------------------------------------------------------------------------- */
 int start_application(void)
 {
+    for (int i = 0; i < MAX_SESSIONS; i++) {
+        sessions[i].id    = i;
+        sessions[i].state = SESS_FREE;
+    }
+
     struct tcp_pcb *pcb = tcp_new_ip_type(IPADDR_TYPE_ANY);
     if (!pcb) return -1;
 
@@ -279,7 +1603,27 @@ int start_application(void)
     if (!pcb) return -3;
 
     tcp_accept(pcb, accept_callback);
+    rx_carve();
+
+#if WIRE_UDP
+    /* Without it MSG_UDP_OPEN is refused and every session stays on TCP */
+    udp_srv = udp_new_ip_type(IPADDR_TYPE_ANY);
+    if (udp_srv && udp_bind(udp_srv, IP_ANY_TYPE, UDP_PORT) == ERR_OK)
+        udp_recv(udp_srv, udp_recv_callback, NULL);
+    else {
+        xil_printf("[UDP] No pcb for port %d, UDP transport off\n\r", UDP_PORT);
+        if (udp_srv) udp_remove(udp_srv);
+        udp_srv = NULL;
+    }
+#endif
+#if WIRE_L2
+    if (udp_srv) {
+        l2_next_input = echo_netif.input;
+        echo_netif.input = l2_input;
+        xil_printf("[UDP] Raw Ethernet on EtherType %04x\n\r", L2_ETHERTYPE);
+    }
+#endif
 
-    xil_printf("[TCP] Server listening on %d\n\r", TCP_PORT);
+    xil_printf("[TCP] Server listening on %d (%d sessions)\n\r", TCP_PORT, MAX_SESSIONS);
     return 0;
 }
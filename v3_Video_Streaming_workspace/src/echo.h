@@ -0,0 +1,190 @@
+/*
+ * echo.h - TCP RX ring / TX engine interface (echo.c)
+ */
+
+#ifndef ECHO_H
+#define ECHO_H
+
+#include "xil_types.h"
+#include "xtime_l.h"
+#include "lwip/tcp.h"
+#include "frame_proto.h"
+#include "udp_frag.h"
+
+/* -------------------------------------------------------------------------- */
+/* Build options                                                              */
+/* -------------------------------------------------------------------------- */
+/*
+ * RX_ZERO_COPY
+ *   0 : recv_callback memcpy's every pbuf into tcp_rx_buffers[] (default)
+ *   1 : the ring keeps pbuf references instead of copying; a ready frame is
+ *       exposed as a scatter list of pbuf payload segments and the pbufs are
+ *       released by tcp_rx_pop_frame() once MM2S has consumed them.
+ *       Needs DMA_USE_SG: simple mode would end every segment with TLAST.
+ *       Holding up to NUM_BUFFERS frames of pbufs needs PBUF_POOL_SIZE in the
+ *       lwIP BSP settings raised well above its default (~120 pbufs per
+ *       320x180 BGR24 frame at MSS 1460).
+ */
+#ifndef RX_ZERO_COPY
+#define RX_ZERO_COPY    0
+#endif
+
+#define RX_ZC_MAX_SEGS  512     // payload segments per frame slot
+#define RX_ZC_MAX_CHAINS 256    // distinct pbuf chains per frame slot
+
+/*
+ * TX_ZERO_COPY
+ *   0 : tcp_write(..., TCP_WRITE_FLAG_COPY) copies the output frame into
+ *       lwIP pbufs; the buffer is free again once the last byte is queued
+ *   1 : tcp_write references the output buffer directly; the buffer stays
+ *       in flight until tcp_sent() has acknowledged its last byte
+ */
+#ifndef TX_ZERO_COPY
+#define TX_ZERO_COPY    0
+#endif
+
+#define TX_MAX_INFLIGHT 4       // output buffers awaiting ACK (zero-copy TX)
+
+#ifndef NUM_BUFFERS
+#define NUM_BUFFERS     10      // RX ring slots per session
+#endif
+
+/*
+ * MAX_SESSIONS: concurrent client connections. Each gets its own RX ring
+ * slice (NUM_BUFFERS) and OUT_SLOTS output buffers from the frame pool;
+ * the DMA/IP is shared round-robin. Extra clients are refused. lwIP needs
+ * MEMP_NUM_TCP_PCB >= MAX_SESSIONS + 1 (listener) in the BSP settings.
+ */
+#ifndef MAX_SESSIONS
+#define MAX_SESSIONS    4
+#endif
+
+/*
+ * WIRE_UDP: a client may move its frame messages onto UDP with MSG_UDP_OPEN
+ * (frame_proto.h); fragments, ACKs and NACKs are udp_frag.h. Sessions that
+ * do not ask stay on TCP unchanged. Off by default; needs WIRE_FRAMED.
+ * Input datagrams are copied into the ring, so UDP_DIR_IN is not granted
+ * with RX_ZERO_COPY. lwIP needs LWIP_UDP and one more MEMP_NUM_UDP_PCB in
+ * the BSP settings.
+ */
+#ifndef WIRE_UDP
+#define WIRE_UDP        0
+#endif
+
+#define UDP_PORT        6002
+#define UDP_TX_BURST    64      // datagrams per session per udp_stream_poll()
+#define UDP_GIVE_UP     25      // unanswered probes before a closed client's output is dropped
+
+/*
+ * WIRE_L2: MSG_UDP_OPEN with UDP_DIR_L2 carries the same datagrams in raw
+ * Ethernet frames between the two MACs, past lwIP's IP and UDP layers.
+ * Output fragments reach the EMAC as pbufs referencing the frame buffer:
+ * no copy and no checksum pass. Client and board must share a segment.
+ * The Xilinx adapter hands only IP and ARP frames to netif->input; its
+ * xemacpsif_input() needs L2_ETHERTYPE added to that switch (README).
+ */
+#ifndef WIRE_L2
+#define WIRE_L2         0
+#endif
+
+#define L2_TX_REFS      256     // payload pbufs the EMAC may hold at once, all sessions
+
+/* Session life cycle: FREE -> OPEN -> CLOSING (FIN) or DEAD (RST/abort) -> FREE */
+enum { SESS_FREE = 0, SESS_OPEN, SESS_CLOSING, SESS_DEAD };
+
+/* One contiguous piece of a received frame */
+typedef struct {
+    const u8 *ptr;
+    u32       len;
+} rx_seg_t;
+
+/* Header fields of a received frame (synthesised when WIRE_FRAMED is 0) */
+typedef struct {
+    u32 seq;
+    u16 width;
+    u16 height;
+    u8  format;
+    u8  bpp;
+    u8  flags;
+    u8  crc_ok;         // 0 if FRAME_FLAG_CRC was set and the payload mismatched
+    u32 length;
+    u32 crc32;
+    XTime t_first;      // stamps TS_RX_FIRST/DONE/COMMIT (frame_trace.h)
+    XTime t_done;
+    XTime t_commit;
+} rx_frame_meta_t;
+
+/* TX burst counters, all sessions, since the last tcp_tx_stats_reset() */
+typedef struct {
+    u32 frames;         // frames fully queued
+    u32 writes;         // tcp_write() calls for payload
+    u32 outputs;        // tcp_output() calls (one per burst)
+    u32 segs;           // segments tcp_write() queued for frames, header included
+    u64 bytes;
+    u32 mss;            // MSS of the last burst
+} tcp_tx_stats_t;
+
+/* RX ring flow control, all sessions, since the last tcp_rx_flow_stats_reset() */
+typedef struct {
+    u32 full;           // frames that filled a ring (rx_count reached NUM_BUFFERS)
+    u32 peak;           // highest rx_count
+    u32 refused;        // pbufs recv_callback refused with ERR_MEM
+    u32 owed_max;       // most window credit withheld from lwIP, bytes
+} tcp_rx_flow_stats_t;
+
+/* FRAME_FLAG_CODED input frames, all sessions, since the last reset */
+typedef struct {
+    u32   frames;
+    u64   coded_bytes;  // on the wire
+    u64   raw_bytes;    // after vc_decode()
+    XTime dec_ticks;
+} tcp_rx_codec_stats_t;
+
+/* -------------------------------------------------------------------------- */
+/* Globals                                                                    */
+/* -------------------------------------------------------------------------- */
+extern struct netif echo_netif;
+
+/* -------------------------------------------------------------------------- */
+/* API                                                                        */
+/* -------------------------------------------------------------------------- */
+int  start_application(void);
+
+/* Sessions (sid = 0 .. MAX_SESSIONS-1) */
+int  tcp_session_count(void);               // connected clients
+int  tcp_session_state(int sid);
+void tcp_session_release(int sid);          // drained CLOSING/DEAD -> FREE
+
+/* Session control: MSG_CONFIG is passed to this handler, which returns CFG_* */
+typedef int (*rx_config_handler_t)(const frame_cfg_t *req);
+void tcp_rx_set_config_handler(rx_config_handler_t fn);
+
+/* RX ring */
+u8*  tcp_rx_peek_frame(int sid, int *idx_out);
+int  tcp_rx_peek_frame_sg(int sid, int *idx_out, const rx_seg_t **segs, int *nsegs);
+int  tcp_rx_peek_nth_sg(int sid, int n, int *idx_out, const rx_seg_t **segs, int *nsegs);
+int  tcp_rx_pop_frame(int sid);
+int  tcp_rx_queued(int sid);
+const rx_frame_meta_t *tcp_rx_frame_meta(int sid, int idx);
+void tcp_rx_get_flow_stats(tcp_rx_flow_stats_t *st);
+void tcp_rx_flow_stats_reset(void);
+void tcp_rx_get_codec_stats(tcp_rx_codec_stats_t *st);
+void tcp_rx_codec_stats_reset(void);
+
+/* TX */
+int  start_sending(int sid, const u8 *buf, u32 len);  // async TX kick
+int  start_sending_frame(int sid, const frame_hdr_t *hdr, const u8 *buf, u32 len);
+int  tcp_tx_is_busy(int sid);
+int  tcp_tx_buf_in_flight(int sid, const u8 *buf);    // still referenced by lwIP
+void tcp_tx_get_stats(tcp_tx_stats_t *st);
+void tcp_tx_stats_reset(void);
+
+/*
+ * UDP sessions: send due fragments and STATUS datagrams. Call every run-loop
+ * turn; nonzero while a retransmission timer is running.
+ */
+int  udp_stream_poll(void);
+void udp_stream_get_stats(udpf_stats_t *rx, udpf_stats_t *tx);   // all sessions
+void udp_stream_stats_reset(void);
+
+#endif /* ECHO_H */
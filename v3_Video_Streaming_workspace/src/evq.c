@@ -0,0 +1,147 @@
+/*
+ * evq.c - event bitmask + WFI idle for the bare-metal run loop
+ *
+ * Interrupt handlers only set bits (and stamp the first post), main() takes
+ * the whole set at once and runs every handler to completion, so the time
+ * from post to dispatch is bounded by one pass of the loop and is measured
+ * per event.
+ *
+ * Sources: the GEM interrupt (the xemacpsif handler is wrapped), the DMA
+ * ISRs (dma.c), the lwIP timer flags of the platform timer, and the
+ * pipeline itself when it has polled work in flight. Any interrupt ends a
+ * WFI, so the timer flags are picked up on the wakeup their tick causes.
+ */
+
+#include "xparameters.h"
+#include "xil_printf.h"
+#include "xil_exception.h"
+#include "evq.h"
+#ifdef SIM_HOST
+#include "sim.h"
+#else
+#include "netif/xadapter.h"
+#include "netif/xemacpsif.h"
+#include "echo.h"
+#endif
+
+static volatile u32 ev_pending = 0;
+static XTime ev_posted[EV_COUNT];   // first post since the last dispatch
+static evq_stats_t evs;
+
+#ifndef SIM_HOST
+/* Set by the platform timer ISR (platform_zynqmp.c of the lwIP template) */
+extern volatile int TcpFastTmrFlag;
+extern volatile int TcpSlowTmrFlag;
+
+static void evq_emac_isr(void *ref)
+{
+    XEmacPs_IntrHandler(ref);
+    evq_post(EV_NET_RX);
+}
+#endif
+
+/*
+ * The lwIP template brings the GIC up with the base-address API and keeps
+ * no driver instance. This one is bound to the same config entry, so its
+ * handler table is the one the template's IRQ vector dispatches from, and
+ * XScuGic_CfgInitialize() leaves the handlers already in it alone.
+ */
+XScuGic *evq_gic(void)
+{
+    static XScuGic gic;
+
+    if (gic.IsReady != XIL_COMPONENT_IS_READY) {
+        XScuGic_Config *cfg = XScuGic_LookupConfig(EVQ_GIC_DEVICE_ID);
+        if (!cfg || XScuGic_CfgInitialize(&gic, cfg, cfg->CpuBaseAddress) != XST_SUCCESS) {
+            xil_printf("[ERROR] GIC instance init failed\n\r");
+            return NULL;
+        }
+    }
+    return &gic;
+}
+
+void evq_init(void)
+{
+#ifndef SIM_HOST
+    /* Same GIC slot xemacpsif registered, now with a post after the handler */
+    struct xemac_s *xemac = (struct xemac_s *)echo_netif.state;
+    xemacpsif_s *emacif = (xemacpsif_s *)xemac->state;
+    XScuGic *gic = evq_gic();
+    if (!gic || XScuGic_Connect(gic, EVQ_EMAC_IRQ_ID, (Xil_InterruptHandler)evq_emac_isr,
+                                &emacif->emacps) != XST_SUCCESS)
+        xil_printf("[ERROR] EVQ: GEM interrupt hook failed, RX events come from polling only\n\r");
+#endif
+    evq_post(EV_NET_RX);    // anything that arrived before the hook
+    xil_printf("[EVQ] run loop: %s idle\n\r", EVQ_USE_WFI ? "WFI" : "spin");
+}
+
+void evq_post(u32 ev)
+{
+    u32 old = __atomic_fetch_or(&ev_pending, ev, __ATOMIC_RELEASE);
+    u32 fresh = ev & ~old;
+
+    if (!fresh) return;
+    XTime now;
+    XTime_GetTime(&now);
+    for (int i = 0; i < EV_COUNT; i++)
+        if (fresh & (1u << i)) ev_posted[i] = now;
+}
+
+/* Turn the platform timer flags into events */
+static void evq_poll_sources(void)
+{
+#ifndef SIM_HOST
+    if (TcpFastTmrFlag) { TcpFastTmrFlag = 0; evq_post(EV_TMR_FAST); }
+    if (TcpSlowTmrFlag) { TcpSlowTmrFlag = 0; evq_post(EV_TMR_SLOW); }
+#endif
+}
+
+/* Nothing pending: sleep until an interrupt (time counts as idle) */
+static void evq_idle(void)
+{
+    XTime t0, t1;
+
+    XTime_GetTime(&t0);
+#ifdef SIM_HOST
+    /* No GEM interrupt: wait for the TAP or 1 ms, xemacif_input() runs the timeouts */
+    if (EVQ_USE_WFI) sim_idle(1000);
+    evq_post(EV_NET_RX);
+#elif EVQ_USE_WFI
+    /* Masked, a pending interrupt still ends WFI; it is taken after the enable */
+    Xil_ExceptionDisable();
+    if (ev_pending == 0) __asm__ volatile("dsb sy\n\twfi" ::: "memory");
+    Xil_ExceptionEnable();
+#endif
+    XTime_GetTime(&t1);
+    evs.idle_ticks += t1 - t0;
+}
+
+u32 evq_wait(void)
+{
+    u32 ev;
+
+    for (;;) {
+        evq_poll_sources();
+        ev = __atomic_exchange_n(&ev_pending, 0, __ATOMIC_ACQUIRE);
+        if (ev) break;
+        evq_idle();
+    }
+
+    XTime now;
+    XTime_GetTime(&now);
+    evs.wakeups++;
+    for (int i = 0; i < EV_COUNT; i++) {
+        if (!(ev & (1u << i))) continue;
+        XTime lat = now - ev_posted[i];
+        evs.events[i]++;
+        evs.lat_sum[i] += lat;
+        if (lat > evs.lat_max[i]) evs.lat_max[i] = lat;
+    }
+    return ev;
+}
+
+int evq_pending(void) { return ev_pending != 0; }
+
+void evq_get_stats(evq_stats_t *st) { *st = evs; }
+
+void evq_stats_reset(void) { evs = (evq_stats_t){ 0 }; }
@@ -0,0 +1,60 @@
+/*
+ * evq.h - run-loop events: interrupt sources post, main() dispatches
+ */
+
+#ifndef EVQ_H
+#define EVQ_H
+
+#include "xil_types.h"
+#include "xtime_l.h"
+#include "xscugic.h"
+
+/*
+ * EVQ_USE_WFI
+ *   0 : evq_wait() spins until an event is pending (lowest latency, 100% CPU)
+ *   1 : the core sleeps in WFI while nothing is pending (default)
+ */
+#ifndef EVQ_USE_WFI
+#define EVQ_USE_WFI     1
+#endif
+
+/* GEM the lwIP netif runs on (main.c adds PSU_ETHERNET_3) */
+#ifndef EVQ_EMAC_IRQ_ID
+#define EVQ_EMAC_IRQ_ID XPAR_XEMACPS_3_INTR
+#endif
+
+#define EVQ_NET_BUDGET  64      // packets per EV_NET_RX before other events get a turn
+
+/* Event bits; several posts of one event before dispatch coalesce */
+#define EV_NET_RX       0x01    // GEM interrupt: frames queued for xemacif_input()
+#define EV_DMA          0x02    // DMA IOC/error interrupt
+#define EV_TMR_FAST     0x04    // lwIP tcp_fasttmr() due (platform timer)
+#define EV_TMR_SLOW     0x08    // lwIP tcp_slowtmr() due
+#define EV_PIPE         0x10    // pipeline work that can only be polled
+#define EV_COUNT        5
+
+typedef struct {
+    u32   wakeups;              // evq_wait() returns
+    u32   events[EV_COUNT];     // dispatches per event
+    XTime lat_sum[EV_COUNT];    // post -> dispatch, ticks
+    XTime lat_max[EV_COUNT];
+    XTime idle_ticks;           // time spent in WFI
+} evq_stats_t;
+
+/* GIC device of the platform (one GIC-400 on ZynqMP) */
+#ifndef EVQ_GIC_DEVICE_ID
+#define EVQ_GIC_DEVICE_ID   XPAR_SCUGIC_SINGLE_DEVICE_ID
+#endif
+
+void evq_init(void);                // after xemac_add(): hooks the GEM interrupt
+void evq_post(u32 ev);              // any context, including ISRs
+u32  evq_wait(void);                // sleep until something is pending, take it all
+int  evq_pending(void);             // nonzero if the next evq_wait() returns at once
+
+/* Driver instance over the GIC init_platform() started, for XScuGic_Connect(); NULL on failure */
+XScuGic *evq_gic(void);
+
+void evq_get_stats(evq_stats_t *st);
+void evq_stats_reset(void);
+
+#endif /* EVQ_H */
@@ -0,0 +1,92 @@
+/*
+ * frame_cache.c - cache policy of the frame pool + timed maintenance helpers
+ *
+ * Every maintenance call is bracketed with XTime so the stats report shows
+ * what flush/invalidate cost per frame in each FRAME_BUF_CACHE_MODE.
+ */
+
+#include "xil_printf.h"
+#include "xil_cache.h"
+#include "xil_mmu.h"
+#include "frame_cache.h"
+
+#define MMU_BLOCK_BYTES     0x200000    // Xil_SetTlbAttributes granularity
+
+static UINTPTR pool_lo = 0, pool_hi = 0;
+static frame_cache_stats_t cstats;
+
+#if FRAME_BUF_CACHE_MODE != FRAME_CACHE_CACHED
+static int in_pool(const void *buf, u32 len)
+{
+    UINTPTR a = (UINTPTR)buf;
+    return a >= pool_lo && a + len <= pool_hi;
+}
+#endif
+
+void frame_cache_init(u8 *pool, u32 size)
+{
+    pool_lo = (UINTPTR)pool;
+    pool_hi = pool_lo + size;
+
+#if FRAME_BUF_CACHE_MODE != FRAME_CACHE_CACHED
+    u64 attr;
+#if FRAME_BUF_CACHE_MODE == FRAME_CACHE_NONCACHED
+    attr = NORM_NONCACHE;
+#else
+    attr = (NORM_WB_CACHE & ~(u64)INNER_SHAREABLE) | OUTER_SHAREABLE;
+#endif
+    /* Write back anything the loader / .bss clear left in the cache first */
+    Xil_DCacheFlushRange((INTPTR)pool, size);
+    for (UINTPTR a = pool_lo; a < pool_hi; a += MMU_BLOCK_BYTES)
+        Xil_SetTlbAttributes(a, attr);
+#endif
+
+    xil_printf("[CACHE] frame pool %d KB, mode %d, rx flush %s\n\r",
+               size / 1024, FRAME_BUF_CACHE_MODE,
+               RX_FLUSH_PER_PBUF ? "per pbuf" : "per frame");
+}
+
+void frame_cache_pool(UINTPTR *base, u32 *size)
+{
+    *base = pool_lo;
+    *size = (u32)(pool_hi - pool_lo);
+}
+
+void frame_buf_flush(const void *buf, u32 len)
+{
+#if FRAME_BUF_CACHE_MODE != FRAME_CACHE_CACHED
+    if (in_pool(buf, len)) return;
+#endif
+    XTime t0, t1;
+    XTime_GetTime(&t0);
+    Xil_DCacheFlushRange((INTPTR)buf, len);
+    XTime_GetTime(&t1);
+
+    cstats.flush_ticks += t1 - t0;
+    cstats.flush_bytes += len;
+    cstats.flush_ops++;
+}
+
+void frame_buf_invalidate(void *buf, u32 len)
+{
+#if FRAME_BUF_CACHE_MODE != FRAME_CACHE_CACHED
+    if (in_pool(buf, len)) return;
+#endif
+    XTime t0, t1;
+    XTime_GetTime(&t0);
+    Xil_DCacheInvalidateRange((INTPTR)buf, len);
+    XTime_GetTime(&t1);
+
+    cstats.inval_ticks += t1 - t0;
+    cstats.inval_bytes += len;
+    cstats.inval_ops++;
+}
+
+void frame_cache_get_stats(frame_cache_stats_t *st) { *st = cstats; }
+
+void frame_cache_stats_reset(void)
+{
+    cstats.flush_ticks = cstats.inval_ticks = 0;
+    cstats.flush_bytes = cstats.inval_bytes = 0;
+    cstats.flush_ops = cstats.inval_ops = 0;
+}
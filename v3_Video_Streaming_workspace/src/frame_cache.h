@@ -0,0 +1,69 @@
+/*
+ * frame_cache.h - cache policy of the frame pool + timed maintenance helpers
+ */
+
+#ifndef FRAME_CACHE_H
+#define FRAME_CACHE_H
+
+#include "xil_types.h"
+#include "xtime_l.h"
+
+/*
+ * FRAME_BUF_CACHE_MODE (RX ring + output slots, i.e. the frame pool)
+ *   0 : cacheable; RX frames are flushed once before the DMA reads them and
+ *       outputs invalidated after S2MM (default)
+ *   1 : non-cacheable; the pool is remapped Normal non-cacheable at boot and
+ *       needs no maintenance. CPU reads of outputs (WIRE_TX_CRC, copy-mode
+ *       TX) get slow, so pair it with TX_ZERO_COPY.
+ *   2 : coherent; the pool stays cacheable but is marked outer shareable and
+ *       the DMA must reach DDR through S_AXI_HPC0/1 with AxCACHE=0xF and
+ *       coherency enabled in the CCI (broadcast outer shareable). No
+ *       maintenance at all.
+ * Zero-copy RX segments live in lwIP pbufs outside the pool and are always
+ * flushed, except in mode 2 if PBUF memory is made coherent as well.
+ */
+#define FRAME_CACHE_CACHED      0
+#define FRAME_CACHE_NONCACHED   1
+#define FRAME_CACHE_COHERENT    2
+
+#ifndef FRAME_BUF_CACHE_MODE
+#define FRAME_BUF_CACHE_MODE    FRAME_CACHE_CACHED
+#endif
+
+/*
+ * RX_FLUSH_PER_PBUF
+ *   0 : one flush of the whole input frame when it completes (default)
+ *   1 : flush every pbuf's bytes as they land, so completion has no 170 KB+
+ *       flush on its critical path (spread across the receive instead)
+ */
+#ifndef RX_FLUSH_PER_PBUF
+#define RX_FLUSH_PER_PBUF       0
+#endif
+
+/* Remapping works on 2 MB MMU blocks: pool base and size must be multiples */
+#if FRAME_BUF_CACHE_MODE != FRAME_CACHE_CACHED
+#define FRAME_POOL_BASE_ALIGN   0x200000
+#else
+#define FRAME_POOL_BASE_ALIGN   64
+#endif
+
+typedef struct {
+    XTime flush_ticks;
+    XTime inval_ticks;
+    u64   flush_bytes;
+    u64   inval_bytes;
+    u32   flush_ops;
+    u32   inval_ops;
+} frame_cache_stats_t;
+
+void frame_cache_init(u8 *pool, u32 size);
+void frame_cache_pool(UINTPTR *base, u32 *size);
+
+/* Range maintenance; no-ops for pool memory that is non-cacheable/coherent */
+void frame_buf_flush(const void *buf, u32 len);
+void frame_buf_invalidate(void *buf, u32 len);
+
+void frame_cache_get_stats(frame_cache_stats_t *st);
+void frame_cache_stats_reset(void);
+
+#endif /* FRAME_CACHE_H */
@@ -0,0 +1,179 @@
+/*
+ * frame_cfg.c - runtime frame geometry and the DDR frame pool
+ */
+
+#include <string.h>
+#include "xil_printf.h"
+#include "echo.h"
+#include "pipeline.h"
+#include "frame_cfg.h"
+#include "frame_cache.h"
+#include "pix_pack.h"
+
+static u8 frame_pool[FRAME_POOL_BYTES] __attribute__((aligned(FRAME_POOL_BASE_ALIGN)));
+
+typedef char frame_pool_size_check[(FRAME_POOL_BYTES % FRAME_POOL_BASE_ALIGN == 0) ? 1 : -1];
+
+static frame_cfg_t cur_cfg;
+static u32 cur_in_bytes;
+static u32 cur_out_bytes;
+static u32 cur_ip_out_bytes;
+static u32 cur_code_bytes;
+
+#if !RX_ZERO_COPY
+static u8 *rx_bufs[MAX_SESSIONS][NUM_BUFFERS];
+#endif
+static u8 *out_bufs[MAX_SESSIONS][OUT_SLOTS];
+static u8 *code_bufs[MAX_SESSIONS][OUT_SLOTS];
+static u8 *code_refs[MAX_SESSIONS];
+static u8 *rx_stages[MAX_SESSIONS];
+
+static u32 pool_align(u32 n)
+{
+    return (n + FRAME_POOL_ALIGN - 1) & ~(u32)(FRAME_POOL_ALIGN - 1);
+}
+
+/* Expected bytes per pixel of a format, 0 if any bpp is allowed */
+static u32 fmt_bpp(u8 fmt)
+{
+    switch (fmt) {
+    case PIXFMT_BGR24:  return 3;
+    case PIXFMT_ABGR32: return 4;
+    case PIXFMT_RAW:    return 0;
+    default:            return 0xFF;
+    }
+}
+
+static int cfg_check(const frame_cfg_t *c)
+{
+    u32 ib = fmt_bpp(c->in_fmt), ob = fmt_bpp(c->out_fmt);
+
+    if (ib == 0xFF || ob == 0xFF) return CFG_ERR_INVALID;
+    if ((ib && ib != c->in_bpp) || (ob && ob != c->out_bpp)) return CFG_ERR_INVALID;
+    if (!c->in_w || !c->in_h || !c->out_w || !c->out_h) return CFG_ERR_INVALID;
+    if (!c->in_bpp || !c->out_bpp) return CFG_ERR_INVALID;
+    if (c->scale && (c->out_w != c->in_w * c->scale || c->out_h != c->in_h * c->scale))
+        return CFG_ERR_INVALID;
+    return CFG_OK;
+}
+
+/* The CFG_CODEC_* subset of a request this build and geometry can do */
+static u16 codec_supported(const frame_cfg_t *c)
+{
+    u16 ok = 0;
+
+#if VCODEC
+    if (c->out_bpp <= VC_MAX_BPP) ok |= CFG_CODEC_OUT | CFG_CODEC_OUT_SKIP;
+#if !RX_ZERO_COPY
+    /* Coded input is decoded out of a staging buffer into a copy-mode slot */
+    if (c->in_bpp <= VC_MAX_BPP) ok |= CFG_CODEC_IN;
+#endif
+#endif
+    ok &= c->codec;
+    if (!(ok & CFG_CODEC_OUT)) ok &= (u16)~CFG_CODEC_OUT_SKIP;
+    return ok;
+}
+
+/* Validate and carve the pool; the caller guarantees nothing is queued */
+int frame_cfg_apply(const frame_cfg_t *req)
+{
+    int st = cfg_check(req);
+    if (st != CFG_OK) return st;
+
+    u32 in_bytes  = (u32)req->in_w * req->in_h * req->in_bpp;
+    u32 out_bytes = (u32)req->out_w * req->out_h * req->out_bpp;
+    u32 ip_bytes  = (req->out_fmt == PIXFMT_BGR24) ? (u32)req->out_w * req->out_h * IP_OUT_BPP
+                                                   : out_bytes;
+    u16 codec = codec_supported(req);
+    u32 code_bytes = (codec & CFG_CODEC_OUT) ? vc_bound(req->out_w, req->out_h, req->out_bpp) : 0;
+    u64 need = (u64)OUT_SLOTS * pool_align(ip_bytes);
+#if !RX_ZERO_COPY
+    need += (u64)NUM_BUFFERS * pool_align(in_bytes);
+#endif
+    if (codec & CFG_CODEC_OUT) need += (u64)OUT_SLOTS * pool_align(code_bytes) + pool_align(out_bytes);
+    if (codec & CFG_CODEC_IN)  need += pool_align(in_bytes);
+    need *= MAX_SESSIONS;
+    if (need > FRAME_POOL_BYTES) {
+        xil_printf("[CFG] %d bytes needed, pool is %d\n\r", (u32)need, FRAME_POOL_BYTES);
+        return CFG_ERR_NOMEM;
+    }
+
+    u8 *p = frame_pool;
+    for (int sid = 0; sid < MAX_SESSIONS; sid++) {
+        for (int i = 0; i < OUT_SLOTS; i++) {
+            out_bufs[sid][i] = p;
+            p += pool_align(ip_bytes);
+        }
+#if !RX_ZERO_COPY
+        for (int i = 0; i < NUM_BUFFERS; i++) {
+            rx_bufs[sid][i] = p;
+            p += pool_align(in_bytes);
+        }
+#endif
+        /* code_bytes is 0 without CFG_CODEC_OUT */
+        for (int i = 0; i < OUT_SLOTS; i++) {
+            code_bufs[sid][i] = code_bytes ? p : NULL;
+            p += pool_align(code_bytes);
+        }
+        code_refs[sid] = code_bytes ? p : NULL;
+        p += code_bytes ? pool_align(out_bytes) : 0;
+        rx_stages[sid] = (codec & CFG_CODEC_IN) ? p : NULL;
+        p += (codec & CFG_CODEC_IN) ? pool_align(in_bytes) : 0;
+    }
+
+    cur_cfg = *req;
+    cur_cfg.status = CFG_OK;
+    cur_cfg.codec  = codec;
+    cur_in_bytes  = in_bytes;
+    cur_out_bytes = out_bytes;
+    cur_ip_out_bytes = ip_bytes;
+    cur_code_bytes = code_bytes;
+
+    xil_printf("[CFG] in %dx%d fmt %d bpp %d -> out %dx%d fmt %d bpp %d (x%d)%s, codec %x, pool %d/%d bytes\n\r",
+               req->in_w, req->in_h, req->in_fmt, req->in_bpp,
+               req->out_w, req->out_h, req->out_fmt, req->out_bpp, req->scale,
+               frame_cfg_out_packed() ? ", packed from ABGR32" : "", codec,
+               (u32)need, FRAME_POOL_BYTES);
+    return CFG_OK;
+}
+
+void frame_cfg_init(void)
+{
+    frame_cfg_t def;
+
+    memset(&def, 0, sizeof(def));
+    def.in_w    = IN_IMG_W;
+    def.in_h    = IN_IMG_H;
+    def.in_fmt  = PIXFMT_BGR24;
+    def.in_bpp  = IN_BPP;
+    def.out_w   = OUT_IMG_W;
+    def.out_h   = OUT_IMG_H;
+    def.out_fmt = PIXFMT_ABGR32;
+    def.out_bpp = OUT_BPP;
+    def.scale   = OUT_SCALE;
+    frame_cache_init(frame_pool, FRAME_POOL_BYTES);
+    frame_cfg_apply(&def);
+}
+
+const frame_cfg_t *frame_cfg_get(void) { return &cur_cfg; }
+u32 frame_cfg_in_bytes(void)  { return cur_in_bytes; }
+u32 frame_cfg_out_bytes(void) { return cur_out_bytes; }
+u32 frame_cfg_ip_out_bytes(void) { return cur_ip_out_bytes; }
+int frame_cfg_out_packed(void) { return cur_ip_out_bytes != cur_out_bytes; }
+
+u8 *frame_cfg_rx_buf(int sid, int idx)
+{
+#if RX_ZERO_COPY
+    (void)sid;
+    (void)idx;
+    return NULL;
+#else
+    return rx_bufs[sid][idx];
+#endif
+}
+
+u8 *frame_cfg_out_buf(int sid, int slot) { return out_bufs[sid][slot]; }
+u8 *frame_cfg_code_buf(int sid, int slot) { return code_bufs[sid][slot]; }
+u8 *frame_cfg_code_ref(int sid) { return code_refs[sid]; }
+u8 *frame_cfg_rx_stage(int sid) { return rx_stages[sid]; }
+u32 frame_cfg_code_bytes(void) { return cur_code_bytes; }
@@ -0,0 +1,66 @@
+/*
+ * frame_cfg.h - runtime frame geometry and the DDR frame pool
+ *
+ * The RX ring and the output slots are carved from one static pool sized by
+ * FRAME_POOL_BYTES, so a MSG_CONFIG at session start can switch geometry
+ * (320x180 -> 1280x720, 640x360 -> 1280x720, feature-map shapes, ...)
+ * without rebuilding the ELF.
+ *
+ * Asking for out_fmt PIXFMT_BGR24 does not change what the IP writes: the
+ * slots still take ABGR32 from S2MM and pix_pack.c drops the alpha byte
+ * before TX, so only 3 bytes per pixel go on the wire.
+ */
+
+#ifndef FRAME_CFG_H
+#define FRAME_CFG_H
+
+#include "xil_types.h"
+#include "frame_proto.h"
+#include "vcodec.h"
+
+/* Boot-time geometry, used until the client sends MSG_CONFIG */
+#define IN_IMG_W        320
+#define IN_IMG_H        180
+#define IN_BPP          3
+#define OUT_SCALE       4
+#define OUT_IMG_W       (IN_IMG_W * OUT_SCALE)
+#define OUT_IMG_H       (IN_IMG_H * OUT_SCALE)
+#define OUT_BPP         4
+
+/*
+ * FRAME_POOL_BYTES: per session, NUM_BUFFERS input frames (copy-mode RX
+ * only) plus OUT_SLOTS output frames, times MAX_SESSIONS, must fit. The
+ * default holds 4 sessions of 10 x 640x360 BGR24 in / 2 x 1280x720 ABGR32
+ * out. Lives in .bss (DDR).
+ * A config with CFG_CODEC_OUT adds OUT_SLOTS coded frames and a reference
+ * frame per session, CFG_CODEC_IN one input frame of staging; with VCODEC
+ * the default grows to fit 4 coded 320x180 -> 1280x720 BGR24 sessions.
+ */
+#ifndef FRAME_POOL_BYTES
+#if VCODEC
+#define FRAME_POOL_BYTES    (80u * 1024 * 1024)
+#else
+#define FRAME_POOL_BYTES    (64u * 1024 * 1024)
+#endif
+#endif
+
+#define FRAME_POOL_ALIGN    64  // cache line; every carved buffer starts on one
+
+void frame_cfg_init(void);
+int  frame_cfg_apply(const frame_cfg_t *req);  // CFG_* status
+
+const frame_cfg_t *frame_cfg_get(void);
+u32  frame_cfg_in_bytes(void);
+u32  frame_cfg_out_bytes(void);           // per output frame on the wire
+u32  frame_cfg_ip_out_bytes(void);        // per output frame from S2MM (slot size)
+int  frame_cfg_out_packed(void);          // out_fmt BGR24: IP ABGR32 packed before TX
+u8  *frame_cfg_rx_buf(int sid, int idx);    // NULL with RX_ZERO_COPY
+u8  *frame_cfg_out_buf(int sid, int slot);
+
+/* Wire codec buffers, NULL unless the config in effect codes that direction */
+u8  *frame_cfg_code_buf(int sid, int slot);   // coded output, frame_cfg_code_bytes()
+u8  *frame_cfg_code_ref(int sid);             // encoder reference, one output frame
+u8  *frame_cfg_rx_stage(int sid);             // coded input being received
+u32  frame_cfg_code_bytes(void);
+
+#endif /* FRAME_CFG_H */
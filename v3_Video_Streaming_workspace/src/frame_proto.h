@@ -0,0 +1,141 @@
+/*
+ * frame_proto.h - wire framing shared by the firmware and the clients
+ *
+ * Every message on the TCP stream starts with a 24-byte little-endian header
+ * followed by `length` payload bytes. scripts/frame_proto.py mirrors this
+ * layout; keep the two in sync.
+ */
+
+#ifndef FRAME_PROTO_H
+#define FRAME_PROTO_H
+
+#include "xil_types.h"
+
+/*
+ * WIRE_FRAMED
+ *   0 : legacy headerless stream sliced on IN_FRAME_BYTES / OUT_FRAME_BYTES
+ *   1 : every frame carries a frame_hdr_t in both directions (default)
+ */
+#ifndef WIRE_FRAMED
+#define WIRE_FRAMED     1
+#endif
+
+/* WIRE_TX_CRC: fill crc32 on output frames (costs a pass over 3.6 MB) */
+#ifndef WIRE_TX_CRC
+#define WIRE_TX_CRC     0
+#endif
+
+#define FRAME_MAGIC     0x314D5246u     // "FRM1"
+#define FRAME_HDR_BYTES 24
+
+/* Message types */
+#define MSG_FRAME       0x01
+#define MSG_CONFIG      0x02            // client -> board, payload frame_cfg_t
+#define MSG_CONFIG_ACK  0x03            // board -> client, effective frame_cfg_t
+#define MSG_LOG_REQ     0x04            // client -> board, no payload
+#define MSG_LOG_DUMP    0x05            // board -> client, tlog records (tlog.h)
+#define MSG_STATS_REQ   0x06            // client -> board, no payload (flags: FT_STATS_RESET)
+#define MSG_STATS       0x07            // board -> client, stage latencies (frame_trace.h)
+#define MSG_UDP_OPEN    0x08            // client -> board, payload frame_udp_t
+#define MSG_UDP_ACK     0x09            // board -> client, frame_udp_t in effect
+
+/*
+ * Pixel formats. As out_fmt, PIXFMT_BGR24 is the IP's ABGR32 with the alpha
+ * byte stripped by the firmware before TX (pix_pack.h).
+ */
+#define PIXFMT_BGR24    0x01
+#define PIXFMT_ABGR32   0x02
+#define PIXFMT_RAW      0x03            // opaque bytes, e.g. feature maps (bpp = channels)
+
+/* Header flags */
+#define FRAME_FLAG_CRC  0x01            // crc32 covers the payload
+#define FRAME_FLAG_CODED 0x02           // payload is a vcodec.h stream, length its size
+
+typedef struct __attribute__((packed)) {
+    u32 magic;
+    u8  type;
+    u8  flags;
+    u8  format;
+    u8  bpp;            // bytes per pixel
+    u32 seq;            // output frames echo the input seq
+    u16 width;
+    u16 height;
+    u32 length;         // payload bytes after the header
+    u32 crc32;          // CRC-32 (IEEE) of the payload if FRAME_FLAG_CRC
+} frame_hdr_t;
+
+typedef char frame_hdr_size_check[(sizeof(frame_hdr_t) == FRAME_HDR_BYTES) ? 1 : -1];
+
+/*
+ * MSG_CONFIG payload. Send once at session start, before any frame, and wait
+ * for MSG_CONFIG_ACK: frames sent ahead of the ACK may be dropped. The ACK
+ * carries the geometry in effect and a CFG_* status.
+ */
+#define FRAME_CFG_BYTES 16
+
+/*
+ * frame_cfg_t.codec: directions that may carry FRAME_FLAG_CODED frames. The
+ * client asks, the ACK answers with what the build supports. A coded input
+ * frame must be smaller than the raw one (send it raw otherwise); output
+ * frames are coded whenever CFG_CODEC_OUT is in effect.
+ */
+#define CFG_CODEC_IN        0x01        // client -> board frames may be coded
+#define CFG_CODEC_OUT       0x02        // board -> client frames are coded
+#define CFG_CODEC_OUT_SKIP  0x04        // ... with VC_LEVEL_SKIP only (cheaper on the A53)
+
+/* frame_cfg_t.status */
+#define CFG_OK          0
+#define CFG_ERR_BUSY    1               // frames still queued or in flight
+#define CFG_ERR_INVALID 2               // bad format / bpp / scale
+#define CFG_ERR_NOMEM   3               // does not fit FRAME_POOL_BYTES
+
+typedef struct __attribute__((packed)) {
+    u16 in_w;
+    u16 in_h;
+    u16 out_w;
+    u16 out_h;
+    u8  in_fmt;
+    u8  in_bpp;
+    u8  out_fmt;
+    u8  out_bpp;
+    u8  scale;          // out = in * scale; 0 = free-form output shape
+    u8  status;
+    u16 codec;          // CFG_CODEC_*
+} frame_cfg_t;
+
+typedef char frame_cfg_size_check[(sizeof(frame_cfg_t) == FRAME_CFG_BYTES) ? 1 : -1];
+
+/*
+ * MSG_UDP_OPEN payload: carry the session's frame messages over UDP
+ * (udp_frag.h) instead of the TCP stream, per direction. Send it after
+ * MSG_CONFIG_ACK with nothing queued; the ACK names the board's port, the
+ * token every datagram carries and the directions granted (possibly none).
+ * dirs 0 moves both directions back to TCP. Control messages always stay
+ * on TCP, and closing the connection still ends the session.
+ *
+ * UDP_DIR_L2 asks for raw Ethernet frames of L2_ETHERTYPE instead of UDP,
+ * one datagram per frame (WIRE_L2 builds only): port is then unused
+ * and mac carries the client's address, the ACK the board's. A board
+ * without it grants plain UDP, which needs port.
+ */
+#define FRAME_UDP_BYTES 16
+
+#define UDP_DIR_IN      0x01            // client -> board frames
+#define UDP_DIR_OUT     0x02            // board -> client frames
+#define UDP_DIR_L2      0x80            // both, in raw Ethernet frames
+
+#define L2_ETHERTYPE    0x88B5          // IEEE 802 local experimental EtherType 1
+
+typedef struct __attribute__((packed)) {
+    u16 port;           // OPEN: the client's UDP port; ACK: the board's
+    u8  dirs;           // UDP_DIR_*: asked / granted
+    u8  status;         // ACK: CFG_OK, CFG_ERR_BUSY or CFG_ERR_INVALID
+    u16 token;          // ACK: udpf_hdr_t.token of the session
+    u16 frag_bytes;     // ACK: UDPF_FRAG_BYTES
+    u16 window;         // ACK: UDPF_WINDOW, also the first credit each way
+    u8  mac[6];         // UDP_DIR_L2: OPEN the client's MAC, ACK the board's
+} frame_udp_t;
+
+typedef char frame_udp_size_check[(sizeof(frame_udp_t) == FRAME_UDP_BYTES) ? 1 : -1];
+
+#endif /* FRAME_PROTO_H */
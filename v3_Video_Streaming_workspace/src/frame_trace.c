@@ -0,0 +1,113 @@
+/*
+ * frame_trace.c - stage latency histograms and MSG_STATS payloads
+ *
+ * Recording is done on core 0 only (stage_tx_retire), so no locking. A
+ * bucket holds values from (4 + sub) << (msb - 2) up to the next bucket's
+ * start: four buckets per power of two, exact below 4 ticks.
+ */
+
+#include <string.h>
+#include "frame_trace.h"
+
+typedef char ft_hdr_size_check[(sizeof(frame_trace_hdr_t) == FT_HDR_BYTES) ? 1 : -1];
+typedef char ft_stage_size_check[(sizeof(frame_trace_stage_t) == 16) ? 1 : -1];
+
+#define FT_SUB          (1u << FT_SUB_BITS)
+
+typedef struct {
+    u32   count;
+    XTime max;
+    u32   hist[FT_BUCKETS];
+} ft_stage_hist_t;
+
+static ft_stage_hist_t stages[ST_COUNT];
+static u32 frames = 0;
+
+static u32 ft_bucket(u64 v)
+{
+    if (v < FT_SUB) return (u32)v;
+    u32 msb = 63 - __builtin_clzll(v);
+    u32 b = (msb - FT_SUB_BITS + 1) * FT_SUB + (u32)((v >> (msb - FT_SUB_BITS)) & (FT_SUB - 1));
+    return (b < FT_BUCKETS) ? b : FT_BUCKETS - 1;
+}
+
+/* Smallest value of bucket b */
+static u64 ft_bucket_low(u32 b)
+{
+    if (b < FT_SUB) return b;
+    u32 msb = b / FT_SUB + FT_SUB_BITS - 1;
+    return (u64)(FT_SUB + b % FT_SUB) << (msb - FT_SUB_BITS);
+}
+
+static u32 ft_ticks_to_ns(u64 t)
+{
+    u64 ns = t * 1000000000ull / COUNTS_PER_SECOND;
+    return (ns > 0xFFFFFFFFull) ? 0xFFFFFFFFu : (u32)ns;
+}
+
+static void ft_add(ft_stage_hist_t *h, XTime from, XTime to)
+{
+    XTime d = (to > from) ? to - from : 0;     // stamps from two cores may tie
+
+    h->hist[ft_bucket(d)]++;
+    h->count++;
+    if (d > h->max) h->max = d;
+}
+
+void frame_trace_record(const frame_trace_t *t)
+{
+#if FRAME_TRACE
+    for (int i = 0; i < ST_TOTAL; i++)
+        ft_add(&stages[i], t->ts[i], t->ts[i + 1]);
+    ft_add(&stages[ST_TOTAL], t->ts[TS_RX_FIRST], t->ts[TS_FREE]);
+    frames++;
+#else
+    (void)t;
+#endif
+}
+
+void frame_trace_reset(void)
+{
+    memset(stages, 0, sizeof(stages));
+    frames = 0;
+}
+
+u32 frame_trace_percentile_ns(int stage, u32 pct)
+{
+    const ft_stage_hist_t *h = &stages[stage];
+    u32 need = (u32)(((u64)h->count * pct + 99) / 100);
+    u32 cum = 0;
+
+    if (h->count == 0) return 0;
+    if (need == 0) need = 1;
+    for (u32 b = 0; b < FT_BUCKETS; b++) {
+        cum += h->hist[b];
+        if (cum < need) continue;
+        u64 hi = (b + 1 < FT_BUCKETS) ? ft_bucket_low(b + 1) - 1 : h->max;
+        return ft_ticks_to_ns((hi < h->max) ? hi : h->max);
+    }
+    return ft_ticks_to_ns(h->max);
+}
+
+u32 frame_trace_query(u8 *out, u32 max_bytes)
+{
+    frame_trace_hdr_t hdr;
+    u32 n = FRAME_TRACE ? ST_COUNT : 0;
+
+    if (max_bytes < FT_HDR_BYTES + n * sizeof(frame_trace_stage_t)) return 0;
+    for (u32 i = 0; i < n; i++) {
+        frame_trace_stage_t st;
+        st.count  = stages[i].count;
+        st.p50_ns = frame_trace_percentile_ns(i, 50);
+        st.p99_ns = frame_trace_percentile_ns(i, 99);
+        st.max_ns = ft_ticks_to_ns(stages[i].max);
+        memcpy(out + FT_HDR_BYTES + i * sizeof(st), &st, sizeof(st));
+    }
+
+    hdr.frames        = frames;
+    hdr.ticks_per_sec = COUNTS_PER_SECOND;
+    hdr.nstages       = (u16)n;
+    hdr.stage_bytes   = sizeof(frame_trace_stage_t);
+    memcpy(out, &hdr, sizeof(hdr));
+    return FT_HDR_BYTES + n * sizeof(frame_trace_stage_t);
+}
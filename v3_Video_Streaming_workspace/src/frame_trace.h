@@ -0,0 +1,95 @@
+/*
+ * frame_trace.h - per-frame stage timestamps and latency histograms
+ *
+ * Every frame carries a frame_trace_t from the first byte received to the
+ * moment its output slot is free again. The stamps are XTime ticks of the
+ * generic timer (CNTPCT), which both A53 cores read from the same counter,
+ * so stamps taken on the DMA core compare directly with core 0's. When the
+ * slot retires, each stage (the gap between two consecutive stamps) goes
+ * into a log-scale histogram. MSG_STATS_REQ returns p50/p99/max per stage.
+ */
+
+#ifndef FRAME_TRACE_H
+#define FRAME_TRACE_H
+
+#include "xil_types.h"
+#include "xtime_l.h"
+
+/*
+ * FRAME_TRACE
+ *   0 : stamps are still taken, but no histograms are kept; MSG_STATS
+ *       replies carry no stages
+ *   1 : one histogram per stage, updated as each frame retires (default)
+ */
+#ifndef FRAME_TRACE
+#define FRAME_TRACE     1
+#endif
+
+/* Stage boundaries, in the order a frame reaches them */
+enum {
+    TS_RX_FIRST = 0,    // first byte of the frame (its header when WIRE_FRAMED)
+    TS_RX_DONE,         // last payload byte copied into the ring
+    TS_RX_COMMIT,       // written back and marked ready
+    TS_POST,            // posted on the job ring
+    TS_DMA_START,       // DMA started on it (head of the SG ring)
+    TS_MM2S,            // last input byte read (SG: equals TS_S2MM)
+    TS_S2MM,            // output fully written
+    TS_DONE,            // output invalidated (packed, coded, CRC'd), done entry posted
+    TS_TX_START,        // handed to tcp_write
+    TS_FREE,            // slot free: queued in lwIP, or ACKed with TX_ZERO_COPY
+    TS_COUNT
+};
+
+/* Stage i runs from stamp i to stamp i+1; the last one spans the whole frame */
+enum {
+    ST_RX_ASM = 0,      // payload arriving over TCP
+    ST_RX_FLUSH,        // decode of a coded input, cache write-back
+    ST_SCHED,           // waiting for an output slot and a round-robin turn
+    ST_DMA_Q,           // on the job ring / in the SG queue
+    ST_MM2S,
+    ST_IP_S2MM,         // IP latency plus S2MM drain
+    ST_INVAL,           // output invalidate, packing, coding and CRC
+    ST_TX_Q,            // waiting for the session's TX to go idle
+    ST_TX,
+    ST_TOTAL,
+    ST_COUNT
+};
+
+typedef struct {
+    XTime ts[TS_COUNT];
+} frame_trace_t;
+
+#define FT_SUB_BITS     2       // 4 buckets per power of two, <= 25% error
+#define FT_BUCKETS      128     // covers up to 2^33 ticks (~86 s at 100 MHz)
+
+/* MSG_STATS payload: this header, then nstages frame_trace_stage_t */
+typedef struct __attribute__((packed)) {
+    u32 frames;                 // frames recorded since the last reset
+    u32 ticks_per_sec;
+    u16 nstages;
+    u16 stage_bytes;
+} frame_trace_hdr_t;
+
+typedef struct __attribute__((packed)) {
+    u32 count;
+    u32 p50_ns;                 // bucket upper bound, clamped to max
+    u32 p99_ns;
+    u32 max_ns;
+} frame_trace_stage_t;
+
+#define FT_HDR_BYTES    12
+#define FT_STATS_BYTES  (FT_HDR_BYTES + ST_COUNT * sizeof(frame_trace_stage_t))
+
+#define FT_STATS_RESET  0x01    // MSG_STATS_REQ flags: clear after replying
+
+static inline void frame_trace_stamp(frame_trace_t *t, int point)
+{
+    XTime_GetTime(&t->ts[point]);
+}
+
+void frame_trace_record(const frame_trace_t *t);   // all stamps set
+void frame_trace_reset(void);
+u32  frame_trace_query(u8 *out, u32 max_bytes);     // MSG_STATS payload, returns bytes
+u32  frame_trace_percentile_ns(int stage, u32 pct); // for the stats report
+
+#endif /* FRAME_TRACE_H */
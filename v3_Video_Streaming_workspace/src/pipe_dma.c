@@ -0,0 +1,194 @@
+/*
+ * pipe_dma.c - DMA service: job ring in, done ring out
+ *
+ * Jobs are handed to dma.c in ring order and only popped once their S2MM
+ * completes, so after a DMA error every job still on the ring is simply
+ * submitted again, in the same order. Runs from pipeline_poll() on a single
+ * core, or as the whole of core 1 with PIPELINE_DUAL_CORE.
+ */
+
+#include "xil_printf.h"
+#include "xtime_l.h"
+#include "crc32.h"
+#include "pix_pack.h"
+#include "vcodec.h"
+#include "pipe_ipc.h"
+
+#if PIPELINE_DUAL_CORE && !defined(SIM_HOST)
+#define IPC     ((pipe_ipc_t *)PIPE_IPC_BASE)
+#else
+static pipe_ipc_t ipc_local;    // single core, or both sim threads
+#define IPC     (&ipc_local)
+#endif
+
+/* dma.c works on dma_job_t; entry i shadows job ring element i */
+static dma_job_t dma_jobs[PIPE_RING_CAP];
+static XTime     t_submit[PIPE_RING_CAP];
+static u32       submitted = 0;     // jobs after the ring tail already in dma.c
+
+pipe_ipc_t *pipe_ipc(void) { return IPC; }
+
+/* -------------------------------------------------------------------------- */
+/* Core 0 side                                                                */
+/* -------------------------------------------------------------------------- */
+void pipe_ipc_init(void)
+{
+    pipe_ipc_t *ipc = IPC;
+
+    spsc_reset(&ipc->job_q);
+    spsc_reset(&ipc->done_q);
+    frame_cache_pool(&ipc->pool_base, &ipc->pool_size);
+    ipc->stats_reset_req = 0;
+    pipe_ipc_poll();
+}
+
+/*
+ * Core 1 says hello and spins until core 0 acknowledges. Core 0 answers from
+ * every poll, so the cores may boot in either order and a hello left over
+ * from a previous run is harmless.
+ */
+void pipe_ipc_poll(void)
+{
+#if PIPELINE_DUAL_CORE
+    pipe_ipc_t *ipc = IPC;
+
+    if (__atomic_load_n(&ipc->c1_state, __ATOMIC_ACQUIRE) == PIPE_C1_HELLO) {
+        __atomic_store_n(&ipc->c1_state, PIPE_C1_ACK, __ATOMIC_RELEASE);
+        xil_printf("[PIPE] core 1 attached\n\r");
+    }
+#endif
+}
+
+void pipe_dma_get_stats(dma_stats_t *ds, frame_cache_stats_t *cs)
+{
+    frame_cache_get_stats(cs);
+#if PIPELINE_DUAL_CORE
+    /* Plain copies of core 1's counters, good enough for a report */
+    pipe_ipc_t *ipc = IPC;
+    *ds = ipc->dma_stats;
+    cs->inval_ticks = ipc->cache_stats.inval_ticks;
+    cs->inval_bytes = ipc->cache_stats.inval_bytes;
+    cs->inval_ops   = ipc->cache_stats.inval_ops;
+#else
+    dma_get_stats(ds);
+#endif
+}
+
+void pipe_dma_stats_reset(void)
+{
+    frame_cache_stats_reset();
+#if PIPELINE_DUAL_CORE
+    __atomic_store_n(&IPC->stats_reset_req, 1, __ATOMIC_RELEASE);
+#else
+    dma_stats_reset();
+#endif
+}
+
+/* -------------------------------------------------------------------------- */
+/* DMA side                                                                   */
+/* -------------------------------------------------------------------------- */
+static void complete_job(pipe_ipc_t *ipc, dma_job_t *job)
+{
+    u32 idx = (u32)job->tag;
+    const pipe_job_t *pj = &ipc->jobs[idx];
+    pipe_done_t *d = &ipc->done[SPSC_IDX(spsc_wr_pos(&ipc->done_q), PIPE_RING_CAP)];
+    XTime now;
+
+    XTime_GetTime(&now);
+    d->tag       = pj->tag;
+    d->flags     = 0;
+    d->crc32     = 0;
+    d->code_len  = 0;
+    d->code_ticks = 0;
+    d->dma_ticks = now - t_submit[idx];
+    /*
+     * Packing writes the slot through the cache after it was invalidated.
+     * Copy-mode TX reads it back through the cache; with TX_ZERO_COPY the
+     * xemacps adapter flushes every TX pbuf before the GEM reads it. The
+     * same holds for the coded frame. A coded frame's CRC is of the coded
+     * bytes, the payload that goes on the wire.
+     */
+    int crc_raw = (pj->flags & PIPE_JOB_CRC) && !(pj->flags & PIPE_JOB_CODE);
+    if (pj->flags & PIPE_JOB_PACK) {
+        pix_pack_bgr24(pj->out, pj->out_len / IP_OUT_BPP, crc_raw ? &d->crc32 : NULL);
+    } else if (crc_raw) {
+        d->crc32 = crc32_update(0, pj->out, pj->out_len);
+    }
+    if (pj->flags & PIPE_JOB_CODE) {
+        XTime t0, t1;
+        XTime_GetTime(&t0);
+        d->code_len = vc_encode(pj->out, pj->ref, (pj->flags & PIPE_JOB_KEY) != 0,
+                                pj->w, pj->h, pj->bpp,
+                                (pj->flags & PIPE_JOB_CODE_SKIP) ? VC_LEVEL_SKIP : VC_LEVEL_FULL,
+                                pj->code, NULL);
+        XTime_GetTime(&t1);
+        d->code_ticks = t1 - t0;
+        if (pj->flags & PIPE_JOB_CRC) d->crc32 = crc32_update(0, pj->code, d->code_len);
+    }
+    d->flags = pj->flags & (PIPE_JOB_CRC | PIPE_JOB_PACK | PIPE_JOB_CODE);
+    d->t_start = job->t_start;
+    d->t_mm2s  = job->t_mm2s;
+    d->t_s2mm  = job->t_s2mm;
+    XTime_GetTime(&d->t_done);
+
+    spsc_pop(&ipc->job_q);
+    submitted--;
+    spsc_push(&ipc->done_q);     // space is guaranteed by the slot count
+}
+
+void pipe_dma_service(void)
+{
+    pipe_ipc_t *ipc = IPC;
+    dma_job_t *job = NULL;
+    int r = dma_poll(&job);
+
+    if (r == DMA_ERROR) {
+        submitted = 0;      // dma.c has reset; resubmit from the ring tail
+    } else if (r == DMA_DONE) {
+        complete_job(ipc, job);
+    }
+
+    while (submitted < spsc_count(&ipc->job_q) && dma_can_submit()) {
+        u32 idx = SPSC_IDX(spsc_rd_pos(&ipc->job_q) + submitted, PIPE_RING_CAP);
+        const pipe_job_t *pj = &ipc->jobs[idx];
+        dma_job_t *dj = &dma_jobs[idx];
+
+        dj->segs    = pj->segs;
+        dj->nsegs   = pj->nsegs;
+        dj->out     = pj->out;
+        dj->out_len = pj->out_len;
+        dj->tag     = (int)idx;
+        if (dma_submit(dj) != 0) break;
+        XTime_GetTime(&t_submit[idx]);
+        submitted++;
+    }
+
+#if PIPELINE_DUAL_CORE
+    if (__atomic_load_n(&ipc->stats_reset_req, __ATOMIC_ACQUIRE)) {
+        dma_stats_reset();
+        frame_cache_stats_reset();
+        __atomic_store_n(&ipc->stats_reset_req, 0, __ATOMIC_RELAXED);
+    }
+    dma_get_stats(&ipc->dma_stats);
+    frame_cache_get_stats(&ipc->cache_stats);
+#endif
+}
+
+/* Core 1: wait for core 0, then run the DMA service forever */
+void pipe_dma_main(void)
+{
+    pipe_ipc_t *ipc = IPC;
+
+    xil_printf("[PIPE1] core 1 up, waiting for core 0\n\r");
+    __atomic_store_n(&ipc->c1_state, PIPE_C1_HELLO, __ATOMIC_RELEASE);
+    while (__atomic_load_n(&ipc->c1_state, __ATOMIC_ACQUIRE) != PIPE_C1_ACK) ;
+
+    frame_cache_init((u8 *)ipc->pool_base, ipc->pool_size);
+    if (dma_init() != 0) {
+        xil_printf("[PIPE1] DMA init failed, core 1 halted\n\r");
+        while (1) ;
+    }
+    xil_printf("[PIPE1] DMA service running\n\r");
+
+    while (1) pipe_dma_service();
+}
@@ -0,0 +1,118 @@
+/*
+ * pipe_ipc.h - job/completion rings between the network core and the DMA core
+ *
+ * The pipeline (pipeline.c) never calls the DMA driver directly. It posts a
+ * pipe_job_t per frame on the job ring; the DMA service (pipe_dma.c) feeds
+ * jobs to dma.c in order and answers each with a pipe_done_t on the done
+ * ring. Both rings are SPSC (spsc.h), so the two sides may run on different
+ * A53 cores without locks.
+ */
+
+#ifndef PIPE_IPC_H
+#define PIPE_IPC_H
+
+#include "xil_types.h"
+#include "spsc.h"
+#include "echo.h"
+#include "dma.h"
+#include "frame_cache.h"
+#include "pipeline.h"
+
+/*
+ * PIPELINE_DUAL_CORE
+ *   0 : pipeline_poll() also runs the DMA service, all on core 0 (default)
+ *   1 : core 0 runs lwIP RX/TX and frame scheduling; core 1 runs the DMA
+ *       service (submit, completion polling, output invalidate, output
+ *       packing, coding and CRC).
+ *       Core 1 is a second application built from the same src/ with
+ *       -DPIPELINE_CORE1 (see README). DMA_USE_INTERRUPTS is not supported
+ *       here: core 1 has nothing else to do and polls.
+ *
+ * PIPE_IPC_BASE: the shared block, at the same address in both images and
+ * outside both linker scripts' DDR regions.
+ */
+#ifndef PIPELINE_DUAL_CORE
+#define PIPELINE_DUAL_CORE  0
+#endif
+
+#ifndef PIPELINE_CORE1
+#define PIPELINE_CORE1      0
+#endif
+
+#ifndef PIPE_IPC_BASE
+#define PIPE_IPC_BASE       0x7FF00000
+#endif
+
+#if PIPELINE_DUAL_CORE && DMA_USE_INTERRUPTS
+#error "PIPELINE_DUAL_CORE polls the DMA on core 1, build with DMA_USE_INTERRUPTS=0"
+#endif
+
+/* Every job needs a free output slot, so the rings can never overflow */
+#define PIPE_RING_CAP       32
+typedef char pipe_ring_cap_check[(MAX_SESSIONS * OUT_SLOTS <= PIPE_RING_CAP) ? 1 : -1];
+
+#define PIPE_JOB_CRC        0x01    // compute the output CRC32 after S2MM
+#define PIPE_JOB_PACK       0x02    // ABGR32 -> BGR24 in place after S2MM (pix_pack.h)
+#define PIPE_JOB_CODE       0x04    // vc_encode() the (packed) frame into code (vcodec.h)
+#define PIPE_JOB_KEY        0x08    // ... as a key frame
+#define PIPE_JOB_CODE_SKIP  0x10    // ... with VC_LEVEL_SKIP
+
+typedef struct {
+    const rx_seg_t *segs;       // input frame, already written back
+    u8             *out;
+    u32             out_len;    // S2MM bytes; 3/4 of it goes out with PIPE_JOB_PACK
+    u16             nsegs;
+    u16             tag;        // SLOT_TAG(sid, slot), echoed in pipe_done_t
+    u32             flags;      // PIPE_JOB_*
+    u8             *code;       // PIPE_JOB_CODE: coded frame, frame_cfg_code_bytes()
+    u8             *ref;        // PIPE_JOB_CODE: the session's encoder reference
+    u16             w, h, bpp;  // PIPE_JOB_CODE: geometry of the frame on the wire
+} pipe_job_t;
+
+typedef struct {
+    u16             tag;
+    u16             flags;      // PIPE_JOB_CRC if crc32 is valid (of the wire payload)
+    u32             crc32;
+    u32             code_len;   // PIPE_JOB_CODE: coded bytes in pipe_job_t.code
+    XTime           code_ticks; // PIPE_JOB_CODE: vc_encode() time
+    XTime           dma_ticks;  // job submit -> S2MM done
+    XTime           t_start;    // TS_DMA_START .. TS_DONE stamps (frame_trace.h)
+    XTime           t_mm2s;
+    XTime           t_s2mm;
+    XTime           t_done;
+} pipe_done_t;
+
+/* Core 1 boot handshake */
+#define PIPE_C1_HELLO       0x43314849  // core 1 is up and waiting
+#define PIPE_C1_ACK         0x43314143  // core 0 has set up the block
+
+typedef struct {
+    spsc_t          job_q;
+    spsc_t          done_q;
+    pipe_job_t      jobs[PIPE_RING_CAP];
+    pipe_done_t     done[PIPE_RING_CAP];
+
+    /* Set by core 0 before the handshake */
+    UINTPTR         pool_base;
+    u32             pool_size;
+    u32             c1_state;               // PIPE_C1_*
+
+    /* DMA core stats, copied out on every service pass */
+    dma_stats_t         dma_stats;
+    frame_cache_stats_t cache_stats;
+    u32             stats_reset_req;
+} pipe_ipc_t;
+
+pipe_ipc_t *pipe_ipc(void);
+void pipe_ipc_init(void);          // core 0, before the first job
+void pipe_ipc_poll(void);          // core 0, answers the core 1 handshake
+
+/* DMA side (pipe_dma.c) */
+void pipe_dma_service(void);       // one pass: submit, poll, complete
+void pipe_dma_main(void);          // core 1 entry, never returns
+
+/* Network side helpers for stats */
+void pipe_dma_get_stats(dma_stats_t *ds, frame_cache_stats_t *cs);
+void pipe_dma_stats_reset(void);
+
+#endif /* PIPE_IPC_H */
@@ -0,0 +1,476 @@
+/*
+ * pipeline.c - three-stage overlapped scheduler
+ *
+ *   RX rings (echo.c, one per session) --> DMA/IP (dma.c) --> TCP TX (echo.c)
+ *
+ * Every stage runs independently from pipeline_poll(): while one frame is in
+ * the DMA/IP, earlier results keep streaming out of other output slots, so
+ * fps is bounded by the slowest stage instead of the sum of all stages.
+ * Sessions take turns at the DMA one frame at a time (round-robin), so one
+ * busy client cannot starve the others.
+ *
+ * Frames reach the DMA as jobs on an SPSC ring (pipe_ipc.h) and come back on
+ * a done ring. pipeline_poll() runs the DMA service itself on a single core;
+ * with PIPELINE_DUAL_CORE core 1 runs it and this file stays on core 0 with
+ * lwIP, which is the only core that touches the RX rings and the pcbs.
+ */
+
+#include "xil_printf.h"
+#include "xtime_l.h"
+#include "echo.h"
+#include "frame_proto.h"
+#include "frame_cfg.h"
+#include "frame_cache.h"
+#include "pipe_ipc.h"
+#include "evq.h"
+#include "tlog.h"
+#include "frame_trace.h"
+#include "pipeline.h"
+
+/* Output slot life cycle: FREE -> DMA (job posted) -> READY -> TX -> FREE */
+enum { SLOT_FREE = 0, SLOT_DMA, SLOT_READY, SLOT_TX };
+
+typedef struct {
+    u8        *buf;
+    u8        *code;        // coded output (CFG_CODEC_OUT), else NULL
+    const u8  *tx_ptr;      // what went to TX: buf or code
+    int        state;
+    frame_trace_t tr;       // stage stamps of the frame in this slot
+    frame_hdr_t hdr;        // output header, seq copied from the input frame
+} out_slot_t;
+
+/* Per-session scheduling state and throughput counters */
+typedef struct {
+    out_slot_t slots[OUT_SLOTS];    // buffers carved from the frame pool
+    int        rx_inflight;         // RX frames handed to the DMA, not yet popped
+    int        code_key;            // next coded output starts a new reference chain
+
+    /* READY slots in completion order */
+    int        tx_fifo[OUT_SLOTS];
+    int        tx_fifo_head;
+    int        tx_fifo_cnt;
+
+    u32        frames_total;
+    u32        win_frames;
+} pipe_session_t;
+
+static pipe_session_t psess[MAX_SESSIONS];
+static int rr_next = 0;             // session that gets the next DMA turn
+
+/* job.tag encodes session and slot */
+#define SLOT_TAG(sid, slot)     ((sid) * OUT_SLOTS + (slot))
+#define TAG_SID(tag)            ((tag) / OUT_SLOTS)
+#define TAG_SLOT(tag)           ((tag) % OUT_SLOTS)
+
+/* Throughput stats */
+static u32   frames_done = 0;
+static XTime win_start = 0;
+static XTime win_dma_ticks = 0;
+static XTime win_tx_ticks  = 0;
+static XTime win_code_ticks = 0;
+static u32   win_code_frames = 0;
+static u64   win_code_bytes = 0;    // coded output bytes, against win_code_frames raw frames
+
+static void session_reset(int sid)
+{
+    pipe_session_t *ps = &psess[sid];
+
+    for (int i = 0; i < OUT_SLOTS; i++) {
+        ps->slots[i].buf    = frame_cfg_out_buf(sid, i);
+        ps->slots[i].code   = frame_cfg_code_buf(sid, i);
+        ps->slots[i].tx_ptr = ps->slots[i].buf;
+        ps->slots[i].state  = SLOT_FREE;
+    }
+    ps->tx_fifo_head = ps->tx_fifo_cnt = 0;
+    ps->rx_inflight  = 0;
+    ps->code_key     = 1;
+    ps->frames_total = 0;
+    ps->win_frames   = 0;
+}
+
+void pipeline_init(void)
+{
+    for (int sid = 0; sid < MAX_SESSIONS; sid++)
+        session_reset(sid);
+    rr_next = 0;
+    pipe_ipc_init();
+    XTime_GetTime(&win_start);
+    tcp_rx_set_config_handler(pipeline_reconfigure);
+}
+
+static int session_idle(int sid)
+{
+    pipe_session_t *ps = &psess[sid];
+
+    if (ps->rx_inflight || tcp_tx_is_busy(sid)) return 0;
+    for (int i = 0; i < OUT_SLOTS; i++) {
+        if (ps->slots[i].state != SLOT_FREE || tcp_tx_buf_in_flight(sid, ps->slots[i].tx_ptr))
+            return 0;
+    }
+    return 1;
+}
+
+/* Re-carve the frame pool for a new geometry; only with every session idle */
+int pipeline_reconfigure(const frame_cfg_t *req)
+{
+    for (int sid = 0; sid < MAX_SESSIONS; sid++) {
+        if (!session_idle(sid) || tcp_rx_queued(sid)) return CFG_ERR_BUSY;
+    }
+
+    int st = frame_cfg_apply(req);
+    if (st != CFG_OK) return st;
+
+    for (int sid = 0; sid < MAX_SESSIONS; sid++) {
+        for (int i = 0; i < OUT_SLOTS; i++) {
+            out_slot_t *s = &psess[sid].slots[i];
+            s->buf    = frame_cfg_out_buf(sid, i);
+            s->code   = frame_cfg_code_buf(sid, i);
+            s->tx_ptr = s->buf;
+        }
+        psess[sid].code_key = 1;
+    }
+    return CFG_OK;
+}
+
+static int find_free_slot(int sid)
+{
+    for (int i = 0; i < OUT_SLOTS; i++)
+        if (psess[sid].slots[i].state == SLOT_FREE) return i;
+    return -1;
+}
+
+static u32 ticks_to_us(XTime t)
+{
+    return (u32)(t / (COUNTS_PER_SECOND / 1000000));
+}
+
+static void report_stats(void)
+{
+    XTime now;
+    XTime_GetTime(&now);
+    XTime span = now - win_start;
+    if (span == 0) return;
+
+    dma_stats_t ds;
+    frame_cache_stats_t cs;
+    pipe_dma_get_stats(&ds, &cs);
+    tcp_tx_stats_t ts;
+    tcp_tx_get_stats(&ts);
+
+    u32 fps_x10 = (u32)((u64)PIPE_STATS_EVERY * 10 * COUNTS_PER_SECOND / span);
+    xil_printf("[PIPE] %d frames, %d.%d fps, avg DMA %d us, avg TX %d us (slots=%d)\n\r",
+               frames_done, fps_x10 / 10, fps_x10 % 10,
+               ticks_to_us(win_dma_ticks / PIPE_STATS_EVERY),
+               ticks_to_us(win_tx_ticks / PIPE_STATS_EVERY),
+               OUT_SLOTS);
+    xil_printf("[PIPE] DMA queue depth %d, max %d of %d, errors %d\n\r",
+               ds.depth, ds.depth_max, ds.ring_size, ds.errors);
+
+    /* Cache maintenance per frame, in timer ticks (COUNTS_PER_SECOND) */
+    xil_printf("[PIPE] cache mode %d: flush %d ticks (%d KB, %d ops), inval %d ticks (%d KB) per frame\n\r",
+               FRAME_BUF_CACHE_MODE,
+               (u32)(cs.flush_ticks / PIPE_STATS_EVERY),
+               (u32)(cs.flush_bytes / PIPE_STATS_EVERY / 1024),
+               cs.flush_ops / PIPE_STATS_EVERY,
+               (u32)(cs.inval_ticks / PIPE_STATS_EVERY),
+               (u32)(cs.inval_bytes / PIPE_STATS_EVERY / 1024));
+
+    /* TCP TX batching, all sessions */
+    if (ts.frames) {
+        u32 tx_mbps = (u32)(ts.bytes * 8 * COUNTS_PER_SECOND / span / 1000000);
+        xil_printf("[PIPE] TX mss %d: %d segs, %d writes, %d flushes per frame, %d.%d Gbps\n\r",
+                   ts.mss, ts.segs / ts.frames, ts.writes / ts.frames, ts.outputs / ts.frames,
+                   tx_mbps / 1000, (tx_mbps % 1000) / 100);
+    }
+    tcp_tx_stats_reset();
+
+    /* RX ring: window credit should fill it without a refused pbuf */
+    tcp_rx_flow_stats_t rf;
+    tcp_rx_get_flow_stats(&rf);
+    xil_printf("[PIPE] RX ring: full %d times, peak %d of %d frames, %d refused, credit withheld max %d KB\n\r",
+               rf.full, rf.peak, NUM_BUFFERS, rf.refused, rf.owed_max / 1024);
+    tcp_rx_flow_stats_reset();
+
+    /* UDP sessions (MSG_UDP_OPEN): loss recovery, all sessions */
+    udpf_stats_t ur, ut;
+    udp_stream_get_stats(&ur, &ut);
+    if (ur.datagrams || ut.datagrams)
+        xil_printf("[PIPE] udp in: %d frames, %d dgrams, %d retx, %d nacks sent, %d dups, %d dropped;"
+                   " out: %d frames, %d dgrams, %d retx, %d nacks, %d probes\n\r",
+                   ur.frames, ur.datagrams, ur.retx, ur.nacks, ur.dups, ur.dropped,
+                   ut.frames, ut.datagrams, ut.retx, ut.nacks, ut.probes);
+    udp_stream_stats_reset();
+
+    /* Run loop: idle share and post -> dispatch latency per event */
+    static const char *ev_name[EV_COUNT] = { "net", "dma", "fast", "slow", "pipe" };
+    evq_stats_t es;
+    evq_get_stats(&es);
+    xil_printf("[PIPE] loop: %d wakeups, idle %d%%",
+               es.wakeups, (u32)((u64)es.idle_ticks * 100 / span));
+    for (int i = 0; i < EV_COUNT; i++) {
+        if (!es.events[i]) continue;
+        xil_printf(", %s %d/%d us", ev_name[i],
+                   ticks_to_us(es.lat_sum[i] / es.events[i]), ticks_to_us(es.lat_max[i]));
+    }
+    xil_printf(" (avg/max)\n\r");
+    evq_stats_reset();
+
+    /* Wire codec (frame_cfg_t.codec): raw / coded bytes and time per frame */
+    tcp_rx_codec_stats_t rs;
+    tcp_rx_get_codec_stats(&rs);
+    if (win_code_frames && win_code_bytes) {
+        u32 r_x100 = (u32)((u64)win_code_frames * frame_cfg_out_bytes() * 100 / win_code_bytes);
+        xil_printf("[PIPE] codec out: %d frames, ratio %d.%02d, encode %d us/frame\n\r",
+                   win_code_frames, r_x100 / 100, r_x100 % 100,
+                   ticks_to_us(win_code_ticks / win_code_frames));
+    }
+    if (rs.frames && rs.coded_bytes) {
+        u32 r_x100 = (u32)(rs.raw_bytes * 100 / rs.coded_bytes);
+        xil_printf("[PIPE] codec in: %d frames, ratio %d.%02d, decode %d us/frame\n\r",
+                   rs.frames, r_x100 / 100, r_x100 % 100, ticks_to_us(rs.dec_ticks / rs.frames));
+    }
+    tcp_rx_codec_stats_reset();
+
+    /* End-to-end frame latency since boot or the last MSG_STATS_REQ reset */
+    if (FRAME_TRACE)
+        xil_printf("[PIPE] frame latency p50 %d us, p99 %d us (first byte in -> slot free)\n\r",
+                   frame_trace_percentile_ns(ST_TOTAL, 50) / 1000,
+                   frame_trace_percentile_ns(ST_TOTAL, 99) / 1000);
+
+    /* Per-session share of the window */
+    u32 in_bytes = frame_cfg_in_bytes(), out_bytes = frame_cfg_out_bytes();
+    for (int sid = 0; sid < MAX_SESSIONS; sid++) {
+        pipe_session_t *ps = &psess[sid];
+        if (tcp_session_state(sid) == SESS_FREE && ps->win_frames == 0) continue;
+
+        u32 sfps_x10 = (u32)((u64)ps->win_frames * 10 * COUNTS_PER_SECOND / span);
+        u32 in_mbps  = (u32)((u64)ps->win_frames * in_bytes * 8 * COUNTS_PER_SECOND / span / 1000000);
+        u32 out_mbps = (u32)((u64)ps->win_frames * out_bytes * 8 * COUNTS_PER_SECOND / span / 1000000);
+        xil_printf("[PIPE]  s%d: %d frames (%d total), %d.%d fps, in %d Mbps, out %d Mbps\n\r",
+                   sid, ps->win_frames, ps->frames_total, sfps_x10 / 10, sfps_x10 % 10,
+                   in_mbps, out_mbps);
+        ps->win_frames = 0;
+    }
+    pipe_dma_stats_reset();
+
+    win_start = now;
+    win_dma_ticks = win_tx_ticks = win_code_ticks = 0;
+    win_code_frames = 0;
+    win_code_bytes = 0;
+}
+
+/* Post the next ready frame of one session as a DMA job */
+static int submit_one(pipe_ipc_t *ipc, int sid)
+{
+    pipe_session_t *ps = &psess[sid];
+    int state = tcp_session_state(sid);
+
+    if (state != SESS_OPEN && state != SESS_CLOSING) return -1;
+
+    int slot = find_free_slot(sid);
+    if (slot < 0) return -1;
+
+    int idx = -1;
+    const rx_seg_t *segs;
+    int nsegs;
+    if (tcp_rx_peek_nth_sg(sid, ps->rx_inflight, &idx, &segs, &nsegs) != 0) return -1;
+
+    out_slot_t *s = &ps->slots[slot];
+    const frame_cfg_t *c = frame_cfg_get();
+    const rx_frame_meta_t *m = tcp_rx_frame_meta(sid, idx);
+    if (!m->crc_ok)
+        TLOG(PIPE_CRC_WARN, sid, m->seq);
+
+    s->hdr.magic  = FRAME_MAGIC;
+    s->hdr.type   = MSG_FRAME;
+    s->hdr.flags  = 0;
+    s->hdr.format = c->out_fmt;
+    s->hdr.bpp    = c->out_bpp;
+    s->hdr.seq    = m->seq;
+    s->hdr.width  = c->out_w;
+    s->hdr.height = c->out_h;
+    s->hdr.length = frame_cfg_out_bytes();
+    s->hdr.crc32  = 0;
+
+    s->tr.ts[TS_RX_FIRST]  = m->t_first;
+    s->tr.ts[TS_RX_DONE]   = m->t_done;
+    s->tr.ts[TS_RX_COMMIT] = m->t_commit;
+    frame_trace_stamp(&s->tr, TS_POST);
+
+    pipe_job_t *j = &ipc->jobs[SPSC_IDX(spsc_wr_pos(&ipc->job_q), PIPE_RING_CAP)];
+    j->segs    = segs;
+    j->nsegs   = (u16)nsegs;
+    j->out     = s->buf;
+    j->out_len = frame_cfg_ip_out_bytes();
+    j->tag     = (u16)SLOT_TAG(sid, slot);
+    j->flags   = (WIRE_TX_CRC ? PIPE_JOB_CRC : 0) | (frame_cfg_out_packed() ? PIPE_JOB_PACK : 0);
+    if (s->code) {
+        /* The DMA side codes jobs in ring order, the order TX sends them */
+        j->code  = s->code;
+        j->ref   = frame_cfg_code_ref(sid);
+        j->w     = c->out_w;
+        j->h     = c->out_h;
+        j->bpp   = c->out_bpp;
+        j->flags |= PIPE_JOB_CODE;
+        if (c->codec & CFG_CODEC_OUT_SKIP) j->flags |= PIPE_JOB_CODE_SKIP;
+        if (ps->code_key) j->flags |= PIPE_JOB_KEY;
+        ps->code_key = 0;
+    }
+    spsc_push(&ipc->job_q);
+
+    s->state = SLOT_DMA;
+    ps->rx_inflight++;
+    TLOG(PIPE_SUBMIT, sid, idx, m->seq);
+    return 0;
+}
+
+/* Stage 1: post ready RX frames as DMA jobs, one per session per turn */
+static void stage_dma_submit(void)
+{
+    pipe_ipc_t *ipc = pipe_ipc();
+
+    while (spsc_space(&ipc->job_q, PIPE_RING_CAP)) {
+        int n;
+        for (n = 0; n < MAX_SESSIONS; n++) {
+            int sid = (rr_next + n) % MAX_SESSIONS;
+            if (submit_one(ipc, sid) == 0) {
+                rr_next = (sid + 1) % MAX_SESSIONS;
+                break;
+            }
+        }
+        if (n == MAX_SESSIONS) return;  // nobody had a frame and a free slot
+    }
+}
+
+/* Stage 2: retire finished DMA jobs, queue their outputs for TX */
+static void stage_dma_reap(void)
+{
+    pipe_ipc_t *ipc = pipe_ipc();
+
+    while (spsc_count(&ipc->done_q)) {
+        const pipe_done_t *d = &ipc->done[SPSC_IDX(spsc_rd_pos(&ipc->done_q), PIPE_RING_CAP)];
+        int sid = TAG_SID(d->tag), slot = TAG_SLOT(d->tag);
+        pipe_session_t *ps = &psess[sid];
+        out_slot_t *s = &ps->slots[slot];
+
+        win_dma_ticks += d->dma_ticks;
+        s->tr.ts[TS_DMA_START] = d->t_start;
+        s->tr.ts[TS_MM2S]      = d->t_mm2s;
+        s->tr.ts[TS_S2MM]      = d->t_s2mm;
+        s->tr.ts[TS_DONE]      = d->t_done;
+        if (d->flags & PIPE_JOB_CRC) {
+            s->hdr.crc32 = d->crc32;
+            s->hdr.flags |= FRAME_FLAG_CRC;
+        }
+        s->tx_ptr = s->buf;
+        if (d->flags & PIPE_JOB_CODE) {
+            s->tx_ptr = s->code;
+            s->hdr.length = d->code_len;
+            s->hdr.flags |= FRAME_FLAG_CODED;
+            win_code_ticks += d->code_ticks;
+            win_code_bytes += d->code_len;
+            win_code_frames++;
+        }
+        spsc_pop(&ipc->done_q);
+
+        tcp_rx_pop_frame(sid);  // input consumed by MM2S, release RX frame
+        ps->rx_inflight--;
+        s->state = SLOT_READY;
+        ps->tx_fifo[(ps->tx_fifo_head + ps->tx_fifo_cnt) % OUT_SLOTS] = slot;
+        ps->tx_fifo_cnt++;
+        TLOG(PIPE_DMA_DONE, sid, slot);
+    }
+}
+
+/* Stage 3a: start sending the oldest READY slot of every idle session */
+static void stage_tx_start(void)
+{
+    for (int sid = 0; sid < MAX_SESSIONS; sid++) {
+        pipe_session_t *ps = &psess[sid];
+        if (ps->tx_fifo_cnt == 0 || tcp_tx_is_busy(sid)) continue;
+
+        int slot = ps->tx_fifo[ps->tx_fifo_head];
+        out_slot_t *s = &ps->slots[slot];
+
+        if (tcp_session_state(sid) == SESS_DEAD) {
+            s->state = SLOT_FREE;       // client is gone, drop the output
+        } else {
+#if WIRE_FRAMED
+            int tx_res = start_sending_frame(sid, &s->hdr, s->tx_ptr, s->hdr.length);
+#else
+            int tx_res = start_sending(sid, s->tx_ptr, s->hdr.length);
+#endif
+            if (tx_res != 0) {
+                TLOG(PIPE_TX_BUSY, sid, tx_res);
+                continue;
+            }
+            frame_trace_stamp(&s->tr, TS_TX_START);
+            s->state = SLOT_TX;
+        }
+        ps->tx_fifo_head = (ps->tx_fifo_head + 1) % OUT_SLOTS;
+        ps->tx_fifo_cnt--;
+    }
+}
+
+/* Stage 3b: free slots lwIP no longer references */
+static void stage_tx_retire(void)
+{
+    for (int sid = 0; sid < MAX_SESSIONS; sid++) {
+        pipe_session_t *ps = &psess[sid];
+        for (int i = 0; i < OUT_SLOTS; i++) {
+            out_slot_t *s = &ps->slots[i];
+            if (s->state != SLOT_TX || tcp_tx_buf_in_flight(sid, s->tx_ptr)) continue;
+
+            frame_trace_stamp(&s->tr, TS_FREE);
+            frame_trace_record(&s->tr);
+            win_tx_ticks += s->tr.ts[TS_FREE] - s->tr.ts[TS_TX_START];
+            s->state = SLOT_FREE;
+            ps->frames_total++;
+            ps->win_frames++;
+
+            if (++frames_done % PIPE_STATS_EVERY == 0) report_stats();
+        }
+    }
+}
+
+/* Close sessions whose client left once nothing of theirs is in flight */
+static void stage_sessions(void)
+{
+    for (int sid = 0; sid < MAX_SESSIONS; sid++) {
+        int state = tcp_session_state(sid);
+        if (state != SESS_CLOSING && state != SESS_DEAD) continue;
+        if (!session_idle(sid)) continue;
+        if (state == SESS_CLOSING && tcp_rx_queued(sid)) continue;  // results still owed
+
+        xil_printf("[PIPE] s%d done, %d frames\n\r", sid, psess[sid].frames_total);
+        tcp_session_release(sid);
+        session_reset(sid);
+    }
+}
+
+/*
+ * Jobs only the DMA core or the polled driver can complete: nothing will
+ * interrupt this core for them, so the run loop must not sleep.
+ */
+static int jobs_need_polling(void)
+{
+    if (DMA_USE_INTERRUPTS && !PIPELINE_DUAL_CORE) return 0;
+    for (int sid = 0; sid < MAX_SESSIONS; sid++)
+        if (psess[sid].rx_inflight) return 1;
+    return 0;
+}
+
+int pipeline_poll(void)
+{
+#if PIPELINE_DUAL_CORE
+    pipe_ipc_poll();
+#else
+    pipe_dma_service();
+#endif
+    stage_tx_retire();
+    stage_dma_reap();
+    stage_dma_submit();
+    stage_tx_start();
+    stage_sessions();
+    return jobs_need_polling();
+}
@@ -0,0 +1,25 @@
+/*
+ * pipeline.h - RX ring -> DMA/IP -> TCP TX scheduler
+ */
+
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include "xil_types.h"
+#include "frame_proto.h"
+
+/*
+ * OUT_SLOTS: output buffers shared by the DMA and TX stages. With 2 or more
+ * slots the IP works on frame N+1 while frame N is still streaming out.
+ */
+#ifndef OUT_SLOTS
+#define OUT_SLOTS   2
+#endif
+
+#define PIPE_STATS_EVERY    60  // frames between throughput reports
+
+void pipeline_init(void);
+int  pipeline_poll(void);           // nonzero: polled work in flight, call again
+int  pipeline_reconfigure(const frame_cfg_t *req);  // MSG_CONFIG handler, CFG_* status
+
+#endif /* PIPELINE_H */
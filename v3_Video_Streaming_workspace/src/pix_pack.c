@@ -0,0 +1,73 @@
+/*
+ * pix_pack.c - output pixel packing between S2MM and TX
+ *
+ * Packing runs front to back and the packed frame never overtakes the
+ * unpacked one (pixel i goes from 4i to 3i), so it works in place in the
+ * output slot and needs no second buffer.
+ */
+
+#include <string.h>
+#include "crc32.h"
+#include "pix_pack.h"
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+/* Pixels per chunk: 16 KB in, 12 KB out, both in the A53's 32 KB L1 */
+#define PACK_CHUNK_PIXELS   4096
+
+static void pack_run(u8 *dst, const u8 *src, u32 n)
+{
+#if defined(__ARM_NEON)
+    /* De-interleave 16 pixels into A/B/G/R planes, store B/G/R interleaved */
+    while (n >= 16) {
+        uint8x16x4_t v = vld4q_u8(src);
+        uint8x16x3_t o;
+        o.val[0] = v.val[1];
+        o.val[1] = v.val[2];
+        o.val[2] = v.val[3];
+        vst3q_u8(dst, o);
+        src += 64;
+        dst += 48;
+        n   -= 16;
+    }
+#endif
+    /* Little-endian word per pixel: A in bits 0-7, then B, G, R */
+    while (n >= 4) {
+        u32 w[4], o[3];
+        memcpy(w, src, sizeof(w));
+        o[0] = (w[0] >> 8)  | (w[1] << 16 & 0xFF000000u);
+        o[1] = (w[1] >> 16) | (w[2] << 8  & 0xFFFF0000u);
+        o[2] = (w[2] >> 24) | (w[3] & 0xFFFFFF00u);
+        memcpy(dst, o, sizeof(o));
+        src += 16;
+        dst += 12;
+        n   -= 4;
+    }
+    while (n--) {
+        u8 b = src[1], g = src[2], r = src[3];
+        dst[0] = b;
+        dst[1] = g;
+        dst[2] = r;
+        src += 4;
+        dst += 3;
+    }
+}
+
+u32 pix_pack_bgr24(u8 *buf, u32 pixels, u32 *crc)
+{
+    u32 done = 0;
+
+    if (crc) *crc = 0;
+    while (done < pixels) {
+        u32 n = pixels - done;
+        if (n > PACK_CHUNK_PIXELS) n = PACK_CHUNK_PIXELS;
+
+        u8 *dst = buf + done * 3;
+        pack_run(dst, buf + done * IP_OUT_BPP, n);
+        if (crc) *crc = crc32_update(*crc, dst, n * 3);
+        done += n;
+    }
+    return pixels * 3;
+}
@@ -0,0 +1,25 @@
+/*
+ * pix_pack.h - output pixel packing between S2MM and TX
+ *
+ * The IP always writes ABGR32 and its alpha byte carries nothing, so a
+ * session that negotiates out_fmt PIXFMT_BGR24 has it stripped on the DMA
+ * side before the frame is queued for TX: 3 bytes per pixel cross the link
+ * instead of 4.
+ */
+
+#ifndef PIX_PACK_H
+#define PIX_PACK_H
+
+#include "xil_types.h"
+
+#define IP_OUT_BPP      4       // what the IP writes per output pixel
+
+/*
+ * ABGR32 -> BGR24 in place (the packed frame starts at buf). NEON when the
+ * compiler targets it, 4 pixels per word otherwise. With crc non-NULL the
+ * CRC-32 of the packed bytes is computed chunk by chunk while they are still
+ * in L1, instead of a second pass over the frame. Returns the packed length.
+ */
+u32 pix_pack_bgr24(u8 *buf, u32 pixels, u32 *crc);
+
+#endif /* PIX_PACK_H */
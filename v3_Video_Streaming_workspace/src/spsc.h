@@ -0,0 +1,67 @@
+/*
+ * spsc.h - lock-free single-producer/single-consumer ring indices
+ *
+ * The ring stores only two free-running counters; the elements live in the
+ * owner's array of SPSC capacity (a power of two), indexed with SPSC_IDX().
+ *
+ *   producer: if (spsc_space(r, CAP)) { a[SPSC_IDX(spsc_wr_pos(r), CAP)] = x; spsc_push(r); }
+ *   consumer: if (spsc_count(r) > n)  { use a[SPSC_IDX(spsc_rd_pos(r) + n, CAP)]; ... spsc_pop(r); }
+ *
+ * spsc_push() is a store-release of head, spsc_count() a load-acquire of it,
+ * so everything the producer wrote before the push (the element and any
+ * buffer it points to) is visible to the consumer once it sees the count.
+ * tail is published the same way in the other direction, so the producer
+ * never reuses an element the consumer is still reading. On AArch64 these
+ * compile to STLR/LDAR, no locks or interrupt masking.
+ *
+ * Both cores must map the ring as Normal, inner shareable memory (the
+ * standalone BSP default for DDR).
+ */
+
+#ifndef SPSC_H
+#define SPSC_H
+
+#include "xil_types.h"
+
+#define SPSC_CACHE_LINE     64
+
+typedef struct {
+    u32 head __attribute__((aligned(SPSC_CACHE_LINE)));    // written by the producer only
+    u32 tail __attribute__((aligned(SPSC_CACHE_LINE)));    // written by the consumer only
+} spsc_t;
+
+#define SPSC_IDX(pos, cap)  ((pos) & ((cap) - 1))
+
+static inline void spsc_reset(spsc_t *r)
+{
+    __atomic_store_n(&r->head, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&r->tail, 0, __ATOMIC_RELAXED);
+}
+
+/* Producer side */
+static inline u32 spsc_wr_pos(spsc_t *r) { return __atomic_load_n(&r->head, __ATOMIC_RELAXED); }
+
+static inline u32 spsc_space(spsc_t *r, u32 cap)
+{
+    return cap - (spsc_wr_pos(r) - __atomic_load_n(&r->tail, __ATOMIC_ACQUIRE));
+}
+
+static inline void spsc_push(spsc_t *r)
+{
+    __atomic_store_n(&r->head, spsc_wr_pos(r) + 1, __ATOMIC_RELEASE);
+}
+
+/* Consumer side */
+static inline u32 spsc_rd_pos(spsc_t *r) { return __atomic_load_n(&r->tail, __ATOMIC_RELAXED); }
+
+static inline u32 spsc_count(spsc_t *r)
+{
+    return __atomic_load_n(&r->head, __ATOMIC_ACQUIRE) - spsc_rd_pos(r);
+}
+
+static inline void spsc_pop(spsc_t *r)
+{
+    __atomic_store_n(&r->tail, spsc_rd_pos(r) + 1, __ATOMIC_RELEASE);
+}
+
+#endif /* SPSC_H */
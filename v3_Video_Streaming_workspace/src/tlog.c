@@ -0,0 +1,98 @@
+/*
+ * tlog.c - binary log ring, idle drain and MSG_LOG_DUMP payloads
+ *
+ * One writer (the core 0 run loop and its lwIP callbacks), two independent
+ * readers: the UART drain and the TCP dump. The ring keeps the newest
+ * TLOG_RING_ENTRIES records; a reader that falls behind skips ahead and
+ * counts what it lost.
+ */
+
+#include <string.h>
+#include "xil_printf.h"
+#include "tlog.h"
+
+typedef char tlog_rec_size_check[(sizeof(tlog_rec_t) == 32) ? 1 : -1];
+typedef char tlog_hdr_size_check[(sizeof(tlog_dump_hdr_t) == TLOG_DUMP_HDR_BYTES) ? 1 : -1];
+
+static const char *const tlog_fmt[TLOG_NUM_IDS] = {
+#define TLOG_ID(name, level, fmt) fmt,
+#include "tlog_ids.h"
+#undef TLOG_ID
+};
+
+static tlog_rec_t ring[TLOG_RING_ENTRIES];
+static u32 wr_pos = 0;          // free-running
+static u32 drain_pos = 0;
+static u32 dump_pos = 0;
+static u32 dump_lost = 0;
+
+static void tlog_print(const tlog_rec_t *r)
+{
+    const u32 *a = r->args;
+    xil_printf(tlog_fmt[r->id], a[0], a[1], a[2], a[3], a[4]);
+    xil_printf("\n\r");
+}
+
+void tlog_put(u16 id, u8 level, const u32 *args, u32 nargs)
+{
+    tlog_rec_t *r = &ring[wr_pos & (TLOG_RING_ENTRIES - 1)];
+
+    XTime_GetTime(&r->ts);
+    r->id    = id;
+    r->level = level;
+    r->nargs = (u8)nargs;
+    for (u32 i = 0; i < TLOG_MAX_ARGS; i++)
+        r->args[i] = (i < nargs) ? args[i] : 0;
+    wr_pos++;
+
+#if TLOG_SYNC
+    tlog_print(r);
+    drain_pos = wr_pos;
+#endif
+}
+
+/* Oldest record a reader at pos can still get */
+static u32 tlog_catch_up(u32 pos, u32 *lost)
+{
+    if (wr_pos - pos > TLOG_RING_ENTRIES) {
+        if (lost) *lost += wr_pos - pos - TLOG_RING_ENTRIES;
+        pos = wr_pos - TLOG_RING_ENTRIES;
+    }
+    return pos;
+}
+
+void tlog_drain(u32 budget)
+{
+    drain_pos = tlog_catch_up(drain_pos, NULL);
+    while (budget > 0 && drain_pos != wr_pos) {
+        const tlog_rec_t *r = &ring[drain_pos & (TLOG_RING_ENTRIES - 1)];
+        drain_pos++;
+        if (r->level > TLOG_PRINT_LEVEL) continue;     // kept for dumps only
+        tlog_print(r);
+        budget--;
+    }
+}
+
+u32 tlog_dump(u8 *out, u32 max_bytes)
+{
+    tlog_dump_hdr_t h;
+    u32 n = 0;
+
+    if (max_bytes < TLOG_DUMP_HDR_BYTES) return 0;
+    dump_pos = tlog_catch_up(dump_pos, &dump_lost);
+    while (dump_pos != wr_pos && n < TLOG_DUMP_MAX &&
+           TLOG_DUMP_HDR_BYTES + (n + 1) * sizeof(tlog_rec_t) <= max_bytes) {
+        memcpy(out + TLOG_DUMP_HDR_BYTES + n * sizeof(tlog_rec_t),
+               &ring[dump_pos & (TLOG_RING_ENTRIES - 1)], sizeof(tlog_rec_t));
+        dump_pos++;
+        n++;
+    }
+
+    h.ticks_per_sec = COUNTS_PER_SECOND;
+    h.lost      = dump_lost;
+    h.nrec      = (u16)n;
+    h.rec_bytes = sizeof(tlog_rec_t);
+    memcpy(out, &h, sizeof(h));
+    dump_lost = 0;
+    return TLOG_DUMP_HDR_BYTES + n * sizeof(tlog_rec_t);
+}
@@ -0,0 +1,93 @@
+/*
+ * tlog.h - deferred binary logging for the per-frame hot path
+ *
+ * TLOG(ID, args...) stores a fixed-size record (timestamp, id, up to
+ * TLOG_MAX_ARGS integers) in a RAM ring instead of formatting it over the
+ * UART. Records are printed lazily by tlog_drain() while the run loop is
+ * idle, and can be fetched in binary over TCP with MSG_LOG_REQ and decoded
+ * on the host (scripts/tlog_dump.py). Ids and formats live in tlog_ids.h.
+ */
+
+#ifndef TLOG_H
+#define TLOG_H
+
+#include "xil_types.h"
+#include "xtime_l.h"
+
+#define TLOG_OFF        0
+#define TLOG_ERR        1
+#define TLOG_WARN       2
+#define TLOG_INFO       3
+#define TLOG_DEBUG      4
+
+/*
+ * TLOG_LEVEL        : records above this level compile to nothing (default DEBUG)
+ * TLOG_PRINT_LEVEL  : records tlog_drain() prints; the rest are kept for dumps
+ *                     only (default WARN, a UART line costs ~4 ms at 115200)
+ * TLOG_SYNC         : 1 prints every record on the spot, like the old
+ *                     xil_printf calls (default 0)
+ */
+#ifndef TLOG_LEVEL
+#define TLOG_LEVEL          TLOG_DEBUG
+#endif
+#ifndef TLOG_PRINT_LEVEL
+#define TLOG_PRINT_LEVEL    TLOG_WARN
+#endif
+#ifndef TLOG_SYNC
+#define TLOG_SYNC           0
+#endif
+
+#define TLOG_RING_ENTRIES   1024        // power of two
+#define TLOG_MAX_ARGS       5
+#define TLOG_DRAIN_BUDGET   1           // records printed per idle pass
+#define TLOG_DUMP_MAX       48          // records per MSG_LOG_DUMP reply
+
+/* 32-byte record, also the wire format of MSG_LOG_DUMP (little-endian) */
+typedef struct {
+    u64 ts;                     // XTime ticks
+    u16 id;
+    u8  level;
+    u8  nargs;
+    u32 args[TLOG_MAX_ARGS];
+} tlog_rec_t;
+
+/* MSG_LOG_DUMP payload: this header, then nrec records */
+typedef struct __attribute__((packed)) {
+    u32 ticks_per_sec;
+    u32 lost;                   // records overwritten before this dump read them
+    u16 nrec;
+    u16 rec_bytes;
+} tlog_dump_hdr_t;
+
+#define TLOG_DUMP_HDR_BYTES 12
+#define TLOG_DUMP_BYTES     (TLOG_DUMP_HDR_BYTES + TLOG_DUMP_MAX * sizeof(tlog_rec_t))
+
+enum {
+#define TLOG_ID(name, level, fmt) TLOG_##name,
+#include "tlog_ids.h"
+#undef TLOG_ID
+    TLOG_NUM_IDS
+};
+
+enum {
+#define TLOG_ID(name, level, fmt) TLOG_LVL_##name = level,
+#include "tlog_ids.h"
+#undef TLOG_ID
+};
+
+#define TLOG_NARGS(...)                 TLOG_NARGS_(__VA_ARGS__, 5, 4, 3, 2, 1, 0)
+#define TLOG_NARGS_(a, b, c, d, e, n, ...) n
+
+#define TLOG(name, ...) do {                                            \
+        if (TLOG_LVL_##name <= TLOG_LEVEL) {                            \
+            const u32 tlog_a_[] = { __VA_ARGS__ };                      \
+            tlog_put(TLOG_##name, TLOG_LVL_##name, tlog_a_,             \
+                     TLOG_NARGS(__VA_ARGS__));                          \
+        }                                                               \
+    } while (0)
+
+void tlog_put(u16 id, u8 level, const u32 *args, u32 nargs);
+void tlog_drain(u32 budget);                // run loop, when idle
+u32  tlog_dump(u8 *out, u32 max_bytes);     // MSG_LOG_DUMP payload, returns bytes
+
+#endif /* TLOG_H */
@@ -0,0 +1,16 @@
+/*
+ * tlog_ids.h - binary log events: TLOG_ID(name, level, format)
+ *
+ * Included several times with different TLOG_ID definitions (tlog.h,
+ * tlog.c) and parsed by scripts/tlog_dump.py, so keep one entry per line.
+ * The format takes up to TLOG_MAX_ARGS integer arguments (%d, %x, %08x).
+ * Append new ids at the end: a dump is decoded by position.
+ */
+
+TLOG_ID(RX_FRAME_READY,  TLOG_DEBUG, "[TCP] s%d Frame ready buf[%d] count=%d")
+TLOG_ID(RX_CRC_BAD,      TLOG_WARN,  "[TCP] s%d CRC mismatch seq=%d (got %08x, hdr %08x)")
+TLOG_ID(TX_FRAME_SENT,   TLOG_DEBUG, "[TCP] s%d Frame sent (%d bytes)")
+TLOG_ID(PIPE_SUBMIT,     TLOG_DEBUG, "[MAIN] s%d frame %d (seq %d) received, processing...")
+TLOG_ID(PIPE_CRC_WARN,   TLOG_WARN,  "[WARN] s%d frame seq=%d failed CRC, processing anyway")
+TLOG_ID(PIPE_DMA_DONE,   TLOG_DEBUG, "[MAIN] s%d DMA done, slot %d queued for TX")
+TLOG_ID(PIPE_TX_BUSY,    TLOG_WARN,  "[WARN] s%d TX incomplete (res=%d)")
@@ -0,0 +1,333 @@
+/*
+ * udp_frag.c - frame messages over UDP: fragments, reassembly and NACKs
+ */
+
+#include <string.h>
+#include "udp_frag.h"
+
+#define BIT_SET(m, i)   ((m)[(i) >> 3] & (1u << ((i) & 7)))
+
+/* udpf_rx_t.status_due */
+#define DUE_SOON        1           // stray datagrams: the sender may have missed a STATUS
+#define DUE_NOW         2           // a frame completed or the credit moved
+
+/* Time a is at least d after time b, across a wrap of the clock */
+static inline int elapsed(u32 a, u32 b, u32 d)
+{
+    return (u32)(a - b) >= d;
+}
+
+void udpf_make_hdr(udpf_hdr_t *h, u16 token, u32 frame, u32 nfrags, u32 frag, u32 len, int retx)
+{
+    h->magic    = UDPF_MAGIC;
+    h->type     = UDPF_DATA;
+    h->flags    = retx ? UDPF_F_RETX : 0;
+    h->token    = token;
+    h->nfrags   = (u16)nfrags;
+    h->frame    = frame;
+    h->frag     = (u16)frag;
+    h->len      = (u16)len;
+}
+
+/* -------------------------------------------------------------------------- */
+/* Receiver                                                                   */
+/* -------------------------------------------------------------------------- */
+void udpf_rx_init(udpf_rx_t *r)
+{
+    memset(r, 0, sizeof(*r));
+    for (int i = 0; i < UDPF_WINDOW; i++) r->f[i].frame = UDPF_NONE;
+}
+
+/* Slot of a DATA header's frame, NULL (counted) if it does not fit */
+static udpf_rx_frame_t *rx_slot(udpf_rx_t *r, const udpf_hdr_t *h, u32 limit)
+{
+    u32 n = h->frame;
+
+    if (n - r->next >= UDPF_WINDOW || n >= limit ||
+        h->nfrags == 0 || h->nfrags > UDPF_MAX_FRAGS || h->frag >= h->nfrags) {
+        r->st.dropped++;
+        if (!r->status_due) r->status_due = DUE_SOON;
+        return NULL;
+    }
+
+    udpf_rx_frame_t *f = &r->f[n % UDPF_WINDOW];
+    if (f->frame != n) {
+        f->frame  = n;
+        f->nfrags = 0;
+        f->nacked = 0;
+    }
+    if (f->nfrags == 0) {
+        /* First fragment, or a frame NACKed whole before any of it arrived */
+        memset(f->map, 0, (h->nfrags + 7) / 8);
+        f->nfrags = h->nfrags;
+        f->got    = 0;
+        f->hi     = 0;
+    }
+    else if (f->nfrags != h->nfrags) {
+        r->st.dropped++;
+        return NULL;
+    }
+    if (n >= r->seen) r->seen = n + 1;
+    return f;
+}
+
+int udpf_rx_accept(udpf_rx_t *r, const udpf_hdr_t *h, u32 limit)
+{
+    if (h->frame < r->next) {
+        r->st.dups++;
+        if (!r->status_due) r->status_due = DUE_SOON;   // our ACK for it went missing
+        return UDPF_DUP;
+    }
+    udpf_rx_frame_t *f = rx_slot(r, h, limit);
+    if (!f) return UDPF_DROP;
+
+    r->st.datagrams++;
+    if (h->flags & UDPF_F_RETX) r->st.retx++;
+    if (BIT_SET(f->map, h->frag)) {
+        r->st.dups++;
+        return UDPF_DUP;
+    }
+    f->map[h->frag >> 3] |= (u8)(1u << (h->frag & 7));
+    f->got++;
+    if (h->frag >= f->hi) f->hi = h->frag + 1;
+    return UDPF_NEW;
+}
+
+void udpf_rx_defer(udpf_rx_t *r, const udpf_hdr_t *h, u32 limit)
+{
+    if (h->frame < r->next) return;
+    udpf_rx_frame_t *f = rx_slot(r, h, limit);
+    if (!f) return;
+
+    r->st.dropped++;
+    if (h->frag >= f->hi) f->hi = h->frag + 1;     // a hole up to here, itself included
+}
+
+int udpf_rx_has(const udpf_rx_t *r, u32 frame, u32 frag)
+{
+    const udpf_rx_frame_t *f = &r->f[frame % UDPF_WINDOW];
+
+    if (frame < r->next) return 1;
+    return f->frame == frame && frag < f->nfrags && BIT_SET(f->map, frag);
+}
+
+int udpf_rx_ready(const udpf_rx_t *r)
+{
+    const udpf_rx_frame_t *f = &r->f[r->next % UDPF_WINDOW];
+    return f->frame == r->next && f->nfrags && f->got == f->nfrags;
+}
+
+void udpf_rx_pop(udpf_rx_t *r)
+{
+    r->f[r->next % UDPF_WINDOW].frame = UDPF_NONE;
+    r->next++;
+    r->st.frames++;
+    r->status_due = DUE_NOW;
+}
+
+int udpf_rx_busy(const udpf_rx_t *r)
+{
+    return r->seen > r->next;
+}
+
+/* Holes of frame n known so far, as ranges; returns their number */
+static u32 rx_holes(const udpf_rx_t *r, u32 n, udpf_range_t *rg)
+{
+    const udpf_rx_frame_t *f = &r->f[n % UDPF_WINDOW];
+
+    if (f->frame != n || f->nfrags == 0) {
+        /* Nothing of it arrived, but a later frame did: all of it */
+        rg[0].first = 0;
+        rg[0].count = 0;
+        return 1;
+    }
+
+    /* The newest frame may still be arriving: only holes below a later fragment */
+    u32 end = (n + 1 < r->seen) ? f->nfrags : f->hi;
+    u32 cnt = 0;
+    for (u32 i = 0; i < end && cnt < UDPF_MAX_RANGES; ) {
+        if (BIT_SET(f->map, i)) {
+            /* Skip a whole byte of received fragments at once */
+            if ((i & 7) == 0 && f->map[i >> 3] == 0xFF) i += 8;
+            else i++;
+            continue;
+        }
+        u32 j = i + 1;
+        while (j < end && !BIT_SET(f->map, j)) j++;
+        rg[cnt].first = (u16)i;
+        rg[cnt].count = (u16)(j - i);
+        cnt++;
+        i = j;
+    }
+    return cnt;
+}
+
+u32 udpf_rx_status(udpf_rx_t *r, u16 token, u32 limit, u32 now_us, u8 *buf)
+{
+    udpf_hdr_t h;
+    udpf_status_t s;
+    udpf_range_t *rg = (udpf_range_t *)(buf + UDPF_HDR_BYTES + sizeof(s));
+    u32 nr = 0;
+
+    memset(&h, 0, sizeof(h));
+    h.magic = UDPF_MAGIC;
+    h.type  = UDPF_STATUS;
+    h.token = token;
+
+    s.nack_frame = r->next;
+    for (u32 n = r->next; n < r->seen && n - r->next < UDPF_WINDOW; n++) {
+        udpf_rx_frame_t *f = &r->f[n % UDPF_WINDOW];
+        if (f->frame == n && f->nfrags && f->got == f->nfrags) continue;
+        if (f->frame == n && f->nacked && !elapsed(now_us, f->nack_us, UDPF_NACK_US)) continue;
+        nr = rx_holes(r, n, rg);
+        if (!nr) continue;
+        if (f->frame != n) {
+            f->frame  = n;      // placeholder until a fragment says how many there are
+            f->nfrags = 0;
+        }
+        f->nacked  = 1;
+        f->nack_us = now_us;
+        s.nack_frame = n;
+        r->st.nacks += nr;
+        break;
+    }
+
+    if (!nr && r->status_due != DUE_NOW && limit == r->limit_sent &&
+        !elapsed(now_us, r->status_us, r->status_due ? UDPF_NACK_US : UDPF_STATUS_US))
+        return 0;
+
+    s.next     = r->next;
+    s.limit    = limit;
+    s.nranges  = (u16)nr;
+    s.reserved = 0;
+    h.len      = (u16)(sizeof(s) + nr * sizeof(udpf_range_t));
+    memcpy(buf, &h, sizeof(h));
+    memcpy(buf + UDPF_HDR_BYTES, &s, sizeof(s));
+    r->status_us  = now_us;
+    r->limit_sent = limit;
+    r->status_due = 0;
+    return UDPF_HDR_BYTES + sizeof(s) + nr * sizeof(udpf_range_t);
+}
+
+/* -------------------------------------------------------------------------- */
+/* Sender                                                                     */
+/* -------------------------------------------------------------------------- */
+void udpf_tx_init(udpf_tx_t *t, u32 limit)
+{
+    memset(t, 0, sizeof(*t));
+    t->limit = limit;
+    for (int i = 0; i < UDPF_WINDOW; i++) t->f[i].frame = UDPF_NONE;
+}
+
+int udpf_tx_can_queue(const udpf_tx_t *t) { return t->head - t->acked < UDPF_WINDOW; }
+int udpf_tx_acked(const udpf_tx_t *t, u32 frame) { return frame < t->acked; }
+int udpf_tx_idle(const udpf_tx_t *t) { return t->acked == t->head; }
+
+u32 udpf_tx_queue(udpf_tx_t *t, u32 len)
+{
+    u32 n = t->head++;
+    udpf_tx_frame_t *f = &t->f[n % UDPF_WINDOW];
+
+    f->frame   = n;
+    f->nfrags  = (u16)udpf_nfrags(len);
+    f->sent    = 0;
+    f->sent_us = 0;
+    return n;
+}
+
+void udpf_tx_resend(udpf_tx_t *t, u32 frame, u32 first, u32 count)
+{
+    const udpf_tx_frame_t *f = &t->f[frame % UDPF_WINDOW];
+
+    if (frame < t->acked || f->frame != frame || first >= f->nfrags) return;
+    if (t->retx_cnt == UDPF_RETX_RING) return;      // the next NACK asks again
+
+    u32 end = (count == 0 || first + count > f->nfrags) ? f->nfrags : first + count;
+    udpf_retx_t *e = &t->retx[(t->retx_head + t->retx_cnt) % UDPF_RETX_RING];
+    e->frame = frame;
+    e->next  = (u16)first;
+    e->end   = (u16)end;
+    t->retx_cnt++;
+}
+
+int udpf_tx_next(udpf_tx_t *t, u32 now_us, u32 *frame, u16 *frag)
+{
+    /* Resends: only what went out once already, of frames still unacknowledged */
+    while (t->retx_cnt) {
+        udpf_retx_t *e = &t->retx[t->retx_head];
+        udpf_tx_frame_t *f = &t->f[e->frame % UDPF_WINDOW];
+        u32 end = (e->end < f->sent) ? e->end : f->sent;
+
+        if (e->frame < t->acked || f->frame != e->frame || e->next >= end) {
+            t->retx_head = (t->retx_head + 1) % UDPF_RETX_RING;
+            t->retx_cnt--;
+            continue;
+        }
+        *frame = e->frame;
+        *frag  = e->next++;
+        t->st.datagrams++;
+        t->st.retx++;
+        return 2;
+    }
+
+    /* New fragments, oldest frame first, within the receiver's credit */
+    for (u32 n = t->acked; n < t->head && n < t->limit; n++) {
+        udpf_tx_frame_t *f = &t->f[n % UDPF_WINDOW];
+        if (f->sent == f->nfrags) continue;
+        *frame = n;
+        *frag  = f->sent++;
+        if (f->sent == f->nfrags) f->sent_us = now_us;
+        t->st.datagrams++;
+        return 1;
+    }
+
+    /* Probe: the oldest frame went out whole and nothing came back */
+    if (t->acked < t->head) {
+        udpf_tx_frame_t *f = &t->f[t->acked % UDPF_WINDOW];
+        if (f->sent == f->nfrags && elapsed(now_us, f->sent_us, UDPF_RTO_US)) {
+            f->sent_us = now_us;
+            *frame = t->acked;
+            *frag  = f->nfrags - 1;
+            t->st.datagrams++;
+            t->st.probes++;
+            t->quiet++;
+            return 2;
+        }
+    }
+    return 0;
+}
+
+int udpf_tx_status(udpf_tx_t *t, const u8 *dgram, u32 len, u32 now_us)
+{
+    udpf_hdr_t h;
+    udpf_status_t s;
+
+    if (len < UDPF_HDR_BYTES + sizeof(s)) return -1;
+    memcpy(&h, dgram, sizeof(h));
+    memcpy(&s, dgram + UDPF_HDR_BYTES, sizeof(s));
+    if (h.magic != UDPF_MAGIC || h.type != UDPF_STATUS || s.nranges > UDPF_MAX_RANGES ||
+        len < UDPF_HDR_BYTES + sizeof(s) + s.nranges * sizeof(udpf_range_t))
+        return -1;
+    t->quiet = 0;
+
+    /* Cumulative ACK; a STATUS overtaken by a later one changes nothing */
+    u32 next = (s.next > t->head) ? t->head : s.next;
+    while (t->acked < next) {
+        t->f[t->acked % UDPF_WINDOW].frame = UDPF_NONE;
+        t->acked++;
+        t->st.frames++;
+    }
+    if (s.limit > t->limit) t->limit = s.limit;
+
+    if (s.nranges && s.nack_frame >= t->acked && s.nack_frame < t->head) {
+        const u8 *p = dgram + UDPF_HDR_BYTES + sizeof(s);
+        for (u32 i = 0; i < s.nranges; i++, p += sizeof(udpf_range_t)) {
+            udpf_range_t rg;
+            memcpy(&rg, p, sizeof(rg));
+            udpf_tx_resend(t, s.nack_frame, rg.first, rg.count);
+        }
+        t->f[s.nack_frame % UDPF_WINDOW].sent_us = now_us;     // the receiver is talking
+        t->st.nacks += s.nranges;
+    }
+    return 0;
+}
@@ -0,0 +1,214 @@
+/*
+ * udp_frag.h - frame messages over UDP: fragments, reassembly and NACKs
+ *
+ * A frame message is the frame_hdr_t and its payload, as on the TCP stream.
+ * Over UDP it is cut into datagrams of one udpf_hdr_t and at most
+ * UDPF_FRAG_BYTES: fragment 0 carries the frame_hdr_t alone, fragment k
+ * payload bytes [(k - 1) * UDPF_FRAG_BYTES, k * UDPF_FRAG_BYTES). Frames are
+ * numbered per direction from 0 in stream order.
+ *
+ * The receiver assembles up to UDPF_WINDOW frames at once and answers with
+ * UDPF_STATUS datagrams: a cumulative ACK, the credit (frames the sender may
+ * start) and, for a frame with holes, the missing fragments as ranges. A
+ * hole is reported once a later fragment shows it, again every
+ * UDPF_NACK_US while it stays open; a sender that hears nothing for
+ * UDPF_RTO_US resends the last fragment of its oldest frame, which makes
+ * every hole visible. There is no congestion control: the link is one
+ * point-to-point segment, and the credit keeps the sender within the
+ * receiver's buffers.
+ *
+ * Only bookkeeping lives here; moving the bytes is up to the caller (echo.c
+ * with lwIP RAW UDP or raw Ethernet frames on the board, tools/udp_link.cpp
+ * on the host). Times
+ * are microseconds from any free-running clock; they may wrap.
+ */
+
+#ifndef UDP_FRAG_H
+#define UDP_FRAG_H
+
+#include "xil_types.h"
+
+#define UDPF_MAGIC      0x4655      // "UF"
+#define UDPF_HDR_BYTES  16
+#define UDPF_FRAG_BYTES 1456        // 1500 MTU - IP 20 - UDP 8 - udpf_hdr_t
+#define UDPF_MAX_FRAGS  8192        // fragments per frame message (~11.9 MB)
+#define UDPF_WINDOW     4           // frames in flight per direction
+#define UDPF_MAX_RANGES 64          // NACK ranges per STATUS
+
+#define UDPF_NACK_US    2000        // repeat a NACK for a hole still open after this
+#define UDPF_RTO_US     20000       // sender: nothing ACKed for this long -> probe
+#define UDPF_STATUS_US  10000       // receiver: STATUS at least this often
+
+/* udpf_hdr_t.type */
+#define UDPF_DATA       1           // a fragment of a frame message
+#define UDPF_STATUS     2           // receiver -> sender, udpf_status_t follows
+
+/* udpf_hdr_t.flags */
+#define UDPF_F_RETX     0x01        // DATA: retransmission (statistics only)
+
+typedef struct __attribute__((packed)) {
+    u16 magic;
+    u8  type;
+    u8  flags;
+    u16 token;          // from MSG_UDP_ACK, names the session on the board
+    u16 nfrags;         // DATA: fragments in the frame message
+    u32 frame;          // DATA: frame number
+    u16 frag;           // DATA: 0 = frame_hdr_t, k >= 1 = payload
+    u16 len;            // bytes after this header
+} udpf_hdr_t;
+
+typedef struct __attribute__((packed)) {
+    u32 next;           // every frame below this is complete
+    u32 limit;          // the sender may start frames below this
+    u32 nack_frame;     // frame the ranges refer to
+    u16 nranges;
+    u16 reserved;
+} udpf_status_t;
+
+/* Missing fragments [first, first + count); count 0 = first to the end */
+typedef struct __attribute__((packed)) {
+    u16 first;
+    u16 count;
+} udpf_range_t;
+
+typedef char udpf_hdr_size_check[(sizeof(udpf_hdr_t) == UDPF_HDR_BYTES) ? 1 : -1];
+
+#define UDPF_STATUS_MAX (UDPF_HDR_BYTES + sizeof(udpf_status_t) + UDPF_MAX_RANGES * sizeof(udpf_range_t))
+#define UDPF_DGRAM_MAX  (UDPF_HDR_BYTES + UDPF_FRAG_BYTES)
+
+/* Fragments of a frame message with len payload bytes */
+static inline u32 udpf_nfrags(u32 len) { return 1 + (len + UDPF_FRAG_BYTES - 1) / UDPF_FRAG_BYTES; }
+
+/* Payload span of fragment k >= 1 */
+static inline u32 udpf_frag_off(u32 frag) { return (frag - 1) * UDPF_FRAG_BYTES; }
+static inline u32 udpf_frag_len(u32 len, u32 frag)
+{
+    u32 off = udpf_frag_off(frag);
+    return (len - off < UDPF_FRAG_BYTES) ? len - off : UDPF_FRAG_BYTES;
+}
+
+/*
+ * Bytes of a received datagram that belong to it, 0 if it is short. A link
+ * that pads small frames (raw Ethernet, 60 bytes) leaves the rest behind.
+ */
+static inline u32 udpf_dgram_len(const udpf_hdr_t *h, u32 n)
+{
+    u32 want = UDPF_HDR_BYTES + h->len;
+    return want <= n ? want : 0;
+}
+
+/* Receiver and sender counters, summed until cleared by the caller */
+typedef struct {
+    u32 datagrams;      // DATA sent or received
+    u32 retx;           // DATA sent again / received with UDPF_F_RETX
+    u32 dups;           // receiver: fragments it already had
+    u32 dropped;        // receiver: outside the window or malformed
+    u32 nacks;          // NACK ranges sent / received
+    u32 probes;         // sender: RTO probes
+    u32 frames;         // frames completed / acknowledged
+} udpf_stats_t;
+
+/* -------------------------------------------------------------------------- */
+/* Receiver                                                                   */
+/* -------------------------------------------------------------------------- */
+typedef struct {
+    u32 frame;          // UDPF_NONE while the slot is unused
+    u16 nfrags;
+    u16 got;
+    u16 hi;             // highest fragment received + 1
+    u8  nacked;         // nack_us is valid
+    u32 nack_us;        // last NACK for this frame
+    u8  map[UDPF_MAX_FRAGS / 8];
+} udpf_rx_frame_t;
+
+typedef struct {
+    u32 next;           // oldest frame not yet complete
+    u32 seen;           // highest frame number received + 1
+    u32 status_us;      // last STATUS sent
+    u32 limit_sent;     // credit in that STATUS
+    u8  status_due;     // something worth reporting since then
+    udpf_rx_frame_t f[UDPF_WINDOW];     // frame n in f[n % UDPF_WINDOW]
+    udpf_stats_t st;
+} udpf_rx_t;
+
+#define UDPF_NONE       0xFFFFFFFFu
+
+/* udpf_rx_accept() */
+#define UDPF_NEW        0
+#define UDPF_DUP        1
+#define UDPF_DROP       2
+
+void udpf_rx_init(udpf_rx_t *r);
+
+/*
+ * Record a DATA header; frames at or past limit are dropped, as are
+ * fragments that do not fit their frame. Only a UDPF_NEW fragment is to be
+ * stored by the caller.
+ */
+int  udpf_rx_accept(udpf_rx_t *r, const udpf_hdr_t *h, u32 limit);
+
+/* A valid fragment the caller cannot store yet: NACKed with the holes around it */
+void udpf_rx_defer(udpf_rx_t *r, const udpf_hdr_t *h, u32 limit);
+int  udpf_rx_has(const udpf_rx_t *r, u32 frame, u32 frag);
+int  udpf_rx_ready(const udpf_rx_t *r);     // frame r->next has every fragment
+void udpf_rx_pop(udpf_rx_t *r);             // the caller took frame r->next
+int  udpf_rx_busy(const udpf_rx_t *r);      // a frame is partly received
+
+/*
+ * STATUS to send now into buf (UDPF_STATUS_MAX bytes), 0 if nothing is due.
+ * Call after every batch of datagrams and from a timer; one call reports
+ * one frame's holes, so loop until it returns 0.
+ */
+u32  udpf_rx_status(udpf_rx_t *r, u16 token, u32 limit, u32 now_us, u8 *buf);
+
+/* -------------------------------------------------------------------------- */
+/* Sender                                                                     */
+/* -------------------------------------------------------------------------- */
+typedef struct {
+    u32 frame;          // UDPF_NONE while the slot is unused
+    u16 nfrags;
+    u16 sent;           // fragments sent once, in order
+    u32 sent_us;        // last fragment first sent, or the last probe
+} udpf_tx_frame_t;
+
+typedef struct {
+    u32 frame;
+    u16 next;           // next fragment of the range to resend
+    u16 end;
+} udpf_retx_t;
+
+#define UDPF_RETX_RING  (UDPF_WINDOW * UDPF_MAX_RANGES)
+
+typedef struct {
+    u32 acked;          // every frame below this is acknowledged
+    u32 limit;          // credit from the last STATUS
+    u32 head;           // number of the next frame queued
+    udpf_tx_frame_t f[UDPF_WINDOW];
+    udpf_retx_t retx[UDPF_RETX_RING];
+    u32 retx_head, retx_cnt;
+    u32 quiet;          // probes since the receiver was last heard
+    udpf_stats_t st;
+} udpf_tx_t;
+
+void udpf_tx_init(udpf_tx_t *t, u32 limit);
+int  udpf_tx_can_queue(const udpf_tx_t *t);
+u32  udpf_tx_queue(udpf_tx_t *t, u32 len);  // frame number of a new message
+int  udpf_tx_acked(const udpf_tx_t *t, u32 frame);
+int  udpf_tx_idle(const udpf_tx_t *t);      // everything queued is acknowledged
+
+/*
+ * Next fragment to put on the wire: resends first, then new fragments in
+ * order, then an RTO probe. Returns 0 with nothing to send, else fills
+ * *frame / *frag and 1, or 2 for a resend. A fragment that could not go
+ * out is handed back with udpf_tx_resend().
+ */
+int  udpf_tx_next(udpf_tx_t *t, u32 now_us, u32 *frame, u16 *frag);
+void udpf_tx_resend(udpf_tx_t *t, u32 frame, u32 first, u32 count);
+
+/* Apply a STATUS datagram (header included); -1 if malformed */
+int  udpf_tx_status(udpf_tx_t *t, const u8 *dgram, u32 len, u32 now_us);
+
+/* Datagram header for a DATA fragment of len bytes */
+void udpf_make_hdr(udpf_hdr_t *h, u16 token, u32 frame, u32 nfrags, u32 frag, u32 len, int retx);
+
+#endif /* UDP_FRAG_H */
@@ -0,0 +1,362 @@
+/*
+ * vcodec.c - lossless frame codec for the wire
+ *
+ * Tile layout: a mode byte, then for SPATIAL / TEMPORAL the residuals in
+ * tile order (row by row, w * bpp bytes each) as groups of 16. Groups go in
+ * pairs: one byte with both plane counts (even group in the low nibble),
+ * then each group's planes, lowest bit first, 2 bytes per plane (bit i of
+ * the first byte is residual i, of the second residual 8 + i).
+ *
+ * Bit planes are moved 8 residuals at a time through a u64: a multiply
+ * gathers bit k of 8 bytes into one byte when encoding, a nibble table
+ * spreads it back when decoding. Both assume a little-endian host, which
+ * the A53 and the x86 hosts are.
+ */
+
+#include <string.h>
+#include "vcodec.h"
+
+#define TILE_MAX_BYTES  (VC_TILE_W * VC_TILE_H * VC_MAX_BPP)
+#define GROUP           16
+
+/* Bit 0 of byte j -> bit 56 + j */
+#define GATHER_MUL      0x0102040810204080ull
+#define LSB_MASK        0x0101010101010101ull
+
+/* Bit j of a nibble -> bit 0 of byte j */
+static const u32 spread4[16] = {
+    0x00000000, 0x00000001, 0x00000100, 0x00000101,
+    0x00010000, 0x00010001, 0x00010100, 0x00010101,
+    0x01000000, 0x01000001, 0x01000100, 0x01000101,
+    0x01010000, 0x01010001, 0x01010100, 0x01010101,
+};
+
+static inline u64 spread(u8 m)
+{
+    return spread4[m & 15] | (u64)spread4[m >> 4] << 32;
+}
+
+static inline u8 zz(u8 d)
+{
+    return (u8)((d << 1) ^ (u8)((signed char)d >> 7));
+}
+
+static inline u8 unzz(u8 z)
+{
+    return (u8)((z >> 1) ^ (u8)-(z & 1));
+}
+
+static inline u8 med(u8 a, u8 b, u8 c)
+{
+    u8 mx = a > b ? a : b;
+    u8 mn = a > b ? b : a;
+    if (c >= mx) return mn;
+    if (c <= mn) return mx;
+    return (u8)(a + b - c);
+}
+
+/* Planes needed for 16 residuals */
+static inline u32 group_width(const u8 *r)
+{
+    u64 lo, hi;
+    memcpy(&lo, r, 8);
+    memcpy(&hi, r + 8, 8);
+    u64 o = lo | hi;
+    o |= o >> 32;
+    o |= o >> 16;
+    o |= o >> 8;
+    o &= 0xFF;
+    return o ? 32 - (u32)__builtin_clz((u32)o) : 0;
+}
+
+/* -------------------------------------------------------------------------- */
+/* Residual groups                                                            */
+/* -------------------------------------------------------------------------- */
+/* Coded size of n residuals; the buffer is zero-padded to a whole group */
+static u32 groups_size(const u8 *r, u32 n)
+{
+    u32 groups = (n + GROUP - 1) / GROUP;
+    u32 size = (groups + 1) / 2;
+
+    for (u32 g = 0; g < groups; g++)
+        size += 2 * group_width(r + g * GROUP);
+    return size;
+}
+
+static u8 *group_put(u8 *p, const u8 *r, u32 w)
+{
+    u64 lo, hi;
+    memcpy(&lo, r, 8);
+    memcpy(&hi, r + 8, 8);
+    for (u32 k = 0; k < w; k++) {
+        *p++ = (u8)((((lo >> k) & LSB_MASK) * GATHER_MUL) >> 56);
+        *p++ = (u8)((((hi >> k) & LSB_MASK) * GATHER_MUL) >> 56);
+    }
+    return p;
+}
+
+static u8 *groups_put(u8 *p, const u8 *r, u32 n)
+{
+    u32 groups = (n + GROUP - 1) / GROUP;
+
+    for (u32 g = 0; g < groups; g += 2) {
+        u32 w0 = group_width(r + g * GROUP);
+        u32 w1 = (g + 1 < groups) ? group_width(r + (g + 1) * GROUP) : 0;
+        *p++ = (u8)(w0 | w1 << 4);
+        p = group_put(p, r + g * GROUP, w0);
+        if (w1) p = group_put(p, r + (g + 1) * GROUP, w1);
+    }
+    return p;
+}
+
+/* Residuals back into r (n rounded up to a group); NULL if in runs short */
+static const u8 *groups_get(const u8 *p, const u8 *end, u8 *r, u32 n)
+{
+    u32 groups = (n + GROUP - 1) / GROUP;
+
+    for (u32 g = 0; g < groups; g += 2) {
+        if (p >= end) return NULL;
+        u32 ws = *p++;
+        for (u32 h = 0; h < 2; h++, ws >>= 4) {
+            u32 w = ws & 15;
+            if (g + h >= groups) {
+                if (w) return NULL;
+                break;
+            }
+            if (w > 8 || (u32)(end - p) < 2 * w) return NULL;
+
+            u64 lo = 0, hi = 0;
+            for (u32 k = 0; k < w; k++) {
+                lo |= spread(*p++) << k;
+                hi |= spread(*p++) << k;
+            }
+            memcpy(r + (g + h) * GROUP, &lo, 8);
+            memcpy(r + (g + h) * GROUP + 8, &hi, 8);
+        }
+    }
+    return p;
+}
+
+/* -------------------------------------------------------------------------- */
+/* Predictors                                                                 */
+/* -------------------------------------------------------------------------- */
+/* up is the row above, NULL on the first row; column 0 predicts from above */
+static inline u8 predict(const u8 *row, const u8 *up, u32 i, u32 bpp)
+{
+    if (!up) return i >= bpp ? row[i - bpp] : 0;
+    if (i < bpp) return up[i];
+    return med(row[i - bpp], up[i], up[i - bpp]);
+}
+
+/* Zigzagged median residuals of n bytes with neighbours l, u, ul */
+static void med_res(const u8 *restrict x, const u8 *restrict l, const u8 *restrict u,
+                    const u8 *restrict ul, u8 *restrict r, u32 n)
+{
+    for (u32 j = 0; j < n; j++) {
+        u8 a = l[j], b = u[j], c = ul[j];
+        u8 mx = a > b ? a : b;
+        u8 mn = a > b ? b : a;
+        u8 p = (u8)(a + b - c);
+        p = c >= mx ? mn : p;
+        p = c <= mn ? mx : p;
+        r[j] = zz((u8)(x[j] - p));
+    }
+}
+
+/* Zigzagged residuals of bytes [i0, i1) of a row */
+static void spatial_row(const u8 *row, const u8 *up, u32 i0, u32 i1, u32 bpp, u8 *r)
+{
+    u32 i = i0;
+
+    /* The edge bytes take the branches, the rest vectorises */
+    for (; i < i1 && (i < bpp || !up); i++) *r++ = zz((u8)(row[i] - predict(row, up, i, bpp)));
+    if (i < i1) med_res(row + i, row + i - bpp, up + i, up + i - bpp, r, i1 - i);
+}
+
+static void delta_res(const u8 *restrict x, const u8 *restrict p, u8 *restrict r, u32 n)
+{
+    for (u32 j = 0; j < n; j++) r[j] = zz((u8)(x[j] - p[j]));
+}
+
+/* Inverse of spatial_row, in place: left and above are already decoded */
+static void spatial_row_dec(u8 *row, const u8 *up, u32 i0, u32 i1, u32 bpp, const u8 *r)
+{
+    u32 i = i0;
+
+    for (; i < i1 && (i < bpp || !up); i++) row[i] = (u8)(predict(row, up, i, bpp) + unzz(*r++));
+    for (; i < i1; i++) {
+        u8 a = row[i - bpp], b = up[i], c = up[i - bpp];
+        u8 mx = a > b ? a : b;
+        u8 mn = a > b ? b : a;
+        u8 p = (u8)(a + b - c);
+        p = c >= mx ? mn : p;
+        p = c <= mn ? mx : p;
+        row[i] = (u8)(p + unzz(*r++));
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+/* Encoder                                                                    */
+/* -------------------------------------------------------------------------- */
+u32 vc_bound(u32 w, u32 h, u32 bpp)
+{
+    u32 tiles = ((w + VC_TILE_W - 1) / VC_TILE_W) * ((h + VC_TILE_H - 1) / VC_TILE_H);
+    return VC_HDR_BYTES + tiles + w * h * bpp;
+}
+
+static int tile_equal(const u8 *a, const u8 *b, u32 stride, u32 rb, u32 th)
+{
+    for (u32 y = 0; y < th; y++)
+        if (memcmp(a + y * stride, b + y * stride, rb)) return 0;
+    return 1;
+}
+
+u32 vc_encode(const u8 *cur, u8 *ref, int key, u32 w, u32 h, u32 bpp, int level,
+              u8 *out, vc_stats_t *st)
+{
+    u8 rs[TILE_MAX_BYTES], rt[TILE_MAX_BYTES];
+    u32 stride = w * bpp;
+    u8 *p = out + VC_HDR_BYTES;
+
+    vc_hdr_t hdr;
+    hdr.width     = (u16)w;
+    hdr.height    = (u16)h;
+    hdr.bpp       = (u8)bpp;
+    hdr.flags     = (key || !ref) ? VC_KEY : 0;
+    hdr.tile_w    = VC_TILE_W;
+    hdr.tile_h    = VC_TILE_H;
+    hdr.raw_bytes = stride * h;
+    memcpy(out, &hdr, sizeof(hdr));
+
+    for (u32 y0 = 0; y0 < h; y0 += VC_TILE_H) {
+        u32 th = (h - y0 < VC_TILE_H) ? h - y0 : VC_TILE_H;
+        for (u32 x0 = 0; x0 < w; x0 += VC_TILE_W) {
+            u32 tw = (w - x0 < VC_TILE_W) ? w - x0 : VC_TILE_W;
+            u32 rb = tw * bpp, n = rb * th;
+            u32 off = y0 * stride + x0 * bpp;
+            const u8 *c = cur + off;
+            u8 *rf = ref ? ref + off : NULL;
+            const u8 *prev = (hdr.flags & VC_KEY) ? NULL : rf;
+
+            if (prev && tile_equal(c, rf, stride, rb, th)) {
+                *p++ = VC_SKIP;
+                if (st) st->tiles[VC_SKIP]++;
+                continue;
+            }
+
+            u32 mode = VC_RAW, best = n;
+            if (level >= VC_LEVEL_FULL) {
+                u32 padded = (n + GROUP - 1) & ~(u32)(GROUP - 1);
+                memset(rs + n, 0, padded - n);
+                for (u32 y = 0; y < th; y++) {
+                    const u8 *row = cur + (y0 + y) * stride;
+                    const u8 *up = (y0 + y) ? row - stride : NULL;
+                    spatial_row(row, up, x0 * bpp, x0 * bpp + rb, bpp, rs + y * rb);
+                }
+                u32 sz = groups_size(rs, n);
+                if (sz < best) {
+                    best = sz;
+                    mode = VC_SPATIAL;
+                }
+                if (prev) {
+                    memset(rt + n, 0, padded - n);
+                    for (u32 y = 0; y < th; y++)
+                        delta_res(c + y * stride, prev + y * stride, rt + y * rb, rb);
+                    sz = groups_size(rt, n);
+                    if (sz < best) {
+                        best = sz;
+                        mode = VC_TEMPORAL;
+                    }
+                }
+            }
+
+            *p++ = (u8)mode;
+            if (mode == VC_RAW) {
+                for (u32 y = 0; y < th; y++, p += rb) memcpy(p, c + y * stride, rb);
+            }
+            else {
+                p = groups_put(p, mode == VC_SPATIAL ? rs : rt, n);
+            }
+            if (rf)
+                for (u32 y = 0; y < th; y++) memcpy(rf + y * stride, c + y * stride, rb);
+            if (st) st->tiles[mode]++;
+        }
+    }
+
+    return (u32)(p - out);
+}
+
+/* -------------------------------------------------------------------------- */
+/* Decoder                                                                    */
+/* -------------------------------------------------------------------------- */
+int vc_is_key(const u8 *in, u32 len)
+{
+    vc_hdr_t hdr;
+
+    if (len < VC_HDR_BYTES) return 0;
+    memcpy(&hdr, in, sizeof(hdr));
+    return (hdr.flags & VC_KEY) != 0;
+}
+
+int vc_decode(const u8 *in, u32 len, u8 *out, const u8 *ref, u32 w, u32 h, u32 bpp)
+{
+    u8 res[TILE_MAX_BYTES];
+    u32 stride = w * bpp;
+    const u8 *p = in + VC_HDR_BYTES, *end = in + len;
+    vc_hdr_t hdr;
+
+    if (len < VC_HDR_BYTES) return -1;
+    memcpy(&hdr, in, sizeof(hdr));
+    if (hdr.width != w || hdr.height != h || hdr.bpp != bpp || bpp > VC_MAX_BPP ||
+        hdr.tile_w != VC_TILE_W || hdr.tile_h != VC_TILE_H || hdr.raw_bytes != stride * h)
+        return -1;
+    if (!(hdr.flags & VC_KEY) && !ref) return -1;
+    if (hdr.flags & VC_KEY) ref = NULL;
+
+    for (u32 y0 = 0; y0 < h; y0 += VC_TILE_H) {
+        u32 th = (h - y0 < VC_TILE_H) ? h - y0 : VC_TILE_H;
+        for (u32 x0 = 0; x0 < w; x0 += VC_TILE_W) {
+            u32 tw = (w - x0 < VC_TILE_W) ? w - x0 : VC_TILE_W;
+            u32 rb = tw * bpp, n = rb * th;
+            u32 off = y0 * stride + x0 * bpp;
+            u8 *o = out + off;
+            const u8 *rf = ref ? ref + off : NULL;
+
+            if (p >= end) return -1;
+            u32 mode = *p++;
+            switch (mode) {
+            case VC_SKIP:
+                if (!rf) return -1;
+                if (rf != o)
+                    for (u32 y = 0; y < th; y++) memcpy(o + y * stride, rf + y * stride, rb);
+                break;
+
+            case VC_RAW:
+                if ((u32)(end - p) < n) return -1;
+                for (u32 y = 0; y < th; y++, p += rb) memcpy(o + y * stride, p, rb);
+                break;
+
+            case VC_TEMPORAL:
+                if (!rf) return -1;
+                if (!(p = groups_get(p, end, res, n))) return -1;
+                for (u32 y = 0; y < th; y++)
+                    for (u32 i = 0; i < rb; i++)
+                        o[y * stride + i] = (u8)(rf[y * stride + i] + unzz(res[y * rb + i]));
+                break;
+
+            case VC_SPATIAL:
+                if (!(p = groups_get(p, end, res, n))) return -1;
+                for (u32 y = 0; y < th; y++) {
+                    u8 *row = out + (y0 + y) * stride;
+                    const u8 *up = (y0 + y) ? row - stride : NULL;
+                    spatial_row_dec(row, up, x0 * bpp, x0 * bpp + rb, bpp, res + y * rb);
+                }
+                break;
+
+            default:
+                return -1;
+            }
+        }
+    }
+    return p == end ? 0 : -1;
+}
@@ -0,0 +1,96 @@
+/*
+ * vcodec.h - lossless frame codec for the wire (input and output frames)
+ *
+ * Frames are cut into VC_TILE_W x VC_TILE_H pixel tiles, coded in raster
+ * order, each in one of four modes:
+ *   SKIP      identical to the same tile of the previous frame
+ *   TEMPORAL  byte residuals against the previous frame
+ *   SPATIAL   byte residuals against the JPEG-LS median predictor of the
+ *             left / above / above-left bytes of the same channel
+ *   RAW       the tile bytes as they are
+ * Residuals are zigzag mapped and stored in groups of 16 as bit planes, with
+ * a 4-bit plane count per group. The encoder picks the smallest mode per
+ * tile, so the coded frame is never more than one byte per tile (plus the
+ * header) larger than the raw one.
+ *
+ * A frame that is not VC_KEY refers to the previous frame of the same
+ * stream, so encoder and decoder each keep one reference frame. The encoder
+ * brings its reference up to date as it goes; the decoder may decode in
+ * place over its reference. Shared by the firmware, the host simulator and
+ * the host tools (tools/Makefile builds this file).
+ */
+
+#ifndef VCODEC_H
+#define VCODEC_H
+
+#include "xil_types.h"
+
+/*
+ * VCODEC
+ *   0 : no wire codec; MSG_CONFIG codec requests are acknowledged as 0
+ *   1 : CFG_CODEC_* requests are honoured (default). Nothing is carved from
+ *       the frame pool for the codec until a config asks for it.
+ * Build this file with -O2 -fvect-cost-model=dynamic (or -O3 for the
+ * encoder only): the residual loops are written for the vectoriser.
+ */
+#ifndef VCODEC
+#define VCODEC          1
+#endif
+
+#define VC_MAX_BPP      4
+#define VC_TILE_W       64      // pixels
+#define VC_TILE_H       8       // rows
+#define VC_HDR_BYTES    12
+
+/* vc_hdr_t.flags */
+#define VC_KEY          0x01    // no reference frame needed
+
+/* Tile modes, one byte ahead of every tile */
+#define VC_SKIP         0
+#define VC_RAW          1
+#define VC_SPATIAL      2
+#define VC_TEMPORAL     3
+
+/* Encoder effort */
+#define VC_LEVEL_SKIP   1       // SKIP or RAW only: a compare and a copy per tile
+#define VC_LEVEL_FULL   2       // all modes
+
+typedef struct __attribute__((packed)) {
+    u16 width;
+    u16 height;
+    u8  bpp;
+    u8  flags;          // VC_KEY
+    u8  tile_w;
+    u8  tile_h;
+    u32 raw_bytes;      // width * height * bpp
+} vc_hdr_t;
+
+typedef char vc_hdr_size_check[(sizeof(vc_hdr_t) == VC_HDR_BYTES) ? 1 : -1];
+
+/* Tiles per mode, summed over calls until cleared by the caller */
+typedef struct {
+    u32 tiles[4];       // indexed by VC_SKIP .. VC_TEMPORAL
+} vc_stats_t;
+
+/* Largest coded frame for a geometry */
+u32 vc_bound(u32 w, u32 h, u32 bpp);
+
+/*
+ * Encode cur (bpp 1..VC_MAX_BPP) into out (vc_bound() bytes). ref is the
+ * previous frame and is updated to cur; with key set (or ref NULL) it is not
+ * referred to, so the frame decodes on its own. Returns the coded length.
+ */
+u32 vc_encode(const u8 *cur, u8 *ref, int key, u32 w, u32 h, u32 bpp, int level,
+              u8 *out, vc_stats_t *st);
+
+/*
+ * Decode len bytes into out (w * h * bpp). ref is the previous decoded
+ * frame and may be out itself; NULL is only accepted for key frames.
+ * Returns 0, or -1 on a malformed stream or a geometry mismatch.
+ */
+int vc_decode(const u8 *in, u32 len, u8 *out, const u8 *ref, u32 w, u32 h, u32 bpp);
+
+/* True if the coded frame needs no reference */
+int vc_is_key(const u8 *in, u32 len);
+
+#endif /* VCODEC_H */
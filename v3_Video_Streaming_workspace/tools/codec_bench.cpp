@@ -0,0 +1,197 @@
+/*
+ * codec_bench.cpp - offline benchmark of the wire codec (../src/vcodec.h)
+ *
+ * Runs a frame sequence through vc_encode() and vc_decode() the way a
+ * stream does (one reference frame per side, the first frame a key frame),
+ * checks that every frame comes back bit-exact, and reports the compression
+ * ratio, the tile modes picked, the codec time per frame on this host and
+ * what that means for a link-bound stream:
+ *   raw fps    = link / raw frame bits
+ *   coded fps  = link / mean coded frame bits, capped by the slower of
+ *                encode and decode (each runs pipelined with the link)
+ *   gain       = coded fps / raw fps
+ *
+ * usage: codec_bench SRC [--geom WxH[xBPP]] [--model] [--out-bpp 3|4]
+ *                        [--level skip|full] [--link MBPS] [--first N]
+ *   SRC        anything frame_src.hpp opens (raw .bin default 320x180x3)
+ *   --model    code the x4 reference model output of SRC (BGR24 input),
+ *              i.e. the board -> client direction; --out-bpp 3 (default)
+ *              is the BGR24 the board sends, 4 the IP's ABGR32
+ *   --level    encoder effort (default full; skip = CFG_CODEC_OUT_SKIP)
+ *   --link     payload rate in Mbit/s (default 940, TCP goodput on 1 GbE)
+ *   --first N  only frames 0..N-1
+ * Exit status 1 if any frame fails the round trip.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "frame_src.hpp"
+#include "golden.hpp"
+
+extern "C" {
+#include "vcodec.h"
+}
+
+#define DEFAULT_W       320
+#define DEFAULT_H       180
+#define DEFAULT_BPP     3
+#define DEFAULT_LINK    940.0   // Mbit/s
+
+static u64 now_ns(void)
+{
+    return (u64)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/* ABGR32 -> BGR24 in place, as the board packs before TX */
+static void pack_bgr24(u8 *buf, size_t pixels)
+{
+    for (size_t i = 0; i < pixels; i++) {
+        u8 b = buf[i * 4 + 1], g = buf[i * 4 + 2], r = buf[i * 4 + 3];
+        buf[i * 3 + 0] = b;
+        buf[i * 3 + 1] = g;
+        buf[i * 3 + 2] = r;
+    }
+}
+
+static void usage(void)
+{
+    fprintf(stderr,
+            "usage: codec_bench SRC [--geom WxH[xBPP]] [--model] [--out-bpp 3|4]\n"
+            "                       [--level skip|full] [--link MBPS] [--first N]\n");
+}
+
+int main(int argc, char **argv)
+{
+    std::vector<std::string> pos;
+    u32 gw = DEFAULT_W, gh = DEFAULT_H, gb = DEFAULT_BPP, first = 0, out_bpp = 3;
+    int level = VC_LEVEL_FULL;
+    bool model = false;
+    double link = DEFAULT_LINK;
+
+    for (int i = 1; i < argc; i++) {
+        std::string a = argv[i];
+        if (a == "--geom" && i + 1 < argc) {
+            if (sscanf(argv[++i], "%ux%ux%u", &gw, &gh, &gb) < 2) {
+                usage();
+                return 2;
+            }
+        }
+        else if (a == "--model")                  model = true;
+        else if (a == "--out-bpp" && i + 1 < argc) out_bpp = (u32)atoi(argv[++i]);
+        else if (a == "--link" && i + 1 < argc)   link = atof(argv[++i]);
+        else if (a == "--first" && i + 1 < argc)  first = (u32)atoi(argv[++i]);
+        else if (a == "--level" && i + 1 < argc) {
+            std::string l = argv[++i];
+            if (l == "skip")      level = VC_LEVEL_SKIP;
+            else if (l == "full") level = VC_LEVEL_FULL;
+            else                  { usage(); return 2; }
+        }
+        else if (a[0] == '-')                     { usage(); return 2; }
+        else                                      pos.push_back(a);
+    }
+    if (pos.size() != 1 || (out_bpp != 3 && out_bpp != 4) || link <= 0) {
+        usage();
+        return 2;
+    }
+
+    frame_src_t src;
+    if (!frame_src_open(src, pos[0], gw, gh, gb)) return 2;
+    if (model && src.pixfmt != PIXFMT_BGR24) {
+        fprintf(stderr, "[ERROR] %s: --model needs BGR24 input frames\n", pos[0].c_str());
+        return 2;
+    }
+    if (!model && (src.bpp == 0 || src.bpp > VC_MAX_BPP)) {
+        fprintf(stderr, "[ERROR] %s: %u bytes/pixel, the codec takes 1..%d\n",
+                pos[0].c_str(), src.bpp, VC_MAX_BPP);
+        return 2;
+    }
+    u32 frames = (first && first < src.frames) ? first : src.frames;
+
+    /* Geometry of the frames that get coded */
+    u32 w   = model ? src.w * GOLDEN_SCALE : src.w;
+    u32 h   = model ? src.h * GOLDEN_SCALE : src.h;
+    u32 bpp = model ? out_bpp : src.bpp;
+    size_t raw_bytes = (size_t)w * h * bpp;
+
+    std::vector<u8> in((size_t)src.w * src.h * src.bpp);
+    std::vector<u8> cur(model ? (size_t)w * h * 4 : raw_bytes);
+    std::vector<u8> enc_ref(raw_bytes), dec_ref(raw_bytes);
+    std::vector<u8> coded(vc_bound(w, h, bpp));
+    std::vector<s32> tmp(model ? golden_tmp_words(src.w, src.h) : 0);
+    bool simd = false;
+#if defined(__x86_64__)
+    simd = __builtin_cpu_supports("avx2");
+#endif
+
+    printf("[INFO] %s: %u frames, coding %ux%u x %u bytes/pixel%s, level %s\n",
+           pos[0].c_str(), frames, w, h, bpp, model ? " (x4 model output)" : "",
+           level == VC_LEVEL_SKIP ? "skip" : "full");
+
+    vc_stats_t st = {};
+    u64 total_coded = 0, enc_ns = 0, dec_ns = 0;
+    u32 min_len = ~0u, max_len = 0, bad = 0;
+
+    for (u32 f = 0; f < frames; f++) {
+        for (u32 y = 0; y < src.h; y++)
+            memcpy(&in[(size_t)y * src.w * src.bpp], frame_src_row(src, f, y), frame_src_row_bytes(src));
+        const u8 *frame = in.data();
+        if (model) {
+            golden_model_frame(simd, in.data(), src.w, src.h, cur.data(), tmp.data());
+            if (bpp == 3) pack_bgr24(cur.data(), (size_t)w * h);
+            frame = cur.data();
+        }
+
+        u64 t0 = now_ns();
+        u32 len = vc_encode(frame, enc_ref.data(), f == 0, w, h, bpp, level, coded.data(), &st);
+        u64 t1 = now_ns();
+        int rc = vc_decode(coded.data(), len, dec_ref.data(), f ? dec_ref.data() : nullptr, w, h, bpp);
+        u64 t2 = now_ns();
+
+        enc_ns += t1 - t0;
+        dec_ns += t2 - t1;
+        total_coded += len;
+        min_len = std::min(min_len, len);
+        max_len = std::max(max_len, len);
+        if (rc != 0 || memcmp(dec_ref.data(), frame, raw_bytes) != 0) {
+            if (bad++ < 10) printf("[ERROR] frame %u: round trip %s\n", f, rc ? "undecodable" : "differs");
+        }
+    }
+    frame_src_close(src);
+    if (frames == 0) {
+        printf("[ERROR] No frames in the input.\n");
+        return 2;
+    }
+
+    double mean   = (double)total_coded / frames;
+    double enc_ms = enc_ns / 1e6 / frames;
+    double dec_ms = dec_ns / 1e6 / frames;
+    u32 tiles = st.tiles[VC_SKIP] + st.tiles[VC_RAW] + st.tiles[VC_SPATIAL] + st.tiles[VC_TEMPORAL];
+
+    double raw_fps   = link * 1e6 / ((double)raw_bytes * 8);
+    double link_fps  = link * 1e6 / (mean * 8);
+    double codec_fps = 1e3 / std::max(enc_ms, dec_ms);
+    double coded_fps = std::min(link_fps, codec_fps);
+
+    printf("[BENCH] raw %.1f KB/frame, coded %.1f KB/frame (min %.1f, max %.1f): ratio %.2f\n",
+           raw_bytes / 1024.0, mean / 1024.0, min_len / 1024.0, max_len / 1024.0,
+           (double)raw_bytes / mean);
+    printf("[BENCH] tiles: skip %.1f%%, temporal %.1f%%, spatial %.1f%%, raw %.1f%%\n",
+           100.0 * st.tiles[VC_SKIP] / tiles, 100.0 * st.tiles[VC_TEMPORAL] / tiles,
+           100.0 * st.tiles[VC_SPATIAL] / tiles, 100.0 * st.tiles[VC_RAW] / tiles);
+    printf("[BENCH] encode %.2f ms/frame, decode %.2f ms/frame (one core, this host)\n", enc_ms, dec_ms);
+    printf("[BENCH] at %.0f Mbit/s: raw %.1f fps, coded %.1f fps (%s-bound), gain x%.2f\n",
+           link, raw_fps, coded_fps, link_fps <= codec_fps ? "link" : "codec", coded_fps / raw_fps);
+
+    if (bad) {
+        printf("[FAIL] %u of %u frames failed the round trip\n", bad, frames);
+        return 1;
+    }
+    printf("[PASS] %u frames bit-exact after decode\n", frames);
+    return 0;
+}
@@ -0,0 +1,298 @@
+/*
+ * frame_compare.cpp - byte-exact comparison of two frame sequences
+ *
+ * Binary replacement for the hex-text compare.py: both inputs are mmap'd
+ * frame sources (frame_src.hpp), rows are compared with an AVX2 equality
+ * kernel (scalar on other hosts), and frames are spread over threads.
+ * Reports the match ratio, the first N mismatching bytes as
+ * (frame, x, y, channel) and, on request, a per-frame CSV and a heatmap.
+ *
+ * usage: frame_compare A B [--geom WxH[xBPP]] [--first N] [-j N]
+ *                          [--csv FILE] [--heatmap FILE.pgm]
+ *   A, B: a .vfc, a raw .bin (default geometry 1280x720x4), a .bmp, a
+ *         directory of .bmp files or DIR/PREFIX. Exit status 0 if
+ *         identical, 1 if not.
+ *
+ * The heatmap is a PGM with one row per frame and one column per image row:
+ * black where a row matches, brighter the more of it mismatches (any
+ * mismatch is at least 64, so single bytes stay visible).
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+#include "frame_src.hpp"
+
+#define DEFAULT_W       1280
+#define DEFAULT_H       720
+#define DEFAULT_BPP     4
+#define DEFAULT_FIRST   10
+
+struct mismatch_t {
+    u32 frame, x, y, ch;
+    u8  a, b;
+};
+
+/* -------------------------------------------------------------------------- */
+/* Kernels: number of differing bytes                                         */
+/* -------------------------------------------------------------------------- */
+static size_t diff_scalar(const u8 *a, const u8 *b, size_t n)
+{
+    size_t d = 0, i = 0;
+
+    for (; i + 8 <= n; i += 8) {
+        u64 x, y;
+        memcpy(&x, a + i, 8);
+        memcpy(&y, b + i, 8);
+        if (x == y) continue;
+        for (int k = 0; k < 8; k++) d += (a[i + k] != b[i + k]);
+    }
+    for (; i < n; i++) d += (a[i] != b[i]);
+    return d;
+}
+
+#if defined(__x86_64__)
+__attribute__((target("avx2,popcnt")))
+static size_t diff_avx2(const u8 *a, const u8 *b, size_t n)
+{
+    size_t d = 0, i = 0;
+
+    /* 128 bytes per pass; equal blocks (the common case) cost one test */
+    for (; i + 128 <= n; i += 128) {
+        __m256i e0 = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)(a + i)),
+                                       _mm256_loadu_si256((const __m256i *)(b + i)));
+        __m256i e1 = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)(a + i + 32)),
+                                       _mm256_loadu_si256((const __m256i *)(b + i + 32)));
+        __m256i e2 = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)(a + i + 64)),
+                                       _mm256_loadu_si256((const __m256i *)(b + i + 64)));
+        __m256i e3 = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)(a + i + 96)),
+                                       _mm256_loadu_si256((const __m256i *)(b + i + 96)));
+        __m256i all = _mm256_and_si256(_mm256_and_si256(e0, e1), _mm256_and_si256(e2, e3));
+        if ((u32)_mm256_movemask_epi8(all) == 0xFFFFFFFFu) continue;
+
+        d += _mm_popcnt_u32(~(u32)_mm256_movemask_epi8(e0));
+        d += _mm_popcnt_u32(~(u32)_mm256_movemask_epi8(e1));
+        d += _mm_popcnt_u32(~(u32)_mm256_movemask_epi8(e2));
+        d += _mm_popcnt_u32(~(u32)_mm256_movemask_epi8(e3));
+    }
+    for (; i + 32 <= n; i += 32) {
+        __m256i e = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)(a + i)),
+                                      _mm256_loadu_si256((const __m256i *)(b + i)));
+        d += _mm_popcnt_u32(~(u32)_mm256_movemask_epi8(e));
+    }
+    return d + diff_scalar(a + i, b + i, n - i);
+}
+#endif
+
+typedef size_t (*diff_fn_t)(const u8 *, const u8 *, size_t);
+
+static diff_fn_t pick_kernel(const char **name)
+{
+#if defined(__x86_64__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("popcnt")) {
+        *name = "avx2";
+        return diff_avx2;
+    }
+#endif
+    *name = "scalar";
+    return diff_scalar;
+}
+
+/* -------------------------------------------------------------------------- */
+/* Compare                                                                    */
+/* -------------------------------------------------------------------------- */
+struct job_t {
+    const frame_src_t *a, *b;
+    u32       frames;
+    u32       first;                    // mismatches to keep per frame
+    diff_fn_t diff;
+    std::atomic<u32> next{0};
+
+    std::vector<u64> frame_mis;         // by frame
+    std::vector<u32> row_mis;           // frames x h, only for the heatmap
+    std::vector<std::vector<mismatch_t>> recs;  // first mismatches, by frame
+};
+
+static void compare_frame(job_t &j, u32 f)
+{
+    const frame_src_t &a = *j.a, &b = *j.b;
+    size_t rb = frame_src_row_bytes(a);
+    u64 total = 0;
+
+    for (u32 y = 0; y < a.h; y++) {
+        const u8 *ra = frame_src_row(a, f, y), *rbp = frame_src_row(b, f, y);
+        size_t d = j.diff(ra, rbp, rb);
+        if (!d) continue;
+
+        total += d;
+        if (!j.row_mis.empty()) j.row_mis[(size_t)f * a.h + y] = (u32)d;
+        std::vector<mismatch_t> &r = j.recs[f];
+        for (size_t i = 0; i < rb && r.size() < j.first; i++) {
+            if (ra[i] == rbp[i]) continue;
+            r.push_back({ f, (u32)(i / a.bpp), y, (u32)(i % a.bpp), ra[i], rbp[i] });
+        }
+    }
+    j.frame_mis[f] = total;
+}
+
+static void worker(job_t &j)
+{
+    for (u32 f; (f = j.next.fetch_add(1)) < j.frames; )
+        compare_frame(j, f);
+}
+
+static bool write_csv(const job_t &j, const char *path, size_t frame_bytes)
+{
+    FILE *fp = fopen(path, "w");
+    if (!fp) {
+        perror(path);
+        return false;
+    }
+    fprintf(fp, "frame,mismatched_bytes,match_pct\n");
+    for (u32 f = 0; f < j.frames; f++)
+        fprintf(fp, "%u,%llu,%.6f\n", f, (unsigned long long)j.frame_mis[f],
+                100.0 * (double)(frame_bytes - j.frame_mis[f]) / (double)frame_bytes);
+    fclose(fp);
+    return true;
+}
+
+static bool write_heatmap(const job_t &j, const char *path, u32 h, size_t row_bytes)
+{
+    FILE *fp = fopen(path, "wb");
+    if (!fp) {
+        perror(path);
+        return false;
+    }
+    fprintf(fp, "P5\n%u %u\n255\n", h, j.frames);
+    std::vector<u8> line(h);
+    for (u32 f = 0; f < j.frames; f++) {
+        for (u32 y = 0; y < h; y++) {
+            u32 d = j.row_mis[(size_t)f * h + y];
+            line[y] = d ? (u8)(64 + (191ull * d) / row_bytes) : 0;
+        }
+        fwrite(line.data(), 1, h, fp);
+    }
+    fclose(fp);
+    return true;
+}
+
+static void usage(void)
+{
+    fprintf(stderr,
+            "usage: frame_compare A B [--geom WxH[xBPP]] [--first N] [-j N]\n"
+            "                         [--csv FILE] [--heatmap FILE.pgm]\n");
+}
+
+int main(int argc, char **argv)
+{
+    std::vector<std::string> pos;
+    u32 gw = 0, gh = 0, gb = DEFAULT_BPP, first = DEFAULT_FIRST;
+    unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+    const char *csv = nullptr, *heat = nullptr;
+
+    for (int i = 1; i < argc; i++) {
+        std::string a = argv[i];
+        if (a == "--geom" && i + 1 < argc) {
+            if (sscanf(argv[++i], "%ux%ux%u", &gw, &gh, &gb) < 2) {
+                usage();
+                return 2;
+            }
+        }
+        else if (a == "--first" && i + 1 < argc)   first = (u32)atoi(argv[++i]);
+        else if (a == "-j" && i + 1 < argc)        threads = std::max(1, atoi(argv[++i]));
+        else if (a == "--csv" && i + 1 < argc)     csv = argv[++i];
+        else if (a == "--heatmap" && i + 1 < argc) heat = argv[++i];
+        else if (a[0] == '-')                      { usage(); return 2; }
+        else                                       pos.push_back(a);
+    }
+    if (pos.size() != 2) {
+        usage();
+        return 2;
+    }
+
+    /* A raw side takes --geom, else the other side's geometry, else 720p ABGR32 */
+    frame_src_t src[2];
+    int order[2] = { 0, 1 };
+    if (frame_src_is_raw(pos[0]) && !frame_src_is_raw(pos[1])) std::swap(order[0], order[1]);
+    for (int k = 0; k < 2; k++) {
+        int i = order[k];
+        u32 w = gw, h = gh, b = gb;
+        if (!w && k == 1 && !frame_src_is_raw(pos[order[0]])) {
+            w = src[order[0]].w;
+            h = src[order[0]].h;
+            b = src[order[0]].bpp;
+        }
+        if (!w) {
+            w = DEFAULT_W;
+            h = DEFAULT_H;
+        }
+        if (!frame_src_open(src[i], pos[i], w, h, b)) return 2;
+    }
+    frame_src_t &a = src[0], &b = src[1];
+    if (a.w != b.w || a.h != b.h || a.bpp != b.bpp) {
+        fprintf(stderr, "[ERROR] geometry differs: %ux%ux%u vs %ux%ux%u\n",
+                a.w, a.h, a.bpp, b.w, b.h, b.bpp);
+        return 2;
+    }
+
+    job_t j;
+    const char *kname;
+    j.a = &a;
+    j.b = &b;
+    j.frames = std::min(a.frames, b.frames);
+    j.first  = first;
+    j.diff   = pick_kernel(&kname);
+    j.frame_mis.assign(j.frames, 0);
+    j.recs.resize(j.frames);
+    if (heat) j.row_mis.assign((size_t)j.frames * a.h, 0);
+
+    std::vector<std::thread> pool;
+    threads = std::min<unsigned>(threads, std::max(1u, j.frames));
+    for (unsigned t = 0; t < threads; t++) pool.emplace_back(worker, std::ref(j));
+    for (std::thread &t : pool) t.join();
+
+    size_t frame_bytes = frame_src_row_bytes(a) * a.h;
+    u64 total = (u64)frame_bytes * j.frames, mis = 0;
+    u32 bad_frames = 0, worst = 0;
+    for (u32 f = 0; f < j.frames; f++) {
+        mis += j.frame_mis[f];
+        if (j.frame_mis[f]) bad_frames++;
+        if (j.frame_mis[f] > j.frame_mis[worst]) worst = f;
+    }
+
+    printf("[CMP] %u frames %ux%ux%u (%s, %u threads): %llu bytes, %llu mismatched, %.6f%% match\n",
+           j.frames, a.w, a.h, a.bpp, kname, threads, (unsigned long long)total,
+           (unsigned long long)mis, total ? 100.0 * (double)(total - mis) / (double)total : 100.0);
+    if (a.frames != b.frames)
+        printf("[WARN] frame counts differ: %s has %u, %s has %u\n",
+               a.name.c_str(), a.frames, b.name.c_str(), b.frames);
+    if (mis) {
+        printf("[CMP] %u frames with mismatches, worst: frame %u (%llu bytes)\n",
+               bad_frames, worst, (unsigned long long)j.frame_mis[worst]);
+        printf("[CMP] first mismatches:\n");
+        u32 shown = 0;
+        for (u32 f = 0; f < j.frames && shown < first; f++) {
+            for (const mismatch_t &m : j.recs[f]) {
+                if (shown++ == first) break;
+                printf("  frame %u x %u y %u ch %u: A=0x%02X B=0x%02X\n",
+                       m.frame, m.x, m.y, m.ch, m.a, m.b);
+            }
+        }
+    }
+
+    if (csv && !write_csv(j, csv, frame_bytes)) return 2;
+    if (heat && !write_heatmap(j, heat, a.h, frame_src_row_bytes(a))) return 2;
+
+    frame_src_close(a);
+    frame_src_close(b);
+    return (mis || a.frames != b.frames) ? 1 : 0;
+}
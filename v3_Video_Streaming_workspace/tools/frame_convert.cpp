@@ -0,0 +1,393 @@
+/*
+ * frame_convert.cpp - turn frame sequences into hex text, BMP, PNG or .vfc
+ *
+ * The conversions that used to run inside the clients' receive loops
+ * (hex dumps of the first frames) happen here instead, after the run and
+ * spread over threads. The source is anything frame_src.hpp opens.
+ *
+ * usage: frame_convert --to hex|bmp|png DIR  SRC [options]
+ *        frame_convert --to vfc FILE.vfc     SRC [options]
+ *        frame_convert --check FILE.vfc
+ *   --geom WxH[xBPP]   raw .bin geometry (default 1280x720x4)
+ *   --first N          only frames 0..N-1 (hex default: 10, as the clients did)
+ *   -j N               threads (default: all cores)
+ *   --abgr             hex/vfc: write BGR24 frames as ABGR32 with alpha 00, the
+ *                      layout of the hex dumps before the board packed to BGR24
+ *
+ * hex: frame_%06u.txt, every pixel's bytes as hex in memory order (AABBGGRR
+ *      for ABGR32), space separated, one line per row - save_txt_frame_hex_abgr()
+ * bmp/png: frame_%06u.bmp/.png, 24-bit, from BGR24 or ABGR32 sources
+ * vfc: one container with the index and CRCs filled in
+ * --check: recompute every CRC of a .vfc; exit 1 on a mismatch
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <zlib.h>
+#include "frame_src.hpp"
+
+#define DEFAULT_W       1280
+#define DEFAULT_H       720
+#define DEFAULT_BPP     4
+#define HEX_FIRST_N     10
+
+enum conv_t { CONV_HEX, CONV_BMP, CONV_PNG, CONV_VFC, CONV_CHECK };
+
+struct job_t {
+    const frame_src_t *src;
+    conv_t      conv;
+    std::string out;                    // directory, or the .vfc path
+    u32         frames;
+    std::atomic<u32>  next{0};
+    std::atomic<u32>  failed{0};
+    bool        abgr = false;           // BGR24 source widened to ABGR32
+
+    /* CONV_VFC */
+    int         fd = -1;
+    vfc_hdr_t   hdr = {};
+    std::vector<vfc_index_t> index;
+};
+
+static std::string frame_name(const job_t &j, u32 f, const char *ext)
+{
+    char name[32];
+    snprintf(name, sizeof(name), "/frame_%06u.%s", f, ext);
+    return j.out + name;
+}
+
+static bool write_file(const std::string &path, const void *p, size_t len)
+{
+    FILE *fp = fopen(path.c_str(), "wb");
+    if (!fp) {
+        fprintf(stderr, "[ERROR] %s: %s\n", path.c_str(), strerror(errno));
+        return false;
+    }
+    bool ok = fwrite(p, 1, len, fp) == len;
+    ok = (fclose(fp) == 0) && ok;
+    if (!ok) fprintf(stderr, "[ERROR] %s: write failed\n", path.c_str());
+    return ok;
+}
+
+static void put_le32(u8 *p, u32 v) { p[0] = (u8)v; p[1] = (u8)(v >> 8); p[2] = (u8)(v >> 16); p[3] = (u8)(v >> 24); }
+static void put_le16(u8 *p, u16 v) { p[0] = (u8)v; p[1] = (u8)(v >> 8); }
+static void put_be32(u8 *p, u32 v) { p[0] = (u8)(v >> 24); p[1] = (u8)(v >> 16); p[2] = (u8)(v >> 8); p[3] = (u8)v; }
+
+/* -------------------------------------------------------------------------- */
+/* Writers                                                                    */
+/* -------------------------------------------------------------------------- */
+static bool conv_hex(const job_t &j, u32 f, std::vector<u8> &buf)
+{
+    static const char digits[] = "0123456789ABCDEF";
+    const frame_src_t &s = *j.src;
+    size_t line = (size_t)s.w * ((s.bpp + j.abgr) * 2 + 1);
+
+    buf.resize(line * s.h);
+    u8 *o = buf.data();
+    for (u32 y = 0; y < s.h; y++) {
+        const u8 *px = frame_src_row(s, f, y);
+        for (u32 x = 0; x < s.w; x++) {
+            if (j.abgr) {
+                *o++ = '0';
+                *o++ = '0';
+            }
+            for (u32 c = 0; c < s.bpp; c++, px++) {
+                *o++ = (u8)digits[*px >> 4];
+                *o++ = (u8)digits[*px & 15];
+            }
+            *o++ = (x + 1 < s.w) ? ' ' : '\n';
+        }
+    }
+    return write_file(frame_name(j, f, "txt"), buf.data(), buf.size());
+}
+
+static bool conv_bmp(const job_t &j, u32 f, std::vector<u8> &buf)
+{
+    const frame_src_t &s = *j.src;
+    size_t stride = ((size_t)s.w * 3 + 3) & ~(size_t)3;
+    size_t img = stride * s.h;
+
+    buf.assign(54 + img, 0);
+    u8 *h = buf.data();
+    h[0] = 'B';
+    h[1] = 'M';
+    put_le32(h + 2, (u32)buf.size());
+    put_le32(h + 10, 54);
+    put_le32(h + 14, 40);
+    put_le32(h + 18, s.w);
+    put_le32(h + 22, s.h);              // bottom-up
+    put_le16(h + 26, 1);
+    put_le16(h + 28, 24);
+    put_le32(h + 34, (u32)img);
+
+    for (u32 y = 0; y < s.h; y++) {
+        const u8 *px = frame_src_row(s, f, y) + s.bgr_at;
+        u8 *o = h + 54 + (size_t)(s.h - 1 - y) * stride;
+        for (u32 x = 0; x < s.w; x++, px += s.bpp, o += 3) {
+            o[0] = px[0];
+            o[1] = px[1];
+            o[2] = px[2];
+        }
+    }
+    return write_file(frame_name(j, f, "bmp"), buf.data(), buf.size());
+}
+
+static void png_chunk(std::vector<u8> &out, const char *type, const u8 *data, u32 len)
+{
+    u8 hdr[8];
+    put_be32(hdr, len);
+    memcpy(hdr + 4, type, 4);
+    out.insert(out.end(), hdr, hdr + 8);
+    out.insert(out.end(), data, data + len);
+
+    uLong crc = crc32(0L, (const Bytef *)type, 4);
+    if (len) crc = crc32(crc, data, len);       // crc32(.., NULL, ..) restarts
+    put_be32(hdr, (u32)crc);
+    out.insert(out.end(), hdr, hdr + 4);
+}
+
+static bool conv_png(const job_t &j, u32 f, std::vector<u8> &buf)
+{
+    static const u8 sig[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+    const frame_src_t &s = *j.src;
+    size_t row = 1 + (size_t)s.w * 3;
+
+    /* Filter type 0 rows of RGB */
+    buf.resize(row * s.h);
+    for (u32 y = 0; y < s.h; y++) {
+        const u8 *px = frame_src_row(s, f, y) + s.bgr_at;
+        u8 *o = buf.data() + (size_t)y * row;
+        *o++ = 0;
+        for (u32 x = 0; x < s.w; x++, px += s.bpp, o += 3) {
+            o[0] = px[2];
+            o[1] = px[1];
+            o[2] = px[0];
+        }
+    }
+    uLongf zlen = compressBound((uLong)buf.size());
+    std::vector<u8> z(zlen);
+    if (compress2(z.data(), &zlen, buf.data(), (uLong)buf.size(), Z_BEST_SPEED) != Z_OK) {
+        fprintf(stderr, "[ERROR] frame %u: deflate failed\n", f);
+        return false;
+    }
+
+    u8 ihdr[13];
+    put_be32(ihdr, s.w);
+    put_be32(ihdr + 4, s.h);
+    ihdr[8]  = 8;                       // bit depth
+    ihdr[9]  = 2;                       // RGB
+    ihdr[10] = ihdr[11] = ihdr[12] = 0;
+
+    std::vector<u8> png(sig, sig + 8);
+    png_chunk(png, "IHDR", ihdr, sizeof(ihdr));
+    png_chunk(png, "IDAT", z.data(), (u32)zlen);
+    png_chunk(png, "IEND", nullptr, 0);
+    return write_file(frame_name(j, f, "png"), png.data(), png.size());
+}
+
+/* Frames land at their final offsets, so workers can write in any order */
+static bool conv_vfc(job_t &j, u32 f, std::vector<u8> &buf)
+{
+    const frame_src_t &s = *j.src;
+    size_t rb = j.abgr ? (size_t)s.w * 4 : frame_src_row_bytes(s);
+
+    buf.resize(rb * s.h);
+    for (u32 y = 0; y < s.h; y++) {
+        const u8 *px = frame_src_row(s, f, y);
+        u8 *o = buf.data() + (size_t)y * rb;
+        if (!j.abgr) {
+            memcpy(o, px, rb);
+            continue;
+        }
+        for (u32 x = 0; x < s.w; x++, px += 3, o += 4) {
+            o[0] = 0;
+            o[1] = px[0];
+            o[2] = px[1];
+            o[3] = px[2];
+        }
+    }
+
+    vfc_index_t &e = j.index[f];
+    e.offset = j.hdr.data_off + (u64)f * j.hdr.frame_stride;
+    e.length = (u32)buf.size();
+    e.crc32  = (u32)crc32(0L, buf.data(), (uInt)buf.size());
+    if (pwrite(j.fd, buf.data(), buf.size(), (off_t)e.offset) != (ssize_t)buf.size()) {
+        fprintf(stderr, "[ERROR] %s: write failed: %s\n", j.out.c_str(), strerror(errno));
+        return false;
+    }
+    return true;
+}
+
+static bool check_vfc(const job_t &j, u32 f)
+{
+    const frame_src_t &s = *j.src;
+    const vfc_index_t &e = s.index[f];
+    u32 crc = (u32)crc32(0L, frame_src_frame(s, f), e.length);
+
+    if (crc != e.crc32) {
+        printf("[ERROR] frame %u: CRC %08X, index says %08X\n", f, crc, e.crc32);
+        return false;
+    }
+    return true;
+}
+
+static void worker(job_t &j)
+{
+    std::vector<u8> buf;
+
+    for (u32 f; (f = j.next.fetch_add(1)) < j.frames; ) {
+        bool ok = false;
+        switch (j.conv) {
+        case CONV_HEX:   ok = conv_hex(j, f, buf); break;
+        case CONV_BMP:   ok = conv_bmp(j, f, buf); break;
+        case CONV_PNG:   ok = conv_png(j, f, buf); break;
+        case CONV_VFC:   ok = conv_vfc(j, f, buf); break;
+        case CONV_CHECK: ok = check_vfc(j, f); break;
+        }
+        if (!ok) j.failed++;
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+/* Main                                                                       */
+/* -------------------------------------------------------------------------- */
+static bool vfc_begin(job_t &j)
+{
+    const frame_src_t &s = *j.src;
+
+    if (s.w > 0xFFFF || s.h > 0xFFFF || s.bpp > 0xFF) {
+        fprintf(stderr, "[ERROR] geometry too large for .vfc\n");
+        return false;
+    }
+    j.fd = open(j.out.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (j.fd < 0) {
+        fprintf(stderr, "[ERROR] %s: %s\n", j.out.c_str(), strerror(errno));
+        return false;
+    }
+    if (j.abgr)
+        j.hdr = vfc_make_hdr((u16)s.w, (u16)s.h, PIXFMT_ABGR32, 4, j.frames);
+    else
+        j.hdr = vfc_make_hdr((u16)s.w, (u16)s.h, s.pixfmt, (u8)s.bpp, j.frames);
+    j.index.assign(j.frames, vfc_index_t());
+    return true;
+}
+
+static bool vfc_end(job_t &j)
+{
+    std::vector<u8> meta(j.hdr.data_off, 0);
+    bool ok = true;
+
+    j.hdr.frames = j.frames;
+    vfc_build_meta(j.hdr, j.index, meta.data());
+    if (pwrite(j.fd, meta.data(), meta.size(), 0) != (ssize_t)meta.size()) ok = false;
+    /* The last frame's padding up to the stride */
+    if (ftruncate(j.fd, (off_t)(j.hdr.data_off + (u64)j.frames * j.hdr.frame_stride)) != 0) ok = false;
+    if (close(j.fd) != 0) ok = false;
+    if (!ok) fprintf(stderr, "[ERROR] %s: %s\n", j.out.c_str(), strerror(errno));
+    return ok;
+}
+
+static void usage(void)
+{
+    fprintf(stderr,
+            "usage: frame_convert --to hex|bmp|png DIR  SRC [--geom WxH[xBPP]] [--first N] [-j N] [--abgr]\n"
+            "       frame_convert --to vfc FILE.vfc     SRC [--geom WxH[xBPP]] [--first N] [-j N] [--abgr]\n"
+            "       frame_convert --check FILE.vfc [-j N]\n");
+}
+
+int main(int argc, char **argv)
+{
+    std::vector<std::string> pos;
+    std::string to, out;
+    u32 gw = DEFAULT_W, gh = DEFAULT_H, gb = DEFAULT_BPP, first = 0;
+    unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+    bool check = false, abgr = false;
+
+    for (int i = 1; i < argc; i++) {
+        std::string a = argv[i];
+        if (a == "--to" && i + 2 < argc) {
+            to  = argv[++i];
+            out = argv[++i];
+        }
+        else if (a == "--check")                 check = true;
+        else if (a == "--abgr")                  abgr = true;
+        else if (a == "--geom" && i + 1 < argc) {
+            if (sscanf(argv[++i], "%ux%ux%u", &gw, &gh, &gb) < 2) {
+                usage();
+                return 2;
+            }
+        }
+        else if (a == "--first" && i + 1 < argc) first = (u32)atoi(argv[++i]);
+        else if (a == "-j" && i + 1 < argc)      threads = std::max(1, atoi(argv[++i]));
+        else if (a[0] == '-')                    { usage(); return 2; }
+        else                                     pos.push_back(a);
+    }
+    if (pos.size() != 1 || check == !to.empty()) {
+        usage();
+        return 2;
+    }
+
+    job_t j;
+    if (check)             j.conv = CONV_CHECK;
+    else if (to == "hex")  j.conv = CONV_HEX;
+    else if (to == "bmp")  j.conv = CONV_BMP;
+    else if (to == "png")  j.conv = CONV_PNG;
+    else if (to == "vfc")  j.conv = CONV_VFC;
+    else {
+        usage();
+        return 2;
+    }
+    if (j.conv == CONV_HEX && !first) first = HEX_FIRST_N;
+
+    frame_src_t src;
+    if (!frame_src_open(src, pos[0], gw, gh, gb)) return 2;
+    if (check && !src.vfc) {
+        fprintf(stderr, "[ERROR] %s: --check needs a .vfc\n", pos[0].c_str());
+        return 2;
+    }
+    if ((j.conv == CONV_BMP || j.conv == CONV_PNG) && src.pixfmt != PIXFMT_BGR24 &&
+        src.pixfmt != PIXFMT_ABGR32 && !(src.bmp && src.bpp == 4)) {
+        fprintf(stderr, "[ERROR] %s: BMP/PNG need BGR24 or ABGR32 frames\n", pos[0].c_str());
+        return 2;
+    }
+
+    if (abgr && (src.pixfmt != PIXFMT_BGR24 || (j.conv != CONV_HEX && j.conv != CONV_VFC))) {
+        fprintf(stderr, "[ERROR] --abgr widens BGR24 frames, for hex or vfc output\n");
+        return 2;
+    }
+
+    j.abgr   = abgr;
+    j.src    = &src;
+    j.out    = out;
+    j.frames = first ? std::min(first, src.frames) : src.frames;
+    if (j.conv == CONV_HEX || j.conv == CONV_BMP || j.conv == CONV_PNG) {
+        if (mkdir(out.c_str(), 0755) != 0 && errno != EEXIST) {
+            fprintf(stderr, "[ERROR] %s: %s\n", out.c_str(), strerror(errno));
+            return 2;
+        }
+    }
+    if (j.conv == CONV_VFC && !vfc_begin(j)) return 2;
+
+    std::vector<std::thread> pool;
+    threads = std::min<unsigned>(threads, std::max(1u, j.frames));
+    for (unsigned t = 0; t < threads; t++) pool.emplace_back(worker, std::ref(j));
+    for (std::thread &t : pool) t.join();
+
+    if (j.conv == CONV_VFC && !vfc_end(j)) j.failed++;
+    frame_src_close(src);
+
+    const char *what = check ? "checked" : "converted";
+    printf("[CONV] %u frames %ux%ux%u %s (%u threads)%s%s, %u failed\n",
+           j.frames, src.w, src.h, src.bpp, what, threads,
+           check ? "" : " -> ", check ? "" : out.c_str(), j.failed.load());
+    return j.failed ? 1 : 0;
+}
@@ -0,0 +1,73 @@
+/*
+ * frame_file.cpp - .vfc header and index helpers
+ */
+
+#include <cstdio>
+#include <cstring>
+#include "frame_file.hpp"
+
+vfc_hdr_t vfc_make_hdr(u16 w, u16 h, u8 pixfmt, u8 bpp, u32 capacity)
+{
+    vfc_hdr_t hd;
+
+    memset(&hd, 0, sizeof(hd));
+    hd.magic        = VFC_MAGIC;
+    hd.version      = VFC_VERSION;
+    hd.hdr_bytes    = sizeof(vfc_hdr_t);
+    hd.width        = w;
+    hd.height       = h;
+    hd.pixfmt       = pixfmt;
+    hd.bpp          = bpp;
+    hd.flags        = VFC_FLAG_CRC;
+    hd.frame_bytes  = (u32)w * h * bpp;
+    hd.capacity     = capacity;
+    hd.frame_stride = vfc_align(hd.frame_bytes);
+    hd.index_off    = VFC_ALIGN;
+    hd.data_off     = hd.index_off + vfc_align((u64)capacity * sizeof(vfc_index_t));
+    return hd;
+}
+
+void vfc_build_meta(const vfc_hdr_t &h, const std::vector<vfc_index_t> &index, u8 *buf)
+{
+    memcpy(buf, &h, sizeof(h));
+    if (!index.empty())
+        memcpy(buf + h.index_off, index.data(), index.size() * sizeof(vfc_index_t));
+}
+
+bool vfc_probe(const u8 *p, size_t len)
+{
+    u32 magic;
+
+    if (len < sizeof(vfc_hdr_t)) return false;
+    memcpy(&magic, p, sizeof(magic));
+    return magic == VFC_MAGIC;
+}
+
+bool vfc_parse(const std::string &name, const u8 *p, size_t len,
+               vfc_hdr_t &hdr, const vfc_index_t *&index)
+{
+    if (!vfc_probe(p, len)) {
+        fprintf(stderr, "[ERROR] %s: not a .vfc file\n", name.c_str());
+        return false;
+    }
+    memcpy(&hdr, p, sizeof(hdr));
+    if (hdr.version != VFC_VERSION || hdr.hdr_bytes < sizeof(vfc_hdr_t)) {
+        fprintf(stderr, "[ERROR] %s: unsupported .vfc version %u\n", name.c_str(), hdr.version);
+        return false;
+    }
+    if (hdr.frames > hdr.capacity ||
+        hdr.index_off + (u64)hdr.capacity * sizeof(vfc_index_t) > len ||
+        hdr.frame_bytes != (u32)hdr.width * hdr.height * hdr.bpp) {
+        fprintf(stderr, "[ERROR] %s: corrupt .vfc header\n", name.c_str());
+        return false;
+    }
+
+    index = (const vfc_index_t *)(p + hdr.index_off);
+    for (u32 i = 0; i < hdr.frames; i++) {
+        if (index[i].length != hdr.frame_bytes || index[i].offset + index[i].length > len) {
+            fprintf(stderr, "[ERROR] %s: frame %u lies outside the file\n", name.c_str(), i);
+            return false;
+        }
+    }
+    return true;
+}
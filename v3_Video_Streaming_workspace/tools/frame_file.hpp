@@ -0,0 +1,81 @@
+/*
+ * frame_file.hpp - .vfc, an indexed frame container for the host tools
+ *
+ * Replaces the headerless .bin streams: the file says what it holds, every
+ * frame has an index entry with its offset and CRC-32, and every frame
+ * starts on a 4 KB boundary so the file can be written O_DIRECT and mapped
+ * for reading without copies.
+ *
+ *   0          vfc_hdr_t, rest of the page zero
+ *   index_off  capacity x vfc_index_t, padded to a page
+ *   data_off   frame 0, frame 1, ... each frame_stride bytes apart
+ *
+ * All fields little-endian. `frames` is written last (by the writer's
+ * close), so a file cut short by a crash reads as empty rather than wrong.
+ * scripts/frame_file.py reads and writes the same layout.
+ */
+
+#ifndef FRAME_FILE_HPP
+#define FRAME_FILE_HPP
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+extern "C" {
+#include "frame_proto.h"
+}
+
+#define VFC_MAGIC       0x31434656u     // "VFC1"
+#define VFC_VERSION     1
+#define VFC_ALIGN       4096
+
+#define VFC_FLAG_CRC    0x0001          // index crc32 fields are valid
+
+typedef struct __attribute__((packed)) {
+    u32 magic;
+    u16 version;
+    u16 hdr_bytes;          // sizeof(vfc_hdr_t)
+    u16 width;
+    u16 height;
+    u8  pixfmt;             // PIXFMT_* from frame_proto.h
+    u8  bpp;
+    u16 flags;              // VFC_FLAG_*
+    u32 frame_bytes;        // payload per frame
+    u32 capacity;           // index entries reserved
+    u32 frames;             // valid frames
+    u32 reserved;
+    u64 frame_stride;       // frame_bytes rounded up to VFC_ALIGN
+    u64 index_off;
+    u64 data_off;
+} vfc_hdr_t;
+
+typedef struct __attribute__((packed)) {
+    u64 offset;             // from the start of the file
+    u32 length;
+    u32 crc32;
+} vfc_index_t;
+
+static_assert(sizeof(vfc_hdr_t) == 56, "vfc_hdr_t layout");
+static_assert(sizeof(vfc_index_t) == 16, "vfc_index_t layout");
+
+static inline u64 vfc_align(u64 n) { return (n + VFC_ALIGN - 1) & ~(u64)(VFC_ALIGN - 1); }
+
+/* Header for an empty container of `capacity` frames */
+vfc_hdr_t vfc_make_hdr(u16 w, u16 h, u8 pixfmt, u8 bpp, u32 capacity);
+
+/*
+ * Header page plus index, data_off bytes, into buf (data_off bytes, zeroed
+ * by the caller). Written at offset 0 when a container is opened and again,
+ * with the real frame count, when it is closed.
+ */
+void vfc_build_meta(const vfc_hdr_t &h, const std::vector<vfc_index_t> &index, u8 *buf);
+
+/* True if the first bytes of a file are a supported .vfc header */
+bool vfc_probe(const u8 *p, size_t len);
+
+/* Checks a mapped container; fills hdr and points index into the mapping */
+bool vfc_parse(const std::string &name, const u8 *p, size_t len,
+               vfc_hdr_t &hdr, const vfc_index_t *&index);
+
+#endif /* FRAME_FILE_HPP */
@@ -0,0 +1,259 @@
+/*
+ * frame_sink.cpp - bounded asynchronous disk sink
+ */
+
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <zlib.h>
+#include "frame_sink.hpp"
+
+static u64 now_ns(void)
+{
+    return (u64)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+std::string sink_path(const frame_sink_t &s, u64 frame)
+{
+    char name[64];
+    const char *ext = s.o.container ? "vfc" : "bin";
+
+    if (s.o.rotate_every == 0)
+        return s.o.dir + "/" + s.o.base + "." + ext;
+    snprintf(name, sizeof(name), "_%06llu.%s",
+             (unsigned long long)(frame - frame % s.o.rotate_every), ext);
+    return s.o.dir + "/" + s.o.base + name;
+}
+
+static bool sink_open_file(frame_sink_t &s, u64 frame)
+{
+    std::string path = sink_path(s, frame);
+    int flags = O_WRONLY | O_CREAT | O_TRUNC;
+
+    s.st.direct = false;
+    s.fd = -1;
+    if (s.o.direct && s.wbytes % SINK_ALIGN == 0) {
+        s.fd = open(path.c_str(), flags | O_DIRECT, 0644);
+        s.st.direct = (s.fd >= 0);
+    }
+    if (s.fd < 0) s.fd = open(path.c_str(), flags, 0644);   // tmpfs etc. refuse O_DIRECT
+    if (s.fd < 0) {
+        fprintf(stderr, "[ERROR] sink: %s: %s\n", path.c_str(), strerror(errno));
+        return false;
+    }
+    s.file_off = 0;
+    s.st.files++;
+
+    if (s.o.container) {
+        /* Header and an empty index now; both are rewritten on close */
+        s.index.clear();
+        s.hdr.frames = 0;
+        memset(s.meta, 0, s.hdr.data_off);
+        vfc_build_meta(s.hdr, s.index, s.meta);
+        if (pwrite(s.fd, s.meta, s.hdr.data_off, 0) != (ssize_t)s.hdr.data_off) {
+            fprintf(stderr, "[ERROR] sink: %s: header write failed\n", path.c_str());
+            return false;
+        }
+        s.file_off = s.hdr.data_off;
+    }
+    return true;
+}
+
+static bool sink_write_frame(frame_sink_t &s, const u8 *buf)
+{
+    const u8 *p = buf;
+    size_t len = s.wbytes;
+    u64 off = s.file_off;
+
+    if (s.o.container) {
+        if (s.index.size() >= s.hdr.capacity) {
+            fprintf(stderr, "[ERROR] sink: container full (%u frames)\n", s.hdr.capacity);
+            return false;
+        }
+        vfc_index_t e;
+        e.offset = off;
+        e.length = s.o.frame_bytes;
+        e.crc32  = (u32)crc32(0L, buf, s.o.frame_bytes);
+        s.index.push_back(e);
+    }
+
+    while (len > 0) {
+        ssize_t n = pwrite(s.fd, p, len, (off_t)off);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) {
+            fprintf(stderr, "[ERROR] sink: write failed: %s\n", n < 0 ? strerror(errno) : "short");
+            return false;
+        }
+        p += n;
+        off += (u64)n;
+        len -= (size_t)n;
+    }
+
+    if (!s.st.direct) {
+        /* Start writeback of this frame, finish the previous one and drop it */
+        sync_file_range(s.fd, (off_t)s.file_off, s.wbytes, SYNC_FILE_RANGE_WRITE);
+        if (s.file_off >= s.wbytes) {
+            off_t prev = (off_t)(s.file_off - s.wbytes);
+            sync_file_range(s.fd, prev, s.wbytes,
+                            SYNC_FILE_RANGE_WAIT_BEFORE | SYNC_FILE_RANGE_WRITE |
+                            SYNC_FILE_RANGE_WAIT_AFTER);
+            posix_fadvise(s.fd, prev, s.wbytes, POSIX_FADV_DONTNEED);
+        }
+    }
+    s.file_off = off;
+    return true;
+}
+
+static bool sink_close_file(frame_sink_t &s)
+{
+    bool ok = true;
+
+    if (s.fd < 0) return true;
+    if (s.o.container) {
+        s.hdr.frames = (u32)s.index.size();
+        memset(s.meta, 0, s.hdr.data_off);
+        vfc_build_meta(s.hdr, s.index, s.meta);
+        if (pwrite(s.fd, s.meta, s.hdr.data_off, 0) != (ssize_t)s.hdr.data_off) {
+            fprintf(stderr, "[ERROR] sink: index write failed: %s\n", strerror(errno));
+            ok = false;
+        }
+    }
+    if (!s.st.direct) {
+        fdatasync(s.fd);
+        posix_fadvise(s.fd, 0, 0, POSIX_FADV_DONTNEED);
+    }
+    close(s.fd);
+    s.fd = -1;
+    return ok;
+}
+
+static void sink_writer(frame_sink_t &s)
+{
+    for (;;) {
+        u64 idx;
+        {
+            std::unique_lock<std::mutex> g(s.lock);
+            s.cv.wait(g, [&] { return s.written != s.committed || s.closing || s.failed; });
+            if (s.failed || s.written == s.committed) break;    // closing and drained
+            idx = s.written;
+        }
+        const u8 *buf = s.bufs[idx % s.bufs.size()];
+
+        u64 t0 = now_ns();
+        bool ok = true;
+        if (!s.o.discard) {
+            if (s.o.rotate_every && idx % s.o.rotate_every == 0 && idx) {
+                ok = sink_close_file(s) && sink_open_file(s, idx);
+            }
+            ok = ok && sink_write_frame(s, buf);
+        }
+        u64 t1 = now_ns();
+        if (ok && s.o.on_frame) s.o.on_frame(buf, (u32)idx);
+
+        std::lock_guard<std::mutex> g(s.lock);
+        if (!ok) s.failed = true;
+        s.written++;
+        s.st.frames++;
+        s.st.bytes += s.o.frame_bytes;
+        s.st.write_ns += t1 - t0;
+        s.cv.notify_all();
+        if (!ok) break;
+    }
+    if (!sink_close_file(s)) {
+        std::lock_guard<std::mutex> g(s.lock);
+        s.failed = true;
+    }
+}
+
+bool sink_open(frame_sink_t &s, const sink_opts_t &o)
+{
+    size_t alloc = ((size_t)o.frame_bytes + SINK_ALIGN - 1) & ~(size_t)(SINK_ALIGN - 1);
+
+    s.o = o;
+    if (s.o.nbufs < 2) s.o.nbufs = 2;
+    s.wbytes = s.o.frame_bytes;
+    if (s.o.container) {
+        u32 cap = s.o.rotate_every ? s.o.rotate_every : s.o.capacity;
+        s.hdr = vfc_make_hdr(s.o.width, s.o.height, s.o.pixfmt, s.o.bpp, cap);
+        if (s.hdr.frame_bytes != s.o.frame_bytes) {
+            fprintf(stderr, "[ERROR] sink: geometry does not match the frame size\n");
+            return false;
+        }
+        s.wbytes = (u32)s.hdr.frame_stride;
+        s.meta = (u8 *)aligned_alloc(SINK_ALIGN, s.hdr.data_off);
+        if (!s.meta) {
+            fprintf(stderr, "[ERROR] sink: out of memory (index)\n");
+            return false;
+        }
+    }
+    for (u32 i = 0; i < s.o.nbufs; i++) {
+        u8 *b = (u8 *)aligned_alloc(SINK_ALIGN, alloc);
+        if (!b) {
+            fprintf(stderr, "[ERROR] sink: out of memory (%u buffers)\n", s.o.nbufs);
+            return false;
+        }
+        memset(b + s.o.frame_bytes, 0, alloc - s.o.frame_bytes);    // container padding
+        s.bufs.push_back(b);
+    }
+    if (!s.o.discard && !sink_open_file(s, 0)) return false;
+    s.writer = std::thread(sink_writer, std::ref(s));
+    return true;
+}
+
+u8 *sink_acquire(frame_sink_t &s)
+{
+    std::unique_lock<std::mutex> g(s.lock);
+    size_t n = s.bufs.size();
+
+    if (s.acquired - s.written >= n) {
+        u64 t0 = now_ns();
+        s.cv.wait(g, [&] { return s.acquired - s.written < n || s.failed || s.closing; });
+        s.st.stalls++;
+        s.st.stall_ns += now_ns() - t0;
+    }
+    if (s.failed || s.closing) return nullptr;
+    return s.bufs[s.acquired++ % n];
+}
+
+void sink_commit(frame_sink_t &s)
+{
+    std::lock_guard<std::mutex> g(s.lock);
+    s.committed++;
+    u32 q = (u32)(s.committed - s.written);
+    if (q > s.st.queued_max) s.st.queued_max = q;
+    s.cv.notify_all();
+}
+
+void sink_abort(frame_sink_t &s)
+{
+    std::lock_guard<std::mutex> g(s.lock);
+    s.closing = true;
+    s.cv.notify_all();
+}
+
+bool sink_close(frame_sink_t &s)
+{
+    {
+        std::lock_guard<std::mutex> g(s.lock);
+        s.closing = true;
+        s.cv.notify_all();
+    }
+    if (s.writer.joinable()) s.writer.join();
+    for (u8 *b : s.bufs) free(b);
+    s.bufs.clear();
+    free(s.meta);
+    s.meta = nullptr;
+    return !s.failed;
+}
+
+void sink_get_stats(frame_sink_t &s, sink_stats_t &st)
+{
+    std::lock_guard<std::mutex> g(s.lock);
+    st = s.st;
+    st.queued = (u32)(s.committed - s.written);
+}
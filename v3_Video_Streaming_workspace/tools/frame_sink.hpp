@@ -0,0 +1,87 @@
+/*
+ * frame_sink.hpp - bounded asynchronous disk sink for received frames
+ *
+ * The receiver takes a free buffer (sink_acquire), fills it from the socket
+ * and hands it over (sink_commit). A writer thread puts committed buffers on
+ * disk in order and recycles them. Memory stays at nbufs frames, and the
+ * receiver only waits when all of them are queued for the disk.
+ *
+ * Frames go into .vfc containers (frame_file.hpp) by default: the writer
+ * thread also computes each frame's CRC for the index, and the page-aligned
+ * layout lets every file be opened O_DIRECT where the filesystem allows it.
+ * Raw headerless .bin output is O_DIRECT only when the frame size is a
+ * multiple of 4 KB. Otherwise each frame is written buffered, then pushed
+ * out with sync_file_range() and dropped from the page cache, so dirty
+ * pages never pile up behind the stream.
+ */
+
+#ifndef FRAME_SINK_HPP
+#define FRAME_SINK_HPP
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "frame_file.hpp"
+
+#define SINK_ALIGN      4096    // O_DIRECT buffer, length and offset alignment
+
+struct sink_opts_t {
+    std::string dir;
+    std::string base = "output_frames";     // <base>.vfc, or <base>_<first>.vfc
+    u32  frame_bytes  = 0;
+    bool container    = true;   // .vfc; false writes a headerless .bin
+    u16  width = 0, height = 0; // container header
+    u8   pixfmt = 0, bpp = 0;
+    u32  capacity     = 0;      // frames per container when not rotating
+    u32  nbufs        = 16;
+    u32  rotate_every = 0;      // frames per file, 0 = one file
+    bool direct       = true;   // try O_DIRECT
+    bool discard      = false;  // no files, frames only go to on_frame
+    std::function<void(const u8 *, u32)> on_frame;     // writer thread, after the write
+};
+
+struct sink_stats_t {
+    u64  frames;
+    u64  bytes;
+    u32  files;
+    u32  queued;                // committed, not yet written
+    u32  queued_max;
+    u32  stalls;                // sink_acquire() calls that had to wait
+    u64  stall_ns;
+    u64  write_ns;              // time inside write()/sync
+    bool direct;                // the current file is O_DIRECT
+};
+
+struct frame_sink_t {
+    sink_opts_t          o;
+    std::vector<u8 *>    bufs;
+    std::thread          writer;
+    std::mutex           lock;
+    std::condition_variable cv;
+    u64                  acquired = 0;  // buffers handed to the receiver
+    u64                  committed = 0;
+    u64                  written = 0;
+    bool                 closing = false;
+    bool                 failed = false;
+
+    int                  fd = -1;
+    u64                  file_off = 0;
+    u32                  wbytes = 0;    // bytes written per frame (container: stride)
+    vfc_hdr_t            hdr = {};      // current container
+    std::vector<vfc_index_t> index;
+    u8                  *meta = nullptr;    // header + index page(s), aligned
+    sink_stats_t         st = {};
+};
+
+bool sink_open(frame_sink_t &s, const sink_opts_t &o);
+u8  *sink_acquire(frame_sink_t &s);     // next buffer; nullptr after a write error
+void sink_commit(frame_sink_t &s);      // the buffer from the last acquire
+void sink_abort(frame_sink_t &s);       // wake a waiting sink_acquire()
+bool sink_close(frame_sink_t &s);       // write what is queued; false on error
+void sink_get_stats(frame_sink_t &s, sink_stats_t &st);
+std::string sink_path(const frame_sink_t &s, u64 frame);   // file frame lands in
+
+#endif /* FRAME_SINK_HPP */
@@ -0,0 +1,205 @@
+/*
+ * frame_src.cpp - mmap'd .bin / .bmp frame sequences
+ */
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "frame_src.hpp"
+
+static bool map_file(const std::string &path, frame_map_t &m)
+{
+    struct stat st;
+    int fd = open(path.c_str(), O_RDONLY);
+
+    if (fd < 0 || fstat(fd, &st) != 0) {
+        fprintf(stderr, "[ERROR] %s: %s\n", path.c_str(), strerror(errno));
+        if (fd >= 0) close(fd);
+        return false;
+    }
+    m.len = (size_t)st.st_size;
+    m.p   = nullptr;
+    if (m.len) {
+        void *p = mmap(nullptr, m.len, PROT_READ, MAP_SHARED, fd, 0);
+        if (p == MAP_FAILED) {
+            fprintf(stderr, "[ERROR] mmap %s: %s\n", path.c_str(), strerror(errno));
+            close(fd);
+            return false;
+        }
+        madvise(p, m.len, MADV_SEQUENTIAL);
+        m.p = (const u8 *)p;
+    }
+    close(fd);      // the mapping stays valid
+    return true;
+}
+
+static u32 le32(const u8 *p) { return p[0] | p[1] << 8 | p[2] << 16 | (u32)p[3] << 24; }
+static u16 le16(const u8 *p) { return (u16)(p[0] | p[1] << 8); }
+
+/* Geometry of one BMP; the first file sets it, the others must agree */
+static bool parse_bmp(frame_src_t &s, const std::string &path, const frame_map_t &m, bool first)
+{
+    if (m.len < 54 || m.p[0] != 'B' || m.p[1] != 'M') {
+        fprintf(stderr, "[ERROR] %s: not a BMP\n", path.c_str());
+        return false;
+    }
+    u32 off   = le32(m.p + 10);
+    s32 w     = (s32)le32(m.p + 18);
+    s32 h     = (s32)le32(m.p + 22);
+    u16 bits  = le16(m.p + 28);
+    u32 comp  = le32(m.p + 30);
+    if ((bits != 24 && bits != 32) || comp != 0 || w <= 0 || h == 0) {
+        fprintf(stderr, "[ERROR] %s: only uncompressed 24/32-bit BMPs\n", path.c_str());
+        return false;
+    }
+
+    u32 uh = (u32)(h < 0 ? -h : h);
+    size_t stride = (((size_t)w * bits + 31) / 32) * 4;
+    if (first) {
+        s.w = (u32)w;
+        s.h = uh;
+        s.bpp = bits / 8;
+        s.pixfmt = (bits == 24) ? PIXFMT_BGR24 : PIXFMT_RAW;    // 32-bit BMPs are BGRA
+        s.bgr_at = 0;
+        s.data_off = off;
+        s.stride = stride;
+        s.bottom_up = h > 0;
+    } else if ((u32)w != s.w || uh != s.h || bits / 8 != s.bpp ||
+               off != s.data_off || (h > 0) != s.bottom_up) {
+        fprintf(stderr, "[ERROR] %s: geometry differs from the first BMP\n", path.c_str());
+        return false;
+    }
+    if (m.len < off + stride * uh) {
+        fprintf(stderr, "[ERROR] %s: truncated\n", path.c_str());
+        return false;
+    }
+    return true;
+}
+
+static bool ends_with(const std::string &s, const char *suffix)
+{
+    size_t n = strlen(suffix);
+    if (s.size() < n) return false;
+    std::string tail = s.substr(s.size() - n);
+    std::transform(tail.begin(), tail.end(), tail.begin(), ::tolower);
+    return tail == suffix;
+}
+
+/* Sorted .bmp files of dir whose name starts with prefix */
+static bool list_bmps(const std::string &dir, const std::string &prefix,
+                      std::vector<std::string> &files)
+{
+    DIR *d = opendir(dir.c_str());
+    if (!d) {
+        fprintf(stderr, "[ERROR] %s: %s\n", dir.c_str(), strerror(errno));
+        return false;
+    }
+    while (struct dirent *e = readdir(d)) {
+        std::string n = e->d_name;
+        if (n.compare(0, prefix.size(), prefix) == 0 && ends_with(n, ".bmp"))
+            files.push_back(dir + "/" + n);
+    }
+    closedir(d);
+    std::sort(files.begin(), files.end());
+    if (files.empty()) {
+        fprintf(stderr, "[ERROR] %s/%s*.bmp: no files\n", dir.c_str(), prefix.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool frame_src_open(frame_src_t &s, const std::string &path, u32 w, u32 h, u32 bpp)
+{
+    struct stat st;
+    std::vector<std::string> files;
+
+    s = frame_src_t();
+    s.name = path;
+    if (stat(path.c_str(), &st) == 0 && S_ISDIR(st.st_mode)) {
+        if (!list_bmps(path, "", files)) return false;
+    } else if (stat(path.c_str(), &st) == 0) {
+        if (ends_with(path, ".bmp")) files.push_back(path);
+    } else {
+        /* DIR/PREFIX: the .bmp files of DIR whose name starts with PREFIX */
+        size_t slash = path.find_last_of('/');
+        std::string dir = (slash == std::string::npos) ? "." : path.substr(0, slash);
+        std::string prefix = path.substr(slash == std::string::npos ? 0 : slash + 1);
+        if (!list_bmps(dir, prefix, files)) return false;
+    }
+
+    if (!files.empty()) {
+        s.bmp = true;
+        for (size_t i = 0; i < files.size(); i++) {
+            frame_map_t m;
+            if (!map_file(files[i], m)) return false;
+            s.maps.push_back(m);
+            if (!parse_bmp(s, files[i], m, i == 0)) return false;
+        }
+        s.frames = (u32)files.size();
+        return true;
+    }
+
+    frame_map_t m;
+    if (!map_file(path, m)) return false;
+    s.maps.push_back(m);
+
+    if (vfc_probe(m.p, m.len)) {
+        vfc_hdr_t hd;
+        if (!vfc_parse(path, m.p, m.len, hd, s.index)) return false;
+        s.vfc = true;
+        s.w = hd.width;
+        s.h = hd.height;
+        s.bpp = hd.bpp;
+        s.pixfmt = hd.pixfmt;
+        s.bgr_at = (hd.pixfmt == PIXFMT_ABGR32) ? 1 : 0;
+        s.stride = (size_t)s.w * s.bpp;
+        s.frames = hd.frames;
+        return true;
+    }
+
+    /* Raw frames */
+    if (!w || !h || !bpp) {
+        fprintf(stderr, "[ERROR] %s: raw frames need a geometry (WxHxBPP)\n", path.c_str());
+        return false;
+    }
+    s.w = w;
+    s.h = h;
+    s.bpp = bpp;
+    s.pixfmt = (bpp == 3) ? PIXFMT_BGR24 : (bpp == 4) ? PIXFMT_ABGR32 : PIXFMT_RAW;
+    s.bgr_at = (bpp == 4) ? 1 : 0;
+    s.stride = (size_t)w * bpp;
+    size_t fbytes = s.stride * h;
+    s.frames = (u32)(m.len / fbytes);
+    if (m.len % fbytes)
+        fprintf(stderr, "[WARN] %s: %zu trailing bytes ignored\n", path.c_str(), m.len % fbytes);
+    return true;
+}
+
+bool frame_src_is_raw(const std::string &path)
+{
+    struct stat st;
+    u8 head[sizeof(vfc_hdr_t)];
+
+    if (stat(path.c_str(), &st) != 0 || S_ISDIR(st.st_mode)) return false;    // BMP dir or prefix
+    if (ends_with(path, ".bmp")) return false;
+
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) return true;
+    ssize_t n = read(fd, head, sizeof(head));
+    close(fd);
+    return !(n > 0 && vfc_probe(head, (size_t)n));
+}
+
+void frame_src_close(frame_src_t &s)
+{
+    for (frame_map_t &m : s.maps)
+        if (m.p) munmap((void *)m.p, m.len);
+    s.maps.clear();
+    s.frames = 0;
+}
@@ -0,0 +1,70 @@
+/*
+ * frame_src.hpp - read-only, memory-mapped frame sequences for the host tools
+ *
+ * A source is one of
+ * - a .vfc container (frame_file.hpp), geometry and index from its header,
+ * - a raw .bin of back-to-back frames (geometry given by the caller),
+ * - a single 24/32-bit uncompressed .bmp,
+ * - a directory of .bmp files, taken in name order, or DIR/PREFIX for only
+ *   the ones whose name starts with PREFIX (compare_txt/frame_).
+ * Every file is mmap'd; frame_src_row() returns a pointer into the mapping,
+ * top row first, so BMP row order and padding are invisible to callers.
+ */
+
+#ifndef FRAME_SRC_HPP
+#define FRAME_SRC_HPP
+
+#include <cstddef>
+#include <string>
+#include <vector>
+#include "frame_file.hpp"
+
+struct frame_map_t {
+    const u8 *p   = nullptr;
+    size_t    len = 0;
+};
+
+struct frame_src_t {
+    std::string name;
+    std::vector<frame_map_t> maps;      // one per file
+    bool   bmp       = false;
+    bool   vfc       = false;
+    u32    w = 0, h = 0, bpp = 0;
+    u8     pixfmt    = 0;               // PIXFMT_*; BMPs read as BGR24/RAW
+    u32    bgr_at    = 0;               // byte of B in a pixel (ABGR32: 1)
+    u32    frames    = 0;
+    const vfc_index_t *index = nullptr; // .vfc only
+    size_t data_off  = 0;               // first pixel byte (BMP: bfOffBits)
+    size_t stride    = 0;               // bytes per stored row
+    bool   bottom_up = false;           // BMP with positive height
+};
+
+/*
+ * Open path. For a raw .bin, w/h/bpp must be set (bpp 3 reads as BGR24,
+ * 4 as ABGR32); .vfc and BMPs fill them in. Returns false (with a message
+ * on stderr) on any error.
+ */
+bool frame_src_open(frame_src_t &s, const std::string &path, u32 w, u32 h, u32 bpp);
+void frame_src_close(frame_src_t &s);
+
+/* An existing file that is neither a BMP nor a .vfc: needs a geometry */
+bool frame_src_is_raw(const std::string &path);
+
+static inline size_t frame_src_row_bytes(const frame_src_t &s) { return (size_t)s.w * s.bpp; }
+
+static inline const u8 *frame_src_row(const frame_src_t &s, u32 frame, u32 y)
+{
+    const frame_map_t &m = s.maps[s.bmp ? frame : 0];
+    size_t base = s.bmp ? s.data_off
+                : s.vfc ? (size_t)s.index[frame].offset
+                : (size_t)frame * s.h * s.stride;
+    u32 row = s.bottom_up ? s.h - 1 - y : y;
+    return m.p + base + (size_t)row * s.stride;
+}
+
+static inline const u8 *frame_src_frame(const frame_src_t &s, u32 frame)
+{
+    return frame_src_row(s, frame, 0);      // whole frame only if !s.bmp
+}
+
+#endif /* FRAME_SRC_HPP */
@@ -0,0 +1,196 @@
+/*
+ * frame_trace_check.cpp - the firmware's latency histograms (../src/frame_trace.c)
+ *
+ * frame_trace.c is compiled in here as it is, so its static bucket helpers
+ * are checked directly, against the sim's xtime_l.h (1 tick = 1 ns):
+ *   buckets     ft_bucket() is exact below FT_SUB, every bucket starts at
+ *               ft_bucket_low(), maps back onto itself, holds exactly the
+ *               values up to the next bucket's start, and is at most 25% of
+ *               its lower bound wide; values past the last bucket land in it
+ *   percentile  frame_trace_record() of known stage latencies; p50/p99 must
+ *               be the upper bound of the bucket holding the true percentile
+ *               (so >= it and within 25% of it), clamped to the stage max
+ *   query       the MSG_STATS payload carries the same counts and figures
+ *
+ * usage: frame_trace_check
+ * Exit status 1 if any check fails.
+ */
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+extern "C" {
+#include "frame_trace.c"
+}
+
+static int failures = 0;
+
+#define CHECK(cond, ...)                                        \
+    do {                                                        \
+        if (!(cond)) {                                          \
+            if (failures++ < 10) {                              \
+                printf("[ERROR] %s:%d: ", __FILE__, __LINE__);  \
+                printf(__VA_ARGS__);                            \
+                printf("\n");                                   \
+            }                                                   \
+        }                                                       \
+    } while (0)
+
+typedef unsigned long long ull;
+
+/* Values worth checking: all small ones, every bucket edge +-1, and a sweep */
+static std::vector<u64> sample_values(void)
+{
+    std::vector<u64> v;
+    for (u64 x = 0; x < 65536; x++) v.push_back(x);
+    for (u32 b = 0; b < FT_BUCKETS; b++) {
+        u64 lo = ft_bucket_low(b);
+        v.push_back(lo);
+        if (lo) v.push_back(lo - 1);
+        v.push_back(lo + 1);
+    }
+    for (u64 x = 65536; x < (1ull << 40); x += x / 97 + 1) v.push_back(x);
+    v.push_back(~0ull);
+    return v;
+}
+
+static bool check_buckets(void)
+{
+    int before = failures;
+
+    for (u64 x = 0; x < FT_SUB; x++)
+        CHECK(ft_bucket(x) == x, "ft_bucket(%llu) = %u, want exact", (ull)x, ft_bucket(x));
+
+    for (u32 b = 0; b < FT_BUCKETS; b++) {
+        u64 lo = ft_bucket_low(b);
+        CHECK(ft_bucket(lo) == b, "bucket %u starts at %llu, which maps to %u", b, (ull)lo, ft_bucket(lo));
+        if (b + 1 < FT_BUCKETS) {
+            u64 next = ft_bucket_low(b + 1);
+            CHECK(next > lo, "bucket %u starts at %llu, bucket %u at %llu", b, (ull)lo, b + 1, (ull)next);
+            if (b >= FT_SUB)
+                CHECK((next - lo) * 4 <= lo, "bucket %u [%llu, %llu) wider than 25%%", b, (ull)lo, (ull)next);
+        }
+    }
+
+    for (u64 x : sample_values()) {
+        u32 b = ft_bucket(x);
+        CHECK(b < FT_BUCKETS, "ft_bucket(%llu) = %u out of range", (ull)x, b);
+        if (b >= FT_BUCKETS) continue;
+        CHECK(ft_bucket_low(b) <= x, "%llu in bucket %u, which starts at %llu", (ull)x, b,
+              (ull)ft_bucket_low(b));
+        if (b + 1 < FT_BUCKETS)
+            CHECK(x < ft_bucket_low(b + 1), "%llu in bucket %u, but bucket %u starts at %llu", (ull)x, b,
+                  b + 1, (ull)ft_bucket_low(b + 1));
+    }
+    CHECK(ft_bucket(1ull << 40) == FT_BUCKETS - 1, "2^40 not in the last bucket");
+
+    printf("[RESULT] buckets: %u buckets up to %llu ticks, %s\n", FT_BUCKETS,
+           (ull)ft_bucket_low(FT_BUCKETS - 1), failures == before ? "ok" : "FAILED");
+    return failures == before;
+}
+
+#define T0  (1ull << 40)
+
+/* One frame whose ST_RX_ASM stage took d ticks and ST_SCHED 2*d; the others 0 */
+static void record(u64 d)
+{
+    frame_trace_t t;
+    for (int i = 0; i < TS_COUNT; i++) t.ts[i] = T0;
+    t.ts[TS_RX_FIRST] = T0 - d;
+    t.ts[TS_POST] = T0 + 2 * d;
+    for (int i = TS_POST + 1; i < TS_COUNT; i++) t.ts[i] = t.ts[TS_POST];
+    frame_trace_record(&t);
+}
+
+/* The p-th percentile of the values 1..n, as frame_trace_percentile_ns() ranks them */
+static u64 true_pct(u64 n, u32 pct) { return (n * pct + 99) / 100; }
+
+static void check_pct(int stage, u32 pct, u64 want, u64 max)
+{
+    u32 got = frame_trace_percentile_ns(stage, pct);
+    u64 hi = want + want / 4;
+    if (hi > max) hi = max;
+    CHECK(got >= want && got <= hi, "stage %d p%u = %u, want %llu..%llu", stage, pct, got, (ull)want, (ull)hi);
+}
+
+static bool check_percentiles(void)
+{
+    int before = failures;
+    const u64 n = 1000;
+
+    frame_trace_reset();
+    CHECK(frame_trace_percentile_ns(ST_RX_ASM, 50) == 0, "empty stage p50 not 0");
+
+    record(777);
+    CHECK(frame_trace_percentile_ns(ST_RX_ASM, 50) == 777, "single value p50 = %u, want 777",
+          frame_trace_percentile_ns(ST_RX_ASM, 50));
+
+    frame_trace_reset();
+    for (u64 d = n; d >= 1; d--) record(d);
+    for (u32 pct : { 1u, 10u, 50u, 90u, 99u, 100u }) {
+        check_pct(ST_RX_ASM, pct, true_pct(n, pct), n);
+        check_pct(ST_SCHED, pct, 2 * true_pct(n, pct), 2 * n);
+        check_pct(ST_TOTAL, pct, 3 * true_pct(n, pct), 3 * n);
+    }
+    CHECK(frame_trace_percentile_ns(ST_RX_ASM, 100) == n, "p100 = %u, want the max %llu",
+          frame_trace_percentile_ns(ST_RX_ASM, 100), (ull)n);
+    CHECK(frame_trace_percentile_ns(ST_TX, 99) == 0, "zero-length stage p99 = %u",
+          frame_trace_percentile_ns(ST_TX, 99));
+
+    /* Past the last bucket: clamped to the max seen */
+    frame_trace_reset();
+    record(1ull << 34);
+    CHECK(frame_trace_percentile_ns(ST_RX_ASM, 50) == 0xFFFFFFFFu, "p50 past 2^32 ns not saturated");
+
+    printf("[RESULT] percentiles: %s\n", failures == before ? "ok" : "FAILED");
+    return failures == before;
+}
+
+static bool check_query(void)
+{
+    int before = failures;
+    u8 buf[FT_STATS_BYTES];
+    frame_trace_hdr_t hdr;
+    frame_trace_stage_t st;
+
+    frame_trace_reset();
+    for (u64 d = 1; d <= 200; d++) record(d);
+
+    CHECK(frame_trace_query(buf, sizeof(buf) - 1) == 0, "query into a short buffer not refused");
+    u32 len = frame_trace_query(buf, sizeof(buf));
+    CHECK(len == FT_STATS_BYTES, "query returned %u bytes, want %u", len, (u32)FT_STATS_BYTES);
+    memcpy(&hdr, buf, sizeof(hdr));
+    CHECK(hdr.frames == 200 && hdr.nstages == ST_COUNT && hdr.stage_bytes == sizeof(st) &&
+          hdr.ticks_per_sec == COUNTS_PER_SECOND, "header %u frames, %u stages of %u bytes, %u ticks/s",
+          hdr.frames, hdr.nstages, hdr.stage_bytes, hdr.ticks_per_sec);
+    for (int i = 0; i < ST_COUNT; i++) {
+        memcpy(&st, buf + FT_HDR_BYTES + i * sizeof(st), sizeof(st));
+        CHECK(st.count == 200, "stage %d count %u", i, st.count);
+        CHECK(st.p50_ns == frame_trace_percentile_ns(i, 50) && st.p99_ns == frame_trace_percentile_ns(i, 99),
+              "stage %d p50/p99 %u/%u differ from frame_trace_percentile_ns()", i, st.p50_ns, st.p99_ns);
+        CHECK(st.p50_ns <= st.p99_ns && st.p99_ns <= st.max_ns, "stage %d p50 %u, p99 %u, max %u", i,
+              st.p50_ns, st.p99_ns, st.max_ns);
+    }
+    memcpy(&st, buf + FT_HDR_BYTES + ST_TOTAL * sizeof(st), sizeof(st));
+    CHECK(st.max_ns == 600, "total max %u, want 600", st.max_ns);
+
+    printf("[RESULT] query: %s\n", failures == before ? "ok" : "FAILED");
+    return failures == before;
+}
+
+int main(int argc, char **argv)
+{
+    (void)argv;
+    if (argc > 1) {
+        fprintf(stderr, "usage: frame_trace_check\n");
+        return 2;
+    }
+
+    bool ok = check_buckets();
+    ok &= check_percentiles();
+    ok &= check_query();
+    if (!ok) return 1;
+    printf("[PASS] histogram buckets, percentiles and MSG_STATS payload\n");
+    return 0;
+}
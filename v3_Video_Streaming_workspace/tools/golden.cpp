@@ -0,0 +1,316 @@
+/*
+ * golden.cpp - bicubic x4 reference model and the streaming golden check
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+#include "golden.hpp"
+#include "bicubic_model.h"
+
+static u64 now_ns(void)
+{
+    return (u64)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/* -------------------------------------------------------------------------- */
+/* Model                                                                      */
+/* -------------------------------------------------------------------------- */
+size_t golden_tmp_words(u32 w, u32 h)
+{
+    /* 4 lanes per output pixel for the SIMD path, 3 for bicubic_model.h */
+    return (size_t)h * w * BICUBIC_SCALE * 4 + (size_t)(w + 4) * 4;
+}
+
+#if defined(__x86_64__)
+/*
+ * Horizontal pass of one source row into 4w x {0,B,G,R} Q10 samples. The
+ * source is widened to int32 lanes with two replicated pixels on each side,
+ * which stands in for the clamp in bicubic_row_h(): output pixel 4k+j then
+ * reads padded pixels k..k+3 (phases 0,1) or k+1..k+4 (phases 2,3).
+ */
+__attribute__((target("avx2")))
+static void row_h_avx2(const u8 *src, u32 w, s32 *pad, s32 *dst)
+{
+    for (u32 p = 0; p < w + 4; p++) {
+        const u8 *s = src + (size_t)std::min(std::max((s32)p - 2, 0), (s32)w - 1) * 3;
+        pad[p * 4 + 0] = 0;
+        pad[p * 4 + 1] = s[0];
+        pad[p * 4 + 2] = s[1];
+        pad[p * 4 + 3] = s[2];
+    }
+
+    __m128i wt[BICUBIC_SCALE][4];
+    for (int j = 0; j < BICUBIC_SCALE; j++)
+        for (int t = 0; t < 4; t++)
+            wt[j][t] = _mm_set1_epi32(bicubic_w[j][t]);
+
+    for (u32 k = 0; k < w; k++) {
+        __m128i px[5];
+        for (int t = 0; t < 5; t++)
+            px[t] = _mm_loadu_si128((const __m128i *)(pad + (k + t) * 4));
+        for (int j = 0; j < BICUBIC_SCALE; j++) {
+            const __m128i *q = px + (j < 2 ? 0 : 1);
+            __m128i acc = _mm_add_epi32(
+                _mm_add_epi32(_mm_mullo_epi32(wt[j][0], q[0]), _mm_mullo_epi32(wt[j][1], q[1])),
+                _mm_add_epi32(_mm_mullo_epi32(wt[j][2], q[2]), _mm_mullo_epi32(wt[j][3], q[3])));
+            _mm_storeu_si128((__m128i *)(dst + ((size_t)k * BICUBIC_SCALE + j) * 4), acc);
+        }
+    }
+}
+
+/* Four taps over 8 lanes at offset o, rounded and shifted back from Q20 */
+__attribute__((target("avx2")))
+static inline __m256i mac_v8(const s32 *const rows[4], const __m256i w[4], size_t o)
+{
+    const __m256i half = _mm256_set1_epi32(1 << (2 * BICUBIC_QBITS - 1));
+    __m256i a = _mm256_add_epi32(
+        _mm256_mullo_epi32(w[0], _mm256_loadu_si256((const __m256i *)(rows[0] + o))),
+        _mm256_mullo_epi32(w[1], _mm256_loadu_si256((const __m256i *)(rows[1] + o))));
+    __m256i b = _mm256_add_epi32(
+        _mm256_mullo_epi32(w[2], _mm256_loadu_si256((const __m256i *)(rows[2] + o))),
+        _mm256_mullo_epi32(w[3], _mm256_loadu_si256((const __m256i *)(rows[3] + o))));
+    return _mm256_srai_epi32(_mm256_add_epi32(_mm256_add_epi32(a, b), half), 2 * BICUBIC_QBITS);
+}
+
+/*
+ * Vertical pass: n int32 lanes (out_w x 4) to n bytes. Rounding matches
+ * bicubic_round_q20(): (v + 2^19) >> 20, and the packs saturate to 0..255,
+ * which also covers v <= 0. Lane A is 0 in every row and stays 0.
+ */
+__attribute__((target("avx2")))
+static void row_v_avx2(const s32 *const rows[4], int oy, size_t n, u8 *dst)
+{
+    const int32_t *w = bicubic_w[oy % BICUBIC_SCALE];
+    const __m256i wv[4] = { _mm256_set1_epi32(w[0]), _mm256_set1_epi32(w[1]),
+                            _mm256_set1_epi32(w[2]), _mm256_set1_epi32(w[3]) };
+    const __m256i perm = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+    size_t i = 0;
+
+    for (; i + 32 <= n; i += 32) {
+        __m256i ab = _mm256_packs_epi32(mac_v8(rows, wv, i), mac_v8(rows, wv, i + 8));
+        __m256i cd = _mm256_packs_epi32(mac_v8(rows, wv, i + 16), mac_v8(rows, wv, i + 24));
+        __m256i px = _mm256_permutevar8x32_epi32(_mm256_packus_epi16(ab, cd), perm);
+        _mm256_storeu_si256((__m256i *)(dst + i), px);
+    }
+    for (; i < n; i++) {
+        s32 acc = w[0] * rows[0][i] + w[1] * rows[1][i] + w[2] * rows[2][i] + w[3] * rows[3][i];
+        dst[i] = bicubic_round_q20(acc);
+    }
+}
+
+__attribute__((target("avx2")))
+static void model_avx2(const u8 *in, u32 w, u32 h, u8 *out, s32 *tmp)
+{
+    size_t row_n = (size_t)w * BICUBIC_SCALE * 4;
+    s32 *pad = tmp + (size_t)h * row_n;
+    u32 out_h = h * BICUBIC_SCALE;
+
+    for (u32 y = 0; y < h; y++)
+        row_h_avx2(in + (size_t)y * w * 3, w, pad, tmp + y * row_n);
+
+    for (u32 oy = 0; oy < out_h; oy++) {
+        const s32 *rows[4];
+        int y0 = bicubic_tap0((int)oy);
+        for (int t = 0; t < 4; t++)
+            rows[t] = tmp + (size_t)bicubic_clampi(y0 + t, 0, (int)h - 1) * row_n;
+        row_v_avx2(rows, (int)oy, row_n, out + oy * row_n);
+    }
+}
+#endif
+
+void golden_model_frame(bool simd, const u8 *in, u32 w, u32 h, u8 *out, s32 *tmp)
+{
+#if defined(__x86_64__)
+    if (simd) {
+        model_avx2(in, w, h, out, tmp);
+        return;
+    }
+#endif
+    (void)simd;
+    bicubic_x4_bgr24_to_abgr32(in, (int)w, (int)h, out, tmp);
+}
+
+/* ABGR32 -> BGR24 in place; kept apart from the firmware's pix_pack.c on purpose */
+static void pack_bgr24(u8 *buf, size_t pixels)
+{
+    for (size_t i = 0; i < pixels; i++) {
+        u8 b = buf[i * 4 + 1], g = buf[i * 4 + 2], r = buf[i * 4 + 3];
+        buf[i * 3 + 0] = b;
+        buf[i * 3 + 1] = g;
+        buf[i * 3 + 2] = r;
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+/* Workers                                                                    */
+/* -------------------------------------------------------------------------- */
+static void golden_worker(golden_t &g)
+{
+    std::vector<s32> tmp(golden_tmp_words(g.o.in_w, g.o.in_h));
+    u32 depth = (u32)g.refs.size();
+
+    for (;;) {
+        u32 k, slot;
+        {
+            std::unique_lock<std::mutex> l(g.lock);
+            g.cv.wait(l, [&] {
+                return g.closing || g.next >= g.frames ||
+                       (g.next < g.checked + depth && !g.busy[g.next % depth]);
+            });
+            if (g.closing || g.next >= g.frames) return;
+            k = g.next++;
+            slot = k % depth;
+            g.busy[slot] = true;
+            g.ready[slot] = -1;
+        }
+
+        u64 t0 = now_ns();
+        golden_model_frame(g.simd, g.o.in[k], g.o.in_w, g.o.in_h,
+                           g.refs[slot], tmp.data());
+        if (g.o.out_bpp == 3) pack_bgr24(g.refs[slot], (size_t)g.out_w * g.out_h);
+        u64 t1 = now_ns();
+
+        std::lock_guard<std::mutex> l(g.lock);
+        g.busy[slot] = false;
+        if (k >= g.checked) g.ready[slot] = k;     // else skipped meanwhile
+        g.st.model_ns += t1 - t0;
+        g.st.modelled++;
+        g.cv.notify_all();
+    }
+}
+
+bool golden_open(golden_t &g, const golden_opts_t &o)
+{
+    g.o = o;
+    if (g.o.out_bpp != 3 && g.o.out_bpp != 4) {
+        fprintf(stderr, "[ERROR] golden: output must be BGR24 or ABGR32\n");
+        return false;
+    }
+    if (g.o.depth < 2) g.o.depth = 2;
+    if (g.o.threads == 0) {
+        u32 n = std::thread::hardware_concurrency();
+        g.o.threads = n > 4 ? n - 3 : 1;
+    }
+    g.frames = (u32)o.in.size();
+    g.out_w = o.in_w * BICUBIC_SCALE;
+    g.out_h = o.in_h * BICUBIC_SCALE;
+    g.out_bytes = (size_t)g.out_w * g.out_h * g.o.out_bpp;
+    g.st.first_bad = ~0u;
+#if defined(__x86_64__)
+    __builtin_cpu_init();
+    g.simd = __builtin_cpu_supports("avx2");
+#endif
+
+    for (u32 i = 0; i < g.o.depth; i++) {
+        u8 *b = (u8 *)malloc((size_t)g.out_w * g.out_h * 4);
+        if (!b) {
+            fprintf(stderr, "[ERROR] golden: out of memory (%u frames)\n", g.o.depth);
+            return false;
+        }
+        g.refs.push_back(b);
+    }
+    g.ready.assign(g.o.depth, -1);
+    g.busy.assign(g.o.depth, false);
+    for (u32 i = 0; i < g.o.threads; i++)
+        g.workers.emplace_back(golden_worker, std::ref(g));
+    return true;
+}
+
+const char *golden_impl(const golden_t &g)
+{
+    return g.simd ? "avx2" : "scalar";
+}
+
+/* -------------------------------------------------------------------------- */
+/* Check                                                                      */
+/* -------------------------------------------------------------------------- */
+static void report_mismatch(const golden_t &g, u32 seq, const u8 *got, const u8 *ref, u64 bad)
+{
+    size_t i = 0;
+    while (got[i] == ref[i]) i++;
+
+    u32 bpp = g.o.out_bpp;
+    size_t px = i / bpp;
+    const char *ch = (bpp == 4) ? "ABGR" : "BGR";
+    printf("[ERROR][GOLDEN] seq %u: %llu bytes differ, first at x=%zu y=%zu %c "
+           "got %02X expected %02X\n", seq, (unsigned long long)bad,
+           px % g.out_w, px / g.out_w, ch[i % bpp], got[i], ref[i]);
+}
+
+bool golden_check(golden_t &g, u32 seq, const u8 *frame)
+{
+    u32 depth = (u32)g.refs.size();
+    u32 slot = seq % depth;
+    const u8 *ref;
+
+    {
+        std::unique_lock<std::mutex> l(g.lock);
+        if (seq < g.checked || seq >= g.frames) {     // duplicate or out of range
+            g.st.skipped++;
+            return true;
+        }
+        if (seq > g.checked) {
+            /* Frames lost in between: let the workers jump ahead */
+            g.st.skipped += seq - g.checked;
+            g.checked = seq;
+            for (u32 i = 0; i < depth; i++)
+                if (g.ready[i] >= 0 && g.ready[i] < (s64)seq) g.ready[i] = -1;
+            if (g.next < seq) g.next = seq;
+            g.cv.notify_all();
+        }
+        if (g.ready[slot] != (s64)seq) {
+            u64 t0 = now_ns();
+            g.cv.wait(l, [&] { return g.ready[slot] == (s64)seq || g.closing; });
+            g.st.waits++;
+            g.st.wait_ns += now_ns() - t0;
+            if (g.closing) return true;
+        }
+        ref = g.refs[slot];
+    }
+
+    /* The slot stays ours until checked moves past seq */
+    bool ok = memcmp(frame, ref, g.out_bytes) == 0;
+    u64 bad = 0;
+    if (!ok) {
+        for (size_t i = 0; i < g.out_bytes; i++) bad += (frame[i] != ref[i]);
+    }
+
+    std::lock_guard<std::mutex> l(g.lock);
+    if (!ok) {
+        if (g.st.bad_frames < g.o.report) report_mismatch(g, seq, frame, ref, bad);
+        if (g.st.bad_frames == 0) g.st.first_bad = seq;
+        g.st.bad_frames++;
+        g.st.bad_bytes += bad;
+    }
+    g.st.checked++;
+    g.ready[slot] = -1;
+    g.checked = seq + 1;
+    g.cv.notify_all();
+    return ok;
+}
+
+void golden_close(golden_t &g)
+{
+    {
+        std::lock_guard<std::mutex> l(g.lock);
+        g.closing = true;
+        g.cv.notify_all();
+    }
+    for (std::thread &t : g.workers) t.join();
+    g.workers.clear();
+    for (u8 *b : g.refs) free(b);
+    g.refs.clear();
+}
+
+void golden_get_stats(golden_t &g, golden_stats_t &st)
+{
+    std::lock_guard<std::mutex> l(g.lock);
+    st = g.st;
+}
@@ -0,0 +1,84 @@
+/*
+ * golden.hpp - on-the-fly golden check of received frames
+ *
+ * A pool of worker threads runs the bicubic x4 reference model over the
+ * input frames, a bounded ring of `depth` frames ahead of the receiver.
+ * The receiver hands every output frame to golden_check(), which compares
+ * it with the reference for the same sequence number and releases the
+ * slot. Nothing is written to disk, so a full run ends with a pass/fail
+ * verdict instead of a file to diff.
+ *
+ * The model is sim/bicubic_model.h (what the host simulator uses for the
+ * IP), reorganised for speed: the horizontal pass writes 4 lanes per output
+ * pixel with lane 0 (A) held at zero, so the vertical pass is a straight
+ * int32 multiply-accumulate over the row and packs to ABGR32 bytes with no
+ * shuffling. AVX2 when the CPU has it, bicubic_model.h itself otherwise.
+ * Both give identical bytes. With out_bpp 3 the reference is packed to
+ * BGR24, as the firmware does when a session negotiates it (pix_pack.h).
+ */
+
+#ifndef GOLDEN_HPP
+#define GOLDEN_HPP
+
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+extern "C" {
+#include "xil_types.h"
+}
+
+#define GOLDEN_SCALE    4       // the model (and the IP) is x4 only
+
+struct golden_opts_t {
+    std::vector<const u8 *> in;     // input frames, BGR24
+    u32  in_w = 0, in_h = 0;        // output is 4w x 4h
+    u32  out_bpp      = 4;          // 4 = ABGR32, 3 = BGR24
+    u32  threads      = 0;          // 0 = all cores but three (TX, RX, writer)
+    u32  depth        = 8;          // reference frames computed ahead
+    u32  report       = 10;         // mismatching frames printed in detail
+};
+
+struct golden_stats_t {
+    u64  checked;                   // frames compared
+    u64  bad_frames;
+    u64  bad_bytes;
+    u64  skipped;                   // received out of order, not compared
+    u32  first_bad;                 // seq of the first bad frame
+    u32  waits;                     // golden_check() calls that waited for the model
+    u64  wait_ns;
+    u64  model_ns;                  // summed over workers
+    u64  modelled;                  // frames the workers produced
+};
+
+struct golden_t {
+    golden_opts_t        o;
+    bool                 simd = false;
+    u32                  frames = 0;
+    u32                  out_w = 0, out_h = 0;
+    size_t               out_bytes = 0;     // compared per frame
+    std::vector<u8 *>    refs;      // ABGR32 sized; packed in place for BGR24      // depth slots; frame k lives in k % depth
+    std::vector<s64>     ready;     // frame in the slot, -1 = none
+    std::vector<bool>    busy;      // a worker is filling the slot
+    std::vector<std::thread> workers;
+    std::mutex           lock;
+    std::condition_variable cv;
+    u32                  next = 0;      // next frame for the workers
+    u32                  checked = 0;   // frames below this are done with
+    bool                 closing = false;
+    golden_stats_t       st = {};
+};
+
+bool golden_open(golden_t &g, const golden_opts_t &o);
+bool golden_check(golden_t &g, u32 seq, const u8 *frame);  // false on mismatch
+void golden_close(golden_t &g);
+void golden_get_stats(golden_t &g, golden_stats_t &st);
+const char *golden_impl(const golden_t &g);
+
+/* One reference frame; tmp holds in_h * 4w * 4 int32 */
+void golden_model_frame(bool simd, const u8 *in, u32 w, u32 h, u8 *out, s32 *tmp);
+size_t golden_tmp_words(u32 w, u32 h);
+
+#endif /* GOLDEN_HPP */
@@ -0,0 +1,173 @@
+/*
+ * l2_sock.cpp - raw Ethernet frames of L2_ETHERTYPE over PACKET_MMAP rings
+ */
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <arpa/inet.h>
+#include <linux/if_packet.h>
+#include <net/ethernet.h>
+#include <net/if.h>
+#include <net/if_arp.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "l2_sock.hpp"
+
+#ifndef PACKET_IGNORE_OUTGOING
+#define PACKET_IGNORE_OUTGOING  23
+#endif
+
+#define L2_BLOCK        (64 * 1024)         // ring block, a whole number of slots
+#define L2_KICK_AFTER   256                 // queued TX slots that trigger a send()
+#define L2_SNDBUF       (8 << 20)
+
+typedef char l2_slot_check[(L2_BLOCK % L2_FRAME_SLOT == 0 && L2_RX_SLOTS % (L2_BLOCK / L2_FRAME_SLOT) == 0 &&
+                            L2_TX_SLOTS % (L2_BLOCK / L2_FRAME_SLOT) == 0) ? 1 : -1];
+
+static struct tpacket2_hdr *rx_slot(l2_sock_t &s, u32 i)
+{
+    return (struct tpacket2_hdr *)(s.ring + (size_t)i * L2_FRAME_SLOT);
+}
+
+static struct tpacket2_hdr *tx_slot(l2_sock_t &s, u32 i)
+{
+    return (struct tpacket2_hdr *)(s.ring + (size_t)(L2_RX_SLOTS + i) * L2_FRAME_SLOT);
+}
+
+static bool set_ring(int fd, int opt, u32 slots)
+{
+    struct tpacket_req req;
+
+    req.tp_block_size = L2_BLOCK;
+    req.tp_frame_size = L2_FRAME_SLOT;
+    req.tp_frame_nr   = slots;
+    req.tp_block_nr   = slots / (L2_BLOCK / L2_FRAME_SLOT);
+    return setsockopt(fd, SOL_PACKET, opt, &req, sizeof(req)) == 0;
+}
+
+bool l2_open(l2_sock_t &s, const char *ifname)
+{
+    struct ifreq ifr;
+    int ver = TPACKET_V2, one = 1, sz = L2_SNDBUF;
+    unsigned idx = if_nametoindex(ifname);
+
+    if (idx == 0) {
+        fprintf(stderr, "[ERROR] l2: no interface %s\n", ifname);
+        return false;
+    }
+    s.fd = socket(AF_PACKET, SOCK_RAW, htons(L2_ETHERTYPE));
+    if (s.fd < 0) {
+        perror("[ERROR] l2: AF_PACKET socket (needs CAP_NET_RAW)");
+        return false;
+    }
+
+    memset(&ifr, 0, sizeof(ifr));
+    strncpy(ifr.ifr_name, ifname, IFNAMSIZ - 1);
+    if (ioctl(s.fd, SIOCGIFHWADDR, &ifr) != 0 || ifr.ifr_hwaddr.sa_family != ARPHRD_ETHER) {
+        fprintf(stderr, "[ERROR] l2: %s is not an Ethernet interface\n", ifname);
+        l2_close(s);
+        return false;
+    }
+    memcpy(s.mac, ifr.ifr_hwaddr.sa_data, 6);
+
+    setsockopt(s.fd, SOL_PACKET, PACKET_IGNORE_OUTGOING, &one, sizeof(one));    // 4.20+; filtered below too
+    setsockopt(s.fd, SOL_SOCKET, SO_SNDBUF, &sz, sizeof(sz));
+    if (setsockopt(s.fd, SOL_PACKET, PACKET_VERSION, &ver, sizeof(ver)) != 0 ||
+        !set_ring(s.fd, PACKET_RX_RING, L2_RX_SLOTS) || !set_ring(s.fd, PACKET_TX_RING, L2_TX_SLOTS)) {
+        perror("[ERROR] l2: PACKET_MMAP rings");
+        l2_close(s);
+        return false;
+    }
+    s.ring_len = (size_t)(L2_RX_SLOTS + L2_TX_SLOTS) * L2_FRAME_SLOT;
+    void *m = mmap(nullptr, s.ring_len, PROT_READ | PROT_WRITE, MAP_SHARED, s.fd, 0);
+    if (m == MAP_FAILED) {
+        perror("[ERROR] l2: mmap");
+        s.ring_len = 0;
+        l2_close(s);
+        return false;
+    }
+    s.ring = (u8 *)m;
+
+    struct sockaddr_ll sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sll_family   = AF_PACKET;
+    sa.sll_protocol = htons(L2_ETHERTYPE);
+    sa.sll_ifindex  = (int)idx;
+    if (bind(s.fd, (struct sockaddr *)&sa, sizeof(sa)) != 0) {
+        perror("[ERROR] l2: bind");
+        l2_close(s);
+        return false;
+    }
+    return true;
+}
+
+bool l2_send(l2_sock_t &s, const void *buf, size_t len)
+{
+    struct tpacket2_hdr *h = tx_slot(s, s.tx_idx);
+    u32 st = __atomic_load_n(&h->tp_status, __ATOMIC_ACQUIRE);
+
+    if (st == TP_STATUS_WRONG_FORMAT) s.tx_bad++;
+    else if (st != TP_STATUS_AVAILABLE) return false;
+    if (len > L2_FRAME_SLOT - TPACKET2_HDRLEN - ETH_HLEN) return false;
+
+    /* TX data starts where an RX slot would keep its sockaddr_ll */
+    u8 *f = (u8 *)h + TPACKET2_HDRLEN - sizeof(struct sockaddr_ll);
+    u16 type = htons(L2_ETHERTYPE);
+    memcpy(f, s.peer, 6);
+    memcpy(f + 6, s.mac, 6);
+    memcpy(f + 12, &type, 2);
+    memcpy(f + ETH_HLEN, buf, len);
+    h->tp_len = (u32)(ETH_HLEN + len);
+    __atomic_store_n(&h->tp_status, TP_STATUS_SEND_REQUEST, __ATOMIC_RELEASE);
+
+    s.tx_idx = (s.tx_idx + 1) % L2_TX_SLOTS;
+    if (++s.tx_queued >= L2_KICK_AFTER) l2_kick(s);
+    return true;
+}
+
+void l2_kick(l2_sock_t &s)
+{
+    if (!s.tx_queued) return;
+    s.tx_queued = 0;
+    send(s.fd, nullptr, 0, MSG_DONTWAIT);   // a full queue leaves the rest for the next kick
+}
+
+const u8 *l2_recv(l2_sock_t &s, u32 &len)
+{
+    for (;;) {
+        struct tpacket2_hdr *h = rx_slot(s, s.rx_idx);
+        if (!(__atomic_load_n(&h->tp_status, __ATOMIC_ACQUIRE) & TP_STATUS_USER)) return nullptr;
+
+        const struct sockaddr_ll *sa =
+            (const struct sockaddr_ll *)((u8 *)h + TPACKET_ALIGN(sizeof(struct tpacket2_hdr)));
+        const u8 *f = (const u8 *)h + h->tp_mac;
+        if (sa->sll_pkttype != PACKET_OUTGOING && h->tp_snaplen > ETH_HLEN &&
+            memcmp(f + 6, s.peer, 6) == 0) {
+            len = h->tp_snaplen - ETH_HLEN;
+            return f + ETH_HLEN;
+        }
+        l2_recv_done(s);
+    }
+}
+
+void l2_recv_done(l2_sock_t &s)
+{
+    __atomic_store_n(&rx_slot(s, s.rx_idx)->tp_status, (u32)TP_STATUS_KERNEL, __ATOMIC_RELEASE);
+    s.rx_idx = (s.rx_idx + 1) % L2_RX_SLOTS;
+}
+
+void l2_close(l2_sock_t &s)
+{
+    if (s.ring) munmap(s.ring, s.ring_len);
+    s.ring = nullptr;
+    if (s.fd >= 0) close(s.fd);
+    s.fd = -1;
+}
+
+void l2_format_mac(const u8 *mac, char *out)
+{
+    sprintf(out, "%02x:%02x:%02x:%02x:%02x:%02x", mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+}
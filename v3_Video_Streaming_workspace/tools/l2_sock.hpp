@@ -0,0 +1,56 @@
+/*
+ * l2_sock.hpp - raw Ethernet frames of L2_ETHERTYPE over PACKET_MMAP rings
+ *
+ * The host end of the board's WIRE_L2 mode (../src/echo.h): an AF_PACKET
+ * socket bound to one interface and L2_ETHERTYPE, with TPACKET_V2 RX and TX
+ * rings mapped into the process. A received frame is read where the kernel
+ * put it; sending fills TX ring slots, and l2_kick() hands the whole batch
+ * to the kernel with one send(). Frames are taken from the peer MAC only.
+ * Needs CAP_NET_RAW. udp_link.hpp carries its datagrams over one of these
+ * in place of a UDP socket.
+ */
+
+#ifndef L2_SOCK_HPP
+#define L2_SOCK_HPP
+
+#include <cstddef>
+
+extern "C" {
+#include "frame_proto.h"
+}
+
+#define L2_FRAME_SLOT   2048        // ring slot: tpacket2_hdr + a 1514-byte frame
+#define L2_RX_SLOTS     2048
+#define L2_TX_SLOTS     1024
+
+struct l2_sock_t {
+    int     fd = -1;
+    u8      mac[6] = {};            // this interface
+    u8      peer[6] = {};           // frames go to and come from here
+    u8     *ring = nullptr;         // RX slots, then TX slots
+    size_t  ring_len = 0;
+    u32     rx_idx = 0, tx_idx = 0;
+    u32     tx_queued = 0;          // slots filled since the last l2_kick()
+    u32     tx_bad = 0;             // frames the kernel refused
+};
+
+/* Bind ifname, map the rings; the interface's MAC in s.mac */
+bool l2_open(l2_sock_t &s, const char *ifname);
+
+/* Queue one frame to s.peer, len bytes after the Ethernet header; false while the TX ring is full */
+bool l2_send(l2_sock_t &s, const void *buf, size_t len);
+void l2_kick(l2_sock_t &s);
+
+/*
+ * Next frame from s.peer: the bytes after its Ethernet header, which may
+ * include padding. nullptr if none; hand it back with l2_recv_done().
+ */
+const u8 *l2_recv(l2_sock_t &s, u32 &len);
+void l2_recv_done(l2_sock_t &s);
+
+void l2_close(l2_sock_t &s);
+
+/* "aa:bb:cc:dd:ee:ff" */
+void l2_format_mac(const u8 *mac, char *out);
+
+#endif /* L2_SOCK_HPP */
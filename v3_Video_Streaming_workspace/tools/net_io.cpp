@@ -0,0 +1,177 @@
+/*
+ * net_io.cpp - blocking TCP helpers and frame_proto.h messages
+ */
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <zlib.h>
+#include "net_io.hpp"
+
+int net_connect(const char *ip, int port, int sndbuf, int rcvbuf)
+{
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) {
+        perror("[ERROR] socket");
+        return -1;
+    }
+
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    if (sndbuf) setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &sndbuf, sizeof(sndbuf));
+    if (rcvbuf) setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+    struct timeval tv = { NET_TIMEOUT_S, 0 };
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+
+    struct sockaddr_in sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sin_family = AF_INET;
+    sa.sin_port   = htons((uint16_t)port);
+    if (inet_pton(AF_INET, ip, &sa.sin_addr) != 1) {
+        fprintf(stderr, "[ERROR] bad address %s\n", ip);
+        close(fd);
+        return -1;
+    }
+    if (connect(fd, (struct sockaddr *)&sa, sizeof(sa)) != 0) {
+        fprintf(stderr, "[ERROR] connect %s:%d: %s\n", ip, port, strerror(errno));
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+bool net_send_all(int fd, const void *buf, size_t len, int flags)
+{
+    const u8 *p = (const u8 *)buf;
+
+    while (len > 0) {
+        ssize_t n = send(fd, p, len, flags | MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        p += n;
+        len -= (size_t)n;
+    }
+    return true;
+}
+
+bool net_recv_all(int fd, void *buf, size_t len)
+{
+    u8 *p = (u8 *)buf;
+
+    while (len > 0) {
+        ssize_t n = recv(fd, p, len, MSG_WAITALL);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        p += n;
+        len -= (size_t)n;
+    }
+    return true;
+}
+
+frame_hdr_t net_make_hdr(u8 type, u32 seq, u16 w, u16 h, u8 fmt, u8 bpp, u32 len)
+{
+    frame_hdr_t hdr;
+
+    memset(&hdr, 0, sizeof(hdr));
+    hdr.magic  = FRAME_MAGIC;
+    hdr.type   = type;
+    hdr.format = fmt;
+    hdr.bpp    = bpp;
+    hdr.seq    = seq;
+    hdr.width  = w;
+    hdr.height = h;
+    hdr.length = len;
+    return hdr;
+}
+
+bool net_check_hdr(const frame_hdr_t &h)
+{
+    return h.magic == FRAME_MAGIC;
+}
+
+frame_cfg_t net_upscale_cfg(u16 in_w, u16 in_h, u8 scale, u8 out_fmt)
+{
+    frame_cfg_t c;
+
+    memset(&c, 0, sizeof(c));
+    c.in_w    = in_w;
+    c.in_h    = in_h;
+    c.out_w   = (u16)(in_w * scale);
+    c.out_h   = (u16)(in_h * scale);
+    c.in_fmt  = PIXFMT_BGR24;
+    c.in_bpp  = 3;
+    c.out_fmt = out_fmt;
+    c.out_bpp = (out_fmt == PIXFMT_BGR24) ? 3 : 4;
+    c.scale   = scale;
+    return c;
+}
+
+bool net_configure(int fd, frame_cfg_t &cfg)
+{
+    static const char *status[] = { "ok", "busy", "invalid", "no memory" };
+    frame_hdr_t h = net_make_hdr(MSG_CONFIG, 0, 0, 0, 0, 0, FRAME_CFG_BYTES);
+
+    if (!net_send_all(fd, &h, sizeof(h), MSG_MORE) || !net_send_all(fd, &cfg, sizeof(cfg)))
+        return false;
+    if (!net_recv_all(fd, &h, sizeof(h))) return false;
+    if (!net_check_hdr(h) || h.type != MSG_CONFIG_ACK || h.length != FRAME_CFG_BYTES) {
+        fprintf(stderr, "[ERROR] expected CONFIG_ACK, got type %d\n", h.type);
+        return false;
+    }
+    if (!net_recv_all(fd, &cfg, sizeof(cfg))) return false;
+    if (cfg.status != CFG_OK) {
+        fprintf(stderr, "[ERROR] board refused config: %s\n",
+                cfg.status < 4 ? status[cfg.status] : "?");
+        return false;
+    }
+    return true;
+}
+
+bool net_udp_open(int fd, frame_udp_t &u)
+{
+    static const char *status[] = { "ok", "busy", "invalid" };
+    frame_hdr_t h = net_make_hdr(MSG_UDP_OPEN, 0, 0, 0, 0, 0, FRAME_UDP_BYTES);
+
+    if (!net_send_all(fd, &h, sizeof(h), MSG_MORE) || !net_send_all(fd, &u, sizeof(u)))
+        return false;
+    if (!net_recv_all(fd, &h, sizeof(h))) return false;
+    if (!net_check_hdr(h) || h.type != MSG_UDP_ACK || h.length != FRAME_UDP_BYTES) {
+        fprintf(stderr, "[ERROR] expected UDP_ACK, got type %d\n", h.type);
+        return false;
+    }
+    if (!net_recv_all(fd, &u, sizeof(u))) return false;
+    if (u.status != CFG_OK) {
+        fprintf(stderr, "[ERROR] board refused UDP: %s\n", u.status < 3 ? status[u.status] : "?");
+        return false;
+    }
+    return true;
+}
+
+u32 net_crc32(const void *buf, size_t len)
+{
+    uLong crc = crc32(0L, Z_NULL, 0);
+    const Bytef *p = (const Bytef *)buf;
+
+    while (len > 0) {
+        uInt n = (len > (1u << 30)) ? (1u << 30) : (uInt)len;
+        crc = crc32(crc, p, n);
+        p += n;
+        len -= n;
+    }
+    return (u32)crc;
+}
+
+bool net_parse_geometry(const char *text, int &w, int &h, int &scale)
+{
+    char tail;
+    int n = sscanf(text, "%dx%dx%d%c", &w, &h, &scale, &tail);
+
+    if (n == 2) return w > 0 && h > 0;
+    return n == 3 && w > 0 && h > 0 && scale > 0;
+}
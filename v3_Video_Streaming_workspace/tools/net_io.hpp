@@ -0,0 +1,49 @@
+/*
+ * net_io.hpp - blocking TCP helpers and frame_proto.h messages for the host tools
+ *
+ * The wire structs come straight from ../src/frame_proto.h (built against the
+ * sim's xil_types.h stand-in), so the tools cannot drift from the firmware.
+ */
+
+#ifndef NET_IO_HPP
+#define NET_IO_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+extern "C" {
+#include "frame_proto.h"
+}
+
+#define NET_DEFAULT_IP      "192.168.1.20"
+#define NET_DEFAULT_PORT    6001
+#define NET_TIMEOUT_S       15
+
+/* Connect with TCP_NODELAY and the given buffer sizes (0 keeps the default) */
+int  net_connect(const char *ip, int port, int sndbuf, int rcvbuf);
+
+/* Loop until everything moved; false on error, timeout or EOF */
+bool net_send_all(int fd, const void *buf, size_t len, int flags = 0);
+bool net_recv_all(int fd, void *buf, size_t len);
+
+/* Little-endian host assumed, as in the firmware */
+frame_hdr_t net_make_hdr(u8 type, u32 seq, u16 w, u16 h, u8 fmt, u8 bpp, u32 len);
+bool net_check_hdr(const frame_hdr_t &h);       // magic only
+
+/*
+ * MSG_CONFIG for an upscale by `scale`; on success cfg holds the ACK.
+ * out_fmt PIXFMT_BGR24 has the board strip the IP's alpha byte before TX.
+ */
+bool net_configure(int fd, frame_cfg_t &cfg);
+frame_cfg_t net_upscale_cfg(u16 in_w, u16 in_h, u8 scale, u8 out_fmt = PIXFMT_ABGR32);
+
+/* MSG_UDP_OPEN (after the CONFIG_ACK); on success u holds the ACK */
+bool net_udp_open(int fd, frame_udp_t &u);
+
+/* zlib CRC-32, same as crc32.c and frame_proto.py */
+u32 net_crc32(const void *buf, size_t len);
+
+/* "WxH" (scale untouched) or "WxHxS"; false if malformed */
+bool net_parse_geometry(const char *text, int &w, int &h, int &scale);
+
+#endif /* NET_IO_HPP */
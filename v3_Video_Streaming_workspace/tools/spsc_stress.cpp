@@ -0,0 +1,227 @@
+/*
+ * spsc_stress.cpp - the firmware's SPSC ring (../src/spsc.h) under two threads
+ *
+ * spsc.h is what core 0 and core 1 hand jobs and completions through
+ * (pipe_ipc.h, pipe_dma.c). Here a producer thread pushes sequence-numbered
+ * elements and a consumer thread pops them, the same calls in the same
+ * order as the pipeline, built against the sim's xil_types.h stand-in.
+ * Every element carries its sequence number, a check word derived from it
+ * and the time it was pushed. The consumer checks that each one arrives
+ * once, in order and whole, and records the push -> pop latency.
+ *
+ * Each capacity runs twice:
+ *   stream   the producer pushes whenever there is space (throughput; the
+ *            latency then includes the time spent queued behind the others)
+ *   handoff  the producer waits for an empty ring before each push, so the
+ *            latency is that of one handoff between the two threads
+ *
+ * usage: spsc_stress [--count N] [--handoff N] [--caps C,C,...] [--cpus P,C]
+ *   --count    elements per stream run (default 20000000)
+ *   --handoff  elements per handoff run (default 1000000, 0 = skip)
+ *   --caps     ring capacities, powers of two (default 2,32,1024; 32 is
+ *              PIPE_RING_CAP)
+ *   --cpus     pin producer and consumer to these CPUs (default 0,1 when
+ *              there are two or more)
+ * Exit status 1 if an element is lost, duplicated, reordered or torn.
+ */
+
+#include <pthread.h>
+#include <sched.h>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+extern "C" {
+#include "spsc.h"
+}
+
+#define LAT_BUCKETS     (1 << 20)   // 1 ns buckets up to ~1 ms; slower ones land in the last
+#define SPIN_BEFORE_YIELD 256       // a single-CPU host needs the other thread to run
+
+struct elem_t {
+    u64 seq;
+    u64 check;                      // seq-derived, catches an element read half-written
+    u64 t_push;
+};
+
+struct run_t {
+    u32  cap;
+    u64  count;
+    bool handoff;
+    int  cpu_prod = -1, cpu_cons = -1;
+
+    spsc_t              ring;
+    std::vector<elem_t> a;
+
+    u64 errors = 0;
+    u64 received = 0;
+    u64 lat_max = 0;
+    std::vector<u64> hist = std::vector<u64>(LAT_BUCKETS);
+};
+
+static u64 now_ns(void)
+{
+    return (u64)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static u64 check_word(u64 seq) { return seq * 0x9E3779B97F4A7C15ull ^ 0xA5A5A5A5A5A5A5A5ull; }
+
+static void pin(int cpu)
+{
+    if (cpu < 0) return;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+}
+
+static void backoff(u32 &spins)
+{
+    if (++spins >= SPIN_BEFORE_YIELD) {
+        spins = 0;
+        sched_yield();
+    }
+}
+
+static void producer(run_t *r)
+{
+    u32 spins = 0;
+
+    pin(r->cpu_prod);
+    for (u64 n = 0; n < r->count; n++) {
+        while (r->handoff ? spsc_space(&r->ring, r->cap) != r->cap : spsc_space(&r->ring, r->cap) == 0)
+            backoff(spins);
+        elem_t *e = &r->a[SPSC_IDX(spsc_wr_pos(&r->ring), r->cap)];
+        e->seq    = n;
+        e->check  = check_word(n);
+        e->t_push = now_ns();
+        spsc_push(&r->ring);
+    }
+}
+
+static void consumer(run_t *r)
+{
+    u32 spins = 0;
+
+    pin(r->cpu_cons);
+    for (u64 n = 0; n < r->count; n++) {
+        while (spsc_count(&r->ring) == 0) backoff(spins);
+        u64 t = now_ns();
+        const elem_t *e = &r->a[SPSC_IDX(spsc_rd_pos(&r->ring), r->cap)];
+        u64 seq = e->seq, check = e->check, t_push = e->t_push;
+        spsc_pop(&r->ring);
+
+        if (seq != n || check != check_word(seq)) {
+            if (r->errors++ < 10)
+                printf("[ERROR] cap %u: element %llu arrived as seq %llu%s\n", r->cap, (unsigned long long)n,
+                       (unsigned long long)seq, check != check_word(seq) ? " (torn)" : "");
+        }
+        u64 lat = t - t_push;
+        if (lat > r->lat_max) r->lat_max = lat;
+        r->hist[lat < LAT_BUCKETS ? lat : LAT_BUCKETS - 1]++;
+        r->received++;
+    }
+}
+
+/* Latency below which pct percent of the elements arrived */
+static u64 percentile(const run_t &r, double pct)
+{
+    u64 want = (u64)(r.received * pct / 100.0), seen = 0;
+    for (u32 i = 0; i < LAT_BUCKETS; i++) {
+        seen += r.hist[i];
+        if (seen > want) return i;
+    }
+    return LAT_BUCKETS - 1;
+}
+
+static bool run(u32 cap, u64 count, bool handoff, int cpu_p, int cpu_c)
+{
+    run_t r;
+    r.cap = cap;
+    r.count = count;
+    r.handoff = handoff;
+    r.cpu_prod = cpu_p;
+    r.cpu_cons = cpu_c;
+    r.a.resize(cap);
+    spsc_reset(&r.ring);
+
+    u64 t0 = now_ns();
+    std::thread c(consumer, &r);
+    std::thread p(producer, &r);
+    p.join();
+    c.join();
+    double secs = (now_ns() - t0) / 1e9;
+
+    u64 p50 = percentile(r, 50), p99 = percentile(r, 99);
+    printf("[RESULT] cap %5u %-7s %10llu elements, %6.1f M/s, latency p50 %s%llu ns, p99 %s%llu ns, max %llu ns\n",
+           cap, handoff ? "handoff" : "stream", (unsigned long long)r.received, r.received / secs / 1e6,
+           p50 == LAT_BUCKETS - 1 ? ">" : "", (unsigned long long)p50,
+           p99 == LAT_BUCKETS - 1 ? ">" : "", (unsigned long long)p99, (unsigned long long)r.lat_max);
+    if (r.errors || r.received != count || spsc_count(&r.ring) != 0) {
+        printf("[FAIL] cap %u: %llu of %llu elements wrong\n", cap, (unsigned long long)r.errors,
+               (unsigned long long)count);
+        return false;
+    }
+    return true;
+}
+
+static void usage(void)
+{
+    fprintf(stderr, "usage: spsc_stress [--count N] [--handoff N] [--caps C,C,...] [--cpus P,C]\n");
+}
+
+int main(int argc, char **argv)
+{
+    u64 count = 20000000, handoff = 1000000;
+    std::vector<u32> caps = { 2, 32, 1024 };
+    int ncpu = (int)std::thread::hardware_concurrency();
+    int cpu_p = ncpu >= 2 ? 0 : -1, cpu_c = ncpu >= 2 ? 1 : -1;
+
+    for (int i = 1; i < argc; i++) {
+        std::string a = argv[i];
+        if (a == "--count" && i + 1 < argc)        count = strtoull(argv[++i], nullptr, 0);
+        else if (a == "--handoff" && i + 1 < argc) handoff = strtoull(argv[++i], nullptr, 0);
+        else if (a == "--caps" && i + 1 < argc) {
+            caps.clear();
+            for (char *s = argv[++i]; *s; ) {
+                u32 c = (u32)strtoul(s, &s, 0);
+                if (c == 0 || (c & (c - 1))) {
+                    usage();
+                    return 2;
+                }
+                caps.push_back(c);
+                if (*s == ',') s++;
+                else if (*s) {
+                    usage();
+                    return 2;
+                }
+            }
+        } else if (a == "--cpus" && i + 1 < argc && sscanf(argv[i + 1], "%d,%d", &cpu_p, &cpu_c) == 2) {
+            i++;
+        } else {
+            usage();
+            return 2;
+        }
+    }
+    if (caps.empty() || count == 0) {
+        usage();
+        return 2;
+    }
+
+    printf("[INFO] %d CPUs, producer on %d, consumer on %d (-1 = not pinned)\n", ncpu, cpu_p, cpu_c);
+    if (ncpu < 2) printf("[INFO] one CPU: both sides take turns, latencies are scheduler time slices\n");
+
+    bool ok = true;
+    for (u32 cap : caps) {
+        ok &= run(cap, count, false, cpu_p, cpu_c);
+        if (handoff) ok &= run(cap, handoff, true, cpu_p, cpu_c);
+    }
+    if (!ok) return 1;
+    printf("[PASS] every element arrived once, in order and whole\n");
+    return 0;
+}
@@ -0,0 +1,958 @@
+/*
+ * stream_client.cpp - native replacement for scripts/ethernet_video.py
+ *
+ * Same session as the Python client: MSG_CONFIG at connect, then every frame
+ * of the input .bin goes out while the upscaled frames come back, and the
+ * results land in <input dir>/recv_out/output_frames.vfc (frame_file.hpp;
+ * --raw-out for the old headerless .bin). Hex, BMP or PNG copies are made
+ * afterwards with frame_convert, not in the receive path. What changes is
+ * the data path:
+ * - the input (.bin, or .vfc with its geometry in the header) is
+ *   memory-mapped; payloads go out with sendfile(), or with
+ *   send(MSG_ZEROCOPY) straight from the mapping (--zerocopy)
+ * - output frames are received directly into the recycled buffers of a
+ *   bounded disk sink (frame_sink.hpp); its writer thread does the disk I/O,
+ *   so a writeback burst never stalls the socket
+ * - TX, RX and the writer are separate threads; the main thread prints one
+ *   live fps/latency line per second instead of one line per frame
+ * - --verify compares every received frame with the bicubic reference model
+ *   run over the input (golden.hpp) and ends with a pass/fail verdict;
+ *   with --no-save nothing is written to disk at all
+ * - output comes back as BGR24: the board strips the IP's constant alpha
+ *   byte before TX, a quarter less on the link. --out-fmt abgr32 asks for
+ *   the IP's ABGR32 as is; --expand receives BGR24 but stores ABGR32
+ *   (alpha 0) for consumers that need the old layout
+ * - --codec in,out[,skip] negotiates the lossless wire codec (vcodec.h) in
+ *   either direction: input frames go out coded whenever that is smaller
+ *   (from a send buffer, not sendfile), output frames are decoded against
+ *   the previous one before they reach the sink. The run ends with the
+ *   ratio and codec time per direction; codec_bench measures the same
+ *   offline
+ * - --udp in,out moves the frame messages of either direction onto the UDP
+ *   transport (udp_link.hpp, MSG_UDP_OPEN); control stays on the TCP
+ *   connection. Sending is paced at --udp-rate Mbit/s, and the run ends
+ *   with the datagram, resend and NACK counts per direction
+ * - --l2 IFACE carries those datagrams in raw Ethernet frames instead, from
+ *   PACKET_MMAP rings on IFACE (l2_sock.hpp; needs a WIRE_L2 board on the
+ *   same segment and CAP_NET_RAW); without --udp both directions move
+ *
+ * usage: stream_client [INPUT.bin|INPUT.vfc [WxH[xS]]] [--ip A] [--port N]
+ *                      [--zerocopy] [--no-crc] [--headerless]
+ *                      [--sink-bufs N] [--rotate N] [--buffered] [--raw-out]
+ *                      [--verify] [--verify-threads N] [--no-save]
+ *                      [--out-fmt bgr24|abgr32] [--expand]
+ *                      [--codec in,out[,skip]] [--udp in,out] [--udp-rate MBPS]
+ *                      [--l2 IFACE]
+ * Without INPUT the file and geometry are prompted for, as in the script.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <linux/errqueue.h>
+#include <sys/mman.h>
+#include <sys/sendfile.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "net_io.hpp"
+#include "frame_sink.hpp"
+#include "golden.hpp"
+#include "l2_sock.hpp"
+#include "udp_link.hpp"
+
+extern "C" {
+#include "vcodec.h"
+}
+
+#ifndef SO_EE_ORIGIN_ZEROCOPY
+#define SO_EE_ORIGIN_ZEROCOPY       5
+#endif
+#ifndef SO_EE_CODE_ZEROCOPY_COPIED
+#define SO_EE_CODE_ZEROCOPY_COPIED  1
+#endif
+
+#define DEFAULT_IN_W    320
+#define DEFAULT_IN_H    180
+#define DEFAULT_SCALE   4
+#define IN_BPP          3
+
+/* -------------------------------------------------------------------------- */
+/* Session state                                                              */
+/* -------------------------------------------------------------------------- */
+struct client_t {
+    /* options */
+    std::string ip = NET_DEFAULT_IP;
+    int  port      = NET_DEFAULT_PORT;
+    bool zerocopy  = false;
+    bool tx_crc    = true;
+    bool framed    = true;      // must match the firmware WIRE_FRAMED
+    u32  sink_bufs = 16;        // output frames held in memory (~59 MB at 720p)
+    u32  rotate    = 0;         // frames per output file, 0 = one file
+    bool direct    = true;
+    bool save      = true;      // write the output file
+    bool raw_out   = false;     // headerless .bin instead of .vfc
+    bool verify    = false;     // golden check against the reference model
+    u32  verify_threads = 0;    // model workers, 0 = auto
+    u8   out_fmt   = PIXFMT_BGR24;  // asked of the board (MSG_CONFIG)
+    bool expand    = false;     // store BGR24 output as ABGR32
+    u16  codec     = 0;         // CFG_CODEC_* asked for; the ACK'd set after connect
+    u8   udp       = 0;         // UDP_DIR_* asked for; the ACK'd set after connect
+    double udp_rate = UDP_LINK_RATE;
+    std::string l2_if;          // --l2: raw Ethernet on this interface
+
+    /* geometry */
+    int  in_w = DEFAULT_IN_W, in_h = DEFAULT_IN_H, scale = DEFAULT_SCALE;
+    u32  in_bytes = 0, out_w = 0, out_h = 0;
+    u32  wire_bpp = 0, wire_bytes = 0;  // output frames on the link
+    u32  out_bpp = 0, out_bytes = 0;    // output frames as stored
+    u32  num_frames = 0;
+
+    int        sock  = -1;
+    int        in_fd = -1;
+    const u8  *map   = nullptr;
+    size_t     map_len = 0;
+    bool       in_vfc = false;
+    vfc_hdr_t  in_hdr = {};
+    const vfc_index_t *in_index = nullptr;
+    std::vector<u64> in_off;    // file offset of every input frame
+    std::string out_dir;
+
+    /* --codec: one reference frame per direction (vcodec.h) */
+    std::vector<u8> enc_ref, enc_buf;   // TX: last input frame, coded frame
+    std::vector<u8> dec_ref, dec_buf;   // RX: last output frame, coded frame
+    bool            dec_have_ref = false;
+
+    udp_link_t          link;           // --udp
+    l2_sock_t           l2;             // --l2, owned by the link once open
+
+    std::atomic<bool> stop{false};
+    std::unique_ptr<std::atomic<int64_t>[]> send_ns;   // by seq, 0 = not sent
+
+    /* counters read by the live line */
+    std::atomic<u32> tx_frames{0};
+    std::atomic<u32> rx_frames{0};
+    std::atomic<u32> crc_errors{0};
+    std::atomic<u64> zc_sends{0}, zc_done{0}, zc_copied{0};
+    u64 tx_coded = 0, tx_coded_bytes = 0, tx_enc_ns = 0;   // owned by TX
+    u64 rx_coded = 0, rx_coded_bytes = 0, rx_dec_ns = 0;   // owned by RX
+
+    /* latency samples (ms): whole run, and the current live window */
+    std::mutex          lat_lock;
+    std::vector<double> lat_all, lat_win;
+
+    frame_sink_t        sink;           // receive buffers and the writer thread
+    golden_t            golden;         // reference model workers (--verify)
+
+    std::mutex          done_lock;
+    std::condition_variable done_cv;
+    bool                rx_finished = false;
+};
+
+static int64_t now_ns(void)
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static void fail(client_t &c, const char *what)
+{
+    if (!c.stop.exchange(true)) {
+        fprintf(stderr, "[ERROR] %s\n", what);
+        shutdown(c.sock, SHUT_RDWR);    // unblock the other thread
+        if (c.udp) udp_link_abort(c.link);
+    }
+    sink_abort(c.sink);
+}
+
+/* -------------------------------------------------------------------------- */
+/* TX                                                                         */
+/* -------------------------------------------------------------------------- */
+/* Collect MSG_ZEROCOPY completions; the kernel reports them as ranges */
+static void zc_reap(client_t &c, bool wait)
+{
+    char ctrl[128];
+
+    while (c.zc_done < c.zc_sends) {
+        struct msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_control    = ctrl;
+        msg.msg_controllen = sizeof(ctrl);
+        if (recvmsg(c.sock, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) < 0) {
+            if (!wait || c.stop || (errno != EAGAIN && errno != EWOULDBLOCK)) return;
+            usleep(100);
+            continue;
+        }
+        for (struct cmsghdr *cm = CMSG_FIRSTHDR(&msg); cm; cm = CMSG_NXTHDR(&msg, cm)) {
+            struct sock_extended_err ee;
+            memcpy(&ee, CMSG_DATA(cm), sizeof(ee));
+            if (ee.ee_origin != SO_EE_ORIGIN_ZEROCOPY) continue;
+            u32 n = ee.ee_data - ee.ee_info + 1;
+            c.zc_done += n;
+            if (ee.ee_code & SO_EE_CODE_ZEROCOPY_COPIED) c.zc_copied += n;
+        }
+    }
+}
+
+static bool send_zerocopy(client_t &c, const u8 *p, size_t len)
+{
+    while (len > 0) {
+        ssize_t n = send(c.sock, p, len, MSG_ZEROCOPY | MSG_NOSIGNAL);
+        if (n < 0 && errno == ENOBUFS) {        // optmem full: completions first
+            zc_reap(c, true);
+            continue;
+        }
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        c.zc_sends++;
+        p += n;
+        len -= (size_t)n;
+    }
+    zc_reap(c, false);
+    return true;
+}
+
+static bool send_file_range(client_t &c, off_t off, size_t len)
+{
+    while (len > 0) {
+        ssize_t n = sendfile(c.sock, c.in_fd, &off, len);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        len -= (size_t)n;
+    }
+    return true;
+}
+
+/*
+ * Code an input frame into c.enc_buf; 0 if it would not be smaller. The
+ * reference follows every frame, coded or not: the board decodes against
+ * whatever its previous ring slot holds.
+ */
+static u32 encode_input(client_t &c, const u8 *frame, u32 seq)
+{
+    int64_t t0 = now_ns();
+    u32 n = vc_encode(frame, c.enc_ref.data(), seq == 0, (u32)c.in_w, (u32)c.in_h, IN_BPP,
+                      VC_LEVEL_FULL, c.enc_buf.data(), nullptr);
+    c.tx_enc_ns += (u64)(now_ns() - t0);
+    return n < c.in_bytes ? n : 0;
+}
+
+static void sender_thread(client_t &c)
+{
+    for (u32 i = 0; i < c.num_frames && !c.stop; i++) {
+        const u8 *frame = c.map + c.in_off[i];
+        u32 coded = (c.codec & CFG_CODEC_IN) ? encode_input(c, frame, i) : 0;
+
+        if (c.framed) {
+            const u8 *payload = coded ? c.enc_buf.data() : frame;
+            frame_hdr_t h = net_make_hdr(MSG_FRAME, i, (u16)c.in_w, (u16)c.in_h,
+                                         PIXFMT_BGR24, IN_BPP, coded ? coded : c.in_bytes);
+            if (coded) h.flags |= FRAME_FLAG_CODED;
+            if (c.tx_crc) {
+                h.flags |= FRAME_FLAG_CRC;
+                h.crc32  = net_crc32(payload, h.length);
+            }
+            c.send_ns[i] = now_ns();
+            if (c.udp & UDP_DIR_IN) {
+                if (!udp_link_send(c.link, h, payload)) break;
+                if (coded) {
+                    c.tx_coded++;
+                    c.tx_coded_bytes += coded;
+                }
+                c.tx_frames++;
+                continue;
+            }
+            if (!net_send_all(c.sock, &h, sizeof(h), MSG_MORE)) break;
+        } else {
+            c.send_ns[i] = now_ns();
+        }
+
+        bool ok;
+        if (coded) {
+            ok = net_send_all(c.sock, c.enc_buf.data(), coded);
+            c.tx_coded++;
+            c.tx_coded_bytes += coded;
+        }
+        else if (c.zerocopy) ok = send_zerocopy(c, frame, c.in_bytes);
+        else                 ok = send_file_range(c, (off_t)c.in_off[i], c.in_bytes);
+        if (!ok) break;
+        c.tx_frames++;
+    }
+
+    if (c.tx_frames != c.num_frames) {
+        fail(c, "[TX] socket closed during send");
+        return;
+    }
+    /* The FIN ends the session: every UDP frame must be in first */
+    if ((c.udp & UDP_DIR_IN) && !udp_link_flush(c.link, NET_TIMEOUT_S)) {
+        fail(c, "[TX] UDP frames never acknowledged");
+        return;
+    }
+    shutdown(c.sock, SHUT_WR);
+    if (c.zerocopy) zc_reap(c, true);
+}
+
+/* -------------------------------------------------------------------------- */
+/* RX + writer                                                                */
+/* -------------------------------------------------------------------------- */
+static void record_latency(client_t &c, u32 seq)
+{
+    if (seq >= c.num_frames) return;
+    int64_t t0 = c.send_ns[seq].load();
+    if (t0 == 0) return;
+
+    double ms = (double)(now_ns() - t0) / 1e6;
+    std::lock_guard<std::mutex> g(c.lat_lock);
+    c.lat_all.push_back(ms);
+    c.lat_win.push_back(ms);
+}
+
+/*
+ * BGR24 at buf + pixels -> ABGR32 at buf, alpha 0. Front to back: pixel i is
+ * read from pixels + 3i before any write reaches it, so no second buffer.
+ */
+static void expand_abgr32(u8 *buf, u32 pixels)
+{
+    const u8 *src = buf + pixels;
+
+    for (u32 i = 0; i < pixels; i++) {
+        u8 b = src[i * 3 + 0], g = src[i * 3 + 1], r = src[i * 3 + 2];
+        buf[i * 4 + 0] = 0;
+        buf[i * 4 + 1] = b;
+        buf[i * 4 + 2] = g;
+        buf[i * 4 + 3] = r;
+    }
+}
+
+/* Payload of the frame just announced: off the socket, or --udp out of the link */
+static bool recv_payload(client_t &c, const u8 *dgram, u8 *dst, u32 len)
+{
+    if (dgram) {
+        memcpy(dst, dgram, len);
+        return true;
+    }
+    return net_recv_all(c.sock, dst, len);
+}
+
+/*
+ * Receive a FRAME_FLAG_CODED payload and decode it into wire (wire_bytes).
+ * Decoding happens in place over the reference, which then is the frame.
+ */
+static bool recv_coded(client_t &c, const frame_hdr_t &h, const u8 *dgram, u8 *wire)
+{
+    if (!recv_payload(c, dgram, c.dec_buf.data(), h.length)) {
+        fail(c, "[RX] socket closed early (or timeout)");
+        return false;
+    }
+    if ((h.flags & FRAME_FLAG_CRC) && net_crc32(c.dec_buf.data(), h.length) != h.crc32) {
+        printf("[ERROR][RX] CRC mismatch on seq %u\n", h.seq);
+        c.crc_errors++;
+    }
+
+    int64_t t0 = now_ns();
+    u8 *ref = c.dec_ref.data();
+    int rc = vc_decode(c.dec_buf.data(), h.length, ref, c.dec_have_ref ? ref : nullptr,
+                       c.out_w, c.out_h, c.wire_bpp);
+    if (rc == 0) memcpy(wire, ref, c.wire_bytes);
+    c.rx_dec_ns += (u64)(now_ns() - t0);
+    if (rc != 0) {
+        char msg[96];
+        snprintf(msg, sizeof(msg), "[RX] Undecodable frame: seq=%u len=%u", h.seq, h.length);
+        fail(c, msg);
+        return false;
+    }
+    c.dec_have_ref = true;
+    c.rx_coded++;
+    c.rx_coded_bytes += h.length;
+    return true;
+}
+
+static void receiver_thread(client_t &c)
+{
+    u32 next_seq = 0;
+
+    for (u32 i = 0; i < c.num_frames && !c.stop; i++) {
+        frame_hdr_t h;
+        bool coded = false;
+        const u8 *dgram = nullptr;      // --udp: the payload, held by the link
+
+        if (c.udp & UDP_DIR_OUT) {
+            dgram = udp_link_recv(c.link, h, NET_TIMEOUT_S);
+            if (!dgram) {
+                fail(c, "[RX] UDP link failed (or timeout)");
+                break;
+            }
+        }
+        if (c.framed) {
+            if (!dgram && !net_recv_all(c.sock, &h, sizeof(h))) {
+                fail(c, "[RX] socket closed early (or timeout)");
+                break;
+            }
+            coded = (h.flags & FRAME_FLAG_CODED) && (c.codec & CFG_CODEC_OUT);
+            bool len_ok = coded ? (h.length >= VC_HDR_BYTES && h.length <= c.dec_buf.size())
+                                : h.length == c.wire_bytes;
+            if (!net_check_hdr(h) || h.type != MSG_FRAME || !len_ok ||
+                h.width != c.out_w || h.height != c.out_h || h.bpp != c.wire_bpp) {
+                char msg[160];
+                snprintf(msg, sizeof(msg), "[RX] Misframed stream: seq=%u %ux%u bpp=%u len=%u",
+                         h.seq, h.width, h.height, h.bpp, h.length);
+                fail(c, msg);
+                break;
+            }
+        }
+
+        /* Only waits if every sink buffer is still queued for the disk */
+        u8 *buf = sink_acquire(c.sink);
+        if (!buf) {
+            fail(c, "[RX] output sink failed");
+            break;
+        }
+        /* --expand: BGR24 lands in the last 3/4 of the buffer, widened in place below */
+        u8 *wire = c.expand ? buf + c.out_w * c.out_h : buf;
+        if (coded) {
+            if (!recv_coded(c, h, dgram, wire)) break;
+        }
+        else if (!recv_payload(c, dgram, wire, c.wire_bytes)) {
+            fail(c, "[RX] socket closed early (or timeout)");
+            break;
+        }
+        else if (c.codec & CFG_CODEC_OUT) {
+            memcpy(c.dec_ref.data(), wire, c.wire_bytes);   // a raw frame still moves the reference
+            c.dec_have_ref = true;
+        }
+
+        u32 seq = i;
+        if (c.framed) {
+            seq = h.seq;
+            if (seq != next_seq)
+                printf("[WARN][RX] seq gap: expected %u, got %u\n", next_seq, seq);
+            next_seq = seq + 1;
+            if (!coded && (h.flags & FRAME_FLAG_CRC) && net_crc32(wire, c.wire_bytes) != h.crc32) {
+                printf("[ERROR][RX] CRC mismatch on seq %u\n", seq);
+                c.crc_errors++;
+            }
+        }
+        if (dgram) udp_link_release(c.link);
+        if (c.expand) expand_abgr32(buf, c.out_w * c.out_h);
+        record_latency(c, seq);
+        c.rx_frames++;
+        sink_commit(c.sink);
+    }
+
+    std::lock_guard<std::mutex> g(c.done_lock);
+    c.rx_finished = true;
+    c.done_cv.notify_all();
+}
+
+/* -------------------------------------------------------------------------- */
+/* Setup and reporting                                                        */
+/* -------------------------------------------------------------------------- */
+static std::string human(double n)
+{
+    static const char *units[] = { "B", "KB", "MB", "GB", "TB" };
+    int i = 0;
+    while (n >= 1024 && i < 4) { n /= 1024; i++; }
+    char s[32];
+    snprintf(s, sizeof(s), "%.1f%s", n, units[i]);
+    return s;
+}
+
+static double percentile(std::vector<double> &v, double p)
+{
+    size_t k = (size_t)(p * (double)(v.size() - 1) + 0.5);
+    std::nth_element(v.begin(), v.begin() + k, v.end());
+    return v[k];
+}
+
+static void usage(void)
+{
+    fprintf(stderr,
+            "usage: stream_client [INPUT.bin|INPUT.vfc [WxH[xS]]] [--ip A] [--port N]\n"
+            "                     [--zerocopy] [--no-crc] [--headerless]\n"
+            "                     [--sink-bufs N] [--rotate N] [--buffered] [--raw-out]\n"
+            "                     [--verify] [--verify-threads N] [--no-save]\n"
+            "                     [--out-fmt bgr24|abgr32] [--expand]\n"
+            "                     [--codec in,out[,skip]] [--udp in,out] [--udp-rate MBPS]\n"
+            "                     [--l2 IFACE]\n");
+}
+
+/* "in", "out", "out,skip", "in,out", ... -> CFG_CODEC_* */
+static bool parse_codec(const std::string &list, u16 &codec)
+{
+    size_t pos = 0;
+
+    codec = 0;
+    while (pos <= list.size()) {
+        size_t comma = list.find(',', pos);
+        std::string w = list.substr(pos, comma == std::string::npos ? std::string::npos : comma - pos);
+        if (w == "in")        codec |= CFG_CODEC_IN;
+        else if (w == "out")  codec |= CFG_CODEC_OUT;
+        else if (w == "skip") codec |= CFG_CODEC_OUT_SKIP;
+        else                  return false;
+        if (comma == std::string::npos) break;
+        pos = comma + 1;
+    }
+    return (codec & CFG_CODEC_OUT_SKIP) == 0 || (codec & CFG_CODEC_OUT);
+}
+
+/* "in", "out", "in,out" -> UDP_DIR_* */
+static bool parse_udp(const std::string &list, u8 &dirs)
+{
+    size_t pos = 0;
+
+    dirs = 0;
+    while (pos <= list.size()) {
+        size_t comma = list.find(',', pos);
+        std::string w = list.substr(pos, comma == std::string::npos ? std::string::npos : comma - pos);
+        if (w == "in")       dirs |= UDP_DIR_IN;
+        else if (w == "out") dirs |= UDP_DIR_OUT;
+        else                 return false;
+        if (comma == std::string::npos) break;
+        pos = comma + 1;
+    }
+    return true;
+}
+
+static bool parse_args(client_t &c, int argc, char **argv, std::string &input, std::string &geom)
+{
+    std::vector<std::string> pos;
+
+    for (int i = 1; i < argc; i++) {
+        std::string a = argv[i];
+        if (a == "--ip" && i + 1 < argc)        c.ip = argv[++i];
+        else if (a == "--port" && i + 1 < argc) c.port = atoi(argv[++i]);
+        else if (a == "--zerocopy")             c.zerocopy = true;
+        else if (a == "--no-crc")               c.tx_crc = false;
+        else if (a == "--headerless")           c.framed = false;
+        else if (a == "--sink-bufs" && i + 1 < argc) c.sink_bufs = (u32)atoi(argv[++i]);
+        else if (a == "--rotate" && i + 1 < argc)    c.rotate = (u32)atoi(argv[++i]);
+        else if (a == "--buffered")             c.direct = false;
+        else if (a == "--verify")               c.verify = true;
+        else if (a == "--verify-threads" && i + 1 < argc) c.verify_threads = (u32)atoi(argv[++i]);
+        else if (a == "--no-save")              c.save = false;
+        else if (a == "--raw-out")              c.raw_out = true;
+        else if (a == "--expand")               c.expand = true;
+        else if (a == "--out-fmt" && i + 1 < argc) {
+            std::string f = argv[++i];
+            if (f == "bgr24")       c.out_fmt = PIXFMT_BGR24;
+            else if (f == "abgr32") c.out_fmt = PIXFMT_ABGR32;
+            else                    return false;
+        }
+        else if (a == "--codec" && i + 1 < argc) {
+            if (!parse_codec(argv[++i], c.codec)) return false;
+        }
+        else if (a == "--udp" && i + 1 < argc) {
+            if (!parse_udp(argv[++i], c.udp)) return false;
+        }
+        else if (a == "--udp-rate" && i + 1 < argc) c.udp_rate = atof(argv[++i]);
+        else if (a == "--l2" && i + 1 < argc)   c.l2_if = argv[++i];
+        else if (a[0] == '-')                   return false;
+        else                                    pos.push_back(a);
+    }
+    if (pos.size() > 2) return false;
+    if (!c.l2_if.empty() && !c.udp) c.udp = UDP_DIR_IN | UDP_DIR_OUT;
+
+    if (pos.empty()) {
+        std::cout << "Input file path: " << std::flush;
+        std::getline(std::cin, input);
+        std::cout << "Input geometry WxH[xScale] [" << DEFAULT_IN_W << "x" << DEFAULT_IN_H
+                  << "x" << DEFAULT_SCALE << "]: " << std::flush;
+        std::getline(std::cin, geom);
+    } else {
+        input = pos[0];
+        if (pos.size() > 1) geom = pos[1];
+    }
+    return true;
+}
+
+/* Map the input; a .vfc also sets the input geometry */
+static bool open_input(client_t &c, const std::string &path)
+{
+    struct stat st;
+
+    c.in_fd = open(path.c_str(), O_RDONLY);
+    if (c.in_fd < 0 || fstat(c.in_fd, &st) != 0 || st.st_size == 0) {
+        printf("[ERROR] File not found: %s\n", path.c_str());
+        return false;
+    }
+    c.map_len = (size_t)st.st_size;
+
+    void *m = mmap(nullptr, c.map_len, PROT_READ, MAP_SHARED, c.in_fd, 0);
+    if (m == MAP_FAILED) {
+        perror("[ERROR] mmap");
+        return false;
+    }
+    madvise(m, c.map_len, MADV_SEQUENTIAL);
+    posix_fadvise(c.in_fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+    c.map = (const u8 *)m;
+
+    if (vfc_probe(c.map, c.map_len)) {
+        if (!vfc_parse(path, c.map, c.map_len, c.in_hdr, c.in_index)) return false;
+        if (c.in_hdr.pixfmt != PIXFMT_BGR24 || c.in_hdr.bpp != IN_BPP) {
+            printf("[ERROR] %s: input frames must be BGR24\n", path.c_str());
+            return false;
+        }
+        c.in_vfc = true;
+        c.in_w = c.in_hdr.width;
+        c.in_h = c.in_hdr.height;
+    }
+
+    size_t slash = path.find_last_of('/');
+    c.out_dir = (slash == std::string::npos ? std::string(".") : path.substr(0, slash)) + "/recv_out";
+    mkdir(c.out_dir.c_str(), 0755);
+    return true;
+}
+
+/* Offset of every input frame, from the .vfc index or the raw layout */
+static bool index_input(client_t &c)
+{
+    if (c.in_vfc) {
+        c.num_frames = c.in_hdr.frames;
+        for (u32 i = 0; i < c.num_frames; i++)
+            c.in_off.push_back(c.in_index[i].offset);
+    } else {
+        if (c.map_len % c.in_bytes != 0) {
+            printf("[ERROR] Invalid file size.\n");
+            return false;
+        }
+        c.num_frames = (u32)(c.map_len / c.in_bytes);
+        for (u32 i = 0; i < c.num_frames; i++)
+            c.in_off.push_back((u64)i * c.in_bytes);
+    }
+    if (c.num_frames == 0) {
+        printf("[ERROR] No frames in the input.\n");
+        return false;
+    }
+    return true;
+}
+
+/* Drop the socket of a link that never opened */
+static void close_udp_fd(client_t &c, int fd)
+{
+    if (c.l2.fd >= 0) l2_close(c.l2);
+    else close(fd);
+}
+
+/* MSG_UDP_OPEN and the link for the directions the board grants */
+static bool open_udp(client_t &c)
+{
+    frame_udp_t u = {};
+    u16 port = 0;
+    int fd;
+
+    if (!c.l2_if.empty()) {
+        if (!l2_open(c.l2, c.l2_if.c_str())) return false;
+        fd = c.l2.fd;
+        memcpy(u.mac, c.l2.mac, sizeof(u.mac));
+    } else if ((fd = udp_link_socket(port)) < 0)
+        return false;
+
+    u.port = port;
+    u.dirs = c.udp | (c.l2.fd >= 0 ? UDP_DIR_L2 : 0);
+    if (!net_udp_open(c.sock, u)) {
+        close_udp_fd(c, fd);
+        return false;
+    }
+    u8 dirs = u.dirs & (UDP_DIR_IN | UDP_DIR_OUT);
+    if (dirs != c.udp)
+        printf("[WARN] Board UDP directions 0x%x, asked for 0x%x\n", dirs, c.udp);
+    c.udp &= dirs;
+    if (!c.udp) {
+        close_udp_fd(c, fd);
+        printf("[INFO] UDP: not granted, frames stay on TCP\n");
+        return true;
+    }
+    if (u.frag_bytes != UDPF_FRAG_BYTES || u.window == 0 || u.window > UDPF_WINDOW ||
+        (c.l2.fd >= 0 && !(u.dirs & UDP_DIR_L2))) {
+        printf("[ERROR] Board UDP fragments %u bytes, window %u%s; this client has %u, %u.\n",
+               u.frag_bytes, u.window, (u.dirs & UDP_DIR_L2) ? ", raw Ethernet" : "",
+               UDPF_FRAG_BYTES, UDPF_WINDOW);
+        close_udp_fd(c, fd);
+        return false;
+    }
+    char via[64];
+    if (c.l2.fd >= 0) {
+        char mac[18];
+        memcpy(c.l2.peer, u.mac, sizeof(c.l2.peer));
+        l2_format_mac(u.mac, mac);
+        snprintf(via, sizeof(via), "raw Ethernet on %s to %s", c.l2_if.c_str(), mac);
+    } else if (!udp_link_connect(fd, c.ip.c_str(), u.port)) {
+        close(fd);
+        return false;
+    } else
+        snprintf(via, sizeof(via), "board port %u", u.port);
+
+    udp_link_opts_t o;
+    o.token     = u.token;
+    o.tx        = (c.udp & UDP_DIR_IN) != 0;
+    o.rx        = (c.udp & UDP_DIR_OUT) != 0;
+    o.tx_max    = std::max<u32>(c.in_bytes, (u32)c.enc_buf.size());
+    o.rx_max    = std::max<u32>(c.wire_bytes, (u32)c.dec_buf.size());
+    o.rate_mbps = c.udp_rate;
+    o.l2        = c.l2.fd >= 0 ? &c.l2 : nullptr;
+    if (!udp_link_open(c.link, fd, o, u.window)) return false;
+    printf("[INFO] UDP: in %s, out %s, %s, %u-frame window, %s\n",
+           o.tx ? "udp" : "tcp", o.rx ? "udp" : "tcp", via, u.window,
+           c.udp_rate > 0 ? (std::to_string((int)c.udp_rate) + " Mbit/s").c_str() : "unpaced");
+    return true;
+}
+
+/* One line per second until RX is done */
+static void live_loop(client_t &c, int64_t t_start)
+{
+    int64_t t_last = t_start;
+    u32 rx_last = 0;
+
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> g(c.done_lock);
+            if (c.done_cv.wait_for(g, std::chrono::seconds(1), [&] { return c.rx_finished; }))
+                return;
+        }
+        int64_t t = now_ns();
+        u32 rx = c.rx_frames;
+        double secs = (double)(t - t_last) / 1e9;
+        double fps = (rx - rx_last) / secs;
+        double gbps = fps * c.wire_bytes * 8 / 1e9;
+
+        std::vector<double> win;
+        {
+            std::lock_guard<std::mutex> g(c.lat_lock);
+            win.swap(c.lat_win);
+        }
+        sink_stats_t ss;
+        sink_get_stats(c.sink, ss);
+        printf("[LIVE] tx %u/%u rx %u/%u  %.1f fps  %.2f Gbps  sink %u/%u",
+               c.tx_frames.load(), c.num_frames, rx, c.num_frames, fps, gbps,
+               ss.queued, c.sink_bufs);
+        if (c.verify) {
+            golden_stats_t gs;
+            golden_get_stats(c.golden, gs);
+            printf("  golden %llu ok %llu bad",
+                   (unsigned long long)(gs.checked - gs.bad_frames),
+                   (unsigned long long)gs.bad_frames);
+        }
+        if (!win.empty()) {
+            double mx = *std::max_element(win.begin(), win.end());
+            printf("  latency p50=%.1fms max=%.1fms", percentile(win, 0.5), mx);
+        }
+        printf("\n");
+        fflush(stdout);
+        t_last = t;
+        rx_last = rx;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    client_t c;
+    std::string input, geom;
+
+    if (!parse_args(c, argc, argv, input, geom)) {
+        usage();
+        return 2;
+    }
+    if (!geom.empty() && !net_parse_geometry(geom.c_str(), c.in_w, c.in_h, c.scale)) {
+        printf("[ERROR] Bad geometry: %s\n", geom.c_str());
+        return 2;
+    }
+    if (!open_input(c, input)) return 1;    // a .vfc overrides WxH
+    if (!c.framed && (c.in_w != DEFAULT_IN_W || c.in_h != DEFAULT_IN_H)) {
+        printf("[ERROR] Geometry can only be changed on the framed protocol.\n");
+        return 2;
+    }
+    if (c.verify && c.scale != GOLDEN_SCALE) {
+        printf("[ERROR] --verify needs scale %d (the reference model is x4).\n", GOLDEN_SCALE);
+        return 2;
+    }
+    if (!c.framed && c.codec) {
+        printf("[ERROR] --codec needs the framed protocol.\n");
+        return 2;
+    }
+    if (!c.framed && c.udp) {
+        printf("[ERROR] --udp needs the framed protocol.\n");
+        return 2;
+    }
+    if (!c.framed) c.out_fmt = PIXFMT_ABGR32;   // boot default, nothing to negotiate with
+    if (c.out_fmt == PIXFMT_ABGR32) c.expand = false;
+    c.in_bytes   = (u32)(c.in_w * c.in_h * IN_BPP);
+    c.out_w      = (u32)(c.in_w * c.scale);
+    c.out_h      = (u32)(c.in_h * c.scale);
+    c.wire_bpp   = (c.out_fmt == PIXFMT_BGR24) ? 3 : 4;
+    c.wire_bytes = c.out_w * c.out_h * c.wire_bpp;
+    c.out_bpp    = c.expand ? 4 : c.wire_bpp;
+    c.out_bytes  = c.out_w * c.out_h * c.out_bpp;
+
+    if (!index_input(c)) return 1;
+    c.send_ns.reset(new std::atomic<int64_t>[c.num_frames]());
+
+    printf("[INFO] Input: %s (%s)\n", input.c_str(), human((double)c.map_len).c_str());
+    printf("[INFO] Geometry: %dx%d BGR24 -> %ux%u %s%s\n", c.in_w, c.in_h, c.out_w, c.out_h,
+           c.wire_bpp == 3 ? "BGR24" : "ABGR32", c.expand ? " (stored as ABGR32)" : "");
+    printf("[INFO] Frames: %u\n", c.num_frames);
+    printf("[INFO] Expect RX: %s\n", human((double)c.num_frames * c.wire_bytes).c_str());
+    printf("[INFO] Connecting to %s:%d ...\n", c.ip.c_str(), c.port);
+
+    c.sock = net_connect(c.ip.c_str(), c.port, (int)c.in_bytes, (int)c.wire_bytes);
+    if (c.sock < 0) return 1;
+    printf("[INFO] Connected.\n");
+
+    if (c.zerocopy) {
+        int one = 1;
+        if (setsockopt(c.sock, SOL_SOCKET, SO_ZEROCOPY, &one, sizeof(one)) != 0) {
+            printf("[WARN] SO_ZEROCOPY not available, using sendfile\n");
+            c.zerocopy = false;
+        }
+    }
+    if (c.framed) {
+        frame_cfg_t cfg = net_upscale_cfg((u16)c.in_w, (u16)c.in_h, (u8)c.scale, c.out_fmt);
+        cfg.codec = c.codec;
+        if (!net_configure(c.sock, cfg)) return 1;
+        printf("[INFO] Board config: %ux%u -> %ux%u, %u bytes/pixel out\n",
+               cfg.in_w, cfg.in_h, cfg.out_w, cfg.out_h, cfg.out_bpp);
+        if (cfg.out_bpp != c.wire_bpp) {
+            printf("[ERROR] Board answered with %u bytes/pixel, asked for %u.\n", cfg.out_bpp, c.wire_bpp);
+            return 1;
+        }
+        if (c.codec) {
+            if (cfg.codec != c.codec)
+                printf("[WARN] Board codec 0x%x, asked for 0x%x\n", cfg.codec, c.codec);
+            c.codec = cfg.codec & c.codec;
+            printf("[INFO] Codec: in %s, out %s\n", (c.codec & CFG_CODEC_IN) ? "coded" : "raw",
+                   (c.codec & CFG_CODEC_OUT_SKIP) ? "coded (skip only)"
+                   : (c.codec & CFG_CODEC_OUT) ? "coded" : "raw");
+        }
+    }
+    if (c.codec & CFG_CODEC_IN) {
+        c.enc_ref.resize(c.in_bytes);
+        c.enc_buf.resize(vc_bound((u32)c.in_w, (u32)c.in_h, IN_BPP));
+    }
+    if (c.codec & CFG_CODEC_OUT) {
+        c.dec_ref.resize(c.wire_bytes);
+        c.dec_buf.resize(vc_bound(c.out_w, c.out_h, c.wire_bpp));
+    }
+    if (c.udp && !open_udp(c)) return 1;
+
+    sink_opts_t so;
+    so.dir          = c.out_dir;
+    so.frame_bytes  = c.out_bytes;
+    so.nbufs        = c.sink_bufs;
+    so.rotate_every = c.rotate;
+    so.direct       = c.direct;
+    so.discard      = !c.save;
+    so.container    = !c.raw_out;
+    so.width        = (u16)c.out_w;
+    so.height       = (u16)c.out_h;
+    so.pixfmt       = (c.out_bpp == 3) ? PIXFMT_BGR24 : PIXFMT_ABGR32;
+    so.bpp          = (u8)c.out_bpp;
+    so.capacity     = c.num_frames;
+    if (c.verify)
+        so.on_frame = [&c](const u8 *frame, u32 idx) { golden_check(c.golden, idx, frame); };
+    if (c.verify) {
+        golden_opts_t go;
+        for (u64 off : c.in_off) go.in.push_back(c.map + off);
+        go.in_w    = (u32)c.in_w;
+        go.in_h    = (u32)c.in_h;
+        go.out_bpp = c.out_bpp;
+        go.threads = c.verify_threads;
+        if (!golden_open(c.golden, go)) return 1;
+        printf("[INFO] Golden check: %s model, %u thread(s), %u frames ahead\n",
+               golden_impl(c.golden), c.golden.o.threads, c.golden.o.depth);
+    }
+    if (!sink_open(c.sink, so)) return 1;
+
+    int64_t t_start = now_ns();
+    std::thread tx(sender_thread, std::ref(c));
+    std::thread rx(receiver_thread, std::ref(c));
+    live_loop(c, t_start);
+    tx.join();
+    rx.join();
+    double secs = (double)(now_ns() - t_start) / 1e9;
+    bool sink_ok = sink_close(c.sink);
+    sink_stats_t ss;
+    sink_get_stats(c.sink, ss);
+    golden_stats_t gs = {};
+    if (c.verify) {
+        golden_get_stats(c.golden, gs);
+        golden_close(c.golden);
+    }
+    if (c.udp) udp_link_close(c.link);
+    close(c.sock);
+
+    u32 got = c.rx_frames;
+    printf("[RX] %u frames in %.2f s: %.1f fps, in %.2f Gbps, out %.2f Gbps\n",
+           got, secs, got / secs, got * (double)c.in_bytes * 8 / secs / 1e9,
+           got * (double)c.wire_bytes * 8 / secs / 1e9);
+    if (!c.lat_all.empty()) {
+        double mn = *std::min_element(c.lat_all.begin(), c.lat_all.end());
+        double mx = *std::max_element(c.lat_all.begin(), c.lat_all.end());
+        printf("[RX] latency ms: min=%.1f p50=%.1f max=%.1f\n", mn, percentile(c.lat_all, 0.5), mx);
+    }
+    printf("[RX] sink: %llu frames in %u file(s)%s, max %u/%u queued, %u RX stalls (%.1f ms)\n",
+           (unsigned long long)ss.frames, ss.files,
+           !c.save ? " (--no-save)" : ss.direct ? " O_DIRECT" : "",
+           ss.queued_max, c.sink_bufs, ss.stalls, ss.stall_ns / 1e6);
+    bool golden_ok = true;
+    if (c.verify) {
+        golden_ok = gs.bad_frames == 0 && gs.checked == c.num_frames;
+        printf("[GOLDEN] model %.2f ms/frame/thread, writer waited %u times (%.1f ms)\n",
+               gs.modelled ? gs.model_ns / 1e6 / (double)gs.modelled : 0.0,
+               gs.waits, gs.wait_ns / 1e6);
+        if (golden_ok)
+            printf("[GOLDEN] PASS: %llu/%u frames bit-exact\n",
+                   (unsigned long long)gs.checked, c.num_frames);
+        else if (gs.bad_frames)
+            printf("[GOLDEN] FAIL: %llu of %llu frames differ (%llu bytes), first at seq %u\n",
+                   (unsigned long long)gs.bad_frames, (unsigned long long)gs.checked,
+                   (unsigned long long)gs.bad_bytes, gs.first_bad);
+        else
+            printf("[GOLDEN] FAIL: only %llu/%u frames checked\n",
+                   (unsigned long long)gs.checked, c.num_frames);
+    }
+    if (c.codec & CFG_CODEC_IN)
+        printf("[CODEC] in: %llu/%u frames coded, ratio %.2f, encode %.2f ms/frame\n",
+               (unsigned long long)c.tx_coded, c.num_frames,
+               c.tx_coded_bytes ? (double)c.tx_coded * c.in_bytes / (double)c.tx_coded_bytes : 0.0,
+               c.tx_frames ? c.tx_enc_ns / 1e6 / c.tx_frames : 0.0);
+    if (c.codec & CFG_CODEC_OUT)
+        printf("[CODEC] out: %llu/%u frames coded, ratio %.2f, decode %.2f ms/frame\n",
+               (unsigned long long)c.rx_coded, got,
+               c.rx_coded_bytes ? (double)c.rx_coded * c.wire_bytes / (double)c.rx_coded_bytes : 0.0,
+               c.rx_coded ? c.rx_dec_ns / 1e6 / c.rx_coded : 0.0);
+    if (c.udp) {
+        udpf_stats_t us_tx, us_rx;
+        udp_link_get_stats(c.link, us_tx, us_rx);
+        if (c.udp & UDP_DIR_IN)
+            printf("[UDP] in: %u frames, %u datagrams, %u resent, %u probes, %u NACK ranges\n",
+                   us_tx.frames, us_tx.datagrams, us_tx.retx, us_tx.probes, us_tx.nacks);
+        if (c.udp & UDP_DIR_OUT)
+            printf("[UDP] out: %u frames, %u datagrams, %u resent, %u duplicates, %u NACK ranges\n",
+                   us_rx.frames, us_rx.datagrams, us_rx.retx, us_rx.dups, us_rx.nacks);
+    }
+    if (c.zerocopy)
+        printf("[TX] zerocopy: %llu sends, %llu fell back to copying\n",
+               (unsigned long long)c.zc_sends.load(), (unsigned long long)c.zc_copied.load());
+
+    if (c.stop || !sink_ok || got != c.num_frames || c.crc_errors || !golden_ok) return 1;
+    printf("[SUCCESS] Stream finished.\n");
+    if (c.save) {
+        printf("[INFO] Output: %s%s\n", sink_path(c.sink, 0).c_str(),
+               c.rotate ? " (and following)" : "");
+        if (!c.raw_out)
+            printf("[INFO] Hex dumps: frame_convert --to hex %s %s%s\n",
+                   c.out_dir.c_str(), sink_path(c.sink, 0).c_str(), c.out_bpp == 3 ? " --abgr" : "");
+    }
+    return 0;
+}
@@ -0,0 +1,325 @@
+/*
+ * udp_link.cpp - frame messages over UDP, host end
+ */
+
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "net_io.hpp"
+#include "l2_sock.hpp"
+#include "udp_link.hpp"
+
+#define LINK_RX_BATCH   256         // datagrams read per service turn
+#define LINK_BURST      64          // datagrams the pacer may send back to back
+#define LINK_WIRE_EXTRA 46          // Ethernet + IP + UDP bytes per datagram
+#define LINK_LINGER_US  (3 * UDPF_RTO_US)
+#define LINK_LINGER_MAX_US 1000000
+
+static u64 now_ns(void)
+{
+    return (u64)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static u32 now_us(void) { return (u32)(now_ns() / 1000); }
+
+static u32 xorshift(u32 &x)
+{
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return x;
+}
+
+int udp_link_socket(u16 &port)
+{
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (fd < 0) {
+        perror("[ERROR] socket");
+        return -1;
+    }
+
+    int sz = UDP_LINK_SOCKBUF;
+    setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &sz, sizeof(sz));
+    setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &sz, sizeof(sz));
+
+    struct sockaddr_in sa;
+    socklen_t len = sizeof(sa);
+    memset(&sa, 0, sizeof(sa));
+    sa.sin_family = AF_INET;
+    if (bind(fd, (struct sockaddr *)&sa, sizeof(sa)) != 0 ||
+        getsockname(fd, (struct sockaddr *)&sa, &len) != 0) {
+        perror("[ERROR] udp bind");
+        close(fd);
+        return -1;
+    }
+    port = ntohs(sa.sin_port);
+    return fd;
+}
+
+bool udp_link_connect(int fd, const char *ip, u16 port)
+{
+    struct sockaddr_in sa;
+
+    memset(&sa, 0, sizeof(sa));
+    sa.sin_family = AF_INET;
+    sa.sin_port   = htons(port);
+    if (inet_pton(AF_INET, ip, &sa.sin_addr) != 1 ||
+        connect(fd, (struct sockaddr *)&sa, sizeof(sa)) != 0) {
+        fprintf(stderr, "[ERROR] udp connect %s:%u: %s\n", ip, port, strerror(errno));
+        return false;
+    }
+    return true;
+}
+
+/* One datagram out; false if the socket is full (try again later) */
+static bool link_put(udp_link_t &l, const void *buf, size_t len)
+{
+    if (l.o.drop_pct > 0 && xorshift(l.rng) % 100000 < (u32)(l.o.drop_pct * 1000)) {
+        l.dropped++;
+        return true;
+    }
+    if (l.o.l2) return l2_send(*l.o.l2, buf, len);
+    if (send(l.fd, buf, len, MSG_DONTWAIT) >= 0) return true;
+    if (errno == EAGAIN || errno == EWOULDBLOCK || errno == ENOBUFS) return false;
+    return true;    // ECONNREFUSED and the like: the peer's timers recover
+}
+
+/* A DATA datagram: header or payload into the frame's window slot */
+static void link_data(udp_link_t &l, const udpf_hdr_t &h, const u8 *body, u32 len)
+{
+    udp_msg_t &m = l.rxq[h.frame % UDPF_WINDOW];
+    u32 off = h.frag ? udpf_frag_off(h.frag) : 0;
+
+    if (h.frag == 0 ? len != FRAME_HDR_BYTES
+                    : len == 0 || len > UDPF_FRAG_BYTES || off + len > l.o.rx_max) {
+        l.rx.st.dropped++;
+        return;
+    }
+    if (udpf_rx_accept(&l.rx, &h, l.rx_released + UDPF_WINDOW) != UDPF_NEW) return;
+    if (h.frag == 0) memcpy(&m.hdr, body, FRAME_HDR_BYTES);
+    else memcpy(m.data.data() + off, body, len);
+
+    while (udpf_rx_ready(&l.rx)) {
+        const frame_hdr_t &fh = l.rxq[l.rx.next % UDPF_WINDOW].hdr;
+        if (fh.magic != FRAME_MAGIC || fh.length > l.o.rx_max ||
+            udpf_nfrags(fh.length) != l.rx.f[l.rx.next % UDPF_WINDOW].nfrags) {
+            fprintf(stderr, "[ERROR] udp: frame %u: bad header (magic %08x, %u bytes)\n",
+                    l.rx.next, fh.magic, fh.length);
+            l.failed = true;
+            return;
+        }
+        udpf_rx_pop(&l.rx);
+        l.cv.notify_all();
+    }
+}
+
+/* One datagram of n bytes (Ethernet padding included); true if it was ours */
+static bool link_dgram(udp_link_t &l, const u8 *buf, u32 n)
+{
+    udpf_hdr_t h;
+
+    if (n < sizeof(h)) return false;
+    memcpy(&h, buf, sizeof(h));
+    if (h.magic != UDPF_MAGIC || h.token != l.o.token || (n = udpf_dgram_len(&h, n)) == 0)
+        return false;
+
+    if (h.type == UDPF_DATA && l.o.rx)
+        link_data(l, h, buf + UDPF_HDR_BYTES, n - UDPF_HDR_BYTES);
+    else if (h.type == UDPF_STATUS && l.o.tx && udpf_tx_status(&l.tx, buf, n, now_us()) == 0)
+        l.cv.notify_all();
+    return true;
+}
+
+/* Read what the socket holds; true if anything arrived */
+static bool link_input(udp_link_t &l, u8 *buf)
+{
+    bool any = false;
+
+    for (int i = 0; i < LINK_RX_BATCH; i++) {
+        if (l.o.l2) {
+            u32 n;
+            const u8 *p = l2_recv(*l.o.l2, n);
+            if (!p) break;
+            any |= link_dgram(l, p, n);
+            l2_recv_done(*l.o.l2);
+            continue;
+        }
+        ssize_t n = recv(l.fd, buf, UDPF_DGRAM_MAX, MSG_DONTWAIT);
+        if (n < 0) break;
+        any |= link_dgram(l, buf, (u32)n);
+    }
+    return any;
+}
+
+/* Paced fragments; returns the ns until the pacer allows more, 0 if idle */
+static u64 link_output(udp_link_t &l, u8 *buf)
+{
+    u64 now = now_ns();
+    double rate = l.o.rate_mbps * 1e6 / 8 / 1e9;    // bytes per ns
+    double full = (double)LINK_BURST * (UDPF_DGRAM_MAX + LINK_WIRE_EXTRA);
+
+    if (rate > 0) {
+        l.tokens += (now - l.last_ns) * rate;
+        if (l.tokens > full) l.tokens = full;
+    }
+    l.last_ns = now;
+
+    for (;;) {
+        if (rate > 0 && l.tokens < UDPF_DGRAM_MAX + LINK_WIRE_EXTRA)
+            return (u64)((UDPF_DGRAM_MAX + LINK_WIRE_EXTRA - l.tokens) / rate) + 1;
+
+        u32 frame;
+        u16 frag;
+        int kind = udpf_tx_next(&l.tx, (u32)(now / 1000), &frame, &frag);
+        if (!kind) return 0;
+
+        const udp_msg_t &m = l.txq[frame % UDPF_WINDOW];
+        u32 len = frag ? udpf_frag_len(m.hdr.length, frag) : FRAME_HDR_BYTES;
+        const void *src = frag ? (const void *)(m.data.data() + udpf_frag_off(frag)) : &m.hdr;
+        udpf_hdr_t h;
+        udpf_make_hdr(&h, l.o.token, frame, udpf_nfrags(m.hdr.length), frag, len, kind == 2);
+        memcpy(buf, &h, sizeof(h));
+        memcpy(buf + UDPF_HDR_BYTES, src, len);
+        if (!link_put(l, buf, UDPF_HDR_BYTES + len)) {
+            udpf_tx_resend(&l.tx, frame, frag, 1);
+            return 50000;       // socket buffer full
+        }
+        l.tokens -= UDPF_HDR_BYTES + len + LINK_WIRE_EXTRA;
+    }
+}
+
+static void link_service(udp_link_t &l)
+{
+    std::vector<u8> in(UDPF_DGRAM_MAX), out(UDPF_DGRAM_MAX);
+    u8 st[UDPF_STATUS_MAX];
+    u64 wait_ns = 0, close_ns = 0;
+
+    l.quiet_ns = now_ns();
+    for (;;) {
+        struct pollfd pfd = { l.fd, POLLIN, 0 };
+        struct timespec ts = { 0, (long)(wait_ns ? wait_ns : 1000000) };
+        if (wait_ns > 1000000) ts.tv_nsec = 1000000;
+        ppoll(&pfd, 1, &ts, nullptr);
+
+        std::lock_guard<std::mutex> g(l.lock);
+        u64 now = now_ns();
+        if (link_input(l, in.data())) l.quiet_ns = now;
+
+        if (l.o.rx) {
+            u32 n;
+            while ((n = udpf_rx_status(&l.rx, l.o.token, l.rx_released + UDPF_WINDOW, (u32)(now / 1000), st)))
+                if (!link_put(l, st, n)) break;
+        }
+        wait_ns = l.o.tx ? link_output(l, out.data()) : 0;
+        if (l.o.l2) l2_kick(*l.o.l2);
+
+        if (l.o.tx && (u64)l.tx.quiet * UDPF_RTO_US >= (u64)NET_TIMEOUT_S * 1000000 && !l.failed) {
+            fprintf(stderr, "[ERROR] udp: no answer from the peer for %d s\n", NET_TIMEOUT_S);
+            l.failed = true;
+        }
+        if (l.failed) l.cv.notify_all();
+
+        /* Closing: keep acknowledging the peer's resends until it goes quiet */
+        if (l.closing) {
+            if (!close_ns) close_ns = now;
+            if (l.failed || (now - l.quiet_ns >= (u64)LINK_LINGER_US * 1000 &&
+                             (!l.o.tx || udpf_tx_idle(&l.tx))) ||
+                now - close_ns >= (u64)LINK_LINGER_MAX_US * 1000)
+                break;
+        }
+    }
+}
+
+bool udp_link_open(udp_link_t &l, int fd, const udp_link_opts_t &o, u32 tx_limit)
+{
+    l.o   = o;
+    l.fd  = fd;
+    l.rng = o.seed ? o.seed : 1;
+    udpf_tx_init(&l.tx, tx_limit);
+    udpf_rx_init(&l.rx);
+    for (int i = 0; i < UDPF_WINDOW; i++) {
+        l.txq[i].data.resize(o.tx ? o.tx_max : 0);
+        l.rxq[i].data.resize(o.rx ? o.rx_max : 0);
+    }
+    l.last_ns = now_ns();
+    l.thr = std::thread(link_service, std::ref(l));
+    return true;
+}
+
+bool udp_link_send(udp_link_t &l, const frame_hdr_t &hdr, const u8 *payload)
+{
+    std::unique_lock<std::mutex> g(l.lock);
+
+    if (hdr.length > l.o.tx_max) return false;
+    l.cv.wait(g, [&] { return l.failed || udpf_tx_can_queue(&l.tx); });
+    if (l.failed) return false;
+
+    /* The service thread leaves slot head alone until it is queued */
+    udp_msg_t &m = l.txq[l.tx.head % UDPF_WINDOW];
+    g.unlock();
+    m.hdr = hdr;
+    memcpy(m.data.data(), payload, hdr.length);
+    g.lock();
+    udpf_tx_queue(&l.tx, hdr.length);
+    return true;
+}
+
+const u8 *udp_link_recv(udp_link_t &l, frame_hdr_t &hdr, int timeout_s)
+{
+    std::unique_lock<std::mutex> g(l.lock);
+
+    if (!l.cv.wait_for(g, std::chrono::seconds(timeout_s),
+                       [&] { return l.failed || l.rx.next != l.rx_taken; }) || l.failed)
+        return nullptr;
+    const udp_msg_t &m = l.rxq[l.rx_taken++ % UDPF_WINDOW];
+    hdr = m.hdr;
+    return m.data.data();
+}
+
+void udp_link_release(udp_link_t &l)
+{
+    std::lock_guard<std::mutex> g(l.lock);
+    l.rx_released++;
+}
+
+bool udp_link_flush(udp_link_t &l, int timeout_s)
+{
+    std::unique_lock<std::mutex> g(l.lock);
+    return l.cv.wait_for(g, std::chrono::seconds(timeout_s),
+                         [&] { return l.failed || udpf_tx_idle(&l.tx); }) && !l.failed;
+}
+
+void udp_link_abort(udp_link_t &l)
+{
+    std::lock_guard<std::mutex> g(l.lock);
+    l.failed = true;
+    l.cv.notify_all();
+}
+
+void udp_link_close(udp_link_t &l)
+{
+    if (l.thr.joinable()) {
+        {
+            std::lock_guard<std::mutex> g(l.lock);
+            l.closing = true;
+        }
+        l.thr.join();
+    }
+    if (l.o.l2) l2_close(*l.o.l2);
+    else if (l.fd >= 0) close(l.fd);
+    l.fd = -1;
+}
+
+void udp_link_get_stats(udp_link_t &l, udpf_stats_t &tx, udpf_stats_t &rx)
+{
+    std::lock_guard<std::mutex> g(l.lock);
+    tx = l.tx.st;
+    rx = l.rx.st;
+}
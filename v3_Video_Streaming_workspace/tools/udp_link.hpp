@@ -0,0 +1,111 @@
+/*
+ * udp_link.hpp - frame messages over UDP, host end (../src/udp_frag.h)
+ *
+ * One connected UDP socket carries both directions: frames this side sends
+ * and frames it receives, each with its own udp_frag.h sender or receiver.
+ * A service thread owns the socket and both engines; the caller only hands
+ * frames in (udp_link_send) and takes assembled frames out (udp_link_recv).
+ * Frames are copied into UDPF_WINDOW buffers per direction, so a sender
+ * blocks only while the peer has the whole window unacknowledged.
+ *
+ * Sending is paced by a token bucket (rate_mbps): loss recovery has no
+ * congestion control, and an unpaced burst overruns the peer's socket
+ * buffer or the EMAC RX ring. drop_pct drops outgoing datagrams on purpose
+ * to exercise the NACK path (tools/udp_loopback).
+ *
+ * With opts.l2 the same datagrams travel in raw Ethernet frames through an
+ * l2_sock.hpp socket instead (the board's WIRE_L2 mode).
+ */
+
+#ifndef UDP_LINK_HPP
+#define UDP_LINK_HPP
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+extern "C" {
+#include "frame_proto.h"
+#include "udp_frag.h"
+}
+
+struct l2_sock_t;
+
+#define UDP_LINK_RATE   900.0   // Mbit/s of datagrams, just under 1 GbE
+#define UDP_LINK_SOCKBUF (8 << 20)
+
+struct udp_link_opts_t {
+    u16    token = 0;           // from MSG_UDP_ACK
+    bool   tx = true, rx = true;    // directions this link carries
+    u32    tx_max = 0;          // largest payload sent / received (buffer size)
+    u32    rx_max = 0;
+    double rate_mbps = UDP_LINK_RATE;   // 0 = unpaced
+    double drop_pct = 0;        // drop this share of outgoing datagrams
+    u32    seed = 1;
+    l2_sock_t *l2 = nullptr;    // raw Ethernet instead of the UDP socket
+};
+
+/* One window slot: a frame message, header and payload */
+struct udp_msg_t {
+    frame_hdr_t     hdr;
+    std::vector<u8> data;
+};
+
+struct udp_link_t {
+    udp_link_opts_t o;
+    int             fd = -1;
+    std::thread     thr;
+    std::mutex      lock;
+    std::condition_variable cv;     // window room, a frame ready, tx drained
+    bool            closing = false;
+    bool            failed = false;
+
+    udpf_tx_t       tx;
+    udpf_rx_t       rx;
+    udp_msg_t       txq[UDPF_WINDOW];   // frame n in [n % UDPF_WINDOW]
+    udp_msg_t       rxq[UDPF_WINDOW];
+    u32             rx_taken = 0;       // frames handed out by udp_link_recv
+    u32             rx_released = 0;
+    u32             rng;
+    u32             dropped = 0;        // by drop_pct
+    double          tokens = 0;         // pacing, bytes
+    u64             last_ns = 0;
+    u64             quiet_ns = 0;       // last datagram from the peer
+};
+
+/*
+ * Take over fd, a UDP socket connect()ed to the peer, or o.l2's socket with
+ * its peer set; the link closes it. tx_limit is the first credit
+ * (frame_udp_t.window).
+ */
+bool udp_link_open(udp_link_t &l, int fd, const udp_link_opts_t &o, u32 tx_limit);
+
+/* Queue a frame message; blocks for window room. False once the link failed */
+bool udp_link_send(udp_link_t &l, const frame_hdr_t &hdr, const u8 *payload);
+
+/*
+ * Next assembled frame in order: header in hdr, payload returned. Valid
+ * until udp_link_release(); nullptr on timeout or a failed link.
+ */
+const u8 *udp_link_recv(udp_link_t &l, frame_hdr_t &hdr, int timeout_s);
+void udp_link_release(udp_link_t &l);
+
+/* Wait until the peer has acknowledged every frame sent */
+bool udp_link_flush(udp_link_t &l, int timeout_s);
+
+/* Fail the link now: blocked and later calls return at once */
+void udp_link_abort(udp_link_t &l);
+
+/* Stop the thread, after answering the peer's resends until it goes quiet */
+void udp_link_close(udp_link_t &l);
+
+void udp_link_get_stats(udp_link_t &l, udpf_stats_t &tx, udpf_stats_t &rx);
+
+/* Bind an ephemeral UDP port on all interfaces; its number in port */
+int  udp_link_socket(u16 &port);
+
+/* Point fd at ip:port (connect) */
+bool udp_link_connect(int fd, const char *ip, u16 port);
+
+#endif /* UDP_LINK_HPP */
@@ -0,0 +1,207 @@
+/*
+ * udp_loopback.cpp - the UDP frame transport against itself, with loss
+ *
+ * Two udp_link.hpp ends on 127.0.0.1 stand in for the client and the
+ * board: the client streams frames, the "board" sends every frame back with
+ * its payload inverted, and the client checks that each one returns once,
+ * in order and bit-exact. Both ends drop a share of their outgoing
+ * datagrams, so fragments, STATUS datagrams and probes all get lost and
+ * the NACK and RTO paths have to recover them.
+ *
+ * --l2 A,B runs the raw Ethernet mode (l2_sock.hpp) instead: the client on
+ * interface A, the board on B, e.g. the two ends of a veth pair (root):
+ *   ip link add l2a type veth peer name l2b
+ *   ip link set l2a up && ip link set l2b up
+ *
+ * usage: udp_loopback [--frames N] [--bytes N] [--loss PCT] [--rate MBPS] [--seed N] [--l2 A,B]
+ *   --frames   frames to stream (default 200)
+ *   --bytes    payload per frame (default 172800, 320x180 BGR24)
+ *   --loss     percent of datagrams each end drops (default 2)
+ *   --rate     pacing per end in Mbit/s (default 900, 0 = unpaced)
+ *   --l2       client and board interfaces for raw Ethernet frames
+ * Exit status 1 if a frame is missing, late, duplicated or corrupt.
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+#include "net_io.hpp"
+#include "l2_sock.hpp"
+#include "udp_link.hpp"
+
+#define LOOP_TOKEN      0x0153
+
+static u64 now_ns(void)
+{
+    return (u64)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/* Payload of frame seq; the checker regenerates it */
+static void fill_frame(u8 *buf, u32 len, u32 seq)
+{
+    u32 x = seq * 2654435761u + 1;
+    for (u32 i = 0; i < len; i++) {
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        buf[i] = (u8)x;
+    }
+}
+
+static void usage(void)
+{
+    fprintf(stderr, "usage: udp_loopback [--frames N] [--bytes N] [--loss PCT] [--rate MBPS] [--seed N] [--l2 A,B]\n");
+}
+
+static void print_stats(const char *who, udp_link_t &l)
+{
+    udpf_stats_t tx, rx;
+    udp_link_get_stats(l, tx, rx);
+    printf("[STATS] %s tx: %u frames, %u dgrams, %u resent, %u probes, %u NACK ranges in; %u dropped on purpose\n",
+           who, tx.frames, tx.datagrams, tx.retx, tx.probes, tx.nacks, l.dropped);
+    printf("[STATS] %s rx: %u frames, %u dgrams, %u resent, %u dups, %u dropped, %u NACK ranges out\n",
+           who, rx.frames, rx.datagrams, rx.retx, rx.dups, rx.dropped, rx.nacks);
+}
+
+int main(int argc, char **argv)
+{
+    u32 frames = 200, bytes = 320 * 180 * 3, seed = 1;
+    double loss = 2.0, rate = UDP_LINK_RATE;
+    std::string l2_if;
+
+    for (int i = 1; i < argc; i++) {
+        std::string a = argv[i];
+        if (a == "--frames" && i + 1 < argc)     frames = (u32)atoi(argv[++i]);
+        else if (a == "--bytes" && i + 1 < argc) bytes = (u32)atoi(argv[++i]);
+        else if (a == "--loss" && i + 1 < argc)  loss = atof(argv[++i]);
+        else if (a == "--rate" && i + 1 < argc)  rate = atof(argv[++i]);
+        else if (a == "--seed" && i + 1 < argc)  seed = (u32)atoi(argv[++i]);
+        else if (a == "--l2" && i + 1 < argc)    l2_if = argv[++i];
+        else                                     { usage(); return 2; }
+    }
+    if (frames == 0 || bytes == 0 || bytes > (UDPF_MAX_FRAGS - 1) * UDPF_FRAG_BYTES ||
+        loss < 0 || loss >= 50 || rate < 0) {
+        usage();
+        return 2;
+    }
+
+    udp_link_opts_t o, ob;
+    l2_sock_t l2_c, l2_b;
+    int fd_c, fd_b;
+    if (l2_if.empty()) {
+        u16 port_c, port_b;
+        fd_c = udp_link_socket(port_c);
+        fd_b = udp_link_socket(port_b);
+        if (fd_c < 0 || fd_b < 0 ||
+            !udp_link_connect(fd_c, "127.0.0.1", port_b) || !udp_link_connect(fd_b, "127.0.0.1", port_c))
+            return 2;
+    } else {
+        size_t comma = l2_if.find(',');
+        if (comma == std::string::npos) {
+            usage();
+            return 2;
+        }
+        if (!l2_open(l2_c, l2_if.substr(0, comma).c_str()) || !l2_open(l2_b, l2_if.substr(comma + 1).c_str()))
+            return 2;
+        memcpy(l2_c.peer, l2_b.mac, 6);
+        memcpy(l2_b.peer, l2_c.mac, 6);
+        fd_c = l2_c.fd;
+        fd_b = l2_b.fd;
+        o.l2 = &l2_c;
+        ob.l2 = &l2_b;
+    }
+
+    o.token     = LOOP_TOKEN;
+    o.tx_max    = o.rx_max = bytes;
+    o.rate_mbps = rate;
+    o.drop_pct  = loss;
+    udp_link_t client, board;
+    o.seed = seed;
+    udp_link_open(client, fd_c, o, UDPF_WINDOW);
+    l2_sock_t *l2 = ob.l2;
+    ob = o;
+    ob.l2 = l2;
+    ob.seed = seed * 7919 + 1;
+    udp_link_open(board, fd_b, ob, UDPF_WINDOW);
+
+    printf("[INFO] %u frames of %u bytes (%u datagrams each) both ways, %.1f%% loss per end, %s, %s\n",
+           frames, bytes, udpf_nfrags(bytes), loss,
+           rate > 0 ? (std::to_string((int)rate) + " Mbit/s").c_str() : "unpaced",
+           l2 ? ("raw Ethernet " + l2_if).c_str() : "UDP on 127.0.0.1");
+
+    /* Board: check each frame, send it back inverted */
+    u32 board_bad = 0;
+    std::thread echo([&] {
+        std::vector<u8> out(bytes);
+        for (u32 n = 0; n < frames; n++) {
+            frame_hdr_t h;
+            const u8 *p = udp_link_recv(board, h, NET_TIMEOUT_S);
+            if (!p) {
+                printf("[ERROR] board: frame %u never arrived\n", n);
+                board_bad++;
+                return;
+            }
+            if (h.seq != n || h.length != bytes || net_crc32(p, bytes) != h.crc32) board_bad++;
+            for (u32 i = 0; i < bytes; i++) out[i] = (u8)~p[i];
+            udp_link_release(board);
+            h.crc32 = net_crc32(out.data(), bytes);
+            if (!udp_link_send(board, h, out.data())) return;
+        }
+        udp_link_flush(board, NET_TIMEOUT_S);
+    });
+
+    /* Client: stream from a second thread, check the echoes here */
+    u64 t0 = now_ns();
+    std::thread sender([&] {
+        std::vector<u8> in(bytes);
+        for (u32 n = 0; n < frames; n++) {
+            fill_frame(in.data(), bytes, n);
+            frame_hdr_t h = net_make_hdr(MSG_FRAME, n, 320, 180, PIXFMT_RAW, 1, bytes);
+            h.flags = FRAME_FLAG_CRC;
+            h.crc32 = net_crc32(in.data(), bytes);
+            if (!udp_link_send(client, h, in.data())) return;
+        }
+    });
+
+    std::vector<u8> want(bytes);
+    u32 got = 0, bad = 0;
+    for (; got < frames; got++) {
+        frame_hdr_t h;
+        const u8 *p = udp_link_recv(client, h, NET_TIMEOUT_S);
+        if (!p) {
+            printf("[ERROR] frame %u never came back\n", got);
+            break;
+        }
+        fill_frame(want.data(), bytes, got);
+        for (u32 i = 0; i < bytes; i++) want[i] = (u8)~want[i];
+        if (h.seq != got || h.length != bytes || memcmp(p, want.data(), bytes) != 0) {
+            if (bad++ < 10) printf("[ERROR] frame %u: got seq %u, %u bytes, %s\n", got, h.seq, h.length,
+                                   h.length == bytes && memcmp(p, want.data(), bytes) ? "corrupt" : "out of place");
+        }
+        udp_link_release(client);
+    }
+    u64 t1 = now_ns();
+
+    sender.join();
+    echo.join();
+    udp_link_close(client);
+    udp_link_close(board);
+
+    double secs = (t1 - t0) / 1e9;
+    printf("[RESULT] %u/%u frames back in %.2f s, %.1f fps, %.0f Mbit/s each way\n",
+           got, frames, secs, got / secs, (double)got * bytes * 8 / secs / 1e6);
+    print_stats("client", client);
+    print_stats("board ", board);
+
+    if (got != frames || bad || board_bad) {
+        printf("[FAIL] %u missing, %u wrong on return, %u wrong at the board\n", frames - got, bad, board_bad);
+        return 1;
+    }
+    printf("[PASS] every frame returned once, in order, bit-exact\n");
+    return 0;
+}